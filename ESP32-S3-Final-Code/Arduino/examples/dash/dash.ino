@@ -5,6 +5,27 @@
 #include <WiFi.h>
 #include "lvgl_port_v8.h"
 #include "waveshare_sd_card.h"
+#include "spectrum_csv.h"
+#include "spectrum_index.h"
+#include "spectrum_cache.h"
+#include "spectrum_store.h"
+#include "spectrum_decimate.h"
+#include "spectrum_pyramid.h"
+#include "spectrum_loader.h"
+#include "spectrum_files.h"
+#include "spectrum_batch.h"
+#include "spectrum_calibration.h"
+#include "spectrum_process.h"
+#include "spectrum_overlay.h"
+#include "spectrum_http.h"
+#include "spectrum_api.h"
+#include "spectrum_events.h"
+#include "spectrum_metrics.h"
+#include "spectrum_ingest.h"
+#include "spectrum_journal.h"
+#include "web_assets.h"
+#include "virtual_list.h"
+#include "screen_manager.h"
 
 #define TP_RST 1
 #define LCD_BL 2
@@ -28,21 +49,130 @@
 const char* ssid = "realme GT 2";
 const char* password = "12345678";
 
-WiFiServer server(80);
+SpectrumHttpServer httpServer;  // Web page on port 80, polled under the LVGL lock, never waiting on a browser
+SpectrumEvents webEvents;       // Pushes the panel's values to every open page through /api/events
 
-lv_obj_t *area_label, *concentration_label, *chart, *slider1, *slider2, *label1, *label2, *file_list;
+lv_obj_t *area_label, *concentration_label, *peak_label, *baseline_dropdown, *chart, *slider1, *slider2, *label1, *label2;
 lv_chart_series_t *series;
-static int lowerLimit = 2100, upperLimit = 2400;
-const int arraySize = 7500;
-int array1[arraySize], array2[arraySize];
+static int lowerLimit = 2100, upperLimit = 2400;  // Integration range, in wavenumbers
+SpectrumStore spectrum;        // Loaded x/y samples, sized from the file and kept in PSRAM
+SpectrumIndex spectrumIndex;  // Trapezoid prefix sums over the loaded spectrum, rebuilt by loadCSV()
+SpectrumDecimator decimator;  // Per-pixel min/max envelopes for the chart, cached per view
+SpectrumPyramid pyramid;      // Min/max blocks over the loaded spectrum, so zoomed-out envelopes do not scan it
+SpectrumProcessor processor;  // Baseline corrected area and peaks of the integration range, over `spectrum`
+// Raw areas unless the dropdown or the calibration file picks a baseline, as the existing m/c calibrations assume
+SpectrumProcessSettings processSettings = {SPECTRUM_BASELINE_NONE, 11, 2, 0.1f};
+
+// Other spectra drawn over the loaded one for comparison, each with its own area readout. They are loaded like the
+// main one and copied into the overlay's pool; the chart draws them on the main one's wavenumber axis.
+SpectrumOverlay overlay;
+lv_chart_series_t *overlaySeries[SPECTRUM_OVERLAY_MAX_SERIES];
+lv_obj_t *overlay_label;
+bool comparing = false;           // The next file picked is loaded as an overlay
+bool loadingOverlay = false;      // The load in progress is one
+String overlayFile;
+const lv_palette_t overlayPalette[SPECTRUM_OVERLAY_MAX_SERIES] = {LV_PALETTE_RED, LV_PALETTE_GREEN, LV_PALETTE_ORANGE,
+                                                                  LV_PALETTE_PURPLE};
+
+// The loader task reads files into these, the UI swaps them with the ones above once a load is complete. A cancelled
+// or failed load leaves the displayed spectrum untouched, and the two arenas are reused in turn.
+SpectrumLoader loader;
+SpectrumStore loadedSpectrum;
+SpectrumIndex loadedIndex;
+SpectrumPyramid loadedPyramid;
+uint32_t loadJob = 0;
+lv_timer_t *loadTimer = NULL;
+lv_obj_t *loadBar, *loadLabel;
+
+// Live scans from the spectrometer on RS485, wired as in the 02_RS485_Test example. The ingest task drains the UART
+// into the ring of `ingest`; ingestTimer decodes it into the displayed spectrum, which grows on the chart as it comes.
+#define RS485_RX_PIN 15
+#define RS485_TX_PIN 16
+#define RS485_BAUD 921600
+#define RS485_RX_BUFFER 4096         // UART driver buffer, ~44 ms of a saturated line while the ingest task is away
+#define RS485 Serial1
+#define INGEST_SAMPLES_PER_TICK 4096 // Decoded per tick at most, so a backlog never holds up a frame for long
+SpectrumIngest ingest;
+lv_timer_t *ingestTimer = NULL;
+
+// Every settled result is kept in an append-only journal on the card (see spectrum_journal.h): batched in RAM, written
+// RESULTS_FLUSH_MS after the first of a batch, and recovered up to the last whole record if the power goes mid-write.
+// Settled means a slider let go, a load or a scan complete, a range posted by the page or a new baseline; the frames
+// of a drag and the ticks of a scan in progress are not results.
+#define RESULTS_JOURNAL_PATH "/sd/results.log"  // The SD library mounts the card at /sd
+#define RESULTS_FLUSH_MS 2000
+struct ResultRecord {
+    uint32_t uptime_ms;
+    int16_t lower, upper;           // Integration range, in wavenumbers
+    float area, concentration;
+    float peak_x, peak_height;      // Tallest peak in the range, NAN if none
+    char source[40];                // File name, or the RS485 scan
+};
+SpectrumJournal resultsJournal;
+lv_timer_t *journalTimer = NULL;
+char loadingPath[SPECTRUM_LOADER_PATH_MAX];
+char resultSource[sizeof(ResultRecord::source)] = "";
+bool resultSettled = false;         // The next values computed are journalled
+
+// Range changes from the sliders and the page only mark the values stale; recomputeTimer brings them up to date at
+// most once per display refresh, so a drag costs one recompute per frame however many events it sends. The counters
+// are in /api/state.
+struct RecomputeStats {
+    uint32_t events;      // Changes requested
+    uint32_t recomputes;  // Recomputes run
+};
+RecomputeStats recomputeStats = {0, 0};
+bool recomputePending = false;
+lv_timer_t *recomputeTimer = NULL;
+
+// Batch analysis of every CSV in the selected file's directory, on one worker per core. The paths point into
+// `csvIndex`, which is not rescanned while a batch runs.
+#define BATCH_SUMMARY_NAME "summary.csv"
+#define BATCH_CALIBRATION_NAME "calibration.csv"
+SpectrumBatch batch;
+SpectrumBatchJob batchJob;
+SpectrumCalibration batchCalibration;   // Copy of `calibration` for the workers
+char batchSummaryPath[256];
+lv_timer_t *batchTimer = NULL;
+lv_obj_t *batchBar, *batchLabel, *batchCancelButton;
+
+// Calibration curve in use, typed on the parameter page or fitted to standards, and kept in /.calibration. Calibrate
+// runs the batch over the directory's standards, whose concentrations come from their file names.
+SpectrumCalibration calibration = SpectrumCalibration::linear(0, 0);
+bool calibrationEdited = false;   // m or c typed since the parameter page was shown
+bool batchCalibrating = false;
+double *standardConcentration = NULL, *standardArea = NULL, *standardResidual = NULL;
+SpectrumCalibration fittedCalibration;
+lv_obj_t *fitLabel, *residualLabel, *useFitButton;
+
+SpectrumFileIndex csvIndex;   // Every CSV on the card, walked once and kept in /.csvindex across reboots
+SpectrumFileFilter csvFilter; // Files of the index matching the selector's type-ahead text
+VirtualList fileList;         // Selector rows, recycled while scrolling through `csvFilter`
+lv_obj_t *file_filter, *file_count_label;
+
+#define CHART_MAX_COLUMNS ESP_PANEL_LCD_WIDTH
+#define CHART_Y_SCALE 1000        // Chart y coordinates span 0..CHART_Y_SCALE, the tick labels show real intensities
+uint16_t chartColumns = 600;      // Pixel columns of the chart, updated once it has been laid out
+float chartYMin = 0, chartYMax = 1;
+#define CHART_MIN_VIEW_SAMPLES 16 // Deepest zoom
+#define CHART_ZOOM_PIXELS 120.0   // Vertical drag distance that halves or doubles the visible range
+double chartViewStart = 0, chartViewLength = 0;  // Visible sample range, the whole spectrum after a load
 String selectedFile;
-float m_value = 0.0, c_value = 0.0;
+
+// The file selector, parameter page and analysis screen are built once and switched between, see screen_manager.h
+#define SCREEN_CYCLE_TEST 0       // Transitions to run through the three at boot, printing their latency and LVGL heap
+ScreenManager screens;
+int fileScreen, parameterScreen, analysisScreen;
 
 ESP_IOExpander_CH422G* expander = new ESP_IOExpander_CH422G((i2c_port_t)I2C_MASTER_NUM, ESP_IO_EXPANDER_I2C_CH422G_ADDRESS, I2C_MASTER_SCL_IO, I2C_MASTER_SDA_IO);
-int tempLowerLimit = 0, tempUpperLimit = 100;
+int tempLowerLimit = 2100, tempUpperLimit = 2400;
 
 void next_button_cb(lv_event_t * e);
-void listCSVFilesRecursively(fs::FS &fs, const char * dirname, std::vector<String> &files, std::vector<String> &fileNames);
+void batch_button_cb(lv_event_t *e);
+void calibrate_button_cb(lv_event_t *e);
+void publishWebState();
+void setBaseline(uint8_t mode);
+static void recomputeTimerCb(lv_timer_t *timer);
 
 void initializeIOExpander(ESP_IOExpander_CH422G *expander) {
     Serial.println("Initializing IO Expander...");
@@ -71,51 +201,247 @@ void initializeIOExpander(ESP_IOExpander_CH422G *expander) {
     Serial.println("IO Expander initialized successfully.");
 }
 
-void loadCSV(fs::FS &fs, const char *path) {
-    String fullPath = String(path);  // Remove the redundant "/"
-    Serial.printf("Opening file: %s\n", fullPath.c_str());
+static bool storeCSVPoint(float x, float y, void *user_data) {
+    return static_cast<SpectrumStore *>(user_data)->push(x, y);
+}
 
-    File file = fs.open(fullPath.c_str());  // Direct path access
-    if (!file || file.isDirectory()) {
-        Serial.println("Failed to open file for reading or file is a directory.");
-        return;
+// A file being read by the loader task, with progress reporting and cancellation between chunks
+struct LoadFile {
+    File *file;
+    SpectrumLoader *loader;
+    uint64_t done;
+    uint64_t total;
+};
+
+static int readFileChunk(void *ctx, uint8_t *buf, size_t len) {
+    LoadFile *load = static_cast<LoadFile *>(ctx);
+    if (load->loader->cancelled()) {
+        return -1;
     }
+    int n = load->file->read(buf, len);
+    if (n > 0) {
+        load->done += n;
+        load->loader->progress(load->done, load->total);
+    }
+    return n;
+}
 
-    int index = 0;
-    while (file.available() && index < arraySize) {
-        String line = file.readStringUntil('\n');
-        line.trim();
+static int readPlainFile(void *ctx, uint8_t *buf, size_t len) {
+    return static_cast<File *>(ctx)->read(buf, len);
+}
+
+static int writeFileChunk(void *ctx, const uint8_t *buf, size_t len) {
+    return static_cast<File *>(ctx)->write(buf, len);
+}
+
+static void buildChartPyramid() {
+    uint32_t start = micros();
+    if (!loadedPyramid.build(loadedSpectrum.x(), loadedSpectrum.y(), loadedSpectrum.size())) {
+        Serial.println("Failed to allocate the chart pyramid, drawing from the samples");
+        loadedPyramid.clear();
+    }
+    Serial.printf("Chart pyramid: %d levels, %u KB in %u us\n", loadedPyramid.levels(),
+                  (unsigned)(loadedPyramid.bytes() / 1024), (uint32_t)(micros() - start));
+}
+
+// Load the sidecar cache if it is fresh for the given source, so the CSV does not need to be parsed again
+static bool loadSpectrumCache(fs::FS &fs, const char *cachePath, uint64_t sourceSize, int64_t sourceMtime,
+                              SpectrumLoader &loader) {
+    File cache = fs.open(cachePath);
+    if (!cache || cache.isDirectory()) {
+        return false;
+    }
 
-        int separatorIndex = line.indexOf(',');
-        if (separatorIndex == -1) {
-            separatorIndex = line.indexOf('\t');
+    uint32_t start = micros();
+    LoadFile load = {&cache, &loader, 0, cache.size()};
+    SpectrumCacheHeader header;
+    bool ok = spectrumCacheReadHeader(readFileChunk, &load, header) &&
+              spectrumCacheIsFresh(header, sourceSize, sourceMtime, cache.size());
+    loadedSpectrum.clear();
+    ok = ok && loadedSpectrum.reserve(header.count) && loadedSpectrum.resize(header.count);
+    SpectrumPrefix *prefix = ok ? loadedIndex.prefixBuffer(header.count) : nullptr;
+    ok = (prefix != nullptr) &&
+         spectrumCacheReadColumns(readFileChunk, &load, header, loadedSpectrum.x(), loadedSpectrum.y(), prefix);
+    cache.close();
+    if (!ok) {
+        if (!loader.cancelled()) {
+            Serial.printf("Sidecar %s is missing or stale, rebuilding\n", cachePath);
         }
+        loadedSpectrum.clear();
+        return false;
+    }
 
-        if (separatorIndex != -1) {
-            String xStr = line.substring(0, separatorIndex);
-            String yStr = line.substring(separatorIndex + 1);
+    loadedIndex.attach(loadedSpectrum.x(), loadedSpectrum.y(), loadedSpectrum.size());
+    buildChartPyramid();
+    Serial.printf("Loaded %d points from sidecar %s in %u us\n", (int)loadedSpectrum.size(), cachePath,
+                  (uint32_t)(micros() - start));
+    return true;
+}
 
-            float x = xStr.toFloat();
-            float y = yStr.toFloat();
+static void saveSpectrumCache(fs::FS &fs, const char *cachePath, uint64_t sourceSize, int64_t sourceMtime) {
+    SpectrumCacheHeader header;
+    spectrumCacheMakeHeader(header, loadedSpectrum.x(), loadedSpectrum.y(), loadedSpectrum.size(), sourceSize,
+                            sourceMtime);
 
-            array1[index] = static_cast<int>(x);
-            array2[index] = static_cast<int>(y);
+    File cache = fs.open(cachePath, FILE_WRITE);
+    if (!cache) {
+        Serial.printf("Failed to create sidecar %s\n", cachePath);
+        return;
+    }
+    bool ok = spectrumCacheWrite(writeFileChunk, &cache, header, loadedSpectrum.x(), loadedSpectrum.y(),
+                                 loadedIndex.prefix());
+    cache.close();
+    if (!ok) {
+        Serial.printf("Failed to write sidecar %s\n", cachePath);
+        fs.remove(cachePath);
+    }
+}
 
-            index++;
-        }
+// Runs on the loader task: reads `path` (or its sidecar) into the `loaded*` objects, never touches LVGL
+bool loadCSV(fs::FS &fs, const char *path, SpectrumLoader &loader) {
+    SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_LOAD);
+    Serial.printf("Opening file: %s\n", path);
+
+    File file = fs.open(path);  // Direct path access
+    if (!file || file.isDirectory()) {
+        Serial.println("Failed to open file for reading or file is a directory.");
+        return false;
+    }
+
+    uint64_t sourceSize = file.size();
+    int64_t sourceMtime = file.getLastWrite();
+    char cachePath[256];
+    bool hasCachePath = spectrumCachePath(path, cachePath, sizeof(cachePath));
+    if (hasCachePath && loadSpectrumCache(fs, cachePath, sourceSize, sourceMtime, loader)) {
+        file.close();
+        return true;
     }
 
-    Serial.printf("Total data points loaded: %d\n", index);
+    // Size the arena from the file up front; it is reused across loads and only grows
+    loadedSpectrum.clear();
+    if (!loadedSpectrum.reserve(SpectrumStore::estimateRows(sourceSize))) {
+        Serial.println("Failed to allocate spectrum storage, loading incrementally");
+    }
+
+    // Parse in place from one reusable chunk buffer, no per-row String allocations
+    static uint8_t chunk[SPECTRUM_CSV_CHUNK_SIZE];
+    LoadFile load = {&file, &loader, 0, sourceSize};
+    SpectrumCsvParser parser(storeCSVPoint, &loadedSpectrum);
+    SpectrumCsvStats stats = {};
+    bool readOk = spectrumCsvParseStream(readFileChunk, &load, chunk, sizeof(chunk), parser, &stats);
     file.close();
+    if (loader.cancelled()) {
+        Serial.printf("Loading %s cancelled after %llu bytes\n", path, load.done);
+        return false;
+    }
+    if (!readOk) {
+        Serial.println("Read error while parsing CSV");
+    }
+    // Out of memory for the samples: show what was read, but never cache it as the whole file
+    bool complete = readOk && !parser.stopped() && (load.done == sourceSize);
+    if (readOk && !complete) {
+        Serial.printf("Out of memory after %llu of %llu bytes, showing a truncated spectrum\n", load.done, sourceSize);
+    }
+
+    Serial.printf("Total data points loaded: %d (%u KB arena in %s)\n", (int)loadedSpectrum.size(),
+                  (unsigned)(loadedSpectrum.bytes() / 1024), loadedSpectrum.inExternalRam() ? "PSRAM" : "SRAM");
+    Serial.printf("Parsed %u rows (%u skipped), %llu bytes in %u us: %.0f rows/s, %.0f bytes/s\n",
+                  stats.rows, stats.skipped, stats.bytes, stats.elapsed_us,
+                  stats.rowsPerSecond(), stats.bytesPerSecond());
+
+    if (!loadedIndex.build(loadedSpectrum.x(), loadedSpectrum.y(), loadedSpectrum.size())) {
+        Serial.println("Failed to allocate the area index");
+        loadedIndex.clear();
+        return false;
+    }
+    buildChartPyramid();
+
+    if (complete && hasCachePath) {
+        saveSpectrumCache(fs, cachePath, sourceSize, sourceMtime);
+    }
+    return true;
 }
 
+static bool loadSpectrumJob(const char *path, SpectrumLoader &loader, void *user_data) {
+    return loadCSV(*static_cast<fs::FS *>(user_data), path, loader);
+}
+
+// Runs on the UI thread once the loader task is done: make the loaded spectrum the displayed one
+void publishLoadedSpectrum() {
+    ingest.reset();  // A scan in progress would now append to the file
+    const char *name = strrchr(loadingPath, '/');
+    snprintf(resultSource, sizeof(resultSource), "%s", (name != NULL) ? name + 1 : loadingPath);
+    resultSettled = true;
+    spectrum.swap(loadedSpectrum);
+    spectrumIndex.swap(loadedIndex);
+    pyramid.swap(loadedPyramid);
+    decimator.setPyramid(&pyramid);
+    if (!processor.attach(spectrum.x(), spectrum.y(), spectrum.size(), &spectrumIndex)) {
+        Serial.println("Not enough memory to smooth the spectrum");
+    }
+    chartViewStart = 0;
+    chartViewLength = spectrum.size();
+    notifySpectrumChanged();
+}
+
+// Tells open pages to fetch the new chart
+void notifySpectrumChanged() {
+    static uint32_t generation = 0;
+    char data[48];
+    snprintf(data, sizeof(data), "{\"generation\":%u,\"points\":%u}", (unsigned)++generation,
+             (unsigned)spectrum.size());
+    webEvents.publish("spectrum", data);
+}
+
+// Runs on the UI thread once the loader task is done with an overlay: copy it into the overlay's pool, leaving the
+// displayed spectrum as it is
+void addLoadedOverlay() {
+    String name = overlayFile.substring(overlayFile.lastIndexOf('/') + 1, overlayFile.length());
+    uint32_t start = micros();
+    if (overlay.add(loadedSpectrum.x(), loadedSpectrum.y(), loadedSpectrum.size(), name.c_str()) < 0) {
+        Serial.printf("Could not overlay %s (%u already, or out of memory)\n", name.c_str(), (unsigned)overlay.count());
+        return;
+    }
+    Serial.printf("Overlaid %s: %u points in %u us, %u series in %u KB\n", name.c_str(),
+                  (unsigned)loadedSpectrum.size(), (uint32_t)(micros() - start), (unsigned)overlay.count(),
+                  (unsigned)(overlay.bytes() / 1024));
+}
+
+// Queues a result for the journal, unless it is the last one again (the same range let go twice, say)
+static void journalResult(float area, float concentration, const SpectrumProcessResult &result) {
+    static ResultRecord last;
+    ResultRecord record = {};
+    record.uptime_ms = millis();
+    record.lower = lowerLimit;
+    record.upper = upperLimit;
+    record.area = area;
+    record.concentration = concentration;
+    record.peak_x = (result.peak_count > 0) ? result.peaks[0].x : NAN;
+    record.peak_height = (result.peak_count > 0) ? result.peaks[0].height : NAN;
+    snprintf(record.source, sizeof(record.source), "%s", resultSource);
+    if ((record.lower == last.lower) && (record.upper == last.upper) && (record.area == last.area) &&
+        (strcmp(record.source, last.source) == 0)) {
+        return;
+    }
+    last = record;
+    if (resultsJournal.mounted() && !resultsJournal.append(&record, sizeof(record))) {
+        Serial.println("Failed to journal the result");
+    }
+}
+
+// Writes the batched results once the first of them has waited RESULTS_FLUSH_MS
+void journal_timer_cb(lv_timer_t *timer) {
+    if (!resultsJournal.poll()) {
+        Serial.println("Failed to write the results journal");
+    }
+}
 
 void update_area_label() {
+    SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_AREA);
     float area = computeAreaUnderCurve();
-    float concentration = computeConcentration(area, m_value, c_value);
+    float concentration = computeConcentration(area);
 
-    Serial.printf("Computed Area: %.2f\n", area);
-    Serial.printf("Computed Concentration: %.2f\n", concentration);
+    Serial.printf("Computed Area: %.2f, Concentration: %.2f\n", area, concentration);
 
     static char areaText[50];
     snprintf(areaText, sizeof(areaText), "Area: %.2f", area);
@@ -125,7 +451,59 @@ void update_area_label() {
     snprintf(concentrationText, sizeof(concentrationText), "Concentration: %.2f", concentration);
     lv_label_set_text(concentration_label, concentrationText);
 
-    lv_refr_now(NULL);
+    // Same range, so this is the result computeAreaUnderCurve() just made
+    const SpectrumProcessResult &result = processor.process(lowerLimit, upperLimit);
+    static char peakText[64];
+    if (result.peak_count == 0) {
+        snprintf(peakText, sizeof(peakText), "No peak");
+    } else if (isfinite(result.peaks[0].fwhm)) {
+        snprintf(peakText, sizeof(peakText), "Peak %.1f cm-1, height %.3f, FWHM %.1f", result.peaks[0].x,
+                 result.peaks[0].height, result.peaks[0].fwhm);
+    } else {
+        snprintf(peakText, sizeof(peakText), "Peak %.1f cm-1, height %.3f", result.peaks[0].x, result.peaks[0].height);
+    }
+    lv_label_set_text(peak_label, peakText);
+    if (resultSettled) {
+        resultSettled = false;
+        journalResult(area, concentration, result);
+    }
+
+    // One line per overlaid spectrum, in the colour of its curve
+    static char overlayText[SPECTRUM_OVERLAY_MAX_SERIES * (SPECTRUM_OVERLAY_NAME_MAX + 48)];
+    int n = 0;
+    overlayText[0] = '\0';
+    for (size_t i = 0; i < overlay.count(); i++) {
+        float overlayArea = overlay.process(i, lowerLimit, upperLimit).area;
+        uint32_t color = lv_color_to32(lv_palette_main(overlayPalette[i])) & 0xFFFFFF;
+        n += snprintf(overlayText + n, sizeof(overlayText) - n, "%s#%06X %s#  Area %.2f, Conc. %.2f",
+                      (i > 0) ? "\n" : "", (unsigned)color, overlay.name(i), overlayArea,
+                      computeConcentration(overlayArea));
+        n = min(n, (int)sizeof(overlayText) - 1);
+    }
+    lv_label_set_text(overlay_label, overlayText);
+
+    // The labels invalidated themselves, the next refresh draws them
+    publishWebState();
+}
+
+// Marks the values stale, recomputeTimerCb() updates them on the next frame
+void requestRecompute() {
+    recomputeStats.events++;
+    recomputePending = true;
+    if (recomputeTimer == NULL) {
+        recomputeTimer = lv_timer_create(recomputeTimerCb, LV_DISP_DEF_REFR_PERIOD, NULL);
+    }
+    lv_timer_resume(recomputeTimer);
+}
+
+static void recomputeTimerCb(lv_timer_t *timer) {
+    if (!recomputePending || (screens.current() != analysisScreen)) {
+        lv_timer_pause(timer);  // Idle until the next change, or until the analysis screen is shown and refreshed
+        return;
+    }
+    recomputePending = false;
+    recomputeStats.recomputes++;
+    update_area_label();
 }
 
 void slider_event_cb(lv_event_t *e) {
@@ -150,87 +528,219 @@ void slider_event_cb(lv_event_t *e) {
     if (tempLowerLimit < tempUpperLimit) {
         lowerLimit = tempLowerLimit;
         upperLimit = tempUpperLimit;
-        update_area_label();
+        requestRecompute();
     }
 }
 
-void update_chart() {
-    static bool chart_updated = false;
+// The range the drag ended on is a result
+void slider_released_cb(lv_event_t *e) {
+    resultSettled = true;
+    requestRecompute();
+}
+
+// Envelope of the visible part of the spectrum at the chart's pixel width, for the panel chart only: /api/spectrum
+// builds its own straight from the pyramid and never goes through the decimator's cache.
+const SpectrumEnvelope *chartEnvelope() {
+    size_t from, to;
+    chartViewSamples(from, to);
+    return decimator.envelope(spectrum.x(), spectrum.y(), from, to, chartColumns);
+}
+
+// Samples [from, to) of the loaded spectrum in view
+void chartViewSamples(size_t &from, size_t &to) {
+    from = (size_t)chartViewStart;
+    to = from + (size_t)chartViewLength;
+    if ((to <= from + 1) || (to > spectrum.size())) {
+        from = 0;
+        to = spectrum.size();
+    }
+}
+
+// One-finger zoom and pan on the chart: drag sideways to pan, drag up/down to zoom in/out around the touch point,
+// long-press without moving to show the whole spectrum again
+void chart_view_event_cb(lv_event_t *e) {
+    static bool moved = false;
+    lv_event_code_t code = lv_event_get_code(e);
+    double count = spectrum.size();
+    if (count < 2) return;
+
+    if (code == LV_EVENT_PRESSED) {
+        moved = false;
+        return;
+    }
+    if (code == LV_EVENT_LONG_PRESSED) {
+        if (!moved) {
+            chartViewStart = 0;
+            chartViewLength = count;
+            update_chart();
+        }
+        return;
+    }
 
-    if (chart_updated) return;
+    lv_indev_t *indev = lv_indev_get_act();
+    lv_point_t vect;
+    lv_indev_get_vect(indev, &vect);
+    if ((vect.x == 0) && (vect.y == 0)) return;
+    moved = true;
+
+    double start = chartViewStart;
+    double length = (chartViewLength > 1) ? chartViewLength : count;
+    if (vect.y != 0) {
+        lv_point_t point;
+        lv_area_t content;
+        lv_indev_get_point(indev, &point);
+        lv_obj_get_content_coords(chart, &content);
+        double anchor = start + (point.x - content.x1) * length / chartColumns;
+        double zoomed = constrain(length * pow(2.0, vect.y / CHART_ZOOM_PIXELS),
+                                  min((double)CHART_MIN_VIEW_SAMPLES, count), count);
+        start = anchor - (anchor - start) * zoomed / length;
+        length = zoomed;
+    }
+    start -= vect.x * length / chartColumns;  // The curve follows the finger
 
-    lowerLimit = 0;
-    upperLimit = arraySize - 1;
+    chartViewLength = length;
+    chartViewStart = constrain(start, 0.0, count - length);
+    update_chart();
+}
 
-    int num_points = upperLimit - lowerLimit;
-    if (num_points <= 0) return;
+void chart_draw_event_cb(lv_event_t *e) {
+    lv_obj_draw_part_dsc_t *dsc = lv_event_get_draw_part_dsc(e);
+    if (!lv_obj_draw_part_check_type(dsc, &lv_chart_class, LV_CHART_DRAW_PART_TICK_LABEL)) return;
 
-    static lv_coord_t data_array[100];
-    num_points = min(num_points, 100);
+    if ((dsc->id == LV_CHART_AXIS_PRIMARY_Y) && (dsc->text != NULL)) {
+        float value = chartYMin + (chartYMax - chartYMin) * dsc->value / CHART_Y_SCALE;
+        snprintf(dsc->text, dsc->text_length, "%.1f", value);
+    }
+}
 
-    for (int i = 0; i < num_points; i++) {
-        int index = lowerLimit + i;
-        if (index < arraySize) {
-            data_array[i] = array2[index];
-        } else {
-            data_array[i] = 0;
+void update_chart() {
+    if (screens.current() != analysisScreen) return;  // Redrawn by its refresh when it is shown again
+    SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_CHART);
+
+    lv_obj_update_layout(chart);
+    lv_coord_t width = lv_obj_get_content_width(chart);
+    chartColumns = constrain(width, 1, CHART_MAX_COLUMNS);
+
+    const SpectrumEnvelope *env = chartEnvelope();
+    if (env == NULL) return;
+
+    // The overlays on the same wavenumbers as the columns, and all curves on one intensity scale
+    static float *overlayColumns = NULL;        // min then max of each series, in PSRAM with the points below
+    static lv_coord_t *overlayPoints = NULL;
+    uint32_t shown = 0;                         // Series with a part in view
+    float yMin = env->y_min, yMax = env->y_max;
+    if ((overlay.count() > 0) && (overlayColumns == NULL)) {
+        overlayColumns = (float *)spectrum_malloc(SPECTRUM_OVERLAY_MAX_SERIES * 2 * CHART_MAX_COLUMNS * sizeof(float));
+        overlayPoints = (lv_coord_t *)spectrum_malloc(SPECTRUM_OVERLAY_MAX_SERIES * 2 * CHART_MAX_COLUMNS *
+                                                      sizeof(lv_coord_t));
+    }
+    if ((overlayColumns != NULL) && (overlayPoints != NULL)) {
+        size_t from, to;
+        chartViewSamples(from, to);
+        for (size_t i = 0; i < overlay.count(); i++) {
+            float *columns = overlayColumns + i * 2 * CHART_MAX_COLUMNS;
+            float lo, hi;
+            bool visible = overlay.envelope(i, spectrum.x()[from], spectrum.x()[to - 1], env->columns, columns,
+                                            columns + CHART_MAX_COLUMNS, lo, hi);
+            lv_chart_hide_series(chart, overlaySeries[i], !visible);
+            if (visible) {
+                yMin = min(yMin, lo);
+                yMax = max(yMax, hi);
+                shown |= 1 << i;
+            }
+        }
+    }
+    for (size_t i = overlay.count(); i < SPECTRUM_OVERLAY_MAX_SERIES; i++) {
+        lv_chart_hide_series(chart, overlaySeries[i], true);
+    }
+
+    // Two points per pixel column (min, then max) draw the envelope as one vertical stroke per column
+    static lv_coord_t data_array[2 * CHART_MAX_COLUMNS];
+    chartYMin = yMin;
+    chartYMax = (yMax > yMin) ? yMax : yMin + 1;
+    float scale = CHART_Y_SCALE / (chartYMax - chartYMin);
+    for (int i = 0; i < env->columns; i++) {
+        data_array[2 * i] = (lv_coord_t)((env->min[i] - chartYMin) * scale);
+        data_array[2 * i + 1] = (lv_coord_t)((env->max[i] - chartYMin) * scale);
+    }
+    for (size_t s = 0; s < overlay.count(); s++) {
+        if (!(shown & (1 << s))) continue;
+        const float *columnMin = overlayColumns + s * 2 * CHART_MAX_COLUMNS;
+        const float *columnMax = columnMin + CHART_MAX_COLUMNS;
+        lv_coord_t *points = overlayPoints + s * 2 * CHART_MAX_COLUMNS;
+        for (int i = 0; i < env->columns; i++) {
+            bool reached = !isnan(columnMin[i]);
+            points[2 * i] = reached ? (lv_coord_t)((columnMin[i] - chartYMin) * scale) : LV_CHART_POINT_NONE;
+            points[2 * i + 1] = reached ? (lv_coord_t)((columnMax[i] - chartYMin) * scale) : LV_CHART_POINT_NONE;
         }
+        lv_chart_set_ext_y_array(chart, overlaySeries[s], points);
     }
 
-    lv_chart_set_point_count(chart, num_points);
+    lv_chart_set_point_count(chart, 2 * env->columns);
     lv_chart_set_ext_y_array(chart, series, data_array);
     lv_chart_refresh(chart);
+}
 
-    chart_updated = true;
+static const char *fileListText(size_t item, void *user_data) {
+    return csvIndex.name(csvFilter.at(item));
 }
 
-void file_select_cb(lv_event_t *e) {
-    lv_obj_t *btn = lv_event_get_target(e);
-    selectedFile = (const char*)lv_list_get_btn_text(file_list, btn);
+static void fileListSelect(size_t item, void *user_data) {
+    if (comparing) {
+        comparing = false;
+        overlayFile = csvIndex.path(csvFilter.at(item));
+        startLoading(overlayFile.c_str(), true);
+        return;
+    }
+    selectedFile = csvIndex.path(csvFilter.at(item));
     Serial.printf("Selected file: %s\n", selectedFile.c_str());
 
-    lv_obj_clean(lv_scr_act());
-    createParameterInputPage();
+    showScreen(parameterScreen);
 }
 
-lv_obj_t *m_input, *c_input, *keyboard;
+// Switches screens and logs what it cost, which should not grow however often it is done
+void showScreen(int id) {
+    screens.show(id);
+    const ScreenManagerStats &stats = screens.stats();
+    Serial.printf("Screen %d in %u us (max %u), %u transitions, LVGL heap %u bytes used (max %u)\n", id,
+                  (unsigned)stats.last_us, (unsigned)stats.max_us, (unsigned)stats.transitions,
+                  (unsigned)stats.lv_used, (unsigned)stats.lv_used_max);
+}
 
-void createParameterInputPage() {
-    lv_obj_clean(lv_scr_act());
+lv_obj_t *m_input, *c_input, *keyboard, *fit_label;
 
-    lv_obj_t *title = lv_label_create(lv_scr_act());
+void buildParameterInputPage(lv_obj_t *screen, void *user_data) {
+    lv_obj_t *title = lv_label_create(screen);
     lv_label_set_text(title, "Enter values for the Equation: y = mx+c:");
     lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 20);
 
-    delay(100);
-
-    m_input = lv_textarea_create(lv_scr_act());
+    m_input = lv_textarea_create(screen);
     lv_textarea_set_placeholder_text(m_input, "Enter m value");
     lv_obj_set_size(m_input, 250, 40);
     lv_obj_align(m_input, LV_ALIGN_CENTER, -150, -50);
     lv_obj_add_event_cb(m_input, keyboard_event_cb, LV_EVENT_FOCUSED, NULL);
+    lv_obj_add_event_cb(m_input, calibration_input_cb, LV_EVENT_VALUE_CHANGED, NULL);
 
-    c_input = lv_textarea_create(lv_scr_act());
+    c_input = lv_textarea_create(screen);
     lv_textarea_set_placeholder_text(c_input, "Enter c value");
     lv_obj_set_size(c_input, 250, 40);
     lv_obj_align(c_input, LV_ALIGN_CENTER, 150, -50);
     lv_obj_add_event_cb(c_input, keyboard_event_cb, LV_EVENT_FOCUSED, NULL);
+    lv_obj_add_event_cb(c_input, calibration_input_cb, LV_EVENT_VALUE_CHANGED, NULL);
 
-    delay(100);
+    fit_label = lv_label_create(screen);
+    lv_obj_align(fit_label, LV_ALIGN_CENTER, 0, -100);
 
-    keyboard = lv_keyboard_create(lv_scr_act());
+    keyboard = lv_keyboard_create(screen);
     lv_keyboard_set_mode(keyboard, LV_KEYBOARD_MODE_NUMBER);
     lv_obj_set_size(keyboard, 350, 150);
     lv_obj_align(keyboard, LV_ALIGN_BOTTOM_MID, 0, -10);
-    lv_keyboard_set_textarea(keyboard, m_input);
 
-    lv_obj_t *next_btn = lv_btn_create(lv_scr_act());
+    lv_obj_t *next_btn = lv_btn_create(screen);
     lv_obj_set_size(next_btn, 150, 50);
     lv_obj_align(next_btn, LV_ALIGN_BOTTOM_MID, 300, -10);
     lv_obj_add_event_cb(next_btn, next_button_cb, LV_EVENT_CLICKED, NULL);
 
-    delay(100);
-
     lv_obj_t *btn_label = lv_label_create(next_btn);
     lv_label_set_text(btn_label, "Next");
     lv_obj_center(btn_label);
@@ -244,6 +754,52 @@ void createParameterInputPage() {
     lv_style_set_text_color(&button_style, lv_color_white());
 
     lv_obj_add_style(next_btn, &button_style, 0);
+
+    lv_obj_t *batch_btn = lv_btn_create(screen);
+    lv_obj_set_size(batch_btn, 150, 50);
+    lv_obj_align(batch_btn, LV_ALIGN_BOTTOM_MID, -300, -10);
+    lv_obj_add_event_cb(batch_btn, batch_button_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *batch_label = lv_label_create(batch_btn);
+    lv_label_set_text(batch_label, "Whole folder");
+    lv_obj_center(batch_label);
+    lv_obj_add_style(batch_btn, &button_style, 0);
+
+    lv_obj_t *calibrate_btn = lv_btn_create(screen);
+    lv_obj_set_size(calibrate_btn, 150, 50);
+    lv_obj_align(calibrate_btn, LV_ALIGN_BOTTOM_MID, -300, -70);
+    lv_obj_add_event_cb(calibrate_btn, calibrate_button_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *calibrate_label = lv_label_create(calibrate_btn);
+    lv_label_set_text(calibrate_label, "Calibrate");
+    lv_obj_center(calibrate_label);
+    lv_obj_add_style(calibrate_btn, &button_style, 0);
+}
+
+// The curve in use: a line fills in m and c, a parabola is shown above them and replaced only if a line is typed
+void refreshParameterInputPage(lv_obj_t *screen, void *user_data) {
+    bool entered = (calibration.coef[0] != 0) || (calibration.coef[1] != 0);
+    bool line = (calibration.model == SPECTRUM_CALIBRATION_LINEAR) && entered;
+    char text[24];
+    snprintf(text, sizeof(text), "%.6g", calibration.coef[1]);
+    lv_textarea_set_text(m_input, line ? text : "");
+    snprintf(text, sizeof(text), "%.6g", calibration.coef[0]);
+    lv_textarea_set_text(c_input, line ? text : "");
+
+    if (calibration.fitted) {
+        static char fitText[160];
+        int n = calibration.format(fitText, sizeof(fitText));
+        snprintf(fitText + n, sizeof(fitText) - n, ", fitted to %u standards, R2 %.5f", (unsigned)calibration.points,
+                 calibration.r2);
+        lv_label_set_text(fit_label, fitText);
+        lv_obj_clear_flag(fit_label, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(fit_label, LV_OBJ_FLAG_HIDDEN);
+    }
+    calibrationEdited = false;  // Setting the text above counts as typing
+    lv_keyboard_set_textarea(keyboard, m_input);
+}
+
+void calibration_input_cb(lv_event_t *e) {
+    calibrationEdited = true;
 }
 
 void keyboard_event_cb(lv_event_t *e) {
@@ -261,99 +817,121 @@ void keyboard_event_cb(lv_event_t *e) {
 
 
 
-void listCSVFilesRecursively(fs::FS &fs, const char *dirname, std::vector<String> &csvFiles, std::vector<String> &csvFileNames) {
-    Serial.printf("Listing CSV files in directory: %s\n", dirname);
-
-    File root = fs.open(dirname);
+static bool listSDDir(void *ctx, const char *path, SpectrumDirVisitCallback visit, void *visit_ctx) {
+    File root = static_cast<fs::FS *>(ctx)->open(path);
     if (!root || !root.isDirectory()) {
-        Serial.println("Failed to open directory");
-        return;
+        Serial.printf("Failed to open directory %s\n", path);
+        return false;
     }
 
     File file = root.openNextFile();
     while (file) {
-        if (file.isDirectory()) {
-            listCSVFilesRecursively(fs, file.path(), csvFiles, csvFileNames);
-        } else {
-            String filePath = file.path();
-            if (filePath.endsWith(".csv")) {
-                Serial.printf("Found CSV file: %s\n", filePath.c_str());
-                csvFiles.push_back(filePath);
-                csvFileNames.push_back(file.name());
-            }
+        SpectrumDirEntry entry = {file.name(), file.isDirectory(), file.size(), (int64_t)file.getLastWrite()};
+        if (!visit(entry, visit_ctx)) {
+            break;
         }
         file = root.openNextFile();
     }
+    return true;
 }
 
-//void createFileSelector() {
-//    lv_obj_t *title = lv_label_create(lv_scr_act());
-//    lv_label_set_text(title, "Please select your CSV file");
-//    lv_obj_set_style_text_font(title, &lv_font_montserrat_26, 0);
-//    lv_obj_set_style_text_color(title, lv_color_hex(0x00CFFF), 0);
-//    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 20);
-//
-//    file_list = lv_list_create(lv_scr_act());
-//    lv_obj_set_size(file_list, 250, 300);
-//    lv_obj_align(file_list, LV_ALIGN_CENTER, 0, 60);
-//
-//    static lv_style_t file_list_style;
-//    lv_style_init(&file_list_style);
-//    lv_style_set_radius(&file_list_style, 12);
-//    lv_style_set_border_width(&file_list_style, 2);
-//    lv_style_set_border_color(&file_list_style, lv_palette_main(LV_PALETTE_CYAN));
-//    lv_style_set_pad_all(&file_list_style, 10);
-//    lv_obj_add_style(file_list, &file_list_style, 0);
-//
-//    std::vector<String> csvFiles;
-//    File root = SD.open("/");
-//    listCSVFilesRecursively(root, csvFiles);
-//
-//    // Now update UI once
-//    lv_disp_trig_activity(NULL);  // Prevent unnecessary redraws
-//
-//    for (const String &path : csvFiles) {
-//        lv_obj_t *btn = lv_list_add_btn(file_list, NULL, path.c_str());
-//        lv_obj_add_event_cb(btn, file_select_cb, LV_EVENT_CLICKED, NULL);
-//    }
-//
-//    lv_obj_invalidate(file_list);  // Force redraw only once
-//}
-
-struct PageData {
-    int *current_page;
-    int total_pages;
-};
+static bool statSDDir(void *ctx, const char *path, int64_t &mtime) {
+    File dir = static_cast<fs::FS *>(ctx)->open(path);
+    if (!dir || !dir.isDirectory()) {
+        return false;
+    }
+    mtime = dir.getLastWrite();
+    return true;
+}
+
+// Bring the CSV index up to date: directories whose mtime is unchanged are not listed again. Not every FAT writer
+// updates directory times when files are added, so `rescan` forgets the index and walks the whole card.
+void refreshCSVIndex(fs::FS &fs, bool rescan) {
+    if (rescan) {
+        csvIndex.clear();
+    } else if (csvIndex.size() == 0) {
+        File saved = fs.open(SPECTRUM_FILE_INDEX_PATH);
+        if (saved && !saved.isDirectory() && !csvIndex.load(readPlainFile, &saved)) {
+            Serial.println("Ignoring invalid " SPECTRUM_FILE_INDEX_PATH);
+        }
+    }
 
-void prev_btn_event_handler(lv_event_t *e) {
-    PageData *data = static_cast<PageData *>(lv_event_get_user_data(e));
-    if (*(data->current_page) > 0) {
-        (*(data->current_page))--;
-        lv_obj_clean(lv_scr_act());
-        createFileSelector();
+    SpectrumFileIndexStats stats;
+    if (!csvIndex.refresh("/", ".csv", listSDDir, statSDDir, &fs, &stats)) {
+        Serial.println("Out of memory while indexing the card, keeping the previous index");
+        return;
+    }
+    Serial.printf("Indexed %u CSV files in %u us (%u directories listed, %u unchanged)\n", stats.files,
+                  stats.elapsed_us, stats.dirs_listed, stats.dirs_reused);
+
+    // Saving changes the root directory's time, so the next refresh lists the root (only) again
+    if (csvIndex.dirty()) {
+        File out = fs.open(SPECTRUM_FILE_INDEX_PATH, FILE_WRITE);
+        if (!out || !csvIndex.save(writeFileChunk, &out)) {
+            Serial.println("Failed to write " SPECTRUM_FILE_INDEX_PATH);
+        }
     }
 }
 
-void next_btn_event_handler(lv_event_t *e) {
-    PageData *data = static_cast<PageData *>(lv_event_get_user_data(e));
-    if (*(data->current_page) < data->total_pages - 1) {
-        (*(data->current_page))++;
-        lv_obj_clean(lv_scr_act());
-        createFileSelector();
+static void loadCalibration(fs::FS &fs) {
+    File saved = fs.open(SPECTRUM_CALIBRATION_PATH);
+    if (saved && !saved.isDirectory()) {
+        if (calibration.load(readPlainFile, &saved)) {
+            setBaseline(calibration.baseline);
+        } else {
+            Serial.println("Ignoring invalid " SPECTRUM_CALIBRATION_PATH);
+        }
     }
 }
 
-void createFileSelector() {
-    lv_obj_t *title = lv_label_create(lv_scr_act());
+static void saveCalibration() {
+    File out = SD.open(SPECTRUM_CALIBRATION_PATH, FILE_WRITE);
+    if (!out || !calibration.save(writeFileChunk, &out)) {
+        Serial.println("Failed to write " SPECTRUM_CALIBRATION_PATH);
+    }
+}
+
+// A typed m and c replace the curve in use, fitted or not, and are kept for the next boot
+static void applyCalibrationInputs() {
+    if (!calibrationEdited) {
+        return;
+    }
+    calibrationEdited = false;
+    calibration = SpectrumCalibration::linear(atof(lv_textarea_get_text(m_input)), atof(lv_textarea_get_text(c_input)));
+    calibration.baseline = processSettings.baseline;
+    saveCalibration();
+}
+
+// Point the list at the current filter matches, e.g. after typing or a rescan
+void updateFileList() {
+    const char *query = (file_filter != NULL) ? lv_textarea_get_text(file_filter) : "";
+    csvFilter.update(csvIndex, query);
+    fileList.setCount(csvFilter.size());
+    lv_label_set_text_fmt(file_count_label, "%u of %u files", (unsigned)csvFilter.size(), (unsigned)csvIndex.size());
+}
+
+void file_filter_event_cb(lv_event_t *e) {
+    updateFileList();
+}
+
+void buildFileSelector(lv_obj_t *screen, void *user_data) {
+    lv_obj_t *title = lv_label_create(screen);
     lv_label_set_text(title, "Please select your CSV file");
     lv_obj_set_style_text_font(title, &lv_font_montserrat_26, 0);
     lv_obj_set_style_text_color(title, lv_color_hex(0x00CFFF), 0);
     lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 20);
 
-    file_list = lv_list_create(lv_scr_act());
-    lv_obj_set_size(file_list, 250, 300);
-    lv_obj_align(file_list, LV_ALIGN_CENTER, 0, 60);
-    lv_obj_clear_flag(file_list, LV_OBJ_FLAG_SCROLLABLE);
+    // Type-ahead filter, each keystroke narrows the list
+    file_filter = lv_textarea_create(screen);
+    lv_textarea_set_one_line(file_filter, true);
+    lv_textarea_set_placeholder_text(file_filter, "Filter by name");
+    lv_obj_set_size(file_filter, 360, 40);
+    lv_obj_align(file_filter, LV_ALIGN_TOP_LEFT, 20, 70);
+    lv_obj_add_event_cb(file_filter, file_filter_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+
+    // Only the visible rows exist, they are rebound while scrolling through any number of files
+    lv_obj_t *list = fileList.create(screen, 360, 330, 40, fileListText, fileListSelect, NULL);
+    lv_obj_align(list, LV_ALIGN_TOP_LEFT, 20, 120);
 
     static lv_style_t file_list_style;
     lv_style_init(&file_list_style);
@@ -361,102 +939,515 @@ void createFileSelector() {
     lv_style_set_border_width(&file_list_style, 2);
     lv_style_set_border_color(&file_list_style, lv_palette_main(LV_PALETTE_CYAN));
     lv_style_set_pad_all(&file_list_style, 10);
-    lv_obj_add_style(file_list, &file_list_style, 0);
+    lv_obj_add_style(list, &file_list_style, 0);
+
+    lv_obj_t *filter_keyboard = lv_keyboard_create(screen);
+    lv_keyboard_set_mode(filter_keyboard, LV_KEYBOARD_MODE_TEXT_LOWER);
+    lv_obj_set_size(filter_keyboard, 380, 220);
+    lv_obj_align(filter_keyboard, LV_ALIGN_BOTTOM_RIGHT, -10, -10);
+    lv_keyboard_set_textarea(filter_keyboard, file_filter);
+
+    file_count_label = lv_label_create(screen);
+    lv_obj_align(file_count_label, LV_ALIGN_TOP_RIGHT, -20, 80);
+
+    lv_obj_t *rescan_btn = lv_btn_create(screen);
+    lv_obj_align(rescan_btn, LV_ALIGN_TOP_RIGHT, -20, 20);
+    lv_obj_t *rescan_label = lv_label_create(rescan_btn);
+    lv_label_set_text(rescan_label, LV_SYMBOL_REFRESH " Rescan");
+    lv_obj_add_event_cb(rescan_btn, rescan_button_cb, LV_EVENT_CLICKED, NULL);
+
+    // Kept with its filter and scroll position between visits, the index only changes through the rescan button
+    updateFileList();
+}
+
+void rescan_button_cb(lv_event_t *e) {
+    if (batch.running()) {
+        return;  // The batch reads paths from the index
+    }
+    refreshCSVIndex(SD, true);
+    updateFileList();  // The rows point into the old index, rebind them before the next redraw
+}
+
+
+// Slider bounds in whole wavenumbers, covering the loaded spectrum. Leaves the arguments alone if nothing is loaded.
+void getWavenumberRange(int &minWavenumber, int &maxWavenumber) {
+    if (spectrumIndex.size() < 2) {
+        return;
+    }
+    minWavenumber = (int)floor(spectrumIndex.minX());
+    maxWavenumber = (int)ceil(spectrumIndex.maxX());
+}
+
+float computeAreaUnderCurve() {
+    // O(log n) with a linear baseline: binary search both wavenumbers, then difference of two interpolated prefix sums
+    // minus the trapezoid under the baseline. The smoothing for the peaks only covers the tiles the range moved into,
+    // and asking again for the same range costs nothing.
+    const SpectrumProcessResult &result = processor.process(lowerLimit, upperLimit);
+#if SPECTRUM_INDEX_VERIFY
+    float expected = spectrumIndex.areaBetweenLinear(lowerLimit, upperLimit);
+    if (fabs(result.raw_area - expected) > 1e-3f * (fabs(expected) + 1.0f)) {
+        Serial.printf("Area mismatch [%d, %d]: index %.4f, loop %.4f\n", lowerLimit, upperLimit, result.raw_area,
+                      expected);
+    }
+#endif
+    return result.area;
+}
+
+// The baseline of the areas, recorded with the calibrations fitted or typed under it
+void setBaseline(uint8_t mode) {
+    processSettings.baseline = mode;
+    processor.configure(processSettings);
+    overlay.configure(processSettings);
+}
 
-    std::vector<String> csvFiles;       // Vector for complete file paths
-    std::vector<String> csvFileNames;   // Vector for file names only
-    File root = SD.open("/");
-    listCSVFilesRecursively(SD, "/", csvFiles, csvFileNames);
+static void baselineDropdownCb(lv_event_t *e) {
+    setBaseline(lv_dropdown_get_selected(lv_event_get_target(e)));
+    resultSettled = true;
+    update_area_label();
+}
 
 
-    // Pagination variables
-    static int current_page = 0;
-    int files_per_page = 5;
-    int total_pages = (csvFileNames.size() + files_per_page - 1) / files_per_page;  // Use csvFileNames for pagination
+void next_button_cb(lv_event_t *e) {
+    applyCalibrationInputs();
 
-    int start_idx = current_page * files_per_page;
-    int end_idx = std::min(start_idx + files_per_page, (int)csvFileNames.size());
+    char curve[96];
+    calibration.format(curve, sizeof(curve));
+    Serial.printf("Calibration: %s\n", curve);
 
-    // Create list buttons with file names from csvFileNames
-    for (int i = start_idx; i < end_idx; i++) {
-        String filename = csvFileNames[i];  // Use file names from csvFileNames vector
-        lv_obj_t *btn = lv_list_add_btn(file_list, NULL, filename.c_str());
+    // Ensure selectedFile stores the full path, not just the filename
+    String fullFilePath = selectedFile;
 
-        // Pass the full path (csvFiles[i]) to the callback to open the correct file
-        lv_obj_add_event_cb(btn, file_select_cb, LV_EVENT_CLICKED, (void *)csvFiles[i].c_str());
+    Serial.printf("Full file path: %s\n", fullFilePath.c_str());
+
+    // Load the CSV file using the full file path, on the loader task
+    startLoading(fullFilePath.c_str(), false);
+}
+
+// Drains the loader's events on the UI thread
+void load_timer_cb(lv_timer_t *timer) {
+    SpectrumLoadEvent event;
+    while (loader.poll(event)) {
+        if (event.job != loadJob) continue;  // Outcome of a superseded load
+
+        lv_bar_set_value(loadBar, event.percent(), LV_ANIM_OFF);
+        if (event.type == SPECTRUM_LOAD_PROGRESS) continue;
+
+        lv_timer_del(loadTimer);
+        loadTimer = NULL;
+        if ((event.type == SPECTRUM_LOAD_DONE) && loadingOverlay) {
+            addLoadedOverlay();
+            showScreen(analysisScreen);
+        } else if (event.type == SPECTRUM_LOAD_DONE) {
+            publishLoadedSpectrum();
+            showScreen(analysisScreen);
+        } else {
+            Serial.println((event.type == SPECTRUM_LOAD_CANCELLED) ? "Loading cancelled" : "Loading failed");
+            showScreen(loadingOverlay ? analysisScreen : fileScreen);
+        }
+        return;
     }
+}
 
-    // Navigation buttons
-    lv_obj_t *prev_btn = lv_btn_create(lv_scr_act());
-    lv_obj_set_size(prev_btn, 50, 50);
-    lv_obj_align(prev_btn, LV_ALIGN_BOTTOM_LEFT, 20, -20);
-    lv_obj_t *prev_label = lv_label_create(prev_btn);
-    lv_label_set_text(prev_label, "<");
-    lv_obj_center(prev_label);
+// Ingest task: hands what the UART driver holds to the ring, never touching the spectrum or LVGL
+static size_t readRS485(void *ctx, uint8_t *buffer, size_t size) {
+    size_t available = RS485.available();
+    return RS485.read(buffer, (available < size) ? available : size);
+}
 
-    lv_obj_t *next_btn = lv_btn_create(lv_scr_act());
-    lv_obj_set_size(next_btn, 50, 50);
-    lv_obj_align(next_btn, LV_ALIGN_BOTTOM_RIGHT, -20, -20);
-    lv_obj_t *next_label = lv_label_create(next_btn);
-    lv_label_set_text(next_label, ">");
-    lv_obj_center(next_label);
+static void ingestTask(void *arg) {
+    for (;;) {
+        if (ingest.receive(readRS485, NULL) == 0) {
+            delay(1);  // ~92 bytes at 921600 baud, well within the driver's buffer
+        }
+    }
+}
 
-    lv_obj_t *page_label = lv_label_create(lv_scr_act());
-    lv_label_set_text_fmt(page_label, "Page %d/%d", current_page + 1, total_pages);
-    lv_obj_align(page_label, LV_ALIGN_BOTTOM_MID, 0, -20);
+// Runs on the UI thread: the index and pyramid are already extended over the new samples, the rest follows them
+void ingest_timer_cb(lv_timer_t *timer) {
+    size_t before = spectrum.size();
+    bool following = (chartViewStart == 0) && (chartViewLength >= before);  // Not zoomed into the scan
+    SpectrumIngestUpdate update = ingest.poll(INGEST_SAMPLES_PER_TICK);
+    if (!update.begun && (update.added == 0) && !update.ended) return;
 
-    // Store page data for navigation
-    static PageData pageData = {&current_page, total_pages};
+    if (update.begun) {
+        Serial.printf("Scan started, %u points announced\n", (unsigned)update.expected);
+        snprintf(resultSource, sizeof(resultSource), "RS485 scan %u", (unsigned)ingest.stats().scans);
+    }
+    // The arrays may have moved if the scan was not announced. Reserving the store's capacity keeps the smoothed copy
+    // from being reallocated as the scan grows.
+    decimator.setPyramid(&pyramid);
+    if (!processor.reserve(spectrum.capacity()) ||
+        !processor.attach(spectrum.x(), spectrum.y(), spectrum.size(), &spectrumIndex)) {
+        Serial.println("Not enough memory to smooth the scan");
+    }
+    if (update.begun || following) {
+        chartViewStart = 0;
+        chartViewLength = spectrum.size();
+    }
 
-    lv_obj_add_event_cb(prev_btn, prev_btn_event_handler, LV_EVENT_CLICKED, &pageData);
-    lv_obj_add_event_cb(next_btn, next_btn_event_handler, LV_EVENT_CLICKED, &pageData);
+    if (update.ended) resultSettled = true;  // The complete scan, journalled when its values are next computed
+    if (update.begun || update.ended) {
+        if (screens.current() == analysisScreen) showScreen(analysisScreen);  // Slider ranges follow the scan
+    } else {
+        requestRecompute();
+        update_chart();
+    }
+    if (update.ended) {
+        SpectrumIngestStats stats = ingest.stats();
+        Serial.printf("Scan complete: %u points; %u frames, %u CRC errors, %u bytes skipped, %u stalls so far\n",
+                      (unsigned)spectrum.size(), (unsigned)stats.frames, (unsigned)stats.crc_errors,
+                      (unsigned)stats.skipped, (unsigned)stats.stalls);
+        notifySpectrumChanged();
+    }
+}
 
-    if (current_page == 0) {
-        lv_obj_add_state(prev_btn, LV_STATE_DISABLED);
+void cancel_load_button_cb(lv_event_t *e) {
+    loader.cancel();
+    lv_label_set_text(loadLabel, "Cancelling...");
+}
+
+// Progress screen shown while the loader task reads `path`
+void startLoading(const char *path, bool asOverlay) {
+    loadingOverlay = asOverlay;
+    lv_obj_t *page = screens.scratch();
+    loadLabel = lv_label_create(page);
+    lv_label_set_text_fmt(loadLabel, "Loading %s", path);
+    lv_obj_align(loadLabel, LV_ALIGN_CENTER, 0, -50);
+
+    loadBar = lv_bar_create(page);
+    lv_obj_set_size(loadBar, 400, 20);
+    lv_bar_set_range(loadBar, 0, 100);
+    lv_obj_align(loadBar, LV_ALIGN_CENTER, 0, 0);
+
+    lv_obj_t *cancel_btn = lv_btn_create(page);
+    lv_obj_align(cancel_btn, LV_ALIGN_CENTER, 0, 60);
+    lv_obj_t *cancel_label = lv_label_create(cancel_btn);
+    lv_label_set_text(cancel_label, "Cancel");
+    lv_obj_add_event_cb(cancel_btn, cancel_load_button_cb, LV_EVENT_CLICKED, NULL);
+
+    loadJob = loader.request(path);
+    snprintf(loadingPath, sizeof(loadingPath), "%s", path);
+    if (loadJob == 0) {
+        Serial.println("Loader is busy, try again");
+        showScreen(fileScreen);
+        return;
     }
-    if (current_page == total_pages - 1) {
-        lv_obj_add_state(next_btn, LV_STATE_DISABLED);
+    if (loadTimer == NULL) {
+        loadTimer = lv_timer_create(load_timer_cb, 50, NULL);
     }
 }
 
 
-float computeAreaUnderCurve() {
-    float area = 0.0;
-    for (int i = lowerLimit; i < upperLimit - 1; i++) {
-        float x1 = array1[i];
-        float x2 = array1[i + 1];
-        float y1 = array2[i];
-        float y2 = array2[i + 1];
+static void *openBatchFile(void *ctx, const char *path) {
+    File file = static_cast<fs::FS *>(ctx)->open(path);
+    if (!file || file.isDirectory()) {
+        return NULL;
+    }
+    return new File(file);
+}
+
+static void closeBatchFile(void *ctx, void *file) {
+    File *open = static_cast<File *>(file);
+    open->close();
+    delete open;
+}
+
+// Runs on the batch workers, with the calibration copied when the batch started
+static float batchConcentration(double area, void *ctx) {
+    return static_cast<const SpectrumCalibration *>(ctx)->concentration(area);
+}
+
+static void freeBatchJob() {
+    spectrum_free((void *)batchJob.paths);
+    spectrum_free(batchJob.results);
+    spectrum_free(standardConcentration);
+    spectrum_free(standardArea);
+    spectrum_free(standardResidual);
+    batchJob = SpectrumBatchJob();
+    standardConcentration = standardArea = standardResidual = NULL;
+}
+
+static void batchBackButtonCb(lv_event_t *e) {
+    showScreen(fileScreen);
+}
+
+static const struct {
+    SpectrumCalibrationModel model;
+    SpectrumCalibrationWeighting weighting;
+} calibrationChoices[] = {
+    {SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_UNWEIGHTED},
+    {SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_INVERSE},
+    {SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_INVERSE_SQUARE},
+    {SPECTRUM_CALIBRATION_QUADRATIC, SPECTRUM_CALIBRATION_UNWEIGHTED},
+    {SPECTRUM_CALIBRATION_QUADRATIC, SPECTRUM_CALIBRATION_INVERSE},
+    {SPECTRUM_CALIBRATION_QUADRATIC, SPECTRUM_CALIBRATION_INVERSE_SQUARE},
+};
+#define CALIBRATION_CHOICES "Linear\nLinear, 1/y\nLinear, 1/y^2\nQuadratic\nQuadratic, 1/y\nQuadratic, 1/y^2"
+
+// Fit the standards with the model picked in the dropdown and show the curve and every residual
+static void refitCalibration(uint16_t choice) {
+    fittedCalibration = SpectrumCalibration();
+    fittedCalibration.lower = min(batchJob.lower, batchJob.upper);
+    fittedCalibration.upper = max(batchJob.lower, batchJob.upper);
+    fittedCalibration.baseline = batchJob.baseline;
+    if (!fittedCalibration.fit(standardArea, standardConcentration, batchJob.count, calibrationChoices[choice].model,
+                               calibrationChoices[choice].weighting, standardResidual)) {
+        lv_label_set_text(fitLabel, "Not enough distinct standards for this model");
+        lv_label_set_text(residualLabel, "");
+        lv_obj_add_state(useFitButton, LV_STATE_DISABLED);
+        return;
+    }
 
-        float dx = fabs(x2 - x1);  // Absolute value
-        area += 0.5 * dx * (y1 + y2);
+    static char fitText[200];
+    int n = fittedCalibration.format(fitText, sizeof(fitText));
+    snprintf(fitText + n, sizeof(fitText) - n, "\nR2 %.6f   s %.4g   largest residual %.4g   %u standards",
+             fittedCalibration.r2, fittedCalibration.std_error, fittedCalibration.max_residual,
+             (unsigned)fittedCalibration.points);
+    lv_label_set_text(fitLabel, fitText);
+    lv_obj_clear_state(useFitButton, LV_STATE_DISABLED);
+
+    static char residualText[6 * 1024];
+    size_t used = 0;
+    for (size_t i = 0; i < batchJob.count; i++) {
+        const char *slash = strrchr(batchJob.paths[i], '/');
+        const char *name = (slash != NULL) ? slash + 1 : batchJob.paths[i];
+        char line[160];
+        if (isnan(standardResidual[i])) {
+            snprintf(line, sizeof(line), "%s: could not be read\n", name);
+        } else {
+            snprintf(line, sizeof(line), "%s: known %.4g, area %.4g, fitted %.4g, residual %+.3g\n", name,
+                     standardConcentration[i], standardArea[i], standardConcentration[i] - standardResidual[i],
+                     standardResidual[i]);
+        }
+        if (used + strlen(line) + 64 > sizeof(residualText)) {
+            snprintf(residualText + used, sizeof(residualText) - used, "... %u more in " BATCH_CALIBRATION_NAME,
+                     (unsigned)(batchJob.count - i));
+            break;
+        }
+        used += snprintf(residualText + used, sizeof(residualText) - used, "%s", line);
     }
-    return area;
+    lv_label_set_text(residualLabel, residualText);
 }
 
+static void calibrationChoiceCb(lv_event_t *e) {
+    refitCalibration(lv_dropdown_get_selected(lv_event_get_target(e)));
+}
 
-void next_button_cb(lv_event_t *e) {
-    m_value = atof(lv_textarea_get_text(m_input));
-    c_value = atof(lv_textarea_get_text(c_input));
+// Makes the fit the curve in use, keeps it for the next boot and the standards' table next to them
+static void useFitButtonCb(lv_event_t *e) {
+    calibration = fittedCalibration;
+    setBaseline(calibration.baseline);
+    saveCalibration();
+    File out = SD.open(batchSummaryPath, FILE_WRITE);
+    if (!out || !spectrumCalibrationWriteStandards(writeFileChunk, &out, calibration, batchJob.paths, standardArea,
+                                                   standardConcentration, batchJob.count)) {
+        Serial.printf("Failed to write %s\n", batchSummaryPath);
+    }
+    out.close();
+    freeBatchJob();
+    showScreen(parameterScreen);
+}
 
-    Serial.printf("Entered m: %.2f, c: %.2f\n", m_value, c_value);
+static void discardFitButtonCb(lv_event_t *e) {
+    freeBatchJob();
+    showScreen(parameterScreen);
+}
 
-    // Ensure selectedFile stores the full path, not just the filename
-    String fullFilePath = selectedFile;
+// Once the areas of the standards are in: the fit screen, starting with an unweighted line
+static void showCalibrationFit() {
+    for (size_t i = 0; i < batchJob.count; i++) {
+        const SpectrumBatchResult &result = batchJob.results[i];
+        standardArea[i] = (result.analysed && result.ok) ? result.area : NAN;
+    }
 
-    Serial.printf("Full file path: %s\n", fullFilePath.c_str());
+    lv_obj_t *page = screens.scratch();
+    lv_obj_t *title = lv_label_create(page);
+    lv_label_set_text_fmt(title, "Calibration from %u standards, range %d - %d", (unsigned)batchJob.count,
+                          (int)min(batchJob.lower, batchJob.upper), (int)max(batchJob.lower, batchJob.upper));
+    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 10);
+
+    lv_obj_t *model = lv_dropdown_create(page);
+    lv_dropdown_set_options_static(model, CALIBRATION_CHOICES);
+    lv_obj_set_width(model, 200);
+    lv_obj_align(model, LV_ALIGN_TOP_LEFT, 20, 45);
+    lv_obj_add_event_cb(model, calibrationChoiceCb, LV_EVENT_VALUE_CHANGED, NULL);
+
+    fitLabel = lv_label_create(page);
+    lv_obj_align(fitLabel, LV_ALIGN_TOP_LEFT, 240, 45);
+
+    lv_obj_t *residuals = lv_obj_create(page);
+    lv_obj_set_size(residuals, 760, 270);
+    lv_obj_align(residuals, LV_ALIGN_TOP_MID, 0, 105);
+    residualLabel = lv_label_create(residuals);
+    lv_obj_set_width(residualLabel, lv_pct(100));
+
+    useFitButton = lv_btn_create(page);
+    lv_obj_set_size(useFitButton, 150, 50);
+    lv_obj_align(useFitButton, LV_ALIGN_BOTTOM_MID, 150, -10);
+    lv_obj_add_event_cb(useFitButton, useFitButtonCb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *use_label = lv_label_create(useFitButton);
+    lv_label_set_text(use_label, "Use");
+    lv_obj_center(use_label);
+
+    lv_obj_t *back_btn = lv_btn_create(page);
+    lv_obj_set_size(back_btn, 150, 50);
+    lv_obj_align(back_btn, LV_ALIGN_BOTTOM_MID, -150, -10);
+    lv_obj_add_event_cb(back_btn, discardFitButtonCb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *back_label = lv_label_create(back_btn);
+    lv_label_set_text(back_label, "Back");
+    lv_obj_center(back_label);
+
+    refitCalibration(0);
+}
 
-    // Load the CSV file using the full file path
-    //loadCSV(SD, fullFilePath.c_str());
-    loadCSV(SD, "/Cu-2-8 mM/Cu-2mM.csv");
-    
-    createUI();
+void cancel_batch_button_cb(lv_event_t *e) {
+    batch.cancel();
+    lv_label_set_text(batchLabel, "Cancelling...");
+}
+
+// Polls the workers from the UI thread; once they are done, writes the summary next to the spectra
+void batch_timer_cb(lv_timer_t *timer) {
+    lv_bar_set_value(batchBar, batch.completed(), LV_ANIM_OFF);
+    if (!batch.finished()) {
+        lv_label_set_text_fmt(batchLabel, "Analysed %u of %u files", (unsigned)batch.completed(),
+                              (unsigned)batchJob.count);
+        return;
+    }
+    lv_timer_del(batchTimer);
+    batchTimer = NULL;
+
+    const SpectrumBatchStats &stats = batch.wait();
+    Serial.printf("Batch: %u files (%u failed), %llu rows, %llu bytes in %u us: %.1f files/s, %.0f bytes/s\n",
+                  (unsigned)stats.files, (unsigned)stats.failed, (unsigned long long)stats.rows,
+                  (unsigned long long)stats.bytes, (unsigned)stats.elapsed_us, stats.filesPerSecond(),
+                  stats.bytesPerSecond());
+    if (batchCalibrating) {
+        showCalibrationFit();
+        return;
+    }
+    File out = SD.open(batchSummaryPath, FILE_WRITE);
+    bool saved = out && spectrumBatchWriteSummary(writeFileChunk, &out, batchJob);
+    out.close();
+    freeBatchJob();
+
+    static char resultText[400];
+    snprintf(resultText, sizeof(resultText), "%u files (%u failed) in %.1f s, %.1f files/s\n%s %s",
+             (unsigned)stats.files, (unsigned)stats.failed, stats.elapsed_us / 1e6, stats.filesPerSecond(),
+             saved ? "Summary written to" : "Could not write", batchSummaryPath);
+    lv_obj_del(batchCancelButton);
+    lv_label_set_text(batchLabel, resultText);
+    lv_obj_t *back_btn = lv_btn_create(lv_scr_act());
+    lv_obj_align(back_btn, LV_ALIGN_CENTER, 0, 60);
+    lv_obj_t *back_label = lv_label_create(back_btn);
+    lv_label_set_text(back_label, "Back to files");
+    lv_obj_add_event_cb(back_btn, batchBackButtonCb, LV_EVENT_CLICKED, NULL);
 }
 
+// Area over the current range, for every CSV next to the selected file: with the concentration from the curve in
+// use, or for calibrating, of the standards whose names give their concentration
+static void startFolderBatch(bool calibrating) {
+    if (batch.running()) {
+        return;
+    }
+    applyCalibrationInputs();
+    batchCalibration = calibration;
+    batchCalibrating = calibrating;
+
+    // Directory of the selected file, with its trailing '/'
+    int slash = selectedFile.lastIndexOf('/');
+    String dir = selectedFile.substring(0, slash + 1);
+    snprintf(batchSummaryPath, sizeof(batchSummaryPath), "%s%s", dir.c_str(),
+             calibrating ? BATCH_CALIBRATION_NAME : BATCH_SUMMARY_NAME);
+
+    size_t count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < csvIndex.size(); i++) {
+            const char *path = csvIndex.path(i);
+            const char *name = csvIndex.name(i);
+            bool inDir = (strncmp(path, dir.c_str(), dir.length()) == 0) && (strchr(path + dir.length(), '/') == NULL);
+            double known = NAN;
+            if (!inDir || (strcmp(name, BATCH_SUMMARY_NAME) == 0) || (strcmp(name, BATCH_CALIBRATION_NAME) == 0) ||
+                    (calibrating && !spectrumConcentrationFromName(name, known))) {
+                continue;
+            }
+            if (pass == 1) {
+                if (calibrating) {
+                    standardConcentration[batchJob.count] = known;
+                }
+                ((const char **)batchJob.paths)[batchJob.count++] = path;
+            } else {
+                count++;
+            }
+        }
+        if ((pass == 0) && (count > 0)) {
+            batchJob.paths = static_cast<const char **>(spectrum_malloc(count * sizeof(const char *)));
+            batchJob.results = static_cast<SpectrumBatchResult *>(spectrum_malloc(count * sizeof(SpectrumBatchResult)));
+            bool ok = (batchJob.paths != NULL) && (batchJob.results != NULL);
+            if (calibrating) {
+                standardConcentration = static_cast<double *>(spectrum_malloc(count * sizeof(double)));
+                standardArea = static_cast<double *>(spectrum_malloc(count * sizeof(double)));
+                standardResidual = static_cast<double *>(spectrum_malloc(count * sizeof(double)));
+                ok = ok && (standardConcentration != NULL) && (standardArea != NULL) && (standardResidual != NULL);
+            }
+            if (!ok) {
+                freeBatchJob();
+                count = 0;
+            }
+        }
+        if (count == 0) {
+            Serial.printf(calibrating ? "No standards (CSV files named with a concentration) in %s\n"
+                                      : "No CSV files to analyse in %s\n", dir.c_str());
+            return;
+        }
+    }
+
+    batchJob.lower = lowerLimit;
+    batchJob.upper = upperLimit;
+    batchJob.baseline = processSettings.baseline;
+    batchJob.concentration = calibrating ? NULL : batchConcentration;
+    batchJob.concentration_ctx = &batchCalibration;
+    batchJob.open = openBatchFile;
+    batchJob.read = readPlainFile;
+    batchJob.close = closeBatchFile;
+    batchJob.io_ctx = &SD;
+    if (!batch.start(batchJob)) {
+        Serial.println("Failed to start the batch workers");
+        freeBatchJob();
+        return;
+    }
+
+    lv_obj_t *page = screens.scratch();
+    batchLabel = lv_label_create(page);
+    lv_obj_set_style_text_align(batchLabel, LV_TEXT_ALIGN_CENTER, 0);
+    lv_label_set_text_fmt(batchLabel, calibrating ? "Measuring %u standards in %s" : "Analysing %u files in %s",
+                          (unsigned)batchJob.count, dir.c_str());
+    lv_obj_align(batchLabel, LV_ALIGN_CENTER, 0, -50);
+
+    batchBar = lv_bar_create(page);
+    lv_obj_set_size(batchBar, 400, 20);
+    lv_bar_set_range(batchBar, 0, batchJob.count);
+    lv_obj_align(batchBar, LV_ALIGN_CENTER, 0, 0);
+
+    batchCancelButton = lv_btn_create(page);
+    lv_obj_align(batchCancelButton, LV_ALIGN_CENTER, 0, 60);
+    lv_obj_t *cancel_label = lv_label_create(batchCancelButton);
+    lv_label_set_text(cancel_label, "Cancel");
+    lv_obj_add_event_cb(batchCancelButton, cancel_batch_button_cb, LV_EVENT_CLICKED, NULL);
+
+    batchTimer = lv_timer_create(batch_timer_cb, 100, NULL);
+}
+
+void batch_button_cb(lv_event_t *e) {
+    startFolderBatch(false);
+}
+
+void calibrate_button_cb(lv_event_t *e) {
+    startFolderBatch(true);
+}
 
 
-float computeConcentration(float area, float m, float c) {
-    return m * area + c;
+float computeConcentration(float area) {
+    return calibration.concentration(area);
 }
 
 void update_button_cb(lv_event_t *e) {
@@ -464,33 +1455,57 @@ void update_button_cb(lv_event_t *e) {
 }
 
 void file_selector_button_cb(lv_event_t *e) {
-    lv_obj_clean(lv_scr_act());
-    createFileSelector();
+    comparing = false;
+    showScreen(fileScreen);
 }
 
-void createUI() {
-    Serial.println("Creating UI...");
-    lv_obj_clean(lv_scr_act());
+// The next file picked in the selector is drawn over this spectrum
+void compare_button_cb(lv_event_t *e) {
+    if (overlay.count() >= SPECTRUM_OVERLAY_MAX_SERIES) {
+        Serial.printf("Already comparing %d spectra, clear them first\n", SPECTRUM_OVERLAY_MAX_SERIES);
+        return;
+    }
+    comparing = true;
+    showScreen(fileScreen);
+}
+
+void clear_overlay_button_cb(lv_event_t *e) {
+    overlay.clear();
+    update_chart();
+    requestRecompute();
+}
 
+void buildAnalysisScreen(lv_obj_t *screen, void *user_data) {
     // Create the chart
-    chart = lv_chart_create(lv_scr_act());
+    chart = lv_chart_create(screen);
     lv_obj_set_size(chart, 600, 300);
     lv_obj_align(chart, LV_ALIGN_CENTER, 0, 50);
 
-    // Add series
+    // Add series: the loaded spectrum, and the overlays hidden until there are some
     series = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_BLUE), LV_CHART_AXIS_PRIMARY_Y);
+    for (int i = 0; i < SPECTRUM_OVERLAY_MAX_SERIES; i++) {
+        overlaySeries[i] = lv_chart_add_series(chart, lv_palette_main(overlayPalette[i]), LV_CHART_AXIS_PRIMARY_Y);
+        lv_chart_hide_series(chart, overlaySeries[i], true);
+    }
 
     // Set X-axis and Y-axis ranges (Now restricting X-axis to 500-2500)
     lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_X, 500, 2500);
-    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, CHART_Y_SCALE);
+    lv_chart_set_div_line_count(chart, 5, 0);
+    lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);  // No point markers, only the envelope line
+    lv_obj_add_event_cb(chart, chart_draw_event_cb, LV_EVENT_DRAW_PART_BEGIN, NULL);
+    lv_obj_clear_flag(chart, LV_OBJ_FLAG_SCROLLABLE);  // Drags zoom and pan the spectrum instead
+    lv_obj_add_event_cb(chart, chart_view_event_cb, LV_EVENT_PRESSED, NULL);
+    lv_obj_add_event_cb(chart, chart_view_event_cb, LV_EVENT_PRESSING, NULL);
+    lv_obj_add_event_cb(chart, chart_view_event_cb, LV_EVENT_LONG_PRESSED, NULL);
 
     // Create X-axis label
-    lv_obj_t *x_label = lv_label_create(lv_scr_act());
+    lv_obj_t *x_label = lv_label_create(screen);
     lv_label_set_text(x_label, "Wavenumber");
     lv_obj_align(x_label, LV_ALIGN_BOTTOM_MID, 0, 20);
 
     // Create Y-axis label
-    lv_obj_t *y_label = lv_label_create(lv_scr_act());
+    lv_obj_t *y_label = lv_label_create(screen);
     lv_label_set_text(y_label, "Intensity");
     lv_obj_align(y_label, LV_ALIGN_LEFT_MID, -30, 0);
 
@@ -512,44 +1527,34 @@ void createUI() {
 
     // Customize axis ticks and labels
     //lv_chart_set_axis_tick(chart, LV_CHART_AXIS_PRIMARY_X, 10, 5, 10, 5, true, 100); 
-    for (int i = 0; i < 11; i++) {
-      lv_chart_set_next_value(chart, series, 500 + (i * 200));  // X-axis: 500, 700, 900, ..., 2500
-    }
-
     lv_chart_set_axis_tick(chart, LV_CHART_AXIS_PRIMARY_Y, 10, 5, 5, 2, true, 50);
 
     // Create first slider
-    slider1 = lv_slider_create(lv_scr_act());
+    slider1 = lv_slider_create(screen);
     lv_obj_set_size(slider1, 300, 30);
-    lv_slider_set_range(slider1, 500, 2500);  // Updated range
     lv_obj_align(slider1, LV_ALIGN_TOP_LEFT, 20, 20);
     lv_obj_add_event_cb(slider1, slider_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_add_event_cb(slider1, slider_released_cb, LV_EVENT_RELEASED, NULL);
 
     // Label for slider1
-    label1 = lv_label_create(lv_scr_act());
-    lv_label_set_text_fmt(label1, "Wavenumber 1: %d", lowerLimit);
-    lv_obj_align_to(label1, slider1, LV_ALIGN_OUT_BOTTOM_MID, 0, 10);
+    label1 = lv_label_create(screen);
 
     // Create second slider
-    slider2 = lv_slider_create(lv_scr_act());
+    slider2 = lv_slider_create(screen);
     lv_obj_set_size(slider2, 300, 30);
-    lv_slider_set_range(slider2, 500, 2500);  // Updated range
     lv_obj_align(slider2, LV_ALIGN_TOP_RIGHT, -20, 20);
     lv_obj_add_event_cb(slider2, slider_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_add_event_cb(slider2, slider_released_cb, LV_EVENT_RELEASED, NULL);
 
     // Label for slider2
-    label2 = lv_label_create(lv_scr_act());
-    lv_label_set_text_fmt(label2, "Wavenumber 2: %d", upperLimit);
-    lv_obj_align_to(label2, slider2, LV_ALIGN_OUT_BOTTOM_MID, 0, 10);
+    label2 = lv_label_create(screen);
 
     // Area label
-    area_label = lv_label_create(lv_scr_act());
-    lv_label_set_text_fmt(area_label, "Area: %.2f", computeAreaUnderCurve());
+    area_label = lv_label_create(screen);
     lv_obj_align(area_label, LV_ALIGN_BOTTOM_LEFT, 20, -40);
 
     // Concentration label
-    concentration_label = lv_label_create(lv_scr_act());
-    lv_label_set_text_fmt(concentration_label, "Concentration: %.2f", computeConcentration(computeAreaUnderCurve(), m_value, c_value));
+    concentration_label = lv_label_create(screen);
 
     static lv_style_t concentration_style;
     lv_style_init(&concentration_style);
@@ -564,8 +1569,19 @@ void createUI() {
     lv_obj_add_style(concentration_label, &concentration_style, 0);
     lv_obj_align(concentration_label, LV_ALIGN_CENTER, 0, -120);
 
+    // Baseline under the area, and the tallest peak of the range above it
+    baseline_dropdown = lv_dropdown_create(screen);
+    lv_dropdown_set_options_static(baseline_dropdown, "No baseline\nLinear baseline\nPolynomial baseline");
+    lv_obj_set_width(baseline_dropdown, 150);
+    lv_obj_align(baseline_dropdown, LV_ALIGN_TOP_MID, 0, 15);
+    lv_obj_add_event_cb(baseline_dropdown, baselineDropdownCb, LV_EVENT_VALUE_CHANGED, NULL);
+
+    peak_label = lv_label_create(screen);
+    lv_label_set_text(peak_label, "");
+    lv_obj_align(peak_label, LV_ALIGN_TOP_MID, 0, 70);
+
     // File selector button
-    lv_obj_t *file_selector_button = lv_btn_create(lv_scr_act());
+    lv_obj_t *file_selector_button = lv_btn_create(screen);
     lv_obj_align(file_selector_button, LV_ALIGN_BOTTOM_LEFT, 20, -100);
     lv_obj_add_event_cb(file_selector_button, file_selector_button_cb, LV_EVENT_CLICKED, NULL);
 
@@ -573,13 +1589,210 @@ void createUI() {
     lv_label_set_text(file_selector_label, "Select CSV File");
     lv_obj_center(file_selector_label);
 
-    // Update chart and area label
-    //1delay(1000);
+    // Spectra to compare with this one
+    overlay_label = lv_label_create(screen);
+    lv_label_set_recolor(overlay_label, true);
+    lv_label_set_text(overlay_label, "");
+    lv_obj_align(overlay_label, LV_ALIGN_TOP_RIGHT, -20, 90);
+
+    lv_obj_t *compare_button = lv_btn_create(screen);
+    lv_obj_align(compare_button, LV_ALIGN_BOTTOM_RIGHT, -20, -100);
+    lv_obj_add_event_cb(compare_button, compare_button_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *compare_label = lv_label_create(compare_button);
+    lv_label_set_text(compare_label, "Compare file");
+    lv_obj_center(compare_label);
+
+    lv_obj_t *clear_button = lv_btn_create(screen);
+    lv_obj_align(clear_button, LV_ALIGN_BOTTOM_RIGHT, -20, -40);
+    lv_obj_add_event_cb(clear_button, clear_overlay_button_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *clear_label = lv_label_create(clear_button);
+    lv_label_set_text(clear_label, "Clear compared");
+    lv_obj_center(clear_label);
+}
+
+// The spectrum, range or baseline may have changed since the screen was last shown
+void refreshAnalysisScreen(lv_obj_t *screen, void *user_data) {
+    int minWavenumber = 500, maxWavenumber = 2500;
+    getWavenumberRange(minWavenumber, maxWavenumber);
+    lv_slider_set_range(slider1, minWavenumber, maxWavenumber);
+    lv_slider_set_value(slider1, lowerLimit, LV_ANIM_OFF);
+    lv_slider_set_range(slider2, minWavenumber, maxWavenumber);
+    lv_slider_set_value(slider2, upperLimit, LV_ANIM_OFF);
+    lv_label_set_text_fmt(label1, "Wavenumber 1: %d", lowerLimit);
+    lv_obj_align_to(label1, slider1, LV_ALIGN_OUT_BOTTOM_MID, 0, 10);
+    lv_label_set_text_fmt(label2, "Wavenumber 2: %d", upperLimit);
+    lv_obj_align_to(label2, slider2, LV_ALIGN_OUT_BOTTOM_MID, 0, 10);
+    lv_dropdown_set_selected(baseline_dropdown, processSettings.baseline);
+
+    recomputePending = false;
     update_chart();
     update_area_label();
 }
 
 
+// Current values for the page, as JSON (see spectrum_api.h)
+static int formatWebState(char *buffer, size_t size) {
+    SpectrumApiState state;
+    state.area = computeAreaUnderCurve();
+    state.concentration = computeConcentration(state.area);
+    state.lower = lowerLimit;
+    state.upper = upperLimit;
+    state.min = 500;
+    state.max = 2500;
+    getWavenumberRange(state.min, state.max);
+    state.events = recomputeStats.events;
+    state.recomputes = recomputeStats.recomputes;
+    return spectrumApiFormatState(buffer, size, state);
+}
+
+static void printWebState(SpectrumHttpResponse &response) {
+    char state[SPECTRUM_EVENTS_DATA_MAX];
+    formatWebState(state, sizeof(state));
+    response.addHeader("Content-Type", "application/json");
+    response.addHeader("Cache-Control", "no-store");
+    response.print(state);
+}
+
+// Called whenever the range or the values change, from the panel or from a page. Cheap: the subscribers pick the
+// latest state up at their own (coalesced) pace.
+void publishWebState() {
+    char state[SPECTRUM_EVENTS_DATA_MAX];
+    formatWebState(state, sizeof(state));
+    webEvents.publish("state", state);
+}
+
+// From handleClients(), which loop() calls under the LVGL lock, so the timers and the chart can be touched directly
+static void applyWebLimits(const SpectrumHttpRequest &request) {
+    long value;
+    if (spectrum_http_form_int(request.body, request.body_length, "slider1", value)) {
+        tempLowerLimit = value;
+        if (tempLowerLimit >= tempUpperLimit) {
+            tempLowerLimit = tempUpperLimit - 1;
+        }
+    }
+    if (spectrum_http_form_int(request.body, request.body_length, "slider2", value)) {
+        tempUpperLimit = value;
+        if (tempUpperLimit <= tempLowerLimit) {
+            tempUpperLimit = tempLowerLimit + 1;
+        }
+    }
+
+    // Update limits if valid
+    if (tempLowerLimit < tempUpperLimit) {
+        lowerLimit = tempLowerLimit;
+        upperLimit = tempUpperLimit;
+        resultSettled = true;
+        requestRecompute();
+        update_chart();
+    }
+}
+
+#if SPECTRUM_METRICS
+// Timings of the hot paths over every screen, on the top layer: a small toggle, and the table it shows and hides
+lv_obj_t *metrics_label;
+lv_timer_t *metricsTimer;
+
+static const char *formatCycles(double cycles, char *text, size_t size) {
+    double us = cycles / spectrum_cycles_per_us();
+    if (us < 1000) {
+        snprintf(text, size, "%.0f us", us);
+    } else if (us < 1000000) {
+        snprintf(text, size, "%.1f ms", us / 1000);
+    } else {
+        snprintf(text, size, "%.2f s", us / 1000000);
+    }
+    return text;
+}
+
+void metrics_timer_cb(lv_timer_t *timer) {
+    static char text[SPECTRUM_SCOPE_COUNT * 64];
+    size_t length = snprintf(text, sizeof(text), "scope   count   p50   p99   max");
+    for (int scope = 0; scope < SPECTRUM_SCOPE_COUNT; scope++) {
+        SpectrumMetricsSnapshot snapshot;
+        spectrumMetrics.snapshot(scope, -1, snapshot);
+        char p50[16], p99[16], max[16];
+        length += snprintf(text + length, sizeof(text) - length, "\n%s  %u  %s  %s  %s",
+                           SpectrumMetrics::scopeName(scope), (unsigned)snapshot.count,
+                           formatCycles(snapshot.quantile(0.5), p50, sizeof(p50)),
+                           formatCycles(snapshot.quantile(0.99), p99, sizeof(p99)),
+                           formatCycles(snapshot.max, max, sizeof(max)));
+        if (length >= sizeof(text)) break;
+    }
+    lv_label_set_text(metrics_label, text);
+}
+
+void metrics_button_cb(lv_event_t *e) {
+    // Only refreshed while shown, so it costs nothing otherwise
+    if (lv_obj_has_flag(metrics_label, LV_OBJ_FLAG_HIDDEN)) {
+        lv_obj_clear_flag(metrics_label, LV_OBJ_FLAG_HIDDEN);
+        metrics_timer_cb(metricsTimer);
+        lv_timer_resume(metricsTimer);
+    } else {
+        lv_obj_add_flag(metrics_label, LV_OBJ_FLAG_HIDDEN);
+        lv_timer_pause(metricsTimer);
+    }
+}
+
+void buildMetricsOverlay() {
+    lv_obj_t *layer = lv_layer_top();
+
+    metrics_label = lv_label_create(layer);
+    lv_obj_set_style_bg_color(metrics_label, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(metrics_label, LV_OPA_70, 0);
+    lv_obj_set_style_text_color(metrics_label, lv_color_white(), 0);
+    lv_obj_set_style_pad_all(metrics_label, 6, 0);
+    lv_obj_align(metrics_label, LV_ALIGN_TOP_LEFT, 4, 40);
+    lv_obj_add_flag(metrics_label, LV_OBJ_FLAG_HIDDEN);
+
+    lv_obj_t *button = lv_btn_create(layer);
+    lv_obj_set_size(button, 32, 32);
+    lv_obj_align(button, LV_ALIGN_TOP_LEFT, 4, 4);
+    lv_obj_set_style_bg_opa(button, LV_OPA_50, 0);
+    lv_obj_add_event_cb(button, metrics_button_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *button_label = lv_label_create(button);
+    lv_label_set_text(button_label, LV_SYMBOL_LIST);
+    lv_obj_center(button_label);
+
+    metricsTimer = lv_timer_create(metrics_timer_cb, 1000, NULL);
+    lv_timer_pause(metricsTimer);
+}
+#endif
+
+// The page itself is a constant gzipped blob (web_assets.h, built from web/), the values come from the API
+static void handleWebRequest(const SpectrumHttpRequest &request, SpectrumHttpResponse &response, void *ctx) {
+    (void)ctx;
+    SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_HTTP);
+    bool get = (request.method == SPECTRUM_HTTP_GET) || (request.method == SPECTRUM_HTTP_HEAD);
+    if (get && (strcmp(request.path, "/") == 0)) {
+        // Revalidated on every load, answered with a 304 until the firmware changes. Every browser accepts gzip.
+        response.addHeader("ETag", WEB_INDEX_ETAG);
+        response.addHeader("Cache-Control", "no-cache");
+        if (request.notModified(WEB_INDEX_ETAG)) {
+            response.setStatus(304);
+            return;
+        }
+        response.addHeader("Content-Type", WEB_INDEX_CONTENT_TYPE);
+        response.addHeader("Content-Encoding", "gzip");
+        response.writeStatic(WEB_INDEX_GZ, sizeof(WEB_INDEX_GZ));
+    } else if (get && (strcmp(request.path, "/api/state") == 0)) {
+        printWebState(response);
+    } else if (get && (strcmp(request.path, "/api/spectrum") == 0)) {
+        spectrumApiRespond(request, response, spectrumIndex, pyramid);
+    } else if (get && (strcmp(request.path, "/api/events") == 0)) {
+        webEvents.respond(response);
+#if SPECTRUM_METRICS
+    } else if (get && (strcmp(request.path, "/metrics") == 0)) {
+        spectrumMetrics.respond(response);
+#endif
+    } else if ((request.method == SPECTRUM_HTTP_POST) && (strcmp(request.path, "/api/limits") == 0)) {
+        applyWebLimits(request);
+        printWebState(response);
+    } else {
+        response.setStatus(404);
+    }
+}
+
+
 void setup() {
     Serial.begin(115200);
     Serial.println("LVGL Line Graph Demo Starting...");
@@ -594,6 +1807,19 @@ void setup() {
     );
 
     initializeIOExpander(expander);
+    refreshCSVIndex(SD, false);
+    processor.configure(processSettings);
+    overlay.configure(processSettings);
+    loadCalibration(SD);
+
+    SpectrumJournalConfig journalConfig = spectrumJournalDefaults();
+    journalConfig.flush_interval_ms = RESULTS_FLUSH_MS;
+    if (resultsJournal.mount(RESULTS_JOURNAL_PATH, journalConfig)) {
+        Serial.printf("Results journal: %u records, %u bytes of an interrupted write truncated\n",
+                      (unsigned)resultsJournal.stats().recovered, (unsigned)resultsJournal.stats().truncated);
+    } else {
+        Serial.println("Failed to open the results journal");
+    }
 
     ESP_Panel *panel = new ESP_Panel();
     panel->init();
@@ -602,8 +1828,42 @@ void setup() {
 
     lvgl_port_init(panel->getLcd(), panel->getTouch());
 
+    if (!loader.begin(loadSpectrumJob, static_cast<fs::FS *>(&SD))) {
+        Serial.println("Failed to start the loader task");
+    }
+
+    RS485.setRxBufferSize(RS485_RX_BUFFER);
+    RS485.begin(RS485_BAUD, SERIAL_8N1, RS485_RX_PIN, RS485_TX_PIN);
+    if (!ingest.begin(&spectrum, &spectrumIndex, &pyramid) ||
+        (spectrum_task_start("ingest", ingestTask, NULL, SPECTRUM_INGEST_STACK_SIZE, SPECTRUM_INGEST_PRIORITY,
+                             SPECTRUM_INGEST_CORE) == nullptr)) {
+        Serial.println("Failed to start RS485 ingest");
+    }
+
+    fileScreen = screens.add(buildFileSelector, NULL, NULL);
+    parameterScreen = screens.add(buildParameterInputPage, refreshParameterInputPage, NULL);
+    analysisScreen = screens.add(buildAnalysisScreen, refreshAnalysisScreen, NULL);
+
     lvgl_port_lock(-1);
-    createFileSelector();
+#if SCREEN_CYCLE_TEST
+    // Latency and LVGL heap should stay flat once all three exist. The analysis one shows whatever is loaded (nothing)
+    for (int i = 0; i < SCREEN_CYCLE_TEST; i++) {
+        screens.show(fileScreen + (i % 3));
+        if ((i % 500) == 499) {
+            const ScreenManagerStats &stats = screens.stats();
+            Serial.printf("%u transitions, %u builds: max %u us, mean %.1f us, LVGL heap %u bytes (max %u)\n",
+                          (unsigned)stats.transitions, (unsigned)stats.builds, (unsigned)stats.max_us,
+                          (double)stats.total_us / stats.transitions, (unsigned)stats.lv_used,
+                          (unsigned)stats.lv_used_max);
+        }
+    }
+#endif
+    showScreen(fileScreen);
+#if SPECTRUM_METRICS
+    buildMetricsOverlay();
+#endif
+    ingestTimer = lv_timer_create(ingest_timer_cb, 50, NULL);
+    journalTimer = lv_timer_create(journal_timer_cb, 250, NULL);
     lvgl_port_unlock();
 
     
@@ -614,313 +1874,19 @@ void setup() {
       Serial.println("Connected to WiFi");
       Serial.println("IP Address: " + WiFi.localIP().toString());
     
-      server.begin();
+      if (!httpServer.begin(80, handleWebRequest, NULL)) {
+        Serial.println("Failed to start the web server");
+      }
     
 
     Serial.println("LVGL Line Graph Demo Setup Complete.");
 }
 void loop() {
-    lv_task_handler();  // Handling LVGL tasks
+    // LVGL is driven by lvgl_port_task alone; calling lv_task_handler() here too would run its timers unlocked
+    // Under the LVGL lock: handlers and streamed bodies read the spectrum, index and pyramid that LVGL timers on
+    // lvgl_port_task swap and grow, and some of them drive widgets. It never waits on a client, see spectrum_http.h
+    lvgl_port_lock(-1);
+    httpServer.handleClients();
+    lvgl_port_unlock();
     delay(10);  // Shorter delay for more responsive UI
-
-    WiFiClient client = server.available();
-    if (client) {
-        String currentLine = "";
-        String header = "";
-        
-        unsigned long currentTime = millis();
-        unsigned long previousTime = currentTime;
-        const long timeoutTime = 2000; // 2 seconds timeout
-        
-        while (client.connected() && (currentTime - previousTime <= timeoutTime)) {
-            currentTime = millis();
-            if (client.available()) {
-                char c = client.read();
-                header += c;
-                
-                if (c == '\n') {
-                    if (currentLine.length() == 0) {
-                        // End of HTTP header, send response
-                        client.println("HTTP/1.1 200 OK");
-                        client.println("Content-type:text/html");
-                        client.println("Connection: close");
-                        client.println();
-                        
-                        // Check if this is a POST request with form data
-                        if (header.indexOf("POST") >= 0) {
-                            // Wait for the POST data
-                            String postData = "";
-                            while (client.available()) {
-                                char c = client.read();
-                                postData += c;
-                            }
-                            
-                            // Parse POST data for slider values
-                            if (postData.indexOf("slider1=") >= 0) {
-                                int startPos = postData.indexOf("slider1=") + 8;
-                                int endPos = postData.indexOf("&", startPos);
-                                if (endPos < 0) endPos = postData.length();
-                                String valueStr = postData.substring(startPos, endPos);
-                                tempLowerLimit = valueStr.toInt();
-                                if (tempLowerLimit >= tempUpperLimit) {
-                                    tempLowerLimit = tempUpperLimit - 1;
-                                }
-                            }
-                            
-                            if (postData.indexOf("slider2=") >= 0) {
-                                int startPos = postData.indexOf("slider2=") + 8;
-                                int endPos = postData.indexOf("&", startPos);
-                                if (endPos < 0) endPos = postData.length();
-                                String valueStr = postData.substring(startPos, endPos);
-                                tempUpperLimit = valueStr.toInt();
-                                if (tempUpperLimit <= tempLowerLimit) {
-                                    tempUpperLimit = tempLowerLimit + 1;
-                                }
-                            }
-                            
-                            // Update limits if valid
-                            if (tempLowerLimit < tempUpperLimit) {
-                                lowerLimit = tempLowerLimit;
-                                upperLimit = tempUpperLimit;
-                                update_area_label();
-                                update_chart();
-                            }
-                        }
-                        
-                        // Calculate values for display
-                        float area = computeAreaUnderCurve();
-                        float concentration = computeConcentration(area, m_value, c_value);
-                        
-                        // Create JSON data for the chart
-                        String chartData = "[";
-                        int num_points = min(100, upperLimit - lowerLimit);
-                        if (num_points > 0) {
-                            for (int i = 0; i < num_points; i++) {
-                                int index = lowerLimit + i * (upperLimit - lowerLimit) / num_points;
-                                if (index < arraySize) {
-                                    if (i > 0) chartData += ",";
-                                    chartData += "{\"x\":" + String(array1[index]) + ",\"y\":" + String(array2[index]) + "}";
-                                }
-                            }
-                        }
-                        chartData += "]";
-                        
-                        // Start sending the HTML content
-                        client.println("<!DOCTYPE html><html>");
-                        client.println("<head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">");
-                        client.println("<link rel=\"icon\" href=\"data:,\">");
-                        client.println("<title>Concentration Calculator</title>");
-                        client.println("<script src=\"https://cdn.jsdelivr.net/npm/chart.js\"></script>");
-                        client.println("<style>");
-                        client.println("@import url('https://fonts.googleapis.com/css2?family=Inter:wght@300;400;600&display=swap');");
-                        client.println("html, body { font-family: 'Inter', sans-serif; margin: 0; padding: 0; background: #121212; color: #e0e0e0; display: flex; flex-direction: column; justify-content: center; align-items: center; height: 100vh; }");
-                        client.println(".container { text-align: center; width: 90%; max-width: 800px; background: #1e1e1e; padding: 20px; border-radius: 12px; box-shadow: 0px 4px 10px rgba(0,0,0,0.3); }");
-                        client.println("h1 { font-size: 24px; font-weight: 600; margin-bottom: 10px; }");
-                        client.println(".chart-container { width: 100%; height: 60vh; margin: 20px 0; }");
-                        client.println(".slider-container { display: flex; flex-direction: column; align-items: center; width: 100%; margin-top: 20px; }");
-                        client.println(".slider { width: 80%; max-width: 500px; height: 8px; background: linear-gradient(45deg, #3498db, #9b59b6); border-radius: 4px; outline: none; transition: 0.3s; margin: 10px 0; }");
-                        client.println(".slider:hover { transform: scale(1.05); }");
-                        client.println(".label { font-size: 18px; font-weight: 400; text-align: center; color: #ccc; margin-top: 5px; }");
-                        client.println(".btn { background: linear-gradient(45deg, #1abc9c, #16a085); color: white; padding: 12px 24px; border-radius: 8px; cursor: pointer; border: none; font-size: 16px; transition: all 0.3s; margin-top: 20px; display: block; margin-left: auto; margin-right: auto; }");
-                        client.println(".btn:hover { background: linear-gradient(45deg, #16a085, #1abc9c); transform: scale(1.05); }");
-                        client.println(".highlight { color: #f39c12; font-size: 24px; font-weight: bold; margin: 20px 0; padding: 10px; background: rgba(243, 156, 18, 0.1); border-radius: 8px; }");
-                        client.println(".loader { width: 50px; height: 50px; border: 6px solid #ddd; border-top: 6px solid #3498db; border-radius: 50%; animation: spin 1.5s linear infinite; margin: 20px auto; }");
-                        client.println("@keyframes spin { 0% { transform: rotate(0deg); } 100% { transform: rotate(360deg); } }");
-                        client.println(".controls { width: 100%; max-width: 800px; margin: 20px auto; padding: 15px; background: #2a2a2a; border-radius: 8px; }");
-                        client.println("form { margin: 0; }");
-                        client.println("</style>");
-                        client.println("</head>");
-                        client.println("<body>");
-                        client.println("<div class=\"container\">");
-                        client.println("<div class=\"loader\" id=\"loader\"></div>");
-                        client.println("<div class=\"content\" id=\"mainContent\" style=\"display: none;\">");
-                        client.println("<h1>Concentration Calculator</h1>");
-
-                        // Display the concentration value here
-                        client.println("<div id=\"concentrationLabel\" class=\"highlight\">Concentration: " + String(concentration, 2) + "</div>");
-                        client.println("<div id=\"areaLabel\" class=\"label\">Area: " + String(area, 2) + "</div>");
-
-                        client.println("<div class=\"chart-container\">");
-                        client.println("<canvas id=\"myChart\"></canvas>");
-                        client.println("</div>");
-
-                        // Send the sliders and other controls
-                        client.println("<div class=\"controls\">");
-                        client.println("<form id=\"sliderForm\" method=\"POST\">");
-                        client.println("<div class=\"slider-container\">");
-                        client.println("<input id=\"slider1\" name=\"slider1\" type=\"range\" min=\"0\" max=\"" + String(arraySize - 1) + "\" value=\"" + String(lowerLimit) + "\" class=\"slider\" onchange=\"updateLabels()\" oninput=\"updateLabels()\"/>");
-                        client.println("<div id=\"label1\" class=\"label\">Wavenumber 1: " + String(lowerLimit) + "</div>");
-                        client.println("</div>");
-
-                        client.println("<div class=\"slider-container\">");
-                        client.println("<input id=\"slider2\" name=\"slider2\" type=\"range\" min=\"0\" max=\"" + String(arraySize - 1) + "\" value=\"" + String(upperLimit) + "\" class=\"slider\" onchange=\"updateLabels()\" oninput=\"updateLabels()\"/>");
-                        client.println("<div id=\"label2\" class=\"label\">Wavenumber 2: " + String(upperLimit) + "</div>");
-                        client.println("</div>");
-                        
-                        client.println("<button type=\"submit\" class=\"btn\">Update Graph</button>");
-                        client.println("</form>");
-                        client.println("</div>");
-
-                        client.println("</div>");
-                        client.println("</div>");
-                        
-                        client.println("<script>");
-                        client.println("// Chart data from server");
-                        client.println("const chartData = " + chartData + ";");
-                        
-                        client.println("// Hide loader and show content");
-                        client.println("document.getElementById('loader').style.display = 'none';");
-                        client.println("document.getElementById('mainContent').style.display = 'block';");
-                        
-                        client.println("// Update slider labels");
-                        client.println("function updateLabels() {");
-                        client.println("  const slider1 = document.getElementById('slider1');");
-                        client.println("  const slider2 = document.getElementById('slider2');");
-                        client.println("  document.getElementById('label1').textContent = 'Wavenumber 1: ' + slider1.value;");
-                        client.println("  document.getElementById('label2').textContent = 'Wavenumber 2: ' + slider2.value;");
-                        client.println("  // Ensure slider1 < slider2");
-                        client.println("  if(parseInt(slider1.value) >= parseInt(slider2.value)) {");
-                        client.println("    if(parseInt(slider1.value) >= parseInt(slider2.max) - 1) {");
-                        client.println("      slider1.value = parseInt(slider2.max) - 2;");
-                        client.println("    } else {");
-                        client.println("      slider2.value = parseInt(slider1.value) + 1;");
-                        client.println("    }");
-                        client.println("    document.getElementById('label1').textContent = 'Wavenumber 1: ' + slider1.value;");
-                        client.println("    document.getElementById('label2').textContent = 'Wavenumber 2: ' + slider2.value;");
-                        client.println("  }");
-                        client.println("}");
-                        
-                        client.println("// Create chart");
-                        client.println("const ctx = document.getElementById('myChart').getContext('2d');");
-                        client.println("const myChart = new Chart(ctx, {");
-                        client.println("  type: 'line',");
-                        client.println("  data: {");
-                        client.println("    datasets: [{");
-                        client.println("      label: 'Spectral Data',");
-                        client.println("      data: chartData,");
-                        client.println("      backgroundColor: 'rgba(52, 152, 219, 0.2)',");
-                        client.println("      borderColor: 'rgba(52, 152, 219, 1)',");
-                        client.println("      borderWidth: 2,");
-                        client.println("      pointRadius: 0,");
-                        client.println("      fill: true,");
-                        client.println("      tension: 0.1");
-                        client.println("    }]");
-                        client.println("  },");
-                        client.println("  options: {");
-                        client.println("    responsive: true,");
-                        client.println("    maintainAspectRatio: false,");
-                        client.println("    scales: {");
-                        client.println("      x: {");
-                        client.println("        type: 'linear',");
-                        client.println("        position: 'bottom',");
-                        client.println("        title: {");
-                        client.println("          display: true,");
-                        client.println("          text: 'Wavenumber',");
-                        client.println("          color: '#e0e0e0'");
-                        client.println("        },");
-                        client.println("        grid: {");
-                        client.println("          color: 'rgba(255, 255, 255, 0.1)'");
-                        client.println("        },");
-                        client.println("        ticks: {");
-                        client.println("          color: '#e0e0e0'");
-                        client.println("        }");
-                        client.println("      },");
-                        client.println("      y: {");
-                        client.println("        title: {");
-                        client.println("          display: true,");
-                        client.println("          text: 'Intensity',");
-                        client.println("          color: '#e0e0e0'");
-                        client.println("        },");
-                        client.println("        grid: {");
-                        client.println("          color: 'rgba(255, 255, 255, 0.1)'");
-                        client.println("        },");
-                        client.println("        ticks: {");
-                        client.println("          color: '#e0e0e0'");
-                        client.println("        }");
-                        client.println("      }");
-                        client.println("    },");
-                        client.println("    plugins: {");
-                        client.println("      legend: {");
-                        client.println("        labels: {");
-                        client.println("          color: '#e0e0e0'");
-                        client.println("        }");
-                        client.println("      },");
-                        client.println("      tooltip: {");
-                        client.println("        mode: 'index',");
-                        client.println("        intersect: false,");
-                        client.println("        backgroundColor: 'rgba(0, 0, 0, 0.8)'");
-                        client.println("      }");
-                        client.println("    }");
-                        client.println("  }");
-                        client.println("});");
-                        
-                        client.println("// Add shaded area between sliders");
-                        client.println("const addAreaPlugin = {");
-                        client.println("  id: 'customCanvasBackgroundColor',");
-                        client.println("  beforeDraw: (chart) => {");
-                        client.println("    const ctx = chart.canvas.getContext('2d');");
-                        client.println("    const slider1 = parseInt(document.getElementById('slider1').value);");
-                        client.println("    const slider2 = parseInt(document.getElementById('slider2').value);");
-                        client.println("    const xScale = chart.scales.x;");
-                        client.println("    const yScale = chart.scales.y;");
-                        client.println("    ");
-                        client.println("    // Find x positions on chart");
-                        client.println("    let xPos1 = null, xPos2 = null;");
-                        client.println("    for(let i = 0; i < chartData.length; i++) {");
-                        client.println("      const x = chartData[i].x;");
-                        client.println("      if (xPos1 === null && x >= slider1) {");
-                        client.println("        xPos1 = xScale.getPixelForValue(x);");
-                        client.println("      }");
-                        client.println("      if (xPos2 === null && x >= slider2) {");
-                        client.println("        xPos2 = xScale.getPixelForValue(x);");
-                        client.println("        break;");
-                        client.println("      }");
-                        client.println("    }");
-                        client.println("    ");
-                        client.println("    if (xPos1 !== null && xPos2 !== null) {");
-                        client.println("      ctx.save();");
-                        client.println("      ctx.fillStyle = 'rgba(243, 156, 18, 0.2)';");
-                        client.println("      ctx.fillRect(xPos1, yScale.top, xPos2 - xPos1, yScale.bottom - yScale.top);");
-                        client.println("      ctx.restore();");
-                        client.println("    }");
-                        client.println("  }");
-                        client.println("};");
-                        client.println("Chart.register(addAreaPlugin);");
-                        
-                        client.println("</script>");
-                        client.println("</body>");
-                        client.println("</html>");
-
-                        client.flush();
-                        break;
-                    } else {
-                        currentLine = "";
-                    }
-                } else if (c != '\r') {
-                    currentLine += c;
-                }
-            }
-        }
-        client.stop();
-    }
-}
-
-
-// Helper function to get the slider value from the HTTP request
-int getSliderValue(WiFiClient &client, String sliderId, int currentValue) {
-    String valueStr = "";
-    while (client.available()) {
-        char c = client.read();
-        if (c == '&' || c == ' ' || c == '=') continue;  // Ignore unnecessary characters
-        valueStr += c;
-        if (valueStr.indexOf(sliderId) != -1) {
-            int startPos = valueStr.indexOf('=') + 1;
-            if (startPos != -1) {
-                valueStr = valueStr.substring(startPos);
-                currentValue = valueStr.toInt();
-                break;
-            }
-        }
-    }
-    return currentValue;
 }
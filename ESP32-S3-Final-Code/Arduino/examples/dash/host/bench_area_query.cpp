@@ -0,0 +1,99 @@
+/*
+ * Benchmark for range-area queries: prefix-sum index vs the linear trapezoid loop, by sample index and by
+ * wavenumber (binary search + interpolated end segments) on ascending and descending spectra.
+ *
+ * Usage: bench_area_query [points...]   (default: 100 10000 1000000)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_index.h"
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> sizes = {100, 10000, 1000000};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) {
+            sizes.push_back((uint32_t)strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    const int queries = 100000;
+    int failures = 0;
+
+    printf("%10s %5s %12s %14s %14s %14s %10s\n", "points", "order", "build us", "index ns/q", "loop ns/q",
+           "wavenum ns/q", "mismatch");
+    for (int run = 0; run < (int)sizes.size() * 2; run++) {
+        uint32_t n = sizes[run / 2];
+        bool descending = (run % 2) == 0;
+        std::vector<float> x(n);
+        std::vector<float> y(n);
+        for (uint32_t i = 0; i < n; i++) {
+            float t = (float)i / (float)n;
+            x[i] = descending ? (4000.0f - 3500.0f * t) : (500.0f + 3500.0f * t);
+            y[i] = 50.0f + 40.0f * (float)((i * 2654435761u) % 1000) / 1000.0f;
+        }
+
+        SpectrumIndex index;
+        uint32_t start = spectrum_time_us();
+        index.build(x.data(), y.data(), n);
+        uint32_t build_us = spectrum_time_us() - start;
+
+        srand(1);
+        std::vector<int> bounds(queries * 2);
+        for (int q = 0; q < queries; q++) {
+            int a = rand() % (int)n;
+            int b = rand() % (int)n;
+            bounds[q * 2] = (a < b) ? a : b;
+            bounds[q * 2 + 1] = (a < b) ? b : a;
+        }
+
+        volatile double sink = 0;
+        start = spectrum_time_us();
+        for (int q = 0; q < queries; q++) {
+            sink = sink + index.area(bounds[q * 2], bounds[q * 2 + 1]);
+        }
+        double index_ns = (double)(spectrum_time_us() - start) * 1000.0 / queries;
+
+        // The loop is O(n) per query, so only time as many queries as fit in a reasonable budget
+        int loop_queries = (int)((uint64_t)20000000 / n);
+        loop_queries = (loop_queries < 1) ? 1 : ((loop_queries > queries) ? queries : loop_queries);
+        start = spectrum_time_us();
+        for (int q = 0; q < loop_queries; q++) {
+            sink = sink + index.areaLinear(bounds[q * 2], bounds[q * 2 + 1]);
+        }
+        double loop_ns = (double)(spectrum_time_us() - start) * 1000.0 / loop_queries;
+
+        for (int q = 0; q < loop_queries; q++) {
+            index.verify(bounds[q * 2], bounds[q * 2 + 1], nullptr);
+        }
+        uint32_t mismatches = index.mismatches();
+
+        std::vector<double> wavenumbers(queries * 2);
+        for (int q = 0; q < queries * 2; q++) {
+            wavenumbers[q] = 400.0 + 3700.0 * (double)rand() / (double)RAND_MAX;
+        }
+        start = spectrum_time_us();
+        for (int q = 0; q < queries; q++) {
+            sink = sink + index.areaBetween(wavenumbers[q * 2], wavenumbers[q * 2 + 1]);
+        }
+        double wavenumber_ns = (double)(spectrum_time_us() - start) * 1000.0 / queries;
+
+        for (int q = 0; q < loop_queries; q++) {
+            double fast = index.areaBetween(wavenumbers[q * 2], wavenumbers[q * 2 + 1]);
+            double slow = index.areaBetweenLinear(wavenumbers[q * 2], wavenumbers[q * 2 + 1]);
+            if (fabs(fast - slow) > 1e-6 * (fabs(slow) + 1.0)) {
+                mismatches++;
+            }
+        }
+        failures += (int)mismatches;
+
+        printf("%10u %5s %12u %14.1f %14.1f %14.1f %10u\n", n, descending ? "desc" : "asc", build_us, index_ns,
+               loop_ns, wavenumber_ns, mismatches);
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/*
+ * Benchmark for batch analysis of a directory of spectra with 1, 2 and 4 workers: straight from the page cache, and
+ * through a simulated SD card that serves one read at a time. The card's rate defaults to what one worker parses from
+ * the cache, which is roughly the device's situation (an SPI card delivers about what one core parses), so one worker
+ * alternates between waiting and parsing and two can overlap the two. Every area is checked against SpectrumIndex on
+ * the same file, the baseline corrected ones against SpectrumProcessor, and the summary CSV must have a line per file.
+ *
+ * Usage: bench_batch [files] [rows per file] [card KB/s]     (default: 32 20000, card as fast as one worker)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_batch.h"
+#include "spectrum_index.h"
+#include "spectrum_process.h"
+#include "spectrum_store.h"
+
+struct Card {
+    uint32_t kbps;              // 0: no simulated card
+    std::mutex bus;
+};
+
+static void *openFile(void *ctx, const char *path)
+{
+    (void)ctx;
+    return fopen(path, "rb");
+}
+
+static void closeFile(void *ctx, void *file)
+{
+    (void)ctx;
+    fclose(static_cast<FILE *>(file));
+}
+
+static Card card;
+
+static int readFile(void *ctx, uint8_t *buf, size_t len)
+{
+    size_t n = fread(buf, 1, len, static_cast<FILE *>(ctx));
+    if (card.kbps > 0) {
+        // The bus is busy for the whole transfer, whoever asked
+        std::lock_guard<std::mutex> lock(card.bus);
+        usleep((useconds_t)((uint64_t)len * 1000 / card.kbps));
+    }
+    return (int)n;
+}
+
+static float linearCalibration(double area, void *ctx)
+{
+    const float *mc = static_cast<const float *>(ctx);
+    return mc[0] * (float)area + mc[1];
+}
+
+static int appendSummary(void *ctx, const uint8_t *buf, size_t len)
+{
+    static_cast<std::string *>(ctx)->append((const char *)buf, len);
+    return (int)len;
+}
+
+static bool storePoint(float x, float y, void *user_data)
+{
+    return static_cast<SpectrumStore *>(user_data)->push(x, y);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t files = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 32;
+    uint32_t rows = (argc > 2) ? (uint32_t)strtoul(argv[2], nullptr, 10) : 20000;
+    uint32_t kbps = (argc > 3) ? (uint32_t)strtoul(argv[3], nullptr, 10) : 0;
+    prctl(PR_SET_TIMERSLACK, 1);    // The simulated transfers are tens of microseconds
+
+    char dir[] = "/tmp/bench_batch_XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::vector<std::string> names;
+    uint64_t total_bytes = 0;
+    for (uint32_t f = 0; f < files; f++) {
+        names.push_back(std::string(dir) + "/Cu-" + std::to_string(f) + "mM.csv");
+        FILE *out = fopen(names.back().c_str(), "w");
+        fprintf(out, "Wavenumber,Intensity\n");
+        for (uint32_t i = 0; i < rows; i++) {
+            float x = 4000.0f - 3500.0f * (float)i / (float)rows;
+            float y = 0.05f * (float)(f + 1) * expf(-(x - 2250.0f) * (x - 2250.0f) / 20000.0f) +
+                      0.001f * (float)((i * 2654435761u + f) % 100);
+            fprintf(out, "%.4f,%.6f\n", x, y);
+        }
+        total_bytes += (uint64_t)ftell(out);
+        fclose(out);
+    }
+    std::vector<const char *> paths;
+    for (const std::string &name : names) {
+        paths.push_back(name.c_str());
+    }
+
+    // Reference areas from the whole spectrum in memory
+    const double lower = 2100;
+    const double upper = 2400;
+    std::vector<double> expected_linear(files);
+    std::vector<double> expected(files);
+    std::vector<double> expected_baseline[3];
+    for (std::vector<double> &areas : expected_baseline) {
+        areas.resize(files);
+    }
+    for (uint32_t f = 0; f < files; f++) {
+        SpectrumStore store;
+        SpectrumCsvParser parser(storePoint, &store);
+        uint8_t chunk[SPECTRUM_CSV_CHUNK_SIZE];
+        FILE *in = fopen(paths[f], "rb");
+        spectrumCsvParseStream([](void *ctx, uint8_t *buf, size_t len) {
+            return (int)fread(buf, 1, len, static_cast<FILE *>(ctx));
+        }, in, chunk, sizeof(chunk), parser, nullptr);
+        fclose(in);
+        SpectrumIndex index;
+        index.build(store.x(), store.y(), store.size());
+        expected_linear[f] = index.areaBetweenLinear(lower, upper);
+        expected[f] = index.areaBetween(lower, upper);
+        SpectrumProcessor processor;
+        processor.attach(store.x(), store.y(), store.size(), &index);
+        for (uint8_t baseline : {SPECTRUM_BASELINE_LINEAR, SPECTRUM_BASELINE_POLYNOMIAL}) {
+            processor.configure({baseline, 0, 0, 0.1f});
+            expected_baseline[baseline][f] = processor.process(lower, upper).area;
+        }
+    }
+
+    float calibration[2] = {2.0f, 0.5f};
+    std::vector<SpectrumBatchResult> results(files);
+    SpectrumBatchJob job = {};
+    job.paths = paths.data();
+    job.count = files;
+    job.lower = upper;          // Either order
+    job.upper = lower;
+    job.concentration = linearCalibration;
+    job.concentration_ctx = calibration;
+    job.open = openFile;
+    job.read = readFile;
+    job.close = closeFile;
+    job.results = results.data();
+
+    int failures = 0;
+    printf("%u files of %u rows, %.1f MB, %u hardware threads\n", files, rows, total_bytes / 1e6,
+           std::thread::hardware_concurrency());
+    printf("%16s %8s %10s %10s %10s %8s\n", "source", "workers", "ms", "files/s", "MB/s", "speedup");
+    for (int mode = 0; mode < 2; mode++) {
+        card.kbps = (mode == 0) ? 0 : kbps;
+        char source[32];
+        snprintf(source, sizeof(source), (mode == 0) ? "cache" : "card %u KB/s", card.kbps);
+        float single = 0;
+        for (int workers : {1, 2, 4}) {
+            SpectrumBatch batch;
+            if (!batch.start(job, workers)) {
+                printf("Failed to start %d workers\n", workers);
+                failures++;
+                continue;
+            }
+            while (!batch.finished()) {
+                usleep(1000);   // Like the UI polling from an lv_timer
+            }
+            const SpectrumBatchStats &stats = batch.wait();
+
+            bool correct = (stats.files == files) && (stats.failed == 0) && (batch.completed() == files);
+            for (uint32_t f = 0; f < files; f++) {
+                const SpectrumBatchResult &result = results[f];
+                correct = correct && result.ok && (result.rows == rows) && (result.skipped == 1) &&
+                          (result.area == expected_linear[f]) &&
+                          (fabs(result.area - expected[f]) <= 1e-9 * fabs(expected[f])) &&
+                          (result.concentration == linearCalibration(expected_linear[f], calibration));
+            }
+            if (!correct) {
+                printf("%16s %8d wrong results\n", source, workers);
+                failures++;
+            }
+            single = (workers == 1) ? stats.filesPerSecond() : single;
+            if ((mode == 0) && (workers == 1) && (kbps == 0)) {
+                kbps = (uint32_t)(stats.bytesPerSecond() / 1000);
+            }
+            printf("%16s %8d %10.1f %10.1f %10.1f %7.2fx\n", source, workers, stats.elapsed_us / 1000.0,
+                   stats.filesPerSecond(), stats.bytesPerSecond() / 1e6, stats.filesPerSecond() / single);
+        }
+    }
+
+    // Baseline corrected areas, as the chart shows them
+    card.kbps = 0;
+    for (uint8_t baseline : {SPECTRUM_BASELINE_LINEAR, SPECTRUM_BASELINE_POLYNOMIAL}) {
+        SpectrumBatchJob corrected = job;
+        corrected.baseline = baseline;
+        SpectrumBatch batch;
+        batch.start(corrected, 2);
+        batch.wait();
+        double worst = 0;
+        for (uint32_t f = 0; f < files; f++) {
+            double want = expected_baseline[baseline][f];
+            worst = fmax(worst, fabs(results[f].area - want) / fabs(want));
+        }
+        printf("%s baseline: largest relative difference to the processor %.2g\n",
+               (baseline == SPECTRUM_BASELINE_LINEAR) ? "Linear" : "Polynomial", worst);
+        if (!(worst <= 1e-6)) {
+            printf("Wrong baseline corrected areas\n");
+            failures++;
+        }
+    }
+    std::string summary;
+    if (!spectrumBatchWriteSummary(appendSummary, &summary, job) ||
+        ((uint32_t)std::count(summary.begin(), summary.end(), '\n') != files + 1)) {
+        printf("Bad summary\n");
+        failures++;
+    }
+    printf("Summary: %s", summary.substr(0, summary.find('\n', summary.find('\n') + 1) + 1).c_str());
+
+    for (const std::string &name : names) {
+        remove(name.c_str());
+    }
+    rmdir(dir);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+/*
+ * Benchmark for the streaming CSV parser against the per-row `String` approach the sketch used before, and for
+ * reopening the same spectrum from its binary sidecar cache.
+ *
+ * Usage: bench_csv_parse [rows...]      (default: 10000 100000 1000000)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_csv.h"
+#include "spectrum_cache.h"
+#include "spectrum_index.h"
+#include "spectrum_store.h"
+
+static void generateCsv(const char *path, uint32_t rows)
+{
+    FILE *f = fopen(path, "w");
+    if (f == nullptr) {
+        perror(path);
+        exit(1);
+    }
+    fprintf(f, "Wavenumber,Intensity\n");
+    for (uint32_t i = 0; i < rows; i++) {
+        double x = 4000.0 - 3500.0 * (double)i / (double)rows;
+        double y = 50.0 + 40.0 * (double)((i * 2654435761u) % 1000) / 1000.0;
+        fprintf(f, "%.6f,%.6f\r\n", x, y);
+    }
+    fclose(f);
+}
+
+struct Sink {
+    uint32_t count;
+    double checksum;
+    SpectrumStore *store;
+};
+
+static bool sinkPoint(float x, float y, void *user_data)
+{
+    Sink *sink = static_cast<Sink *>(user_data);
+    sink->count++;
+    sink->checksum += (double)x + (double)y;
+    return (sink->store == nullptr) || sink->store->push(x, y);
+}
+
+static int readFile(void *ctx, uint8_t *buf, size_t len)
+{
+    return (int)fread(buf, 1, len, static_cast<FILE *>(ctx));
+}
+
+static uint64_t fileSize(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    uint64_t size = (uint64_t)ftell(f);
+    fclose(f);
+    return size;
+}
+
+static int writeFile(void *ctx, const uint8_t *buf, size_t len)
+{
+    return (int)fwrite(buf, 1, len, static_cast<FILE *>(ctx));
+}
+
+// Write the sidecar for the parsed columns, then time reopening it. Returns the load time, 0 on failure.
+static uint32_t benchSidecar(const char *csv_path, uint64_t source_size, const SpectrumStore &store)
+{
+    char path[96];
+    spectrumCachePath(csv_path, path, sizeof(path));
+    uint32_t count = (uint32_t)store.size();
+    std::vector<float> x(store.x(), store.x() + count);
+    std::vector<float> y(store.y(), store.y() + count);
+
+    SpectrumIndex index;
+    index.build(x.data(), y.data(), count);
+    SpectrumCacheHeader header;
+    spectrumCacheMakeHeader(header, x.data(), y.data(), count, source_size, 1234);
+    FILE *f = fopen(path, "wb");
+    bool ok = spectrumCacheWrite(writeFile, f, header, x.data(), y.data(), index.prefix());
+    fclose(f);
+
+    std::vector<float> rx(count);
+    std::vector<float> ry(count);
+    SpectrumIndex loaded;
+    uint32_t start = spectrum_time_us();
+    f = fopen(path, "rb");
+    SpectrumCacheHeader read_header;
+    ok = ok && spectrumCacheReadHeader(readFile, f, read_header) &&
+         spectrumCacheIsFresh(read_header, source_size, 1234, spectrumCacheFileSize(count));
+    SpectrumPrefix *prefix = loaded.prefixBuffer(count);
+    ok = ok && spectrumCacheReadColumns(readFile, f, read_header, rx.data(), ry.data(), prefix);
+    loaded.attach(rx.data(), ry.data(), count);
+    fclose(f);
+    uint32_t elapsed = spectrum_time_us() - start;
+    remove(path);
+
+    // A changed source must invalidate the sidecar
+    ok = ok && !spectrumCacheIsFresh(read_header, source_size + 1, 1234, spectrumCacheFileSize(count)) &&
+         !spectrumCacheIsFresh(read_header, source_size, 1235, spectrumCacheFileSize(count));
+    ok = ok && (rx == x) && (ry == y) && (loaded.areaBetween(1000, 3000) == index.areaBetween(1000, 3000));
+    return ok ? ((elapsed == 0) ? 1 : elapsed) : 0;
+}
+
+// Mirrors the old `readStringUntil()` + `trim()` + `substring()` + `toFloat()` loop
+static uint32_t parseNaive(FILE *f, Sink &sink)
+{
+    std::string line;
+    int c;
+    uint32_t start = spectrum_time_us();
+    while ((c = fgetc(f)) != EOF) {
+        if (c != '\n') {
+            line.push_back((char)c);
+            continue;
+        }
+        size_t a = line.find_first_not_of(" \t\r");
+        size_t b = line.find_last_not_of(" \t\r");
+        std::string trimmed = (a == std::string::npos) ? std::string() : line.substr(a, b - a + 1);
+        size_t sep = trimmed.find(',');
+        if (sep == std::string::npos) {
+            sep = trimmed.find('\t');
+        }
+        if (sep != std::string::npos) {
+            std::string xs = trimmed.substr(0, sep);
+            std::string ys = trimmed.substr(sep + 1);
+            sinkPoint(strtof(xs.c_str(), nullptr), strtof(ys.c_str(), nullptr), &sink);
+        }
+        line.clear();
+    }
+    return spectrum_time_us() - start;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sizes[16] = {10000, 100000, 1000000};
+    int num_sizes = 3;
+    if (argc > 1) {
+        num_sizes = 0;
+        for (int i = 1; (i < argc) && (num_sizes < 16); i++) {
+            sizes[num_sizes++] = (uint32_t)strtoul(argv[i], nullptr, 10);
+        }
+    }
+
+    static uint8_t chunk[SPECTRUM_CSV_CHUNK_SIZE];
+    SpectrumStore store;
+    int failures = 0;
+
+    printf("%10s %12s %14s %14s %12s %10s %12s %12s\n", "rows", "bytes", "rows/s", "bytes/s", "naive rows/s",
+           "speedup", "parse us", "sidecar us");
+    for (int i = 0; i < num_sizes; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/bench_csv_%u.csv", sizes[i]);
+        generateCsv(path, sizes[i]);
+
+        FILE *f = fopen(path, "rb");
+        store.clear();
+        store.reserve(SpectrumStore::estimateRows(fileSize(path)));
+        Sink sink = {0, 0, &store};
+        SpectrumCsvParser parser(sinkPoint, &sink);
+        SpectrumCsvStats stats = {};
+        spectrumCsvParseStream(readFile, f, chunk, sizeof(chunk), parser, &stats);
+        fclose(f);
+
+        f = fopen(path, "rb");
+        Sink naive = {};
+        uint32_t naive_us = parseNaive(f, naive);
+        fclose(f);
+
+        uint32_t sidecar_us = benchSidecar(path, stats.bytes, store);
+        if (sidecar_us == 0) {
+            printf("sidecar round trip failed\n");
+            failures++;
+        }
+        remove(path);
+
+        // The naive loop accepts the header as (0, 0), the streaming parser skips it
+        if ((sink.count != sizes[i]) || (naive.count != sizes[i] + 1) || (stats.skipped != 1)) {
+            printf("row count mismatch: streaming %u, naive %u\n", sink.count, naive.count);
+            failures++;
+        }
+
+        double naive_rate = (naive_us == 0) ? 0.0 : (double)naive.count * 1e6 / (double)naive_us;
+        printf("%10u %12llu %14.0f %14.0f %12.0f %9.2fx %12u %12u\n", stats.rows, (unsigned long long)stats.bytes,
+               stats.rowsPerSecond(), stats.bytesPerSecond(), naive_rate,
+               (naive_rate > 0) ? stats.rowsPerSecond() / naive_rate : 0.0, stats.elapsed_us, sidecar_us);
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+/*
+ * Benchmark for chart decimation: one-pass min/max envelope vs a cached redraw of the same view, and zoom/pan
+ * windows answered from the min/max pyramid (whose cost should not depend on the spectrum size).
+ *
+ * Usage: bench_decimate [points...]     (default: 10000 100000 1000000)
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_decimate.h"
+#include "spectrum_pyramid.h"
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> sizes = {10000, 100000, 1000000};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) {
+            sizes.push_back((uint32_t)strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    const uint16_t width = 600;
+    int failures = 0;
+
+    printf("%10s %8s %14s %14s %10s %12s %14s %14s %8s\n", "points", "width", "envelope us", "cached ns",
+           "peak kept", "pyramid us", "zoom linear us", "zoom pyr us", "equal");
+    for (uint32_t n : sizes) {
+        std::vector<float> x(n);
+        std::vector<float> y(n);
+        for (uint32_t i = 0; i < n; i++) {
+            x[i] = 4000.0f - 3500.0f * (float)i / (float)n;
+            y[i] = 50.0f + 10.0f * (float)((i * 2654435761u) % 1000) / 1000.0f;
+        }
+        // A one-sample spike that plain stride sampling would almost always miss
+        uint32_t spike = n / 3 + 7;
+        y[spike] = 500.0f;
+
+        SpectrumDecimator decimator;
+        uint32_t start = spectrum_time_us();
+        const SpectrumEnvelope *env = decimator.envelope(x.data(), y.data(), 0, n, width);
+        uint32_t envelope_us = spectrum_time_us() - start;
+
+        const int redraws = 100000;
+        start = spectrum_time_us();
+        for (int i = 0; i < redraws; i++) {
+            env = decimator.envelope(x.data(), y.data(), 0, n, width);
+        }
+        double cached_ns = (double)(spectrum_time_us() - start) * 1000.0 / redraws;
+
+        bool peak_kept = false;
+        for (uint16_t c = 0; c < env->columns; c++) {
+            peak_kept = peak_kept || (env->max[c] == 500.0f);
+        }
+        if (!peak_kept || (env->y_max != 500.0f) || (decimator.misses() != 1)) {
+            failures++;
+        }
+
+        SpectrumPyramid pyramid;
+        start = spectrum_time_us();
+        pyramid.build(x.data(), y.data(), n);
+        uint32_t pyramid_us = spectrum_time_us() - start;
+
+        // Random zoom windows of at least 10% of the spectrum, linear scan vs pyramid
+        const int windows = 50;
+        std::vector<float> lx(width), lmin(width), lmax(width), px(width), pmin(width), pmax(width);
+        float lo0, hi0, lo1, hi1;
+        uint64_t linear_us = 0;
+        uint64_t pyr_us = 0;
+        bool equal = true;
+        srand(3);
+        for (int w = 0; w < windows; w++) {
+            size_t len = n / 10 + (size_t)rand() % (n - n / 10);
+            size_t from = (size_t)rand() % (n - len + 1);
+            start = spectrum_time_us();
+            spectrumEnvelopeCompute(x.data(), y.data(), from, from + len, width, lx.data(), lmin.data(), lmax.data(),
+                                    &lo0, &hi0);
+            linear_us += spectrum_time_us() - start;
+            start = spectrum_time_us();
+            pyramid.envelope(from, from + len, width, px.data(), pmin.data(), pmax.data(), &lo1, &hi1);
+            pyr_us += spectrum_time_us() - start;
+            equal = equal && (lo0 == lo1) && (hi0 == hi1) && (lmin == pmin) && (lmax == pmax);
+        }
+        if (!equal) {
+            failures++;
+        }
+
+        printf("%10u %8u %14u %14.1f %10s %12u %14.1f %14.1f %8s\n", n, width, envelope_us, cached_ns,
+               peak_kept ? "yes" : "NO", pyramid_us, (double)linear_us / windows, (double)pyr_us / windows,
+               equal ? "yes" : "NO");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/*
+ * Benchmark for the SD file index: a full walk of a generated tree, a refresh when nothing changed (one stat per
+ * directory), a refresh after one directory changed, a save/load round trip, and a page of the selector taken from the
+ * table vs re-walking the tree for every page as the sketch used to, and type-ahead filtering one keystroke at a time.
+ *
+ * Usage: bench_file_index [dirs] [files per dir]      (default: 50 100)
+ */
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_files.h"
+
+// Nanosecond modification times, so a change made within the same second as the previous scan is still seen
+static int64_t mtimeOf(const struct stat &st)
+{
+    return (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+static bool listDir(void *ctx, const char *path, SpectrumDirVisitCallback visit, void *visit_ctx)
+{
+    (void)ctx;
+    DIR *dir = opendir(path);
+    if (dir == nullptr) {
+        return false;
+    }
+    std::string child;
+    for (struct dirent *ent = readdir(dir); ent != nullptr; ent = readdir(dir)) {
+        if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+            continue;
+        }
+        child = std::string(path) + "/" + ent->d_name;
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0) {
+            continue;
+        }
+        SpectrumDirEntry entry = {ent->d_name, S_ISDIR(st.st_mode), (uint64_t)st.st_size, mtimeOf(st)};
+        if (!visit(entry, visit_ctx)) {
+            break;
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+static bool statDir(void *ctx, const char *path, int64_t &mtime)
+{
+    (void)ctx;
+    struct stat st;
+    if ((stat(path, &st) != 0) || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    mtime = mtimeOf(st);
+    return true;
+}
+
+// The old selector: walk the whole tree and copy every matching path, then keep one page of it
+static size_t walkTree(const char *path, std::vector<std::string> &out)
+{
+    DIR *dir = opendir(path);
+    if (dir == nullptr) {
+        return 0;
+    }
+    for (struct dirent *ent = readdir(dir); ent != nullptr; ent = readdir(dir)) {
+        if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+            continue;
+        }
+        std::string child = std::string(path) + "/" + ent->d_name;
+        struct stat st;
+        stat(child.c_str(), &st);
+        if (S_ISDIR(st.st_mode)) {
+            walkTree(child.c_str(), out);
+        } else if ((child.size() > 4) && (child.compare(child.size() - 4, 4, ".csv") == 0)) {
+            out.push_back(child);
+        }
+    }
+    closedir(dir);
+    return out.size();
+}
+
+static void touch(const std::string &path)
+{
+    FILE *f = fopen(path.c_str(), "w");
+    if (f != nullptr) {
+        fputs("1,2\n", f);
+        fclose(f);
+    }
+}
+
+static int writeFile(void *ctx, const uint8_t *buf, size_t len)
+{
+    return (int)fwrite(buf, 1, len, static_cast<FILE *>(ctx));
+}
+
+static int readFile(void *ctx, uint8_t *buf, size_t len)
+{
+    return (int)fread(buf, 1, len, static_cast<FILE *>(ctx));
+}
+
+int main(int argc, char **argv)
+{
+    int dirs = (argc > 1) ? atoi(argv[1]) : 50;
+    int files = (argc > 2) ? atoi(argv[2]) : 100;
+    int failures = 0;
+
+    char root[] = "/tmp/bench_file_index_XXXXXX";
+    if (mkdtemp(root) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    for (int d = 0; d < dirs; d++) {
+        std::string dir = std::string(root) + "/run" + std::to_string(d);
+        mkdir(dir.c_str(), 0755);
+        if (d % 10 == 0) {
+            dir += "/nested";
+            mkdir(dir.c_str(), 0755);
+        }
+        for (int f = 0; f < files; f++) {
+            touch(dir + "/sample" + std::to_string(f) + ".csv");
+        }
+        touch(dir + "/notes.txt");
+        touch(dir + "/sample0.spc");
+    }
+    size_t expected = (size_t)dirs * files;
+
+    SpectrumFileIndex index;
+    SpectrumFileIndexStats full;
+    SpectrumFileIndexStats same;
+    SpectrumFileIndexStats changed;
+    index.refresh(root, ".csv", listDir, statDir, nullptr, &full);
+    failures += (index.size() != expected);
+    index.refresh(root, ".csv", listDir, statDir, nullptr, &same);
+    failures += (index.size() != expected) || (same.dirs_listed != 0);
+
+    touch(std::string(root) + "/run1/added.csv");
+    index.refresh(root, ".csv", listDir, statDir, nullptr, &changed);
+    failures += (index.size() != expected + 1) || (changed.dirs_listed != 1);
+    expected++;
+
+    // Save, load into a fresh index, refresh: nothing needs to be listed again
+    // Kept outside the tree, writing it into the root would change the root's mtime
+    std::string indexPath = std::string(root) + ".index";
+    FILE *out = fopen(indexPath.c_str(), "wb");
+    bool saved = index.save(writeFile, out);
+    fclose(out);
+    SpectrumFileIndex reloaded;
+    FILE *in = fopen(indexPath.c_str(), "rb");
+    uint32_t start = spectrum_time_us();
+    bool loaded = reloaded.load(readFile, in);
+    uint32_t load_us = spectrum_time_us() - start;
+    fclose(in);
+    SpectrumFileIndexStats after_load;
+    reloaded.refresh(root, ".csv", listDir, statDir, nullptr, &after_load);
+    failures += !saved || !loaded || (reloaded.size() != expected) || (after_load.dirs_listed != 0);
+    for (size_t i = 0; (i < index.size()) && (reloaded.size() == index.size()); i++) {
+        failures += (strcmp(index.path(i), reloaded.path(i)) != 0) || (strcmp(index.name(i), reloaded.name(i)) != 0);
+    }
+
+    // A page of five, from the table and from a fresh walk
+    const size_t per_page = 5;
+    const int pages = 2000;
+    size_t sink = 0;
+    start = spectrum_time_us();
+    for (int p = 0; p < pages; p++) {
+        size_t first;
+        size_t count = index.page((size_t)p % index.pageCount(per_page), per_page, first);
+        for (size_t i = first; i < first + count; i++) {
+            sink += strlen(index.name(i));
+        }
+    }
+    double table_ns = (double)(spectrum_time_us() - start) * 1000.0 / pages;
+
+    const int walks = 5;
+    start = spectrum_time_us();
+    for (int w = 0; w < walks; w++) {
+        std::vector<std::string> all;
+        sink += walkTree(root, all);
+    }
+    double walk_us = (double)(spectrum_time_us() - start) / walks;
+
+    // Type "sample12" one character at a time: every keystroke after the first only re-checks the previous matches
+    const char *typed = "Sample12";
+    SpectrumFileFilter filter;
+    SpectrumFileFilter fresh;
+    char query[16] = "";
+    size_t checked = 0;
+    start = spectrum_time_us();
+    for (size_t i = 0; typed[i] != '\0'; i++) {
+        query[i] = typed[i];
+        query[i + 1] = '\0';
+        filter.update(index, query);
+        checked += filter.checked();
+    }
+    uint32_t typing_us = spectrum_time_us() - start;
+    fresh.update(index, query);
+    failures += (filter.size() != fresh.size()) || (filter.size() == 0);
+    for (size_t i = 0; (i < filter.size()) && (filter.size() == fresh.size()); i++) {
+        failures += (filter.at(i) != fresh.at(i));
+    }
+    filter.update(index, "sample1");
+    failures += (filter.checked() != index.size());
+
+    printf("%8s %10s %10s %12s %12s %12s %10s %12s %12s\n", "files", "full us", "same us", "same stats", "change us",
+           "change list", "load us", "page ns", "walk us");
+    printf("%8zu %10u %10u %12u %12u %12u %10u %12.1f %12.0f\n", index.size(), full.elapsed_us, same.elapsed_us,
+           same.dirs_reused, changed.elapsed_us, changed.dirs_listed, load_us, table_ns, walk_us);
+    printf("Typing \"%s\": %zu matches, %zu names checked over %zu keystrokes (%zu for one full filter), %u us\n",
+           typed, fresh.size(), checked, strlen(typed), index.size(), typing_us);
+    printf("(checksum %zu)\n", sink);
+
+    remove(indexPath.c_str());
+    std::string cleanup = std::string("rm -rf ") + root;
+    if (system(cleanup.c_str()) != 0) {
+        fprintf(stderr, "Failed to remove %s\n", root);
+    }
+    if (failures != 0) {
+        printf("FAILED: %d checks\n", failures);
+    }
+    return (failures == 0) ? 0 : 1;
+}
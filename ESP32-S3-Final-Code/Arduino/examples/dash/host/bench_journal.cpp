@@ -0,0 +1,143 @@
+/*
+ * Benchmark for the results journal against a local file standing in for the SD card: the same records appended
+ * under each batching setting, from a write and an fsync per record to a block written when full, and compared with
+ * the plain way of logging (an O_APPEND write per record, synced or not). For each: records per second, the slowest
+ * append (what the UI thread would stall for), the bytes written per byte of record, flushes and syncs. Then the time
+ * `mount()` takes to check the largest journal.
+ *
+ * A file on a host SSD is not an SD card, but the counts are the same, and the card pays per sector and per sync far
+ * more than this disk does; point `dir` at a mounted card to see its real costs.
+ *
+ * Usage: bench_journal [records] [payload bytes] [dir]     (default: 2000 48 /tmp)
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_journal.h"
+
+struct Setting {
+    const char *name;
+    size_t block_size;
+    uint32_t flush_records;
+    uint32_t sync_every;
+    bool seal_sectors;
+};
+
+static const Setting settings[] = {
+    {"flush+sync each record",      4 * SPECTRUM_JOURNAL_SECTOR,  1,  1, false},
+    {"  sealed",                    4 * SPECTRUM_JOURNAL_SECTOR,  1,  1, true},
+    {"flush each, sync every 8",    4 * SPECTRUM_JOURNAL_SECTOR,  1,  8, false},
+    {"flush every 8, sync each",    4 * SPECTRUM_JOURNAL_SECTOR,  8,  1, false},
+    {"  sealed",                    4 * SPECTRUM_JOURNAL_SECTOR,  8,  1, true},
+    {"2 KB block, sync each",       4 * SPECTRUM_JOURNAL_SECTOR,  0,  1, false},
+    {"16 KB block, sync each",      32 * SPECTRUM_JOURNAL_SECTOR, 0,  1, false},
+    {"16 KB block, no sync",        32 * SPECTRUM_JOURNAL_SECTOR, 0,  0, false},
+};
+
+static void report(const char *name, uint32_t records, uint64_t elapsed_us, uint32_t max_us, double amplification,
+                   uint32_t flushes, uint32_t syncs)
+{
+    printf("%-28s %10.0f %10u %8.2f %8u %8u\n", name, records * 1e6 / (elapsed_us > 0 ? elapsed_us : 1),
+           (unsigned)max_us, amplification, (unsigned)flushes, (unsigned)syncs);
+}
+
+// One write() per record, as a logger without a journal would
+static void plainAppend(const std::string &path, uint32_t records, const std::vector<uint8_t> &payload, bool sync)
+{
+    unlink(path.c_str());
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    uint32_t max_us = 0;
+    uint32_t start = spectrum_time_us();
+    for (uint32_t i = 0; i < records; i++) {
+        uint32_t t0 = spectrum_time_us();
+        if ((write(fd, payload.data(), payload.size()) != (ssize_t)payload.size()) || (sync && (fsync(fd) != 0))) {
+            perror("write");
+            break;
+        }
+        uint32_t us = spectrum_time_us() - t0;
+        max_us = (us > max_us) ? us : max_us;
+    }
+    uint32_t elapsed = spectrum_time_us() - start;
+    close(fd);
+    // The card writes the whole sector under each record anyway
+    report(sync ? "plain append + fsync" : "plain append", records, elapsed, max_us,
+           sync ? (double)SPECTRUM_JOURNAL_SECTOR / payload.size() : 1.0, records, sync ? records : 0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t records = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 2000;
+    size_t length = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 48;
+    const char *parent = (argc > 3) ? argv[3] : "/tmp";
+    if ((records == 0) || (length > SPECTRUM_JOURNAL_PAYLOAD_MAX)) {
+        fprintf(stderr, "Records must be positive and payloads at most %d bytes\n", SPECTRUM_JOURNAL_PAYLOAD_MAX);
+        return 1;
+    }
+
+    std::string dir = std::string(parent) + "/bench_journal_XXXXXX";
+    if (mkdtemp(&dir[0]) == nullptr) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string path = dir + "/results.log";
+    std::vector<uint8_t> payload(length);
+    for (size_t i = 0; i < length; i++) {
+        payload[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    printf("%u records of %u bytes (%u with the header) in %s\n\n", (unsigned)records, (unsigned)length,
+           (unsigned)(length + SPECTRUM_JOURNAL_HEADER), dir.c_str());
+    printf("%-28s %10s %10s %8s %8s %8s\n", "", "records/s", "max us", "ampl.", "flushes", "syncs");
+    plainAppend(path, records, payload, true);
+    plainAppend(path, records, payload, false);
+
+    SpectrumJournal journal;
+    for (const Setting &setting : settings) {
+        SpectrumJournalConfig config = spectrumJournalDefaults();
+        config.block_size = setting.block_size;
+        config.flush_records = setting.flush_records;
+        config.flush_interval_ms = 0;
+        config.sync_every = setting.sync_every;
+        config.seal_sectors = setting.seal_sectors;
+        unlink(path.c_str());
+        if (!journal.mount(path.c_str(), config)) {
+            fprintf(stderr, "Could not mount %s\n", path.c_str());
+            return 1;
+        }
+
+        uint32_t max_us = 0;
+        uint32_t start = spectrum_time_us();
+        for (uint32_t i = 0; i < records; i++) {
+            uint32_t t0 = spectrum_time_us();
+            if (!journal.append(payload.data(), payload.size())) {
+                fprintf(stderr, "Append failed\n");
+                return 1;
+            }
+            uint32_t us = spectrum_time_us() - t0;
+            max_us = (us > max_us) ? us : max_us;
+        }
+        journal.sync();
+        uint32_t elapsed = spectrum_time_us() - start;
+        const SpectrumJournalStats &stats = journal.stats();
+        report(setting.name, records, elapsed, max_us, stats.amplification(), stats.flushes, stats.syncs);
+        journal.close();
+    }
+
+    // Recovery reads the whole journal back: what a boot costs as it grows
+    SpectrumJournalConfig config = spectrumJournalDefaults();
+    uint32_t start = spectrum_time_us();
+    bool mounted = journal.mount(path.c_str(), config);
+    uint32_t elapsed = spectrum_time_us() - start;
+    printf("\nmount: %u records checked in %.2f ms%s\n", (unsigned)journal.stats().recovered, elapsed / 1000.0,
+           mounted ? "" : " (failed)");
+    journal.close();
+
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+    return mounted ? 0 : 1;
+}
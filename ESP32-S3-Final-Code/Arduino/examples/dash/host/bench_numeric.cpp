@@ -0,0 +1,105 @@
+/*
+ * Benchmark for the numeric core: the same integration, prefix-sum and envelope kernels in double, float, Q16.16 and
+ * Q32.32, on the same float spectrum. Integration and prefix sums read the float samples and convert them as they go,
+ * as `SpectrumIndex` does; envelopes run on samples converted beforehand. For each type: millions of samples per
+ * second for each kernel, and how far its whole area is from the double one.
+ *
+ * A host has a double FPU, so double is as fast as float here; on the ESP32-S3 it is emulated and falls far behind,
+ * and on a part without an FPU so does float. The fixed-point rows are what those parts get instead.
+ *
+ * Usage: bench_numeric [points] [columns]     (default: 1000000 800)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_numeric.h"
+
+static const int ROUNDS = 5;                        // Best of, per kernel
+
+static volatile double sink;
+
+template <typename T>
+static std::vector<T> convert(const std::vector<float> &values)
+{
+    std::vector<T> out(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        out[i] = SpectrumNumeric<T>::from(values[i]);
+    }
+    return out;
+}
+
+// Samples per microsecond of the fastest of ROUNDS runs of `run`
+template <typename F>
+static double rate(size_t n, F run)
+{
+    uint32_t best = UINT32_MAX;
+    for (int r = 0; r < ROUNDS; r++) {
+        uint32_t start = spectrum_time_us();
+        run();
+        uint32_t us = spectrum_time_us() - start;
+        best = (us < best) ? us : best;
+    }
+    return (double)n / (best > 0 ? best : 1);
+}
+
+template <typename T>
+static void measure(const char *name, const std::vector<float> &x, const std::vector<float> &y, uint16_t columns,
+                    double expected)
+{
+    typedef typename SpectrumNumeric<T>::Accum Accum;
+    const size_t n = x.size();
+    double area = 0;
+    double integrate = rate(n, [&]() {
+        area = spectrumToDouble(spectrumIntegrate<T>(x.data(), y.data(), 0, n));
+        sink = area;
+    });
+
+    std::vector<Accum> prefix(n);
+    double prefix_sum = rate(n, [&]() {
+        spectrumPrefixSum<T>(x.data(), y.data(), 0, n, prefix.data());
+        sink = spectrumToDouble(prefix[n - 1]);
+    });
+
+    std::vector<T> tx = convert<T>(x);
+    std::vector<T> ty = convert<T>(y);
+    std::vector<T> ox(columns), omin(columns), omax(columns);
+    T lo, hi;
+    double envelope = rate(n, [&]() {
+        spectrumEnvelope<T>(tx.data(), ty.data(), 0, n, columns, ox.data(), omin.data(), omax.data(), &lo, &hi);
+        sink = spectrumToDouble(omax[columns / 2]);
+    });
+
+    printf("%-8s %12.1f %12.1f %12.1f %14.3g\n", name, integrate, prefix_sum, envelope, fabs(area - expected));
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000000;
+    uint16_t columns = (argc > 2) ? (uint16_t)strtoul(argv[2], nullptr, 10) : 800;
+    if ((n < 2) || (columns == 0)) {
+        fprintf(stderr, "Need at least 2 points and 1 column\n");
+        return 1;
+    }
+
+    // Descending wavenumbers as the instrument writes them, peaks on a sloped baseline, within Q16.16 range
+    std::vector<float> x(n);
+    std::vector<float> y(n);
+    for (size_t i = 0; i < n; i++) {
+        double w = 4000.0 - 3600.0 * (double)i / (double)(n - 1);
+        x[i] = (float)w;
+        y[i] = (float)(0.05 + 1e-5 * w + 1.8 * exp(-pow((w - 2250) / 12, 2)) + 0.9 * exp(-pow((w - 1650) / 30, 2)) +
+                       0.002 * ((double)((i * 2654435761u) % 1000) / 1000.0 - 0.5));
+    }
+    double expected = spectrumIntegrate<double>(x.data(), y.data(), 0, n);
+
+    printf("%u points, %u columns, area %.6f\n\n", (unsigned)n, (unsigned)columns, expected);
+    printf("%-8s %12s %12s %12s %14s\n", "", "integrate", "prefix sum", "envelope", "area error");
+    printf("%-8s %12s %12s %12s %14s\n", "", "Msamples/s", "Msamples/s", "Msamples/s", "vs double");
+    measure<double>("double", x, y, columns, expected);
+    measure<float>("float", x, y, columns, expected);
+    measure<SpectrumQ16>("Q16.16", x, y, columns, expected);
+    measure<SpectrumQ32>("Q32.32", x, y, columns, expected);
+    return 0;
+}
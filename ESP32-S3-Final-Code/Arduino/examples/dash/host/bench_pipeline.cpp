@@ -0,0 +1,384 @@
+/*
+ * End-to-end benchmark of the dash analysis pipeline, on synthetic spectra of every size the panel may open:
+ *
+ *   parse          CSV text to the sample store, as loadCSV() does (from memory, so the disk is not measured)
+ *   index          trapezoid prefix table over the samples
+ *   pyramid        min/max blocks for the chart
+ *   area           raw area between two wavenumbers, what a slider move costs without processing
+ *   process        baseline corrected area and peaks of a range, as computeAreaUnderCurve() does on a slider move
+ *   decimate       chart envelope of a new view (zoom or pan), as update_chart() does on a drag
+ *   api json       whole /api/spectrum?format=json body at the chart width
+ *   state json     /api/state body
+ *
+ * Each stage is timed per operation and reported as latency percentiles and throughput, as JSON on stdout (one result
+ * per line) and as a table on stderr. The spectra, the ranges and the views come from a fixed seed and the number of
+ * operations does not depend on timing, so two runs do the same work and can be compared: with `--baseline`, a
+ * stage whose median is slower than the baseline's by more than `--tolerance` (and more than the timer noise of the
+ * sub-microsecond stages) fails the run.
+ *
+ * Usage: bench_pipeline [--points n,n,...] [--baseline results.json] [--tolerance 0.25]
+ *        (default points: 1000,10000,100000,1000000,10000000)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_api.h"
+#include "spectrum_csv.h"
+#include "spectrum_decimate.h"
+#include "spectrum_index.h"
+#include "spectrum_process.h"
+#include "spectrum_pyramid.h"
+#include "spectrum_store.h"
+
+static const uint64_t SEED = 20240611;
+static const uint16_t WIDTH = 800;                  // Chart and web page columns
+static const int QUERIES = 20000;                   // Per size, for the per-query stages
+static const int DRAG = 50;                         // Slider steps per drag
+static const int VIEWS = 2000;
+static const double NOISE_NS = 250;                 // Slowdowns of the median below this are not regressions
+
+static uint64_t rngState = SEED;
+
+// Deterministic, uniform in [0, 1)
+static double uniform(void)
+{
+    rngState = rngState * 6364136223846793005ull + 1442695040888963407ull;
+    return (double)(rngState >> 11) / (double)(1ull << 53);
+}
+
+static double nowNs(void)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Stage {
+    const char *name;
+    uint32_t points;
+    std::vector<double> ns;     // One per operation
+    double items;               // Per operation, for the throughput
+    const char *item_unit;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    double mean;
+    double throughput;          // items per second over all operations
+};
+
+static std::vector<Stage> results;
+static volatile double sink = 0;    // Keeps the compiler from dropping the work
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    size_t rank = (size_t)ceil(p * sorted.size());
+    return sorted[(rank == 0) ? 0 : rank - 1];
+}
+
+static void record(const char *name, uint32_t points, std::vector<double> &ns, double items, const char *item_unit)
+{
+    Stage stage;
+    stage.name = name;
+    stage.points = points;
+    stage.items = items;
+    stage.item_unit = item_unit;
+    std::sort(ns.begin(), ns.end());
+    double total = 0;
+    for (double v : ns) {
+        total += v;
+    }
+    stage.p50 = percentile(ns, 0.50);
+    stage.p90 = percentile(ns, 0.90);
+    stage.p99 = percentile(ns, 0.99);
+    stage.max = ns.back();
+    stage.mean = total / ns.size();
+    stage.throughput = items * ns.size() / (total * 1e-9);
+    stage.ns.swap(ns);
+    results.push_back(stage);
+}
+
+// Whole-spectrum stages are repeated for about a second of work, at least 3 and at most 50 times; the first run is a
+// warm-up and is not counted. The count depends on the size only, not on how fast this run is.
+static int wholeRuns(uint32_t points)
+{
+    int runs = (int)(2e7 / (points + 1000.0));
+    return (runs < 3) ? 3 : ((runs > 50) ? 50 : runs);
+}
+
+// Descending wavenumbers like an FTIR export: a sloped background, three peaks and noise
+static std::string makeCsv(uint32_t points)
+{
+    std::string csv = "Wavenumber,Intensity\r\n";
+    csv.reserve((size_t)points * 24 + 32);
+    char row[64];
+    for (uint32_t i = 0; i < points; i++) {
+        double w = 4000.0 - 3500.0 * i / (points - 1);
+        double u1 = (w - 2250) / 15, u2 = (w - 2330) / 8, u3 = (w - 1650) / 20;
+        double y = 0.5 + 0.0002 * (w - 2000) + 0.3 * exp(-0.5 * u1 * u1) + 0.1 * exp(-0.5 * u2 * u2) +
+                   0.05 * exp(-0.5 * u3 * u3) + 0.002 * (uniform() - 0.5);
+        int n = snprintf(row, sizeof(row), "%.4f,%.6f\r\n", w, y);
+        csv.append(row, n);
+    }
+    return csv;
+}
+
+struct MemoryReader {
+    const std::string *text;
+    size_t offset;
+};
+
+static int readMemory(void *ctx, uint8_t *buf, size_t len)
+{
+    MemoryReader *reader = static_cast<MemoryReader *>(ctx);
+    size_t left = reader->text->size() - reader->offset;
+    size_t n = (len < left) ? len : left;
+    memcpy(buf, reader->text->data() + reader->offset, n);
+    reader->offset += n;
+    return (int)n;
+}
+
+static bool storePoint(float x, float y, void *user_data)
+{
+    return static_cast<SpectrumStore *>(user_data)->push(x, y);
+}
+
+// Ranges processed: processing costs O(samples in the range), so big spectra get fewer, still a fixed number per size
+static int processQueries(uint32_t points)
+{
+    int queries = (int)(2e9 / points);
+    return (queries < 200) ? 200 : ((queries > QUERIES) ? QUERIES : queries);
+}
+
+// A range like the ones picked with the sliders: 20 to 600 wavenumbers wide, anywhere in the spectrum
+static void randomRange(double &lower, double &upper)
+{
+    double width = 20 + 580 * uniform();
+    lower = 500 + (3500 - width) * uniform();
+    upper = lower + width;
+}
+
+static void benchSize(uint32_t points)
+{
+    rngState = SEED ^ points;
+    const std::string csv = makeCsv(points);
+    const int runs = wholeRuns(points);
+    std::vector<double> ns;
+
+    static uint8_t chunk[SPECTRUM_CSV_CHUNK_SIZE];
+    SpectrumStore store;
+    for (int run = 0; run <= runs; run++) {
+        store.clear();
+        store.reserve(SpectrumStore::estimateRows(csv.size()));
+        MemoryReader reader = {&csv, 0};
+        SpectrumCsvParser parser(storePoint, &store);
+        double start = nowNs();
+        spectrumCsvParseStream(readMemory, &reader, chunk, sizeof(chunk), parser, nullptr);
+        if (run > 0) {
+            ns.push_back(nowNs() - start);
+        }
+    }
+    if (store.size() != points) {
+        fprintf(stderr, "parsed %u rows of %u\n", (unsigned)store.size(), (unsigned)points);
+        exit(1);
+    }
+    record("parse", points, ns, csv.size(), "bytes");
+
+    SpectrumIndex index;
+    for (int run = 0; run <= runs; run++) {
+        double start = nowNs();
+        index.build(store.x(), store.y(), store.size());
+        if (run > 0) {
+            ns.push_back(nowNs() - start);
+        }
+    }
+    record("index", points, ns, points, "points");
+
+    SpectrumPyramid pyramid;
+    for (int run = 0; run <= runs; run++) {
+        double start = nowNs();
+        pyramid.build(store.x(), store.y(), store.size());
+        if (run > 0) {
+            ns.push_back(nowNs() - start);
+        }
+    }
+    record("pyramid", points, ns, points, "points");
+
+    for (int q = 0; q < QUERIES; q++) {
+        double lower, upper;
+        randomRange(lower, upper);
+        double start = nowNs();
+        sink = sink + index.areaBetween(lower, upper);
+        ns.push_back(nowNs() - start);
+    }
+    record("area", points, ns, 1, "queries");
+
+    // Slider drags: each range a small step from the previous one, so the smoothed tiles build up as on the panel
+    SpectrumProcessor processor;
+    processor.attach(store.x(), store.y(), store.size(), &index);
+    SpectrumProcessSettings settings = {SPECTRUM_BASELINE_LINEAR, 11, 2, 0.1f};
+    processor.configure(settings);
+    double lower = 2100, upper = 2400;
+    for (int q = 0; q < processQueries(points); q++) {
+        if ((q % DRAG) == 0) {
+            randomRange(lower, upper);      // A new drag
+        } else {
+            double step = 4 * (uniform() - 0.5);
+            lower += step;
+            upper += step;
+        }
+        double start = nowNs();
+        sink = sink + processor.process(lower, upper).area;
+        ns.push_back(nowNs() - start);
+    }
+    record("process", points, ns, 1, "queries");
+
+    SpectrumDecimator decimator;
+    decimator.setPyramid(&pyramid);
+    for (int v = 0; v < VIEWS; v++) {
+        size_t length = (size_t)(points * pow(2.0, -8 * uniform()));
+        length = (length < 16) ? ((points < 16) ? points : 16) : length;
+        size_t from = (size_t)((points - length) * uniform());
+        double start = nowNs();
+        const SpectrumEnvelope *env = decimator.envelope(store.x(), store.y(), from, from + length, WIDTH);
+        ns.push_back(nowNs() - start);
+        sink = sink + ((env != nullptr) ? env->max[0] : 0);
+    }
+    record("decimate", points, ns, WIDTH, "columns");
+
+    // The page's first chart request, for the whole spectrum
+    static char body[SPECTRUM_HTTP_BODY_MAX];
+    size_t bytes = 0;
+    for (int r = 0; r < 200; r++) {
+        char query[64];
+        snprintf(query, sizeof(query), "width=%u&format=json", (unsigned)WIDTH);
+        double start = nowNs();
+        SpectrumApiStream stream;
+        if (!spectrumApiParse(query, index, pyramid, stream)) {
+            fprintf(stderr, "bad query %s\n", query);
+            exit(1);
+        }
+        size_t sent = 0;
+        bool done = false;
+        while (!done) {
+            sent += spectrumApiBody(nullptr, &stream, body, SPECTRUM_HTTP_BODY_MAX - 16, done);
+        }
+        ns.push_back(nowNs() - start);
+        bytes += sent;
+    }
+    record("api json", points, ns, (double)bytes / 200, "bytes");
+
+    char state[SPECTRUM_HTTP_BODY_MAX];
+    for (int q = 0; q < QUERIES; q++) {
+        SpectrumApiState values = {12.34 + q, (q % 2) ? NAN : 5.67, 2100, 2400, 500, 4000, (uint32_t)q,
+                                   (uint32_t)q / 2};
+        double start = nowNs();
+        int n = spectrumApiFormatState(state, sizeof(state), values);
+        ns.push_back(nowNs() - start);
+        sink = sink + n;
+    }
+    record("state json", points, ns, 1, "bodies");
+}
+
+static void printJson(void)
+{
+    printf("{\"suite\":\"dash_pipeline\",\"seed\":%llu,\"compiler\":\"%s\",\"results\":[\n",
+           (unsigned long long)SEED, __VERSION__);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Stage &s = results[i];
+        printf("{\"stage\":\"%s\",\"points\":%u,\"ops\":%u,\"p50_ns\":%.0f,\"p90_ns\":%.0f,\"p99_ns\":%.0f,"
+               "\"max_ns\":%.0f,\"mean_ns\":%.0f,\"throughput\":%.6g,\"unit\":\"%s/s\"}%s\n",
+               s.name, s.points, (unsigned)s.ns.size(), s.p50, s.p90, s.p99, s.max, s.mean, s.throughput,
+               s.item_unit, (i + 1 < results.size()) ? "," : "");
+    }
+    printf("]}\n");
+}
+
+static void printTable(void)
+{
+    fprintf(stderr, "%-11s %10s %6s %12s %12s %12s %12s %14s\n", "stage", "points", "ops", "p50 us", "p90 us",
+            "p99 us", "max us", "throughput");
+    for (const Stage &s : results) {
+        fprintf(stderr, "%-11s %10u %6u %12.3f %12.3f %12.3f %12.3f %10.4g %s/s\n", s.name, s.points,
+                (unsigned)s.ns.size(), s.p50 / 1e3, s.p90 / 1e3, s.p99 / 1e3, s.max / 1e3, s.throughput, s.item_unit);
+    }
+}
+
+// Compares the medians with those of an earlier run's JSON, which has one result per line
+static int compareBaseline(const char *path, double tolerance)
+{
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        perror(path);
+        return 1;
+    }
+    int regressions = 0;
+    int compared = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        char name[32];
+        unsigned points;
+        double p50;
+        const char *stage = strstr(line, "{\"stage\":\"");
+        if ((stage == nullptr) ||
+            (sscanf(stage, "{\"stage\":\"%31[^\"]\",\"points\":%u,\"ops\":%*u,\"p50_ns\":%lf", name, &points,
+                    &p50) != 3)) {
+            continue;
+        }
+        for (const Stage &s : results) {
+            if ((strcmp(s.name, name) != 0) || (s.points != points)) {
+                continue;
+            }
+            compared++;
+            double ratio = s.p50 / ((p50 > 0) ? p50 : 1);
+            if ((ratio > 1 + tolerance) && (s.p50 - p50 > NOISE_NS)) {
+                fprintf(stderr, "REGRESSION %s at %u points: median %.3f us, was %.3f us (%+.0f%%)\n", name, points,
+                        s.p50 / 1e3, p50 / 1e3, (ratio - 1) * 100);
+                regressions++;
+            }
+        }
+    }
+    fclose(f);
+    fprintf(stderr, "%d stages compared with %s, %d slower by more than %.0f%%\n", compared, path, regressions,
+            tolerance * 100);
+    return (regressions == 0) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> sizes = {1000, 10000, 100000, 1000000, 10000000};
+    const char *baseline = nullptr;
+    double tolerance = 0.25;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--points") == 0) && (i + 1 < argc)) {
+            sizes.clear();
+            for (char *p = argv[++i]; *p != '\0';) {
+                sizes.push_back((uint32_t)strtoul(p, &p, 10));
+                p += (*p == ',') ? 1 : 0;
+            }
+        } else if ((strcmp(argv[i], "--baseline") == 0) && (i + 1 < argc)) {
+            baseline = argv[++i];
+        } else if ((strcmp(argv[i], "--tolerance") == 0) && (i + 1 < argc)) {
+            tolerance = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--points n,n,...] [--baseline results.json] [--tolerance 0.25]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (uint32_t points : sizes) {
+        if (points < 2) {
+            fprintf(stderr, "At least 2 points\n");
+            return 2;
+        }
+        benchSize(points);
+    }
+    printJson();
+    printTable();
+    return (baseline != nullptr) ? compareBaseline(baseline, tolerance) : 0;
+}
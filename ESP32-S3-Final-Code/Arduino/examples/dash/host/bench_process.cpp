@@ -0,0 +1,212 @@
+/*
+ * Benchmark for the range processing: the smoothing, baseline and clipping kernels on their SIMD and scalar paths, then
+ * the whole pipeline on a synthetic spectrum (sloped or curved background, three Gaussian peaks, noise) for a first
+ * range, a slider nudge that only smooths one more tile, and an unchanged range. Checks that both kernel paths agree,
+ * that the peaks come out where they were put with the right widths, and that the corrected area matches the peaks'
+ * and does not move with the spectrum's offset.
+ *
+ * Usage: bench_process [points...]     (default: 100000 1000000)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_index.h"
+#include "spectrum_process.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Best of a few runs, in microseconds
+template <typename Fn>
+static double timeUs(Fn fn)
+{
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        uint32_t start = spectrum_time_us();
+        fn();
+        double us = (double)(spectrum_time_us() - start);
+        best = (us < best) ? us : best;
+    }
+    return best;
+}
+
+static float maxDiff(const std::vector<float> &a, const std::vector<float> &b)
+{
+    float diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff = fmaxf(diff, fabsf(a[i] - b[i]));
+    }
+    return diff;
+}
+
+static void benchKernels(uint32_t n)
+{
+    std::vector<float> in(n + SPECTRUM_SMOOTH_MAX_WINDOW);
+    std::vector<float> t(n);
+    for (uint32_t i = 0; i < in.size(); i++) {
+        in[i] = 1.0f + 0.5f * sinf(0.001f * (float)i) + 0.01f * (float)((i * 2654435761u) % 1000) / 1000.0f;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        t[i] = -1.0f + 2.0f * (float)i / (float)n;
+    }
+    std::vector<float> simd(n);
+    std::vector<float> scalar(n);
+
+    for (int window : {11, 25}) {
+        float coef[SPECTRUM_SMOOTH_MAX_WINDOW];
+        spectrumSavgolCoefficients(window, 2, coef);
+        double simd_us = timeUs([&]() { spectrumConvolve(in.data(), simd.data(), n, coef, window); });
+        double scalar_us = timeUs([&]() { spectrumConvolveScalar(in.data(), scalar.data(), n, coef, window); });
+        check(maxDiff(simd, scalar) <= 1e-5f, "convolution paths differ");
+        printf("%10u %-22s %2d %12.1f %12.1f %8.2fx\n", n, "savgol convolve", window, n / scalar_us, n / simd_us,
+               scalar_us / simd_us);
+    }
+
+    const float poly[4] = {1.0f, 0.2f, -0.1f, 0.05f};
+    double simd_us = timeUs([&]() { spectrumSubtractPolynomial(t.data(), in.data(), simd.data(), n, poly, 3); });
+    double scalar_us = timeUs([&]() {
+        spectrumSubtractPolynomialScalar(t.data(), in.data(), scalar.data(), n, poly, 3);
+    });
+    check(maxDiff(simd, scalar) <= 1e-6f, "baseline subtraction paths differ");
+    printf("%10u %-22s %2d %12.1f %12.1f %8.2fx\n", n, "subtract cubic", 3, n / scalar_us, n / simd_us,
+           scalar_us / simd_us);
+
+    std::vector<float> clip_simd(in.begin(), in.begin() + n);
+    std::vector<float> clip_scalar(clip_simd);
+    double moments_simd[4];
+    double moments_scalar[4];
+    simd_us = timeUs([&]() { spectrumClipMoments(t.data(), clip_simd.data(), n, poly, 3, moments_simd); });
+    scalar_us = timeUs([&]() {
+        spectrumClipMomentsScalar(t.data(), clip_scalar.data(), n, poly, 3, moments_scalar);
+    });
+    check(maxDiff(clip_simd, clip_scalar) == 0, "clipping paths differ");
+    for (int k = 0; k < 4; k++) {
+        check(fabs(moments_simd[k] - moments_scalar[k]) <= 1e-5 * n, "moment paths differ");
+    }
+    printf("%10u %-22s %2d %12.1f %12.1f %8.2fx\n", n, "clip + moments", 3, n / scalar_us, n / simd_us,
+           scalar_us / simd_us);
+}
+
+static double gaussian(double x, double center, double sigma)
+{
+    return exp(-0.5 * (x - center) * (x - center) / (sigma * sigma));
+}
+
+static void benchPipeline(uint32_t n)
+{
+    // Descending wavenumbers like an FTIR export, peaks at 2250 (the one of interest), 2330 and 1650
+    const double peak_area = 0.3 * 15 * sqrt(2 * M_PI) + 0.1 * 8 * sqrt(2 * M_PI);
+    std::vector<float> x(n);
+    std::vector<float> y(n);
+    std::vector<float> shifted(n);
+    std::vector<float> curved(n);
+    for (uint32_t i = 0; i < n; i++) {
+        double w = 4000.0 - 3500.0 * i / (n - 1);
+        double peaks = 0.3 * gaussian(w, 2250, 15) + 0.1 * gaussian(w, 2330, 8) + 0.05 * gaussian(w, 1650, 20);
+        double noise = 0.001 * ((double)((i * 2654435761u) % 1000) / 500.0 - 1.0);
+        x[i] = (float)w;
+        y[i] = (float)(0.5 + 0.0002 * (w - 2000) + peaks + noise);
+        shifted[i] = y[i] + 100.0f;
+        double u = (w - 2250) / 150;
+        curved[i] = (float)(0.5 + 0.0002 * (w - 2000) + 0.05 * u * u + peaks + noise);
+    }
+
+    SpectrumIndex index;
+    index.build(x.data(), y.data(), n);
+    SpectrumProcessor processor;
+    processor.attach(x.data(), y.data(), n, &index);
+    SpectrumProcessSettings settings = {SPECTRUM_BASELINE_LINEAR, 11, 2, 0.1f};
+    check(processor.configure(settings), "configure");
+
+    uint32_t start = spectrum_time_us();
+    SpectrumProcessResult first = processor.process(2100, 2400);
+    double cold_us = spectrum_time_us() - start;
+    uint32_t cold_smoothed = first.smoothed;
+
+    // A slider step: only the tiles the range grows into are smoothed
+    start = spectrum_time_us();
+    SpectrumProcessResult nudged = processor.process(2098, 2400);
+    double nudge_us = spectrum_time_us() - start;
+
+    const int repeats = 100000;
+    volatile double sink = 0;
+    start = spectrum_time_us();
+    for (int r = 0; r < repeats; r++) {
+        sink = sink + processor.process(2098, 2400).area;
+    }
+    double same_ns = (spectrum_time_us() - start) * 1000.0 / repeats;
+
+    settings.baseline = SPECTRUM_BASELINE_POLYNOMIAL;
+    processor.configure(settings);
+    start = spectrum_time_us();
+    SpectrumProcessResult polynomial = processor.process(2100, 2400);
+    double polynomial_us = spectrum_time_us() - start;
+
+    printf("%10u %10.1f %8u %10.1f %8u %10.1f %12.1f %10.4f %10.4f %8.2f %8.2f\n", n, cold_us, cold_smoothed,
+           nudge_us, nudged.smoothed, same_ns, polynomial_us, first.area, polynomial.area, first.peaks[0].x,
+           first.peaks[0].fwhm);
+
+    check(first.peak_count >= 2, "peaks found");
+    check(fabs(first.peaks[0].x - 2250) < 0.5, "main peak position");
+    check(fabs(first.peaks[0].height - 0.3) < 0.01, "main peak height");
+    check(fabs(first.peaks[0].fwhm - 2 * sqrt(2 * log(2.0)) * 15) < 0.03 * 35.3, "main peak width");
+    check(fabs(first.peaks[1].x - 2330) < 0.5, "second peak position");
+    check(fabs(first.area - peak_area) < 0.01 * peak_area, "linear baseline area");
+    check(fabs(polynomial.area - peak_area) < 0.03 * peak_area, "polynomial baseline area");
+    check(nudged.smoothed <= n * 2 / 3500 + 2 * SPECTRUM_PROCESS_TILE, "nudge only smooths the tiles it adds");
+    check(cold_smoothed > 0, "first range smoothed its tiles");
+
+    // The offset of the spectrum must not change the corrected area, nor a curved background the polynomial one
+    SpectrumIndex shifted_index;
+    shifted_index.build(x.data(), shifted.data(), n);
+    SpectrumProcessor shifted_processor;
+    shifted_processor.attach(x.data(), shifted.data(), n, &shifted_index);
+    settings.baseline = SPECTRUM_BASELINE_LINEAR;
+    shifted_processor.configure(settings);
+    double shifted_area = shifted_processor.process(2100, 2400).area;
+    check(fabs(shifted_area - first.area) < 2e-3 * peak_area, "area moves with the offset");
+    check(fabs(shifted_processor.process(2100, 2400).raw_area - first.raw_area) > 1000,
+          "raw area moves with the offset");
+
+    SpectrumIndex curved_index;
+    curved_index.build(x.data(), curved.data(), n);
+    SpectrumProcessor curved_processor;
+    curved_processor.attach(x.data(), curved.data(), n, &curved_index);
+    settings.baseline = SPECTRUM_BASELINE_POLYNOMIAL;
+    curved_processor.configure(settings);
+    double curved_area = curved_processor.process(2100, 2400).area;
+    check(fabs(curved_area - peak_area) < 0.03 * peak_area, "polynomial baseline on a curved background");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> sizes = {100000, 1000000};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) {
+            sizes.push_back((uint32_t)strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    printf("SIMD path: %s\n", SPECTRUM_PROCESS_SIMD ? "vector extensions" : "scalar (not available)");
+    printf("%10s %-22s %2s %12s %12s %9s\n", "points", "kernel", "n", "scalar M/s", "simd M/s", "speedup");
+    for (uint32_t n : sizes) {
+        benchKernels(n);
+    }
+
+    printf("\n%10s %10s %8s %10s %8s %10s %12s %10s %10s %8s %8s\n", "points", "first us", "smoothed", "nudge us",
+           "smoothed", "same ns", "polynom. us", "area lin", "area poly", "peak", "fwhm");
+    for (uint32_t n : sizes) {
+        benchPipeline(n);
+    }
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+/*
+ * Benchmark for the chart data sent to the web page, over the whole spectrum at a chart width of 800 columns:
+ *
+ *   string     the first web page: one String grown point by point, then sent (std::string here; Arduino's String
+ *              reallocates to the exact length on every append, so on the device it allocates even more)
+ *   chart      /api/chart: a linear min/max envelope of the whole range, then encoded chunk by chunk
+ *   api json   /api/spectrum?format=json: columns computed from the pyramid one block per chunk
+ *   api f32    /api/spectrum?format=f32: the same columns as little-endian float32
+ *
+ * Bytes, heap allocations (operator new) and time to the first chunk / whole body. Chunks are the size the HTTP
+ * server hands to body callbacks; nothing goes to a socket. The api json body must match the chart one.
+ *
+ * Usage: bench_spectrum_api [points...]     (default: 10000 100000 1000000)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_api.h"
+#include "spectrum_decimate.h"
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+    (void)size;
+    free(p);
+}
+
+struct Result {
+    size_t bytes;
+    size_t allocations;
+    uint32_t first_us;
+    uint32_t total_us;
+    double checksum;    // Keeps the compiler from dropping the output
+};
+
+static const size_t CHUNK = SPECTRUM_HTTP_BODY_MAX - 16;
+static const uint16_t WIDTH = 800;
+
+static void consume(Result &result, const char *data, size_t length, uint32_t start)
+{
+    if (result.bytes == 0) {
+        result.first_us = spectrum_time_us() - start;
+    }
+    result.bytes += length;
+    for (size_t i = 0; i < length; i += 64) {
+        result.checksum += (unsigned char)data[i];
+    }
+}
+
+static Result runString(const std::vector<float> &x, const std::vector<float> &y)
+{
+    Result result = {};
+    size_t before = allocations;
+    uint32_t start = spectrum_time_us();
+    std::vector<float> cx(WIDTH), cmin(WIDTH), cmax(WIDTH);
+    float lo, hi;
+    spectrumEnvelopeCompute(x.data(), y.data(), 0, x.size(), WIDTH, cx.data(), cmin.data(), cmax.data(), &lo, &hi);
+    std::string json = "[";
+    for (uint16_t i = 0; i < WIDTH; i++) {
+        if (i > 0) {
+            json += ",";
+        }
+        json += "{\"x\":" + std::to_string(cx[i]) + ",\"min\":" + std::to_string(cmin[i]) + ",\"max\":" +
+                std::to_string(cmax[i]) + "}";
+    }
+    json += "]";
+    for (size_t sent = 0; sent < json.size(); sent += CHUNK) {
+        size_t length = json.size() - sent;
+        consume(result, json.data() + sent, (length > CHUNK) ? CHUNK : length, start);
+    }
+    result.total_us = spectrum_time_us() - start;
+    result.allocations = allocations - before;
+    return result;
+}
+
+static Result runChart(const std::vector<float> &x, const std::vector<float> &y)
+{
+    Result result = {};
+    size_t before = allocations;
+    uint32_t start = spectrum_time_us();
+    std::vector<float> cx(WIDTH), cmin(WIDTH), cmax(WIDTH);
+    float lo, hi;
+    spectrumEnvelopeCompute(x.data(), y.data(), 0, x.size(), WIDTH, cx.data(), cmin.data(), cmax.data(), &lo, &hi);
+    char buffer[CHUNK];
+    size_t used = 0;
+    buffer[used++] = '[';
+    for (uint16_t i = 0; i < WIDTH; i++) {
+        int n = snprintf(buffer + used, CHUNK - used, "%s%.6g,%.6g,%.6g", (i > 0) ? "," : "", cx[i], cmin[i], cmax[i]);
+        if ((size_t)n >= CHUNK - used) {
+            consume(result, buffer, used, start);
+            used = 0;
+            i--;
+            continue;
+        }
+        used += n;
+    }
+    buffer[used++] = ']';
+    consume(result, buffer, used, start);
+    result.total_us = spectrum_time_us() - start;
+    result.allocations = allocations - before;
+    return result;
+}
+
+static Result runApi(const SpectrumIndex &index, const SpectrumPyramid &pyramid, const char *query, bool &valid)
+{
+    Result result = {};
+    size_t before = allocations;
+    uint32_t start = spectrum_time_us();
+    SpectrumApiStream stream;
+    valid = spectrumApiParse(query, index, pyramid, stream);
+    char buffer[CHUNK];
+    bool done = !valid;
+    while (!done) {
+        size_t length = spectrumApiBody(nullptr, &stream, buffer, sizeof(buffer), done);
+        if (length == 0 && !done) {
+            valid = false;
+            break;
+        }
+        consume(result, buffer, length, start);
+    }
+    result.total_us = spectrum_time_us() - start;
+    result.allocations = allocations - before;
+    return result;
+}
+
+static void print(uint32_t points, const char *path, const Result &result)
+{
+    printf("%10u %10s %10zu %8zu %10u %10u\n", points, path, result.bytes, result.allocations, result.first_us,
+           result.total_us);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> sizes = {10000, 100000, 1000000};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) {
+            sizes.push_back((uint32_t)strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    int failures = 0;
+    printf("%10s %10s %10s %8s %10s %10s\n", "points", "path", "bytes", "allocs", "first us", "total us");
+    for (uint32_t n : sizes) {
+        std::vector<float> x(n);
+        std::vector<float> y(n);
+        for (uint32_t i = 0; i < n; i++) {
+            x[i] = 4000.0f - 3500.0f * (float)i / (float)n;
+            y[i] = 50.0f + 10.0f * sinf((float)i * 0.01f) + (float)((i * 2654435761u) % 1000) / 1000.0f;
+        }
+        SpectrumIndex index;
+        SpectrumPyramid pyramid;
+        if (!index.build(x.data(), y.data(), n) || !pyramid.build(x.data(), y.data(), n)) {
+            printf("%10u out of memory\n", n);
+            failures++;
+            continue;
+        }
+
+        Result chart = runChart(x, y);
+        print(n, "string", runString(x, y));
+        print(n, "chart", chart);
+        bool json_valid, f32_valid;
+        Result json = runApi(index, pyramid, "width=800", json_valid);
+        Result f32 = runApi(index, pyramid, "width=800&format=f32", f32_valid);
+        print(n, "api json", json);
+        print(n, "api f32", f32);
+        if (!json_valid || !f32_valid || (json.bytes != chart.bytes) ||
+            (json.checksum != chart.checksum) || (json.allocations != 0) || (f32.allocations != 0) ||
+            (f32.bytes != (size_t)WIDTH * 3 * sizeof(float))) {
+            printf("%10u api stream FAILED\n", n);
+            failures++;
+        }
+        // strtod() takes "nan" and "inf", which no clamp would catch
+        const char *invalid[] = {"width=0", "width=nan", "width=inf", "from=nan", "to=-inf", "format=csv"};
+        for (const char *query : invalid) {
+            SpectrumApiStream stream;
+            if (spectrumApiParse(query, index, pyramid, stream)) {
+                printf("%10u %s accepted\n", n, query);
+                failures++;
+            }
+        }
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
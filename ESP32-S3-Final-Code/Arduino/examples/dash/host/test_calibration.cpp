@@ -0,0 +1,489 @@
+/*
+ * Test for the calibration fit: datasets of thousands of standards, with and without noise, weighted or not, checked
+ * against a Householder QR solve in long double on the raw powers of the area; the statistics against their
+ * definitions; degenerate sets; the saved file; concentrations from file names; and a batch of standard files on the
+ * worker tasks feeding the fit, like the Calibrate button does.
+ *
+ * Usage: test_calibration
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_batch.h"
+#include "spectrum_calibration.h"
+#include "spectrum_process.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+// Deterministic noise, uniform in [-1, 1)
+static double noise(uint64_t &state)
+{
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return (double)(state >> 11) / (double)(1ull << 52) - 1.0;
+}
+
+struct Dataset {
+    const char *name;
+    SpectrumCalibrationModel model;
+    SpectrumCalibrationWeighting weighting;
+    std::vector<double> area;
+    std::vector<double> concentration;
+};
+
+static double referenceWeight(const Dataset &set, size_t i)
+{
+    double floor_y = INFINITY;
+    for (double y : set.concentration) {
+        if (y != 0) {
+            floor_y = fmin(floor_y, fabs(y));
+        }
+    }
+    double y = fmax(fabs(set.concentration[i]), floor_y);
+    switch (set.weighting) {
+    case SPECTRUM_CALIBRATION_INVERSE:
+        return 1.0 / y;
+    case SPECTRUM_CALIBRATION_INVERSE_SQUARE:
+        return 1.0 / (y * y);
+    default:
+        return 1.0;
+    }
+}
+
+// Weighted least squares by Householder QR of [sqrt(w) sqrt(w)a sqrt(w)a^2], in long double
+static std::vector<long double> referenceFit(const Dataset &set)
+{
+    int terms = (set.model == SPECTRUM_CALIBRATION_QUADRATIC) ? 3 : 2;
+    size_t n = set.area.size();
+    std::vector<std::vector<long double>> col(terms, std::vector<long double>(n));
+    std::vector<long double> rhs(n);
+    for (size_t i = 0; i < n; i++) {
+        long double sw = sqrtl((long double)referenceWeight(set, i));
+        long double a = set.area[i];
+        col[0][i] = sw;
+        col[1][i] = sw * a;
+        if (terms == 3) {
+            col[2][i] = sw * a * a;
+        }
+        rhs[i] = sw * set.concentration[i];
+    }
+    for (int k = 0; k < terms; k++) {
+        long double norm = 0;
+        for (size_t i = k; i < n; i++) {
+            norm += col[k][i] * col[k][i];
+        }
+        norm = sqrtl(norm);
+        long double alpha = (col[k][k] > 0) ? -norm : norm;
+        std::vector<long double> v(col[k].begin() + k, col[k].end());
+        v[0] -= alpha;
+        long double vv = 0;
+        for (long double e : v) {
+            vv += e * e;
+        }
+        auto reflect = [&](std::vector<long double> &target) {
+            long double dot = 0;
+            for (size_t i = k; i < n; i++) {
+                dot += v[i - k] * target[i];
+            }
+            for (size_t i = k; i < n; i++) {
+                target[i] -= 2 * dot / vv * v[i - k];
+            }
+        };
+        for (int j = k; j < terms; j++) {
+            reflect(col[j]);
+        }
+        reflect(rhs);
+    }
+    std::vector<long double> coef(SPECTRUM_CALIBRATION_TERMS, 0);
+    for (int k = terms - 1; k >= 0; k--) {
+        long double sum = rhs[k];
+        for (int j = k + 1; j < terms; j++) {
+            sum -= col[j][k] * coef[j];
+        }
+        coef[k] = sum / col[k][k];
+    }
+    return coef;
+}
+
+static long double referenceConcentration(const std::vector<long double> &coef, double area)
+{
+    return coef[0] + area * (coef[1] + area * coef[2]);
+}
+
+// Fit `set` and compare with the reference over its range of areas; returns the largest relative difference
+static double checkDataset(const Dataset &set, double tolerance)
+{
+    SpectrumCalibration curve = {};
+    std::vector<double> residuals(set.area.size());
+    bool ok = curve.fit(set.area.data(), set.concentration.data(), set.area.size(), set.model, set.weighting,
+                        residuals.data());
+    CHECK(ok);
+    if (!ok) {
+        return INFINITY;
+    }
+    std::vector<long double> reference = referenceFit(set);
+
+    double lo = INFINITY;
+    double hi = -INFINITY;
+    double y_scale = 0;
+    for (size_t i = 0; i < set.area.size(); i++) {
+        lo = fmin(lo, set.area[i]);
+        hi = fmax(hi, set.area[i]);
+        y_scale = fmax(y_scale, fabs(set.concentration[i]));
+    }
+    double worst = 0;
+    for (int k = 0; k <= 100; k++) {
+        double a = lo + (hi - lo) * k / 100;
+        double diff = fabs((double)(curve.concentration(a) - referenceConcentration(reference, a)));
+        worst = fmax(worst, diff / y_scale);
+    }
+
+    // Statistics from their definitions, with the reference curve
+    long double sum_w = 0;
+    long double sum_wy = 0;
+    for (size_t i = 0; i < set.area.size(); i++) {
+        sum_w += referenceWeight(set, i);
+        sum_wy += referenceWeight(set, i) * set.concentration[i];
+    }
+    long double ss_res = 0;
+    long double ss_tot = 0;
+    double max_residual = 0;
+    double residual_error = 0;
+    for (size_t i = 0; i < set.area.size(); i++) {
+        long double w = referenceWeight(set, i);
+        long double r = set.concentration[i] - referenceConcentration(reference, set.area[i]);
+        ss_res += w * r * r;
+        ss_tot += w * (set.concentration[i] - sum_wy / sum_w) * (set.concentration[i] - sum_wy / sum_w);
+        max_residual = fmax(max_residual, fabs((double)r));
+        residual_error = fmax(residual_error, fabs(residuals[i] - (double)r));
+    }
+    int terms = (set.model == SPECTRUM_CALIBRATION_QUADRATIC) ? 3 : 2;
+    double r2 = (double)(1 - ss_res / ss_tot);
+    double std_error = (double)sqrtl(ss_res / (set.area.size() - terms));
+
+    printf("%-34s %6zu standards  max rel diff %.2e  R2 %.9f  s %.4g\n", set.name, set.area.size(), worst, curve.r2,
+           curve.std_error);
+    CHECK(worst <= tolerance);
+    CHECK(curve.points == set.area.size());
+    CHECK(curve.fitted == 1);
+    CHECK((curve.model == set.model) && (curve.weighting == set.weighting));
+    CHECK(fabs(curve.r2 - r2) <= 1e-9);
+    CHECK(fabs(curve.std_error - std_error) <= 1e-7 * std_error + 1e-15 * y_scale);
+    CHECK(fabs(curve.max_residual - max_residual) <= tolerance * y_scale);
+    CHECK(residual_error <= tolerance * y_scale);
+    return worst;
+}
+
+static Dataset makeDataset(const char *name, SpectrumCalibrationModel model, SpectrumCalibrationWeighting weighting,
+                           size_t n, double area_lo, double area_hi, const double truth[3], double absolute_noise,
+                           double relative_noise, uint64_t seed)
+{
+    Dataset set = {name, model, weighting, {}, {}};
+    uint64_t state = seed;
+    for (size_t i = 0; i < n; i++) {
+        double a = area_lo + (area_hi - area_lo) * (0.5 + 0.5 * noise(state));
+        double y = truth[0] + a * (truth[1] + a * truth[2]);
+        y += absolute_noise * noise(state) + relative_noise * y * noise(state);
+        set.area.push_back(a);
+        set.concentration.push_back(y);
+    }
+    return set;
+}
+
+static void testReferenceDatasets(void)
+{
+    const double linear[3] = {0.45, 0.0123, 0};
+    const double quadratic[3] = {-0.3, 0.01, 2e-6};
+    const double offset[3] = {-3e5 + 1, 3, 0};   // y = 3 (area - 1e5) + 1
+
+    std::vector<std::pair<Dataset, double>> sets;
+    sets.push_back({makeDataset("linear", SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_UNWEIGHTED, 5000, 0.5, 400,
+                                linear, 0.01, 0, 1), 1e-12});
+    sets.push_back({makeDataset("linear 1/y", SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_INVERSE, 5000, 0.5, 400,
+                                linear, 0, 0.02, 2), 1e-12});
+    sets.push_back({makeDataset("linear 1/y^2", SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_INVERSE_SQUARE, 5000,
+                                0.5, 400, linear, 0, 0.02, 3), 1e-12});
+    sets.push_back({makeDataset("quadratic", SPECTRUM_CALIBRATION_QUADRATIC, SPECTRUM_CALIBRATION_UNWEIGHTED, 8000, 10,
+                                2000, quadratic, 0.05, 0, 4), 1e-11});
+    sets.push_back({makeDataset("quadratic 1/y^2", SPECTRUM_CALIBRATION_QUADRATIC,
+                                SPECTRUM_CALIBRATION_INVERSE_SQUARE, 8000, 50, 2000, quadratic, 0, 0.03, 5), 1e-11});
+    sets.push_back({makeDataset("linear, areas 1e5 + [0, 10]", SPECTRUM_CALIBRATION_LINEAR,
+                                SPECTRUM_CALIBRATION_UNWEIGHTED, 3000, 1e5, 1e5 + 10, offset, 0.1, 0, 6), 1e-9});
+    sets.push_back({makeDataset("linear, 3 standards of 1000 reps", SPECTRUM_CALIBRATION_LINEAR,
+                                SPECTRUM_CALIBRATION_UNWEIGHTED, 0, 0, 0, linear, 0, 0, 7), 1e-12});
+
+    // Replicates at three levels, the usual lab design
+    Dataset &reps = sets.back().first;
+    uint64_t state = 8;
+    for (double level : {20.0, 150.0, 380.0}) {
+        for (int i = 0; i < 1000; i++) {
+            double a = level * (1 + 0.01 * noise(state));
+            reps.area.push_back(a);
+            reps.concentration.push_back(linear[0] + linear[1] * a + 0.005 * noise(state));
+        }
+    }
+
+    for (const auto &set : sets) {
+        checkDataset(set.first, set.second);
+    }
+}
+
+static void testExactData(void)
+{
+    // On the curve: the fit must give it back, with R2 = 1 and no residual
+    const double truth[3] = {0.25, 0.5, 0.001};
+    for (SpectrumCalibrationModel model : {SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_QUADRATIC}) {
+        std::vector<double> area;
+        std::vector<double> y;
+        for (int i = 0; i < 2000; i++) {
+            double a = 1 + i * 0.125;
+            area.push_back(a);
+            y.push_back(truth[0] + a * (truth[1] + a * ((model == SPECTRUM_CALIBRATION_QUADRATIC) ? truth[2] : 0)));
+        }
+        SpectrumCalibration curve = {};
+        CHECK(curve.fit(area.data(), y.data(), area.size(), model, SPECTRUM_CALIBRATION_UNWEIGHTED));
+        CHECK(fabs(curve.coef[0] - truth[0]) <= 1e-10);
+        CHECK(fabs(curve.coef[1] - truth[1]) <= 1e-12);
+        CHECK(fabs(curve.coef[2] - ((model == SPECTRUM_CALIBRATION_QUADRATIC) ? truth[2] : 0)) <= 1e-14);
+        CHECK(fabs(curve.r2 - 1) <= 1e-14);
+        CHECK(curve.max_residual <= 1e-10);
+    }
+
+    // Two points through a line is no fit, three are
+    double area[4] = {1, 2, 3, 4};
+    double y[4] = {1, 3, 5, 7};
+    SpectrumCalibration curve = SpectrumCalibration::linear(9, 9);
+    CHECK(!curve.fit(area, y, 2, SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_UNWEIGHTED));
+    CHECK((curve.coef[1] == 9) && (curve.fitted == 0));
+    CHECK(!curve.fit(area, y, 3, SPECTRUM_CALIBRATION_QUADRATIC, SPECTRUM_CALIBRATION_UNWEIGHTED));
+    CHECK(curve.fit(area, y, 3, SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_UNWEIGHTED));
+    CHECK((fabs(curve.coef[1] - 2) < 1e-12) && (fabs(curve.coef[0] + 1) < 1e-12) && (curve.std_error < 1e-12));
+}
+
+static void testDegenerate(void)
+{
+    SpectrumCalibration curve = SpectrumCalibration::linear(1, 0);
+    curve.lower = 2100;
+    curve.upper = 2400;
+    curve.baseline = SPECTRUM_BASELINE_LINEAR;
+
+    // Every area the same: no slope
+    double same[5] = {7, 7, 7, 7, 7};
+    double y[5] = {1, 2, 3, 4, 5};
+    CHECK(!curve.fit(same, y, 5, SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_UNWEIGHTED));
+
+    // Two distinct areas cannot give a parabola
+    double two[5] = {1, 1, 2, 2, 2};
+    CHECK(!curve.fit(two, y, 5, SPECTRUM_CALIBRATION_QUADRATIC, SPECTRUM_CALIBRATION_UNWEIGHTED));
+    CHECK(curve.coef[1] == 1);
+
+    // Failed files (NAN areas) are left out, a blank keeps a finite weight
+    double area[6] = {0.1, NAN, 10, 20, 30, INFINITY};
+    double conc[6] = {0, 1, 1, 2, 3, 4};
+    double residuals[6];
+    CHECK(curve.fit(area, conc, 6, SPECTRUM_CALIBRATION_LINEAR, SPECTRUM_CALIBRATION_INVERSE_SQUARE, residuals));
+    CHECK(curve.points == 4);
+    CHECK(isnan(residuals[1]) && isnan(residuals[5]) && isfinite(residuals[0]) && isfinite(residuals[4]));
+    CHECK(isfinite(curve.coef[0]) && isfinite(curve.coef[1]) && (curve.r2 > 0.99));
+    CHECK((curve.lower == 2100) && (curve.upper == 2400) && (curve.baseline == SPECTRUM_BASELINE_LINEAR));
+}
+
+static int appendBytes(void *ctx, const uint8_t *buf, size_t len)
+{
+    static_cast<std::string *>(ctx)->append((const char *)buf, len);
+    return (int)len;
+}
+
+struct Reader {
+    const std::string *data;
+    size_t offset;
+};
+
+static int readBytes(void *ctx, uint8_t *buf, size_t len)
+{
+    Reader *reader = static_cast<Reader *>(ctx);
+    len = std::min(len, reader->data->size() - reader->offset);
+    memcpy(buf, reader->data->data() + reader->offset, len);
+    reader->offset += len;
+    return (int)len;
+}
+
+static void testSaveLoad(void)
+{
+    double area[5] = {10, 20, 30, 40, 50};
+    double y[5] = {1.1, 1.9, 3.2, 3.9, 5.1};
+    SpectrumCalibration curve = {};
+    curve.lower = 2100;
+    curve.upper = 2400;
+    curve.baseline = SPECTRUM_BASELINE_POLYNOMIAL;
+    CHECK(curve.fit(area, y, 5, SPECTRUM_CALIBRATION_QUADRATIC, SPECTRUM_CALIBRATION_INVERSE));
+
+    std::string file;
+    CHECK(curve.save(appendBytes, &file));
+    CHECK(file.size() == sizeof(SpectrumCalibrationHeader) + sizeof(SpectrumCalibration));
+
+    SpectrumCalibration loaded = SpectrumCalibration::linear(1, 2);
+    Reader reader = {&file, 0};
+    CHECK(loaded.load(readBytes, &reader));
+    CHECK(memcmp(&loaded, &curve, sizeof(curve)) == 0);
+
+    // Foreign, truncated or corrupted files leave the curve alone
+    std::string bad = file;
+    bad[0] ^= 1;
+    loaded = SpectrumCalibration::linear(1, 2);
+    reader = {&bad, 0};
+    CHECK(!loaded.load(readBytes, &reader) && (loaded.coef[1] == 1));
+    bad = file.substr(0, file.size() - 1);
+    reader = {&bad, 0};
+    CHECK(!loaded.load(readBytes, &reader) && (loaded.coef[1] == 1));
+    bad = file;
+    bad[sizeof(SpectrumCalibrationHeader)] = 7;     // Model
+    reader = {&bad, 0};
+    CHECK(!loaded.load(readBytes, &reader) && (loaded.coef[1] == 1));
+    bad = file;
+    bad[sizeof(SpectrumCalibrationHeader) + 3] = 7; // Baseline
+    reader = {&bad, 0};
+    CHECK(!loaded.load(readBytes, &reader) && (loaded.coef[1] == 1));
+
+    char text[96];
+    SpectrumCalibration::linear(0.0123, -0.45).format(text, sizeof(text));
+    CHECK(strcmp(text, "y = 0.0123x - 0.45") == 0);
+    curve.format(text, sizeof(text));
+    CHECK(strncmp(text, "y = ", 4) == 0 && (strstr(text, "x^2") != nullptr));
+}
+
+static void testNames(void)
+{
+    struct {
+        const char *name;
+        bool ok;
+        double value;
+    } cases[] = {
+        {"Cu-2mM.csv", true, 2},
+        {"/Cu-2-8 mM/Cu-2.5 mM.csv", true, 2.5},
+        {"std 10.csv", true, 10},
+        {"0.125.CSV", true, 0.125},
+        {"Cu-3mM-v.csv", true, 3},
+        {"sample.1.csv", true, 1},
+        {"blank.csv", false, 0},
+        {"/run 4/blank.csv", false, 0},
+        {"Cu.csv", false, 0},
+    };
+    for (const auto &c : cases) {
+        double value = -1;
+        bool ok = spectrumConcentrationFromName(c.name, value);
+        if ((ok != c.ok) || (ok && (value != c.value))) {
+            printf("FAILED name \"%s\": %d %g\n", c.name, ok, value);
+            failures++;
+        }
+    }
+}
+
+static void *openFile(void *ctx, const char *path)
+{
+    (void)ctx;
+    return fopen(path, "rb");
+}
+
+static void closeFile(void *ctx, void *file)
+{
+    (void)ctx;
+    fclose(static_cast<FILE *>(file));
+}
+
+static int readFile(void *ctx, uint8_t *buf, size_t len)
+{
+    return (int)fread(buf, 1, len, static_cast<FILE *>(ctx));
+}
+
+static void testBatchOfStandards(void)
+{
+    // Peak height proportional to the concentration, so the area over the peak is linear in it
+    char dir[] = "/tmp/test_calibration_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    std::vector<std::string> names;
+    for (double conc : {0.5, 1.0, 2.0, 4.0, 8.0}) {
+        char name[64];
+        snprintf(name, sizeof(name), "/Cu-%gmM.csv", conc);
+        names.push_back(std::string(dir) + name);
+        FILE *out = fopen(names.back().c_str(), "w");
+        fprintf(out, "Wavenumber,Intensity\n");
+        for (int i = 0; i <= 2000; i++) {
+            double x = 4000 - 1.75 * i;
+            fprintf(out, "%.2f,%.6f\n", x, 0.01 + 0.02 * conc * exp(-(x - 2250) * (x - 2250) / 5000));
+        }
+        fclose(out);
+    }
+    std::vector<const char *> paths;
+    for (const std::string &name : names) {
+        paths.push_back(name.c_str());
+    }
+
+    std::vector<SpectrumBatchResult> results(paths.size());
+    SpectrumBatchJob job = {};
+    job.paths = paths.data();
+    job.count = paths.size();
+    job.lower = 2100;
+    job.upper = 2400;
+    job.open = openFile;
+    job.read = readFile;
+    job.close = closeFile;
+    job.results = results.data();
+    SpectrumBatch batch;
+    CHECK(batch.start(job));
+    CHECK(batch.wait().files == paths.size());
+
+    std::vector<double> area;
+    std::vector<double> conc;
+    for (size_t i = 0; i < paths.size(); i++) {
+        double value = 0;
+        CHECK(results[i].ok && isnan(results[i].concentration));
+        CHECK(spectrumConcentrationFromName(paths[i], value));
+        area.push_back(results[i].area);
+        conc.push_back(value);
+    }
+    SpectrumCalibration curve = {};
+    CHECK(curve.fit(area.data(), conc.data(), area.size(), SPECTRUM_CALIBRATION_LINEAR,
+                    SPECTRUM_CALIBRATION_UNWEIGHTED));
+    CHECK(curve.r2 > 0.999999);
+    CHECK(fabs(curve.concentration(results[2].area) - 2.0) < 1e-3);
+
+    std::string report;
+    area[1] = NAN;      // As for a file that failed
+    CHECK(spectrumCalibrationWriteStandards(appendBytes, &report, curve, paths.data(), area.data(), conc.data(),
+                                            paths.size()));
+    CHECK(std::count(report.begin(), report.end(), '\n') == (long)paths.size() + 1);
+    CHECK(report.compare(0, 41, "file,concentration,area,fitted,residual\n\"") == 0);
+    CHECK(report.find("mM.csv\",,,,\n") != std::string::npos);
+
+    for (const std::string &name : names) {
+        remove(name.c_str());
+    }
+    rmdir(dir);
+}
+
+int main(void)
+{
+    testReferenceDatasets();
+    testExactData();
+    testDegenerate();
+    testSaveLoad();
+    testNames();
+    testBatchOfStandards();
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
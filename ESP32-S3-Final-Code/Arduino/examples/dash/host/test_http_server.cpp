@@ -0,0 +1,613 @@
+/*
+ * Test for the non-blocking HTTP server over loopback, with the server polled from its own thread as `loop()` would
+ * and plain blocking sockets as clients: keep-alive and pipelined requests, requests trickling in a byte at a time,
+ * streamed (chunked and HTTP/1.0 close-delimited) and constant bodies, ETag revalidation, the error responses, the
+ * I/O timeout, eviction of idle connections when the pool is full, more concurrent clients than the pool has
+ * connections, and Server-Sent Events (SpectrumEvents) pushed to several subscribers.
+ *
+ * Usage: test_http_server
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_events.h"
+#include "spectrum_http.h"
+
+static std::atomic<int> failures(0);
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static SpectrumEvents events;
+static std::atomic<uint32_t> event_value(0);   // Published as event "state" by the server's thread, like the UI would
+
+static char static_page[3 * SPECTRUM_HTTP_BODY_MAX + 123];
+static const char *STATIC_ETAG = "\"v1\"";
+
+struct StreamState {
+    uint32_t sent;
+    uint32_t total;
+};
+
+// Bytes of a streamed body, so the client can check every one of them
+static char streamByte(uint32_t i)
+{
+    return (char)('a' + (i * 7) % 26);
+}
+
+static size_t streamBody(void *ctx, void *state, char *buffer, size_t size, bool &done)
+{
+    (void)ctx;
+    StreamState *stream = static_cast<StreamState *>(state);
+    size_t n = stream->total - stream->sent;
+    n = (n < size) ? n : size;
+    for (size_t i = 0; i < n; i++) {
+        buffer[i] = streamByte(stream->sent + i);
+    }
+    stream->sent += n;
+    done = (stream->sent == stream->total);
+    return n;
+}
+
+static void handle(const SpectrumHttpRequest &request, SpectrumHttpResponse &response, void *ctx)
+{
+    (void)ctx;
+    long value = 0;
+    if (strcmp(request.path, "/") == 0) {
+        response.addHeader("Content-Type", "text/plain");
+        response.print("hello");
+    } else if ((strcmp(request.path, "/form") == 0) && (request.method == SPECTRUM_HTTP_POST)) {
+        long slider1 = -1;
+        long slider2 = -1;
+        spectrum_http_form_int(request.body, request.body_length, "slider1", slider1);
+        spectrum_http_form_int(request.body, request.body_length, "slider2", slider2);
+        response.printf("%ld %ld", slider1, slider2);
+    } else if ((strcmp(request.path, "/stream") == 0) &&
+               spectrum_http_form_int(request.query, strlen(request.query), "bytes", value)) {
+        StreamState *stream = static_cast<StreamState *>(response.stream(streamBody, nullptr, sizeof(StreamState)));
+        stream->total = (uint32_t)value;
+    } else if (strcmp(request.path, "/header") == 0) {
+        const char *test = request.header("x-test");
+        response.print((test != nullptr) ? test : "(none)");
+    } else if (strcmp(request.path, "/static") == 0) {
+        response.addHeader("ETag", STATIC_ETAG);
+        if (request.notModified(STATIC_ETAG)) {
+            response.setStatus(304);
+        } else {
+            response.writeStatic(static_page, sizeof(static_page));
+        }
+    } else if (strcmp(request.path, "/events") == 0) {
+        events.respond(response);
+    } else if (strcmp(request.path, "/big") == 0) {
+        std::string big(SPECTRUM_HTTP_BODY_MAX + 1, 'x');
+        response.print(big.c_str());
+    } else {
+        response.setStatus(404);
+    }
+}
+
+struct Reply {
+    int status;
+    std::string head;
+    std::string body;
+};
+
+static int connectTo(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    struct timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+// Append what arrives to `pending`, false once the server closed the connection
+static bool readMore(int fd, std::string &pending)
+{
+    char buffer[4096];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+        return false;
+    }
+    pending.append(buffer, n);
+    return true;
+}
+
+// Read one response, framed by Content-Length, chunks or the end of the connection. Bytes of the next response stay
+// in `pending`.
+static bool readReply(int fd, std::string &pending, Reply &reply, bool head_request = false)
+{
+    size_t head_end;
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos) {
+        if (!readMore(fd, pending)) {
+            return false;
+        }
+    }
+    reply.head = pending.substr(0, head_end + 2);
+    reply.status = atoi(reply.head.c_str() + 9);
+    reply.body.clear();
+    pending.erase(0, head_end + 4);
+    if (head_request) {
+        return true;
+    }
+
+    size_t length_at = reply.head.find("Content-Length: ");
+    if (length_at != std::string::npos) {
+        size_t length = strtoul(reply.head.c_str() + length_at + 16, nullptr, 10);
+        while (pending.size() < length) {
+            if (!readMore(fd, pending)) {
+                return false;
+            }
+        }
+        reply.body = pending.substr(0, length);
+        pending.erase(0, length);
+        return true;
+    }
+    if (reply.head.find("Transfer-Encoding: chunked") != std::string::npos) {
+        for (;;) {
+            size_t line_end;
+            while ((line_end = pending.find("\r\n")) == std::string::npos) {
+                if (!readMore(fd, pending)) {
+                    return false;
+                }
+            }
+            size_t size = strtoul(pending.c_str(), nullptr, 16);
+            while (pending.size() < line_end + 2 + size + 2) {
+                if (!readMore(fd, pending)) {
+                    return false;
+                }
+            }
+            if (pending.compare(line_end + 2 + size, 2, "\r\n") != 0) {
+                return false;
+            }
+            reply.body += pending.substr(line_end + 2, size);
+            pending.erase(0, line_end + 2 + size + 2);
+            if (size == 0) {
+                return true;
+            }
+        }
+    }
+    if ((reply.status == 204) || (reply.status == 304)) {
+        return true;
+    }
+    while (readMore(fd, pending)) {
+    }
+    reply.body.swap(pending);
+    pending.clear();
+    return true;
+}
+
+static bool closedByServer(int fd)
+{
+    char c;
+    return recv(fd, &c, 1, 0) == 0;
+}
+
+static std::string get(const char *path, const char *extra = "")
+{
+    return std::string("GET ") + path + " HTTP/1.1\r\nHost: test\r\n" + extra + "\r\n";
+}
+
+// Next event of a chunked text/event-stream as "name=data", skipping comments and the retry field
+static bool readEvent(int fd, std::string &pending, std::string &stream, std::string &event)
+{
+    for (;;) {
+        size_t end = stream.find("\n\n");
+        if (end != std::string::npos) {
+            std::string message = stream.substr(0, end + 1);
+            stream.erase(0, end + 2);
+            size_t name_at = message.find("event: ");
+            size_t data_at = message.find("data: ");
+            if ((name_at == std::string::npos) || (data_at == std::string::npos)) {
+                continue;
+            }
+            event = message.substr(name_at + 7, message.find('\n', name_at) - name_at - 7) + "=" +
+                    message.substr(data_at + 6, message.find('\n', data_at) - data_at - 6);
+            return true;
+        }
+        size_t line_end = pending.find("\r\n");
+        if (line_end != std::string::npos) {
+            size_t size = strtoul(pending.c_str(), nullptr, 16);
+            if (pending.size() >= line_end + 2 + size + 2) {
+                stream += pending.substr(line_end + 2, size);
+                pending.erase(0, line_end + 2 + size + 2);
+                continue;
+            }
+        }
+        if (!readMore(fd, pending)) {
+            return false;
+        }
+    }
+}
+
+static bool validStream(const std::string &body, uint32_t total)
+{
+    if (body.size() != total) {
+        return false;
+    }
+    for (uint32_t i = 0; i < total; i++) {
+        if (body[i] != streamByte(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testKeepAlive(uint16_t port)
+{
+    int fd = connectTo(port);
+    std::string pending;
+    Reply reply;
+    for (int i = 0; i < 3; i++) {
+        CHECK(sendAll(fd, get("/")));
+        CHECK(readReply(fd, pending, reply));
+        CHECK(reply.status == 200);
+        CHECK(reply.body == "hello");
+        CHECK(reply.head.find("Connection: keep-alive") != std::string::npos);
+    }
+
+    CHECK(sendAll(fd, get("/header", "X-Test:   spaced value  \r\n")));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "spaced value"));
+    CHECK(sendAll(fd, get("/missing")));
+    CHECK(readReply(fd, pending, reply) && (reply.status == 404));
+
+    // HEAD gets the headers of the GET without its body
+    CHECK(sendAll(fd, "HEAD / HTTP/1.1\r\n\r\nGET / HTTP/1.1\r\n\r\n"));
+    CHECK(readReply(fd, pending, reply, true) && (reply.head.find("Content-Length: 5") != std::string::npos));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "hello"));
+
+    CHECK(sendAll(fd, get("/", "Connection: close\r\n")));
+    CHECK(readReply(fd, pending, reply) && (reply.head.find("Connection: close") != std::string::npos));
+    CHECK(closedByServer(fd));
+    close(fd);
+}
+
+static void testPipelinedAndTrickled(uint16_t port)
+{
+    int fd = connectTo(port);
+    std::string pending;
+    Reply reply;
+
+    // Three requests in one segment, answered in order
+    CHECK(sendAll(fd, get("/") + get("/stream?bytes=10") + get("/header", "X-Test: third\r\n")));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "hello"));
+    CHECK(readReply(fd, pending, reply) && validStream(reply.body, 10));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "third"));
+
+    // A POST arriving a byte at a time, with bare LF line ends
+    std::string post = "POST /form HTTP/1.1\nContent-Length: 23\n\nslider1=2100&slider2=24";
+    for (char c : post) {
+        CHECK(sendAll(fd, std::string(1, c)));
+        usleep(200);
+    }
+    CHECK(readReply(fd, pending, reply) && (reply.body == "2100 24"));
+    close(fd);
+}
+
+static void testStreams(uint16_t port)
+{
+    const uint32_t total = 300000;
+    char path[64];
+    snprintf(path, sizeof(path), "/stream?bytes=%u", total);
+
+    int fd = connectTo(port);
+    std::string pending;
+    Reply reply;
+    CHECK(sendAll(fd, get(path)));
+    CHECK(readReply(fd, pending, reply) && (reply.head.find("Transfer-Encoding: chunked") != std::string::npos));
+    CHECK(validStream(reply.body, total));
+    // Still usable after the stream
+    CHECK(sendAll(fd, get("/")));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "hello"));
+    close(fd);
+
+    // HTTP/1.0 has no chunks: the body ends with the connection
+    fd = connectTo(port);
+    pending.clear();
+    CHECK(sendAll(fd, std::string("GET ") + path + " HTTP/1.0\r\n\r\n"));
+    CHECK(readReply(fd, pending, reply) && (reply.head.find("Connection: close") != std::string::npos));
+    CHECK(validStream(reply.body, total));
+    close(fd);
+}
+
+// A constant body larger than the output buffer, and revalidation of it
+static void testStatic(uint16_t port)
+{
+    for (size_t i = 0; i < sizeof(static_page); i++) {
+        static_page[i] = (char)('A' + i % 23);
+    }
+
+    int fd = connectTo(port);
+    std::string pending;
+    Reply reply;
+    CHECK(sendAll(fd, get("/static")));
+    CHECK(readReply(fd, pending, reply) && (reply.status == 200));
+    CHECK(reply.body == std::string(static_page, sizeof(static_page)));
+    CHECK(sendAll(fd, get("/static", "If-None-Match: \"v0\", \"v1\"\r\n")));
+    CHECK(readReply(fd, pending, reply) && (reply.status == 304) && reply.body.empty());
+    CHECK(reply.head.find("ETag: \"v1\"") != std::string::npos);
+    CHECK(sendAll(fd, get("/static", "If-None-Match: \"v0\"\r\n")));
+    CHECK(readReply(fd, pending, reply) && (reply.status == 200) && (reply.body.size() == sizeof(static_page)));
+    CHECK(sendAll(fd, "HEAD /static HTTP/1.1\r\n\r\n" + get("/")));
+    CHECK(readReply(fd, pending, reply, true) && (reply.status == 200));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "hello"));
+    close(fd);
+}
+
+static void testErrors(uint16_t port)
+{
+    struct Case {
+        std::string request;
+        int status;
+    };
+    const Case cases[] = {
+        {"BREW / HTTP/1.1\r\n\r\n", 501},
+        {"GET HTTP/1.1\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\nContent-Length: x\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\nX-Long: " + std::string(SPECTRUM_HTTP_REQUEST_MAX, 'a') + "\r\n\r\n", 431},
+        {"POST /form HTTP/1.1\r\nContent-Length: 100000\r\n\r\n", 413},
+        {"POST /form HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", 501},
+        {get("/big"), 500},
+    };
+    for (const Case &c : cases) {
+        int fd = connectTo(port);
+        std::string pending;
+        Reply reply = {};
+        sendAll(fd, c.request);
+        CHECK(readReply(fd, pending, reply));
+        if (reply.status != c.status) {
+            printf("Expected %d, got %d for %.40s\n", c.status, reply.status, c.request.c_str());
+        }
+        CHECK(reply.status == c.status);
+        CHECK(closedByServer(fd));
+        close(fd);
+    }
+}
+
+// A request that stops halfway is dropped after the I/O timeout, without holding up anyone else
+static void testTimeout(uint16_t port)
+{
+    int stalled = connectTo(port);
+    CHECK(sendAll(stalled, "GET / HTTP/1.1\r\nHost:"));
+
+    int fd = connectTo(port);
+    std::string pending;
+    Reply reply;
+    CHECK(sendAll(fd, get("/")));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "hello"));
+    close(fd);
+
+    uint32_t start = spectrum_time_us();
+    CHECK(closedByServer(stalled));
+    uint32_t elapsed_ms = (spectrum_time_us() - start) / 1000;
+    CHECK(elapsed_ms <= SPECTRUM_HTTP_IO_TIMEOUT_MS + 500);
+    close(stalled);
+}
+
+// With every connection idle, a new client takes the place of the oldest one
+static void testEviction(uint16_t port)
+{
+    std::vector<int> idle;
+    std::string pending;
+    Reply reply;
+    for (int i = 0; i < SPECTRUM_HTTP_MAX_CONNECTIONS; i++) {
+        int fd = connectTo(port);
+        CHECK(sendAll(fd, get("/")));
+        CHECK(readReply(fd, pending, reply));
+        idle.push_back(fd);
+    }
+    int fd = connectTo(port);
+    CHECK(sendAll(fd, get("/")));
+    CHECK(readReply(fd, pending, reply) && (reply.body == "hello"));
+    CHECK(closedByServer(idle[0]));
+    close(fd);
+    for (int idle_fd : idle) {
+        close(idle_fd);
+    }
+}
+
+// Every subscriber gets the latest value on connecting and then each change, quickly but coalesced
+static void testEvents(uint16_t port)
+{
+    SpectrumEvents local;
+    CHECK(!local.publish("a", "two\nlines"));
+    CHECK(!local.publish("a", std::string(SPECTRUM_EVENTS_DATA_MAX, 'x').c_str()));
+    const char *names[] = {"a", "b", "c", "d", "e"};
+    for (int i = 0; i < SPECTRUM_EVENTS_MAX_EVENTS; i++) {
+        CHECK(local.publish(names[i], "1"));
+    }
+    CHECK(!local.publish(names[SPECTRUM_EVENTS_MAX_EVENTS], "1"));
+    CHECK(local.publish(names[0], "2"));
+
+    const int clients = SPECTRUM_EVENTS_MAX_CLIENTS;
+    int fds[clients];
+    std::string pending[clients];
+    std::string stream[clients];
+    std::string event;
+    Reply reply;
+    for (int i = 0; i < clients; i++) {
+        fds[i] = connectTo(port);
+        CHECK(sendAll(fds[i], get("/events")));
+        CHECK(readReply(fds[i], pending[i], reply, true) && (reply.status == 200));
+        CHECK(reply.head.find("Content-Type: text/event-stream") != std::string::npos);
+        CHECK(readEvent(fds[i], pending[i], stream[i], event) && (event == "state=0"));
+    }
+
+    // One too many
+    int extra = connectTo(port);
+    std::string extra_pending;
+    CHECK(sendAll(extra, get("/events")));
+    CHECK(readReply(extra, extra_pending, reply) && (reply.status == 503));
+    close(extra);
+
+    uint32_t start = spectrum_time_us();
+    event_value = 1;
+    for (int i = 0; i < clients; i++) {
+        CHECK(readEvent(fds[i], pending[i], stream[i], event) && (event == "state=1"));
+    }
+    uint32_t latency_us = spectrum_time_us() - start;
+    CHECK(latency_us < 100000);
+
+    // A burst of changes arrives as a few messages, ending with the last value
+    const uint32_t burst = 200;
+    start = spectrum_time_us();
+    for (uint32_t v = 2; v <= 1 + burst; v++) {
+        event_value = v;
+        usleep(1000);
+    }
+    uint32_t burst_ms = (spectrum_time_us() - start) / 1000;
+    std::string last = "state=" + std::to_string(1 + burst);
+    int messages = 0;
+    for (int i = 0; i < clients; i++) {
+        int received = 0;
+        while (readEvent(fds[i], pending[i], stream[i], event)) {
+            received++;
+            if (event == last) {
+                break;
+            }
+        }
+        CHECK(event == last);
+        CHECK(received <= (int)(burst_ms / SPECTRUM_EVENTS_MIN_INTERVAL_MS) + 2);
+        messages += received;
+    }
+    printf("events: %u us to reach %d subscribers, %u changes in %u ms sent as %.1f messages each\n", latency_us,
+           clients, burst, burst_ms, (double)messages / clients);
+
+    // A subscriber leaving makes room for another
+    close(fds[0]);
+    bool subscribed = false;
+    for (int attempt = 0; (attempt < 50) && !subscribed; attempt++) {
+        usleep(10000);
+        fds[0] = connectTo(port);
+        pending[0].clear();
+        stream[0].clear();
+        subscribed = sendAll(fds[0], get("/events")) && readReply(fds[0], pending[0], reply, true) &&
+                     (reply.status == 200) && readEvent(fds[0], pending[0], stream[0], event) && (event == last);
+        if (!subscribed) {
+            close(fds[0]);
+        }
+    }
+    CHECK(subscribed);
+    for (int i = 0; i < clients; i++) {
+        close(fds[i]);
+    }
+}
+
+// Twice as many clients as connections, each sending a burst of keep-alive requests
+static void testLoad(uint16_t port)
+{
+    const int clients = 2 * SPECTRUM_HTTP_MAX_CONNECTIONS;
+    const int requests = 200;
+    std::atomic<int> served(0);
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&]() {
+            std::string pending;
+            Reply reply;
+            int fd = -1;
+            for (int i = 0; i < requests; i++) {
+                // The server may close a connection it considers idle; reconnect like a browser would
+                if (fd < 0) {
+                    fd = connectTo(port);
+                    pending.clear();
+                }
+                if (!sendAll(fd, get((i % 10 == 0) ? "/stream?bytes=20000" : "/")) ||
+                    !readReply(fd, pending, reply)) {
+                    close(fd);
+                    fd = -1;
+                    i--;
+                    continue;
+                }
+                if ((reply.status == 200) && (reply.body.size() == ((i % 10 == 0) ? 20000u : 5u))) {
+                    served++;
+                }
+            }
+            close(fd);
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    CHECK(served == clients * requests);
+}
+
+int main(void)
+{
+    SpectrumHttpServer server;
+    CHECK(server.begin(0, handle, nullptr));
+    uint16_t port = server.port();
+    CHECK(port != 0);
+
+    std::atomic<bool> stop(false);
+    std::thread loop([&]() {
+        uint32_t published = UINT32_MAX;
+        while (!stop) {
+            uint32_t value = event_value;
+            if (value != published) {
+                events.publish("state", std::to_string(value).c_str());
+                published = value;
+            }
+            server.handleClients();
+            usleep(100);
+        }
+    });
+
+    testKeepAlive(port);
+    testPipelinedAndTrickled(port);
+    testStreams(port);
+    testStatic(port);
+    testErrors(port);
+    testTimeout(port);
+    testEviction(port);
+    testEvents(port);
+    uint32_t start = spectrum_time_us();
+    testLoad(port);
+    uint32_t elapsed_us = spectrum_time_us() - start;
+
+    stop = true;
+    loop.join();
+    const SpectrumHttpStats &stats = server.stats();
+    printf("%u connections, %u requests (%u in the load test, %.0f req/s), %u errors, %u timeouts, %u evicted, "
+           "longest handleClients() %u us\n", stats.accepted, stats.requests,
+           2 * SPECTRUM_HTTP_MAX_CONNECTIONS * 200, 2 * SPECTRUM_HTTP_MAX_CONNECTIONS * 200 / (elapsed_us / 1e6),
+           stats.errors, stats.timeouts, stats.evicted, stats.max_handle_us);
+    server.end();
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
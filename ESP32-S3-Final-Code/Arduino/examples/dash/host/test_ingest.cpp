@@ -0,0 +1,372 @@
+/*
+ * Test for the RS485 ingest: a thread standing in for the spectrometer writes framed scans into a pseudo-terminal at
+ * the byte rate of a 921600 baud line, with line noise, a corrupted frame, samples outside a scan and an interrupted
+ * scan between them; a reader thread drains the other end into the ring, and the main thread polls it like the UI
+ * timer does. After every update the area index and chart pyramid must be exactly what building them from scratch
+ * gives, and every complete scan must arrive intact. Then the same scans are sent as fast as the terminal takes them
+ * through a small ring, which wraps and fills.
+ *
+ * Usage: test_ingest
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_index.h"
+#include "spectrum_ingest.h"
+#include "spectrum_pyramid.h"
+#include "spectrum_store.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+#define LINE_BYTES_PER_SECOND   (921600 / 10)   // 8N1: ten bits a byte
+
+struct Scan {
+    std::vector<float> x;
+    std::vector<float> y;
+};
+
+static Scan makeScan(double first, double last, size_t count, double peak)
+{
+    Scan s;
+    for (size_t i = 0; i < count; i++) {
+        double w = first + (last - first) * i / (count - 1);
+        double u = (w - peak) / 6;
+        s.x.push_back((float)w);
+        s.y.push_back((float)(0.1 + 0.00005 * w + exp(-0.5 * u * u)));
+    }
+    return s;
+}
+
+static void appendFrame(std::vector<uint8_t> &out, uint8_t type, const void *payload, size_t length)
+{
+    uint8_t frame[SPECTRUM_FRAME_MAX];
+    size_t n = spectrumFrameEncode(type, payload, length, frame, sizeof(frame));
+    CHECK(n == SPECTRUM_FRAME_HEADER + length + SPECTRUM_FRAME_CRC);
+    out.insert(out.end(), frame, frame + n);
+}
+
+// `count` samples of the scan from `from`, in frames of up to the maximum
+static void appendSamples(std::vector<uint8_t> &out, const Scan &scan, size_t from, size_t count)
+{
+    for (size_t i = from; i < from + count; i += SPECTRUM_FRAME_SAMPLES_MAX) {
+        float payload[SPECTRUM_FRAME_SAMPLES_MAX * 2];
+        size_t n = std::min((size_t)SPECTRUM_FRAME_SAMPLES_MAX, from + count - i);
+        for (size_t k = 0; k < n; k++) {
+            payload[k * 2] = scan.x[i + k];
+            payload[k * 2 + 1] = scan.y[i + k];
+        }
+        appendFrame(out, SPECTRUM_FRAME_SAMPLES, payload, n * 2 * sizeof(float));
+    }
+}
+
+static void appendScan(std::vector<uint8_t> &out, const Scan &scan, bool announce)
+{
+    uint32_t points = announce ? (uint32_t)scan.x.size() : 0;
+    appendFrame(out, SPECTRUM_FRAME_BEGIN, &points, sizeof(points));
+    appendSamples(out, scan, 0, scan.x.size());
+    appendFrame(out, SPECTRUM_FRAME_END, nullptr, 0);
+}
+
+struct Stream {
+    std::vector<uint8_t> bytes;
+    std::vector<const Scan *> complete;     // Scans that must arrive intact, in order
+    uint32_t scans;                         // BEGIN frames
+    uint32_t ignored;                       // Samples sent outside a scan
+};
+
+static Stream makeStream(const Scan &a, const Scan &b, const Scan &c, const Scan &d)
+{
+    Stream stream = {};
+
+    // Announced, so stored without the arrays ever moving
+    appendScan(stream.bytes, a, true);
+    stream.complete.push_back(&a);
+
+    // Noise, including a sync pair, a frame that fails its CRC, then samples before any BEGIN
+    const uint8_t noise[] = {0x00, 0xFF, SPECTRUM_FRAME_SYNC_0, 0x13, SPECTRUM_FRAME_SYNC_0, SPECTRUM_FRAME_SYNC_1, 0x7F};
+    stream.bytes.insert(stream.bytes.end(), noise, noise + sizeof(noise));
+    std::vector<uint8_t> bad;
+    appendSamples(bad, b, 0, 10);
+    bad[SPECTRUM_FRAME_HEADER + 3] ^= 0x40;
+    stream.bytes.insert(stream.bytes.end(), bad.begin(), bad.end());
+    appendFrame(stream.bytes, SPECTRUM_FRAME_END, nullptr, 0);
+    stream.bytes.push_back(0x55);
+
+    // Not announced: the store grows, and moves, while it arrives
+    appendScan(stream.bytes, b, false);
+    stream.complete.push_back(&b);
+    appendSamples(stream.bytes, c, 0, 100);
+    stream.ignored += 100;
+
+    // Cut short by the next BEGIN
+    uint32_t points = (uint32_t)c.x.size();
+    appendFrame(stream.bytes, SPECTRUM_FRAME_BEGIN, &points, sizeof(points));
+    appendSamples(stream.bytes, c, 0, c.x.size() / 2);
+    appendScan(stream.bytes, d, true);
+    stream.complete.push_back(&d);
+
+    stream.scans = 4;
+    return stream;
+}
+
+// The index and pyramid extended update after update must equal those built in one go
+static void checkIncremental(const SpectrumStore &store, const SpectrumIndex &index, const SpectrumPyramid &pyramid)
+{
+    CHECK(index.size() == store.size());
+    CHECK(pyramid.size() == store.size());
+    if (store.size() < 2) {
+        return;
+    }
+    SpectrumIndex fresh;
+    fresh.build(store.x(), store.y(), store.size());
+    bool same = memcmp(fresh.prefix(), index.prefix(), store.size() * sizeof(SpectrumPrefix)) == 0;
+    CHECK(same);
+    CHECK(index.descending() == fresh.descending());
+
+    SpectrumPyramid built;
+    built.build(store.x(), store.y(), store.size());
+    CHECK(pyramid.levels() == built.levels());
+    const uint16_t columns = 97;
+    float ex[columns], emin[columns], emax[columns], bx[columns], bmin[columns], bmax[columns];
+    float elo, ehi, blo, bhi;
+    size_t to = store.size();
+    size_t from = to / 3;
+    CHECK(pyramid.envelope(from, to, columns, ex, emin, emax, &elo, &ehi));
+    CHECK(built.envelope(from, to, columns, bx, bmin, bmax, &blo, &bhi));
+    CHECK((memcmp(emin, bmin, sizeof(emin)) == 0) && (memcmp(emax, bmax, sizeof(emax)) == 0));
+    CHECK((elo == blo) && (ehi == bhi));
+}
+
+struct Pty {
+    int master;
+    int slave;
+};
+
+static bool openPty(Pty &pty)
+{
+    pty.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((pty.master < 0) || (grantpt(pty.master) != 0) || (unlockpt(pty.master) != 0)) {
+        return false;
+    }
+    pty.slave = open(ptsname(pty.master), O_RDWR | O_NOCTTY);
+    if (pty.slave < 0) {
+        return false;
+    }
+    // Binary, like the UART: no line discipline, no echo
+    struct termios tio;
+    tcgetattr(pty.slave, &tio);
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B921600);
+    cfsetospeed(&tio, B921600);
+    tcsetattr(pty.slave, TCSANOW, &tio);
+    return true;
+}
+
+static size_t readPty(void *ctx, uint8_t *buffer, size_t size)
+{
+    int fd = *static_cast<int *>(ctx);
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (::poll(&pfd, 1, 5) <= 0) {
+        return 0;
+    }
+    ssize_t n = read(fd, buffer, size);
+    return (n > 0) ? (size_t)n : 0;
+}
+
+struct RunResult {
+    double seconds;
+    double poll_max_us;
+    uint32_t updates;
+};
+
+// Send the stream through a pty (paced to the line rate, or as fast as it goes) and check everything on the way
+static RunResult run(const Stream &stream, size_t ring_size, bool paced)
+{
+    RunResult result = {};
+    Pty pty;
+    if (!openPty(pty)) {
+        printf("No pseudo-terminal available (%s), skipped\n", strerror(errno));
+        return result;
+    }
+
+    SpectrumStore store;
+    SpectrumIndex index;
+    SpectrumPyramid pyramid;
+    SpectrumIngest ingest;
+    CHECK(ingest.begin(&store, &index, &pyramid, ring_size));
+
+    std::atomic<bool> sent(false);
+    std::atomic<bool> stop(false);
+    auto start = std::chrono::steady_clock::now();
+    std::thread spectrometer([&]() {
+        const size_t chunk = 256;
+        for (size_t at = 0; at < stream.bytes.size(); at += chunk) {
+            if (paced) {
+                std::this_thread::sleep_until(start + std::chrono::microseconds(
+                                                          (uint64_t)at * 1000000 / LINE_BYTES_PER_SECOND));
+            }
+            size_t n = std::min(chunk, stream.bytes.size() - at);
+            for (size_t done = 0; done < n;) {
+                ssize_t w = write(pty.master, stream.bytes.data() + at + done, n - done);
+                done += (w > 0) ? (size_t)w : 0;
+            }
+        }
+        sent = true;
+    });
+    std::thread reader([&]() {
+        while (!stop) {
+            if (ingest.receive(readPty, &pty.slave) == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+    });
+
+    // The UI timer
+    size_t next = 0;
+    uint64_t decoded = 0;
+    auto idle_since = std::chrono::steady_clock::now();
+    while (true) {
+        uint32_t t0 = spectrum_time_us();
+        SpectrumIngestUpdate update = ingest.poll(2048);
+        double us = spectrum_time_us() - t0;
+        result.poll_max_us = (us > result.poll_max_us) ? us : result.poll_max_us;
+        result.updates++;
+        decoded += update.added;
+
+        if (update.begun || (update.added > 0) || update.ended) {
+            idle_since = std::chrono::steady_clock::now();
+            checkIncremental(store, index, pyramid);
+        }
+        if (update.ended) {
+            CHECK(next < stream.complete.size());
+            if (next < stream.complete.size()) {
+                const Scan &scan = *stream.complete[next++];
+                bool intact = (store.size() == scan.x.size()) &&
+                              (memcmp(store.x(), scan.x.data(), scan.x.size() * sizeof(float)) == 0) &&
+                              (memcmp(store.y(), scan.y.data(), scan.y.size() * sizeof(float)) == 0);
+                CHECK(intact);
+                CHECK(index.areaBetween(1000, 3000) > 0);
+            }
+        }
+        if (sent && (std::chrono::steady_clock::now() - idle_since > std::chrono::milliseconds(200))) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(paced ? 10 : 1));
+    }
+    result.seconds = std::chrono::duration<double>(idle_since - start).count();
+    stop = true;
+    spectrometer.join();
+    reader.join();
+    close(pty.slave);
+    close(pty.master);
+
+    SpectrumIngestStats stats = ingest.stats();
+    CHECK(next == stream.complete.size());
+    CHECK(stats.bytes == stream.bytes.size());
+    CHECK(stats.scans == stream.scans);
+    CHECK(stats.crc_errors >= 1);
+    CHECK(stats.ignored == stream.ignored);
+    CHECK(stats.samples == decoded);
+    CHECK(!ingest.scanning());
+    printf("%s, %u KB ring: %u bytes in %.2f s (%.0f%% of the line rate), %u frames, %u CRC errors, %u bytes "
+           "skipped, %u stalls, %u updates, slowest %.0f us\n",
+           paced ? "Paced" : "Flood", (unsigned)(ring_size / 1024), (unsigned)stats.bytes, result.seconds,
+           100.0 * stats.bytes / result.seconds / LINE_BYTES_PER_SECOND, (unsigned)stats.frames,
+           (unsigned)stats.crc_errors, (unsigned)stats.skipped, (unsigned)stats.stalls, (unsigned)result.updates,
+           result.poll_max_us);
+    return result;
+}
+
+// Appending in chunks of any size must give the tables of a single build
+static void testExtend(void)
+{
+    Scan s = makeScan(4000, 500, 150000, 1700);
+    std::mt19937 rng(7);
+    SpectrumIndex index;
+    SpectrumPyramid pyramid;
+    SpectrumStore store;
+    size_t at = 0;
+    bool same = true;
+    while (at < s.x.size()) {
+        size_t n = std::min(s.x.size() - at, (size_t)(1 + rng() % ((at < 100) ? 3 : 5000)));
+        for (size_t i = at; i < at + n; i++) {
+            store.push(s.x[i], s.y[i]);
+        }
+        at += n;
+        CHECK(index.extend(store.x(), store.y(), store.size()));
+        CHECK(pyramid.extend(store.x(), store.y(), store.size()));
+        if ((rng() % 16) == 0) {
+            SpectrumPyramid built;
+            built.build(store.x(), store.y(), store.size());
+            for (int q = 0; q < 20; q++) {
+                size_t a = rng() % store.size();
+                size_t b = a + 1 + rng() % (store.size() - a);
+                float lo1, hi1, lo2, hi2;
+                pyramid.rangeMinMax(a, b, lo1, hi1);
+                built.rangeMinMax(a, b, lo2, hi2);
+                same = same && (lo1 == lo2) && (hi1 == hi2);
+            }
+        }
+    }
+    CHECK(same);
+    checkIncremental(store, index, pyramid);
+    printf("Extended to %u samples: pyramid %u KB, index %u samples\n", (unsigned)store.size(),
+           (unsigned)(pyramid.bytes() / 1024), (unsigned)index.size());
+
+    // A shorter spectrum starts again
+    CHECK(index.extend(store.x(), store.y(), 1000));
+    CHECK(pyramid.extend(store.x(), store.y(), 1000));
+    store.resize(1000);
+    checkIncremental(store, index, pyramid);
+}
+
+static void testFrames(void)
+{
+    // The check value of CRC-16/MODBUS
+    CHECK(spectrumFrameCrc((const uint8_t *)"123456789", 9) == 0x4B37);
+    uint8_t frame[SPECTRUM_FRAME_MAX];
+    CHECK(spectrumFrameEncode(SPECTRUM_FRAME_SAMPLES, frame, SPECTRUM_FRAME_PAYLOAD_MAX + 1, frame, sizeof(frame)) == 0);
+    CHECK(spectrumFrameEncode(SPECTRUM_FRAME_END, nullptr, 0, frame, 6) == 0);
+    CHECK(spectrumFrameEncode(SPECTRUM_FRAME_END, nullptr, 0, frame, 7) == 7);
+}
+
+int main(void)
+{
+    testFrames();
+    testExtend();
+
+    Scan a = makeScan(4000, 500, 6000, 1700);
+    Scan b = makeScan(400, 3800, 4500, 2300);
+    Scan c = makeScan(4000, 500, 3000, 1200);
+    Scan d = makeScan(3999, 501, 5000, 2900);
+    Stream stream = makeStream(a, b, c, d);
+
+    RunResult paced = run(stream, SPECTRUM_INGEST_RING_SIZE, true);
+    // Kept up with the line: done within a poll period or so of the last byte
+    double line_seconds = (double)stream.bytes.size() / LINE_BYTES_PER_SECOND;
+    CHECK((paced.seconds == 0) || (paced.seconds < line_seconds + 0.1));
+    run(stream, 4 * 1024, false);
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
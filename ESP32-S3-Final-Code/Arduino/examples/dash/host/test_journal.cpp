@@ -0,0 +1,329 @@
+/*
+ * Test for the results journal: records read back in order across remounts in both flush modes, with the sequence
+ * carrying on; a power cut at every byte of the file (the records wholly before the cut survive, the rest is
+ * truncated and appending resumes after them); a corrupted record and a stale one with a good CRC but the wrong
+ * sequence number; and the batching, write sizes and syncs each setting asks for.
+ *
+ * Usage: test_journal
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "spectrum_journal.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+struct Record {
+    uint32_t sequence;
+    std::vector<uint8_t> payload;
+};
+
+static void collect(void *ctx, uint32_t sequence, const uint8_t *payload, size_t length)
+{
+    static_cast<std::vector<Record> *>(ctx)->push_back({sequence, std::vector<uint8_t>(payload, payload + length)});
+}
+
+// Payload of record `sequence`: its length varies so records straddle sectors at every offset
+static std::vector<uint8_t> payloadOf(uint32_t sequence)
+{
+    std::vector<uint8_t> payload((sequence * 37) % 97 + 1);
+    for (size_t i = 0; i < payload.size(); i++) {
+        payload[i] = (uint8_t)(sequence * 131 + i);
+    }
+    return payload;
+}
+
+static bool appendRecord(SpectrumJournal &journal)
+{
+    std::vector<uint8_t> payload = payloadOf(journal.sequence());
+    return journal.append(payload.data(), payload.size());
+}
+
+static std::vector<uint8_t> readAll(const std::string &path)
+{
+    std::vector<uint8_t> bytes;
+    FILE *in = fopen(path.c_str(), "rb");
+    int c;
+    while ((in != nullptr) && ((c = fgetc(in)) != EOF)) {
+        bytes.push_back((uint8_t)c);
+    }
+    if (in != nullptr) {
+        fclose(in);
+    }
+    return bytes;
+}
+
+static void writeAll(const std::string &path, const uint8_t *bytes, size_t length)
+{
+    FILE *out = fopen(path.c_str(), "wb");
+    fwrite(bytes, 1, length, out);
+    fclose(out);
+}
+
+// Where each record of a good journal ends, and where the padding after it does
+static void recordEnds(const std::vector<uint8_t> &bytes, std::vector<size_t> &ends, std::vector<size_t> &padded)
+{
+    size_t offset = 0;
+    while (offset < bytes.size()) {
+        if (bytes[offset] == 0) {
+            offset = (offset / SPECTRUM_JOURNAL_SECTOR + 1) * SPECTRUM_JOURNAL_SECTOR;
+            padded.back() = (offset < bytes.size()) ? offset : bytes.size();
+            continue;
+        }
+        offset += SPECTRUM_JOURNAL_HEADER + (bytes[offset + 2] | (bytes[offset + 3] << 8));
+        ends.push_back(offset);
+        padded.push_back(offset);
+    }
+}
+
+// Records 1..count read back as appended
+static void checkRecords(const std::vector<Record> &records, uint32_t count)
+{
+    CHECK(records.size() == count);
+    for (size_t i = 0; (i < records.size()) && (i < count); i++) {
+        CHECK(records[i].sequence == i + 1);
+        CHECK(records[i].payload == payloadOf((uint32_t)i + 1));
+    }
+}
+
+static SpectrumJournalConfig config(size_t block_size, uint32_t flush_records, uint32_t sync_every, bool seal)
+{
+    SpectrumJournalConfig config = spectrumJournalDefaults();
+    config.block_size = block_size;
+    config.flush_records = flush_records;
+    config.flush_interval_ms = 0;
+    config.sync_every = sync_every;
+    config.seal_sectors = seal;
+    return config;
+}
+
+static void testCrc(void)
+{
+    CHECK(spectrumJournalCrc("123456789", 9) == 0xCBF43926);
+    CHECK(spectrumJournalCrc("56789", 5, spectrumJournalCrc("1234", 4)) == 0xCBF43926);
+}
+
+static void testRemount(const std::string &path, bool seal)
+{
+    unlink(path.c_str());
+    SpectrumJournal journal;
+    CHECK(journal.mount(path.c_str(), config(1024, 3, 0, seal)));
+    for (int i = 0; i < 100; i++) {
+        CHECK(appendRecord(journal));
+    }
+    journal.close();
+
+    std::vector<Record> records;
+    CHECK(journal.mount(path.c_str(), config(2048, 5, 1, seal), collect, &records));
+    checkRecords(records, 100);
+    CHECK(journal.stats().recovered == 100);
+    CHECK(journal.stats().truncated == 0);
+    CHECK(journal.sequence() == 101);
+    for (int i = 0; i < 50; i++) {
+        CHECK(appendRecord(journal));
+    }
+    journal.close();
+
+    records.clear();
+    CHECK(journal.mount(path.c_str(), config(1024, 0, 0, !seal), collect, &records));
+    checkRecords(records, 150);
+    CHECK(appendRecord(journal));
+    journal.close();
+    records.clear();
+    CHECK(journal.mount(path.c_str(), config(1024, 0, 0, seal), collect, &records));
+    checkRecords(records, 151);
+    journal.close();
+}
+
+// Power lost after any number of bytes of the journal reached the file
+static void testPowerCut(const std::string &path, bool seal)
+{
+    unlink(path.c_str());
+    SpectrumJournal journal;
+    CHECK(journal.mount(path.c_str(), config(1024, 4, 0, seal)));
+    for (int i = 0; i < 40; i++) {
+        CHECK(appendRecord(journal));
+    }
+    journal.close();
+    std::vector<uint8_t> bytes = readAll(path);
+    std::vector<size_t> ends, padded;
+    recordEnds(bytes, ends, padded);
+    CHECK(ends.size() == 40);
+
+    int bad = 0;
+    for (size_t cut = 0; cut <= bytes.size(); cut++) {
+        writeAll(path, bytes.data(), cut);
+        uint32_t survivors = 0;
+        while ((survivors < ends.size()) && (ends[survivors] <= cut)) {
+            survivors++;
+        }
+        // Padding is kept as far as it reached
+        size_t end = (survivors == 0) ? 0 : std::min(cut, padded[survivors - 1]);
+
+        std::vector<Record> records;
+        bool ok = journal.mount(path.c_str(), config(1024, 0, 0, seal), collect, &records) &&
+                  (records.size() == survivors) && (journal.stats().truncated == cut - end) &&
+                  (journal.sequence() == survivors + 1) && appendRecord(journal);
+        journal.close();
+        records.clear();
+        ok = ok && journal.mount(path.c_str(), config(1024, 0, 0, seal), collect, &records) &&
+             (records.size() == survivors + 1) && (journal.stats().truncated == 0);
+        journal.close();
+        for (size_t i = 0; ok && (i < records.size()); i++) {
+            ok = (records[i].sequence == i + 1) && (records[i].payload == payloadOf((uint32_t)i + 1));
+        }
+        bad += ok ? 0 : 1;
+    }
+    printf("%s: power cut at each of %u bytes, %d wrong\n", seal ? "sealed" : "rewritten", (unsigned)bytes.size(),
+           bad);
+    CHECK(bad == 0);
+}
+
+static void testCorruption(const std::string &path)
+{
+    unlink(path.c_str());
+    SpectrumJournal journal;
+    CHECK(journal.mount(path.c_str(), config(1024, 0, 0, false)));
+    for (int i = 0; i < 30; i++) {
+        CHECK(appendRecord(journal));
+    }
+    journal.close();
+    const std::vector<uint8_t> bytes = readAll(path);
+    std::vector<size_t> ends, padded;
+    recordEnds(bytes, ends, padded);
+
+    // A flipped bit in the payload of record 12
+    std::vector<uint8_t> corrupt = bytes;
+    corrupt[ends[10] + SPECTRUM_JOURNAL_HEADER] ^= 0x10;
+    writeAll(path, corrupt.data(), corrupt.size());
+    std::vector<Record> records;
+    CHECK(journal.mount(path.c_str(), config(1024, 0, 0, false), collect, &records));
+    checkRecords(records, 11);
+    CHECK(journal.stats().truncated == bytes.size() - ends[10]);
+    CHECK(journal.sequence() == 12);
+    journal.close();
+    CHECK(readAll(path).size() == ends[10]);
+
+    // Record 12 with a good CRC but a number that does not follow, as left by an older journal in a torn sector
+    corrupt = bytes;
+    uint8_t *header = &corrupt[ends[10]];
+    header[4] = 40;
+    uint32_t crc = spectrumJournalCrc(header + SPECTRUM_JOURNAL_HEADER, header[2] | (header[3] << 8),
+                                      spectrumJournalCrc(header + 2, 6));
+    for (int i = 0; i < 4; i++) {
+        header[8 + i] = (uint8_t)(crc >> (8 * i));
+    }
+    writeAll(path, corrupt.data(), corrupt.size());
+    records.clear();
+    CHECK(journal.mount(path.c_str(), config(1024, 0, 0, false), collect, &records));
+    checkRecords(records, 11);
+    journal.close();
+
+    // Garbage that is not a journal at all
+    std::vector<uint8_t> noise(3000);
+    for (size_t i = 0; i < noise.size(); i++) {
+        noise[i] = (uint8_t)(i * 2654435761u >> 13) | 1;
+    }
+    writeAll(path, noise.data(), noise.size());
+    records.clear();
+    CHECK(journal.mount(path.c_str(), config(1024, 0, 0, false), collect, &records));
+    CHECK(records.empty());
+    CHECK(journal.stats().truncated == noise.size());
+    CHECK(journal.sequence() == 1);
+    journal.close();
+}
+
+static void testBatching(const std::string &path)
+{
+    SpectrumJournal journal;
+    CHECK(!journal.mount(path.c_str(), config(512, 0, 0, false)));     // No room for a record and a partial sector
+    CHECK(!journal.mount(path.c_str(), config(1000, 0, 0, false)));
+    CHECK(!journal.append("x", 1));
+
+    // Only a full block is written: whole sectors, but for the partial one the next flush completes
+    unlink(path.c_str());
+    CHECK(journal.mount(path.c_str(), config(2048, 0, 0, false)));
+    uint8_t payload[SPECTRUM_JOURNAL_PAYLOAD_MAX + 1] = {};
+    CHECK(!journal.append(payload, sizeof(payload)));
+    int appended = 0;
+    while (journal.stats().flushes == 0) {
+        CHECK(journal.append(payload, 52));
+        appended++;
+    }
+    CHECK(appended == 2048 / 64 + 1);
+    CHECK(journal.stats().bytes_written == 2048);
+    CHECK(journal.pending() == 1);
+    CHECK(journal.stats().syncs == 0);
+    for (int i = 0; i < 1000; i++) {
+        CHECK(journal.append(payload, 52));
+    }
+    CHECK(journal.sync());
+    const SpectrumJournalStats &stats = journal.stats();
+    printf("block 2 KB, rewriting: %u records, %u flushes, %.3f write amplification\n", (unsigned)stats.records,
+           (unsigned)stats.flushes, stats.amplification());
+    CHECK(stats.amplification() < 1.3);
+    CHECK(stats.syncs == 1);
+    journal.close();
+
+    // A flush every 4 records, each sealed, and every second one synced
+    unlink(path.c_str());
+    CHECK(journal.mount(path.c_str(), config(2048, 4, 2, true)));
+    for (int i = 0; i < 40; i++) {
+        CHECK(journal.append(payload, 52));
+    }
+    printf("flush every 4, sealed: %u flushes, %u syncs, %.3f write amplification\n",
+           (unsigned)journal.stats().flushes, (unsigned)journal.stats().syncs, journal.stats().amplification());
+    CHECK(journal.pending() == 0);
+    CHECK(journal.stats().flushes == 10);
+    CHECK(journal.stats().syncs == 5);
+    CHECK(journal.stats().bytes_written == 10 * SPECTRUM_JOURNAL_SECTOR);
+    journal.close();
+    CHECK(readAll(path).size() == 10 * SPECTRUM_JOURNAL_SECTOR);
+
+    // On a timer
+    unlink(path.c_str());
+    SpectrumJournalConfig timed = config(2048, 0, 0, false);
+    timed.flush_interval_ms = 10;
+    CHECK(journal.mount(path.c_str(), timed));
+    CHECK(journal.append(payload, 52));
+    CHECK(journal.poll());
+    CHECK(journal.pending() == 1);
+    usleep(30000);
+    CHECK(journal.poll());
+    CHECK(journal.pending() == 0);
+    CHECK(readAll(path).size() == 64);
+    journal.close();
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/test_journal_XXXXXX";
+    CHECK(mkdtemp(dir) != nullptr);
+    std::string path = std::string(dir) + "/results.log";
+
+    testCrc();
+    testRemount(path, false);
+    testRemount(path, true);
+    testPowerCut(path, false);
+    testPowerCut(path, true);
+    testCorruption(path);
+    testBatching(path);
+
+    unlink(path.c_str());
+    rmdir(dir);
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+/*
+ * Test for the background loader, with pthreads standing in for the FreeRTOS task and queues: loads complete with
+ * monotonic progress, can be cancelled or superseded mid-file, and `end()` returns even if nobody drains the events.
+ *
+ * Usage: test_loader
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_csv.h"
+#include "spectrum_loader.h"
+#include "spectrum_store.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+// Stands in for the SD card: every path maps to the same in-memory CSV, read in small chunks with a delay
+struct FakeCard {
+    std::string csv;
+    std::atomic<useconds_t> chunk_delay_us;  // Changed by the test while a load runs
+    SpectrumStore store;
+};
+
+struct FakeFile {
+    const FakeCard *card;
+    size_t offset;
+    SpectrumLoader *loader;
+};
+
+static bool storePoint(float x, float y, void *user_data)
+{
+    return static_cast<SpectrumStore *>(user_data)->push(x, y);
+}
+
+static int readChunk(void *ctx, uint8_t *buf, size_t len)
+{
+    FakeFile *file = static_cast<FakeFile *>(ctx);
+    if (file->loader->cancelled()) {
+        return -1;
+    }
+    if (file->card->chunk_delay_us > 0) {
+        usleep(file->card->chunk_delay_us);
+    }
+    size_t left = file->card->csv.size() - file->offset;
+    len = (len < left) ? len : left;
+    memcpy(buf, file->card->csv.data() + file->offset, len);
+    file->offset += len;
+    file->loader->progress(file->offset, file->card->csv.size());
+    return (int)len;
+}
+
+static bool loadFake(const char *path, SpectrumLoader &loader, void *user_data)
+{
+    FakeCard *card = static_cast<FakeCard *>(user_data);
+    if (strcmp(path, "/missing.csv") == 0) {
+        return false;
+    }
+    FakeFile file = {card, 0, &loader};
+    uint8_t chunk[256];
+    card->store.clear();
+    SpectrumCsvParser parser(storePoint, &card->store);
+    return spectrumCsvParseStream(readChunk, &file, chunk, sizeof(chunk), parser, nullptr);
+}
+
+// Poll like the UI's lv_timer would until the outcome of `job` arrives
+static SpectrumLoadEvent waitFor(SpectrumLoader &loader, uint32_t job, std::vector<SpectrumLoadEvent> *progress)
+{
+    SpectrumLoadEvent event = {};
+    for (int i = 0; i < 10000; i++) {
+        while (loader.poll(event)) {
+            if (event.job != job) {
+                continue;
+            }
+            if (event.type != SPECTRUM_LOAD_PROGRESS) {
+                return event;
+            }
+            if (progress != nullptr) {
+                progress->push_back(event);
+            }
+        }
+        usleep(1000);
+    }
+    printf("Timed out waiting for job %u\n", job);
+    failures++;
+    event.type = SPECTRUM_LOAD_FAILED;
+    return event;
+}
+
+static void testQueue(void)
+{
+    SpectrumQueue *queue = spectrum_queue_create(2, sizeof(int));
+    int a = 1;
+    int b = 2;
+    int c = 3;
+    int out = 0;
+    CHECK(!spectrum_queue_receive(queue, &out, 0));
+    CHECK(spectrum_queue_send(queue, &a, 0));
+    CHECK(spectrum_queue_send(queue, &b, 0));
+    CHECK(!spectrum_queue_send(queue, &c, 5));
+    CHECK(spectrum_queue_receive(queue, &out, 0) && (out == 1));
+    CHECK(spectrum_queue_send(queue, &c, 0));
+    CHECK(spectrum_queue_receive(queue, &out, 0) && (out == 2));
+    CHECK(spectrum_queue_receive(queue, &out, 0) && (out == 3));
+    spectrum_queue_delete(queue);
+}
+
+int main(void)
+{
+    FakeCard card;
+    card.csv = "Wavenumber,Intensity\n";
+    const int rows = 20000;
+    char line[64];
+    for (int i = 0; i < rows; i++) {
+        snprintf(line, sizeof(line), "%d.5,%d\n", 4000 - i, i % 97);
+        card.csv += line;
+    }
+
+    testQueue();
+
+    SpectrumLoader loader;
+    CHECK(loader.begin(loadFake, &card));
+
+    // A full load: progress only goes up and ends at 100%, all rows arrive
+    card.chunk_delay_us = 0;
+    std::vector<SpectrumLoadEvent> progress;
+    uint32_t job = loader.request("/a.csv");
+    CHECK(job != 0);
+    SpectrumLoadEvent outcome = waitFor(loader, job, &progress);
+    CHECK(outcome.type == SPECTRUM_LOAD_DONE);
+    CHECK(card.store.size() == (size_t)rows);
+    CHECK(!progress.empty());
+    for (size_t i = 1; i < progress.size(); i++) {
+        CHECK(progress[i].done > progress[i - 1].done);
+    }
+    CHECK(outcome.percent() == 100);
+    CHECK(!loader.busy());
+
+    // A failing load reports it
+    job = loader.request("/missing.csv");
+    CHECK(waitFor(loader, job, nullptr).type == SPECTRUM_LOAD_FAILED);
+
+    // Cancel once the load is under way
+    card.chunk_delay_us = 200;
+    job = loader.request("/b.csv");
+    progress.clear();
+    SpectrumLoadEvent event;
+    for (int i = 0; (i < 5000) && progress.empty(); i++) {
+        if (loader.poll(event) && (event.job == job)) {
+            progress.push_back(event);
+        }
+        usleep(100);
+    }
+    CHECK(loader.busy());
+    loader.cancel();
+    outcome = waitFor(loader, job, nullptr);
+    CHECK(outcome.type == SPECTRUM_LOAD_CANCELLED);
+    CHECK(card.store.size() < (size_t)rows);
+
+    // A new request supersedes the one in progress
+    uint32_t first = loader.request("/c.csv");
+    usleep(2000);
+    uint32_t second = loader.request("/d.csv");
+    CHECK((first != 0) && (second > first));
+    CHECK(waitFor(loader, first, nullptr).type == SPECTRUM_LOAD_CANCELLED);
+    card.chunk_delay_us = 0;
+    CHECK(waitFor(loader, second, nullptr).type == SPECTRUM_LOAD_DONE);
+    CHECK(card.store.size() == (size_t)rows);
+
+    // A request turned away by a full queue leaves the queued ones alone
+    card.chunk_delay_us = 100000;
+    first = loader.request("/g.csv");
+    usleep(20000);
+    second = loader.request("/h.csv");
+    uint32_t third = loader.request("/i.csv");
+    CHECK((first != 0) && (second != 0) && (third != 0));
+    CHECK(loader.request("/j.csv") == 0);
+    card.chunk_delay_us = 0;
+    CHECK(waitFor(loader, third, nullptr).type == SPECTRUM_LOAD_DONE);
+    CHECK(card.store.size() == (size_t)rows);
+
+    // Stopping with a load in flight and nobody polling must not hang
+    card.chunk_delay_us = 200;
+    CHECK(loader.request("/e.csv") != 0);
+    usleep(5000);
+    uint32_t start = spectrum_time_us();
+    loader.end();
+    printf("end() with a load in flight returned in %u us, %u progress updates dropped\n",
+           spectrum_time_us() - start, loader.dropped());
+    CHECK(loader.request("/f.csv") == 0);
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
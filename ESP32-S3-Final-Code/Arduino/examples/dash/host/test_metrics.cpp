@@ -0,0 +1,236 @@
+/*
+ * Test for the hot-path metrics: samples land in the right power-of-two bucket, sums carry past 32 bits, counts stay
+ * exact with several threads recording at once, quantiles fall in the right bucket, and the `/metrics` body is valid
+ * Prometheus text whichever buffer size it is streamed through. Also prints what one timer costs.
+ *
+ * Usage: test_metrics
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_metrics.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static void testBuckets(void)
+{
+    static SpectrumMetrics metrics;
+    metrics.record(SPECTRUM_SCOPE_AREA, 0, 0);
+    metrics.record(SPECTRUM_SCOPE_AREA, 0, 1);
+    metrics.record(SPECTRUM_SCOPE_AREA, 0, 1023);
+    metrics.record(SPECTRUM_SCOPE_AREA, 0, 1024);
+    metrics.record(SPECTRUM_SCOPE_AREA, 1, 3000);
+    metrics.record(SPECTRUM_SCOPE_AREA, 1, 1ULL << 50);    // Past the last bucket
+    metrics.record(SPECTRUM_SCOPE_COUNT, 0, 5);             // Ignored
+
+    SpectrumMetricsSnapshot s;
+    metrics.snapshot(SPECTRUM_SCOPE_AREA, 0, s);
+    CHECK(s.count == 4);
+    CHECK((s.buckets[0] == 2) && (s.buckets[9] == 1) && (s.buckets[10] == 1));
+    CHECK(s.sum == 2048);
+    CHECK(s.max == 1024);
+
+    metrics.snapshot(SPECTRUM_SCOPE_AREA, -1, s);
+    CHECK(s.count == 6);
+    CHECK((s.buckets[11] == 1) && (s.buckets[SPECTRUM_METRICS_BUCKETS - 1] == 1));
+    CHECK(s.sum == 2048 + 3000 + (1ULL << 50));
+    CHECK(s.max == (float)(1ULL << 50));
+
+    metrics.snapshot(SPECTRUM_SCOPE_LOAD, -1, s);
+    CHECK((s.count == 0) && (s.sum == 0) && (s.max == 0) && (s.quantile(0.5) == 0));
+
+    // Low words carrying into the high one
+    for (int i = 0; i < 5; i++) {
+        metrics.record(SPECTRUM_SCOPE_LOAD, 0, 0xF0000000u);
+    }
+    metrics.snapshot(SPECTRUM_SCOPE_LOAD, 0, s);
+    CHECK(s.sum == 5ULL * 0xF0000000u);
+
+    metrics.reset();
+    metrics.snapshot(SPECTRUM_SCOPE_AREA, -1, s);
+    CHECK((s.count == 0) && (s.sum == 0) && (s.max == 0));
+}
+
+static void testQuantiles(void)
+{
+    static SpectrumMetrics metrics;
+    // 90 samples around 1000 cycles and 10 around 100000: the p50 is in the first bucket, the p99 in the last
+    for (int i = 0; i < 90; i++) {
+        metrics.record(SPECTRUM_SCOPE_CHART, 0, 900 + i);
+    }
+    for (int i = 0; i < 10; i++) {
+        metrics.record(SPECTRUM_SCOPE_CHART, 1, 100000 + i);
+    }
+    SpectrumMetricsSnapshot s;
+    metrics.snapshot(SPECTRUM_SCOPE_CHART, -1, s);
+    double p50 = s.quantile(0.5);
+    double p99 = s.quantile(0.99);
+    printf("p50 %.0f (true ~945), p99 %.0f (true ~100009)\n", p50, p99);
+    CHECK((p50 >= 512) && (p50 < 1024));
+    CHECK((p99 >= 65536) && (p99 <= 100009));
+    CHECK(s.quantile(1.0) <= s.max);
+    CHECK(s.quantile(0.0) >= 512);
+}
+
+static void testThreads(void)
+{
+    static SpectrumMetrics metrics;
+    const int threads = 4;
+    const int samples = 200000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        // Two threads per core slot, as two tasks on one core would be
+        workers.emplace_back([t]() {
+            for (int i = 0; i < samples; i++) {
+                metrics.record(SPECTRUM_SCOPE_HTTP, t & 1, (uint64_t)(i % 5000) * 1000000);
+            }
+        });
+    }
+    for (std::thread &w : workers) {
+        w.join();
+    }
+
+    uint64_t expected_sum = 0;
+    for (int i = 0; i < samples; i++) {
+        expected_sum += (uint64_t)(i % 5000) * 1000000;
+    }
+    SpectrumMetricsSnapshot s;
+    metrics.snapshot(SPECTRUM_SCOPE_HTTP, -1, s);
+    CHECK(s.count == (uint32_t)(threads * samples));
+    CHECK(s.sum == threads * expected_sum);
+    CHECK(s.max == (float)(4999ULL * 1000000));
+    metrics.snapshot(SPECTRUM_SCOPE_HTTP, 0, s);
+    CHECK(s.count == (uint32_t)(threads / 2 * samples));
+}
+
+// The whole `/metrics` body, streamed through buffers of `size` bytes
+static std::string streamBody(SpectrumMetrics &metrics, size_t size, int &calls)
+{
+    std::vector<char> buffer(size);
+    alignas(8) char state[SPECTRUM_HTTP_STATE_MAX] = {};
+    std::string body;
+    bool done = false;
+    calls = 0;
+    while (!done && (calls < 1000)) {
+        size_t n = SpectrumMetrics::body(&metrics, state, buffer.data(), size, done);
+        CHECK(n <= size);
+        CHECK((n > 0) || done);
+        body.append(buffer.data(), n);
+        calls++;
+    }
+    CHECK(done);
+    return body;
+}
+
+static void testPrometheus(void)
+{
+    static SpectrumMetrics metrics;
+    for (int i = 1; i <= 1000; i++) {
+        metrics.record(SPECTRUM_SCOPE_RENDER, 0, (uint64_t)i * 5000);     // 5 us to 5 ms
+    }
+    metrics.record(SPECTRUM_SCOPE_FLUSH, 1, 3000000000ULL);                // 3 s
+
+    int calls_large, calls_small;
+    std::string body = streamBody(metrics, SPECTRUM_HTTP_BODY_MAX, calls_large);
+    CHECK(streamBody(metrics, 1400, calls_small) == body);
+    printf("/metrics: %u bytes in %d chunks of %u, %d of 1400\n", (unsigned)body.size(), calls_large,
+           (unsigned)SPECTRUM_HTTP_BODY_MAX, calls_small);
+    CHECK(body.size() > SPECTRUM_HTTP_BODY_MAX);
+    CHECK(calls_small > calls_large);
+
+    // Every line a comment or `name{labels} value`, buckets cumulative and ending at the count
+    int families = 0;
+    int series = 0;
+    int gauges = 0;
+    unsigned previous = 0;
+    size_t start = 0;
+    while (start < body.size()) {
+        size_t end = body.find('\n', start);
+        CHECK(end != std::string::npos);
+        std::string line = body.substr(start, end - start);
+        start = end + 1;
+        if (line.compare(0, 7, "# TYPE ") == 0) {
+            families++;
+            continue;
+        }
+        if (line[0] == '#') {
+            continue;
+        }
+        size_t brace = line.find('}');
+        CHECK((line.find('{') != std::string::npos) && (brace != std::string::npos) && (line[brace + 1] == ' '));
+        char *rest;
+        double value = strtod(line.c_str() + brace + 2, &rest);
+        CHECK(*rest == '\0');
+        if (line.compare(0, 26, "dash_scope_seconds_bucket{") == 0) {
+            CHECK((unsigned)value >= previous);
+            previous = (unsigned)value;
+        } else if (line.compare(0, 25, "dash_scope_seconds_count{") == 0) {
+            series++;
+            CHECK((unsigned)value == previous);
+            previous = 0;
+        } else if (line.compare(0, 23, "dash_scope_max_seconds{") == 0) {
+            gauges++;
+        }
+    }
+    CHECK(families == 2);
+    CHECK(series == SPECTRUM_SCOPE_COUNT * SPECTRUM_METRICS_CORES);
+    CHECK(gauges == SPECTRUM_SCOPE_COUNT * SPECTRUM_METRICS_CORES);
+
+    CHECK(body.find("dash_scope_seconds_count{scope=\"render\",core=\"0\"} 1000\n") != std::string::npos);
+    CHECK(body.find("dash_scope_seconds_sum{scope=\"render\",core=\"0\"} 2.5025\n") != std::string::npos);
+    // 4^9 ns takes the 52 samples below 262 us, 4^12 ns all of them
+    CHECK(body.find("dash_scope_seconds_bucket{scope=\"render\",core=\"0\",le=\"0.000262\"} 52\n") != std::string::npos);
+    CHECK(body.find("dash_scope_seconds_bucket{scope=\"render\",core=\"0\",le=\"0.0168\"} 1000\n") != std::string::npos);
+    CHECK(body.find("dash_scope_max_seconds{scope=\"flush\",core=\"1\"} 3\n") != std::string::npos);
+    CHECK(body.find("dash_scope_seconds_bucket{scope=\"flush\",core=\"1\",le=\"+Inf\"} 1\n") != std::string::npos);
+}
+
+static void testTimer(void)
+{
+    spectrumMetrics.reset();
+    {
+        SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_LOAD);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    SpectrumMetricsSnapshot s;
+    spectrumMetrics.snapshot(SPECTRUM_SCOPE_LOAD, -1, s);
+    CHECK(s.count == 1);
+    CHECK((s.sum >= 20000000) && (s.sum < 2000000000));
+
+    // What one timer costs on the host, four clock reads included: on the device it reads CCOUNT and the tick count
+    const int rounds = 1000000;
+    uint32_t start = spectrum_time_us();
+    for (int i = 0; i < rounds; i++) {
+        SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_AREA);
+    }
+    double ns = (spectrum_time_us() - start) * 1000.0 / rounds;
+    spectrumMetrics.snapshot(SPECTRUM_SCOPE_AREA, -1, s);
+    CHECK(s.count == (uint32_t)rounds);
+    printf("One timer: %.1f ns\n", ns);
+    CHECK(ns < 1000);
+}
+
+int main(void)
+{
+    testBuckets();
+    testQuantiles();
+    testThreads();
+    testPrometheus();
+    testTimer();
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
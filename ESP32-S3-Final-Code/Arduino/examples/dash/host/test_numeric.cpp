@@ -0,0 +1,319 @@
+/*
+ * Accuracy test for the numeric core: the Q16.16 and Q32.32 types and their 64-bit multiply; then the integration,
+ * prefix-sum and envelope kernels in fixed point against the same kernels in double, on the same float samples.
+ *
+ * The fixed-point error has a bound worked out from the data: every sample is off by at most one step `q` once
+ * converted, so a trapezoid is off by at most (2q |y0 + y1| + 2q |dx| + 4q^2) / 2, plus the rounding of its product.
+ * The sums then add no error of their own, so a difference of two prefix sums is exactly the integral of that range.
+ * The float kernels are timed in bench_numeric; their error is printed here for comparison.
+ *
+ * Last, the sketch's own configuration (`SPECTRUM_NUMERIC_FIXED`, which CMake also builds as test_numeric_q16): area
+ * queries on `SpectrumIndex` within the same bound, the pyramid's envelopes identical to the linear ones, and sidecars
+ * flagged with the format of their prefix sums.
+ *
+ * Usage: test_numeric
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "spectrum_cache.h"
+#include "spectrum_decimate.h"
+#include "spectrum_index.h"
+#include "spectrum_numeric.h"
+#include "spectrum_pyramid.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+struct Spectrum {
+    std::vector<float> x;
+    std::vector<float> y;
+};
+
+static uint32_t lcg(uint32_t &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// Absorbance-like: a sloped baseline, a few peaks and noise, at slightly uneven steps from `first` in either direction
+static Spectrum makeSpectrum(size_t count, double first, double step)
+{
+    Spectrum s;
+    uint32_t state = 7;
+    double x = first;
+    for (size_t i = 0; i < count; i++) {
+        double peaks = 1.8 * exp(-pow((x - 2250) / 12, 2)) + 0.9 * exp(-pow((x - 1650) / 30, 2)) +
+                       2.5 * exp(-pow((x - 3300) / 4, 2));
+        s.x.push_back((float)x);
+        s.y.push_back((float)(0.05 + 1e-5 * x + peaks + 0.002 * ((lcg(state) % 1000) / 1000.0 - 0.5)));
+        x += step * (1 + 0.01 * ((lcg(state) % 100) / 100.0));
+    }
+    return s;
+}
+
+template <typename T>
+static std::vector<T> convert(const std::vector<float> &values)
+{
+    std::vector<T> out;
+    for (float v : values) {
+        out.push_back(SpectrumNumeric<T>::from(v));
+    }
+    return out;
+}
+
+// The most a fixed-point integral of samples [from, to) can be off, for a step of `q`
+static double integralBound(const Spectrum &s, size_t from, size_t to, double q)
+{
+    double bound = 0;
+    for (size_t i = from + 1; i < to; i++) {
+        double dx = fabs((double)s.x[i] - (double)s.x[i - 1]);
+        double y = fabs((double)s.y[i - 1] + (double)s.y[i]);
+        bound += 0.5 * (2 * q * y + 2 * q * dx + 4 * q * q) + 2 * ldexp(1.0, -32);
+    }
+    return bound;
+}
+
+static void testFixed(void)
+{
+    CHECK(SpectrumQ16::fromFloat(1.5f).raw == 0x18000);
+    CHECK(SpectrumQ16::fromFloat(-1.5f).raw == -0x18000);
+    CHECK(SpectrumQ16::fromDouble(1.0 / 65536 * 0.49).raw == 0);
+    CHECK(SpectrumQ16::fromDouble(1.0 / 65536 * 0.51).raw == 1);
+    CHECK(SpectrumQ16::fromFloat(40000.0f).raw == INT32_MAX);
+    CHECK(SpectrumQ16::fromFloat(-40000.0f).raw == INT32_MIN);
+    CHECK(SpectrumQ16::fromFloat(NAN).raw == 0);
+    CHECK(SpectrumQ32::fromDouble(3e9).raw == INT64_MAX);
+    CHECK(SpectrumQ32::fromFloat(-2.25f).toDouble() == -2.25);
+    CHECK(fabs(SpectrumQ32::fromDouble(1234.5678).toDouble() - 1234.5678) <= ldexp(1.0, -33));
+    CHECK(SpectrumQ16::fromFloat(4000.25f).toFloat() == 4000.25f);
+
+    // Against a 128-bit multiply, which the host has and the ESP32 does not
+    uint32_t state = 1;
+    int wrong = 0;
+    for (int i = 0; i < 100000; i++) {
+        int64_t a = ((int64_t)lcg(state) << 24 | lcg(state)) >> (lcg(state) % 40);
+        int64_t b = ((int64_t)lcg(state) << 8 | (lcg(state) & 0xFF)) >> (lcg(state) % 20);
+        a = (lcg(state) & 1) ? -a : a;
+        b = (lcg(state) & 1) ? -b : b;
+        __int128 p = (__int128)a * b;
+        __int128 magnitude = (p < 0) ? -p : p;
+        int64_t expected = (int64_t)((magnitude + ((__int128)1 << 31)) >> 32);
+        expected = (p < 0) ? -expected : expected;
+        wrong += (spectrumMulShift32(a, b) != expected) ? 1 : 0;
+    }
+    CHECK(wrong == 0);
+}
+
+// Every raw offset of a few short spans, either way, lands in the column the division would put it in, walked in order
+// or looked up
+static void testColumns(void)
+{
+    const int32_t spans[] = {1, 7, 800, 1601, 65536, -65536, -12345};
+    const uint16_t columns[] = {1, 3, 800};
+    int wrong = 0;
+    for (int32_t span : spans) {
+        for (uint16_t count : columns) {
+            SpectrumNumeric<SpectrumQ16>::Columns walk(SpectrumQ16::fromRaw(span), count);
+            int64_t length = (span < 0) ? -(int64_t)span : span;
+            for (int64_t o = 0; o <= length; o++) {
+                int64_t expected = o * count / length;
+                expected = (expected >= count) ? count - 1 : expected;
+                SpectrumQ16 offset = SpectrumQ16::fromRaw((int32_t)((span < 0) ? -o : o));
+                int column = walk.of(offset);
+                wrong += ((o < length) && (column != expected)) ? 1 : 0;
+                wrong += (walk.at(offset) != column) ? 1 : 0;
+            }
+        }
+    }
+    CHECK(wrong == 0);
+}
+
+template <typename T>
+static void checkIntegral(const char *name, const Spectrum &s, double q)
+{
+    std::vector<T> x = convert<T>(s.x);
+    std::vector<T> y = convert<T>(s.y);
+    const size_t n = s.x.size();
+
+    // Whole spectrum, straight from the float samples and from samples converted beforehand
+    double expected = spectrumIntegrate<double>(s.x.data(), s.y.data(), 0, n);
+    double area = spectrumToDouble(spectrumIntegrate<T>(s.x.data(), s.y.data(), 0, n));
+    CHECK(spectrumToDouble(spectrumIntegrate<T>(x.data(), y.data(), 0, n)) == area);
+    double bound = integralBound(s, 0, n, q);
+    printf("%-6s area %.9f, off by %.3g (bound %.3g)\n", name, area, fabs(area - expected), bound);
+    CHECK(fabs(area - expected) <= bound);
+
+    // Ranges as differences of prefix sums: the same as integrating the range alone, to the last bit
+    std::vector<typename SpectrumNumeric<T>::Accum> prefix(n);
+    spectrumPrefixSum<T>(x.data(), y.data(), 0, n / 3, prefix.data());
+    spectrumPrefixSum<T>(x.data(), y.data(), n / 3, n, prefix.data());
+    uint32_t state = 3;
+    double worst = 0;
+    int exact = 0;
+    for (int i = 0; i < 2000; i++) {
+        size_t from = lcg(state) % n;
+        size_t to = from + 1 + lcg(state) % ((i % 2) ? 50 : (n - from));
+        to = (to > n) ? n : to;
+        double range = spectrumToDouble(prefix[to - 1] - prefix[from]);
+        double direct = spectrumIntegrate<double>(s.x.data(), s.y.data(), from, to);
+        exact += (spectrumIntegrate<T>(x.data(), y.data(), from, to) == prefix[to - 1] - prefix[from]) ? 1 : 0;
+        double error = fabs(range - direct);
+        worst = (error > worst) ? error : worst;
+        CHECK(error <= integralBound(s, from, to, q));
+    }
+    printf("%-6s 2000 prefix ranges: worst error %.3g, %d identical to integrating the range alone\n", name, worst,
+           exact);
+    CHECK(exact == 2000);
+}
+
+// Float sums are not exact: for comparison only
+static void printFloatIntegral(const Spectrum &s)
+{
+    const size_t n = s.x.size();
+    double expected = spectrumIntegrate<double>(s.x.data(), s.y.data(), 0, n);
+    double area = spectrumIntegrate<float>(s.x.data(), s.y.data(), 0, n);
+    std::vector<float> prefix(n);
+    spectrumPrefixSum<float>(s.x.data(), s.y.data(), 0, n, prefix.data());
+    double tail = spectrumIntegrate<double>(s.x.data(), s.y.data(), n - 50, n);
+    printf("float  area %.9f, off by %.3g; last 50 samples from float prefix sums off by %.3g of %.4f\n", area,
+           fabs(area - expected), fabs((double)(prefix[n - 1] - prefix[n - 50]) - tail), tail);
+}
+
+template <typename T>
+static void checkEnvelope(const char *name, const Spectrum &s, uint16_t columns, double q)
+{
+    const size_t n = s.x.size();
+    std::vector<double> xd(s.x.begin(), s.x.end());
+    std::vector<double> yd(s.y.begin(), s.y.end());
+    std::vector<double> ex(columns), emin(columns), emax(columns);
+    double elo, ehi;
+    CHECK(spectrumEnvelope<double>(xd.data(), yd.data(), 0, n, columns, ex.data(), emin.data(), emax.data(), &elo,
+                                   &ehi));
+
+    std::vector<T> x = convert<T>(s.x);
+    std::vector<T> y = convert<T>(s.y);
+    std::vector<T> ox(columns), omin(columns), omax(columns);
+    T lo, hi;
+    CHECK(spectrumEnvelope<T>(x.data(), y.data(), 0, n, columns, ox.data(), omin.data(), omax.data(), &lo, &hi));
+
+    // Sample values are off by their conversion; the lines through empty columns also by where they are taken
+    double max_slope = 0;
+    for (size_t i = 1; i < n; i++) {
+        double slope = fabs((yd[i] - yd[i - 1]) / (xd[i] - xd[i - 1]));
+        max_slope = (slope > max_slope) ? slope : max_slope;
+    }
+    double value_bound = q + max_slope * 3 * q + ldexp(1.0, -30);
+    double worst_x = 0;
+    double worst = 0;
+    for (uint16_t c = 0; c < columns; c++) {
+        worst_x = fmax(worst_x, fabs(spectrumToDouble(ox[c]) - ex[c]));
+        worst = fmax(worst, fabs(spectrumToDouble(omin[c]) - emin[c]));
+        worst = fmax(worst, fabs(spectrumToDouble(omax[c]) - emax[c]));
+    }
+    printf("%-6s %u samples on %u columns: centres off by %.3g, values by %.3g (bound %.3g)\n", name, (unsigned)n,
+           (unsigned)columns, worst_x, worst, value_bound);
+    CHECK(worst_x <= 2 * q);
+    CHECK(worst <= value_bound);
+    CHECK(fabs(spectrumToDouble(lo) - elo) <= q);
+    CHECK(fabs(spectrumToDouble(hi) - ehi) <= q);
+}
+
+static int readMemory(void *ctx, uint8_t *buf, size_t len)
+{
+    memcpy(buf, ctx, len);
+    return (int)len;
+}
+
+static void checkSketchConfig(const Spectrum &s)
+{
+    const size_t n = s.x.size();
+    const double q = (SPECTRUM_NUMERIC_FIXED == 0) ? 0 : ldexp(1.0, -SPECTRUM_NUMERIC_FIXED);
+    SpectrumIndex index;
+    SpectrumPyramid pyramid;
+    CHECK(index.build(s.x.data(), s.y.data(), n) && pyramid.build(s.x.data(), s.y.data(), n));
+
+    // Every range is within the bound of the whole spectrum, plus what double rounding leaves
+    double bound = integralBound(s, 0, n, q);
+    double worst = 0;
+    uint32_t state = 11;
+    for (int i = 0; i < 500; i++) {
+        double x0 = index.minX() + (index.maxX() - index.minX()) * (lcg(state) % 10000) / 10000.0;
+        double x1 = index.minX() + (index.maxX() - index.minX()) * (lcg(state) % 10000) / 10000.0;
+        double expected = index.areaBetweenLinear(x0, x1);
+        double error = fabs(index.areaBetween(x0, x1) - expected);
+        worst = (error > worst) ? error : worst;
+        CHECK(error <= bound + 1e-9 * (fabs(expected) + 1));
+    }
+    printf("SPECTRUM_NUMERIC_FIXED %d: 500 area queries off by %.3g at most (bound %.3g)\n", SPECTRUM_NUMERIC_FIXED,
+           worst, bound);
+
+    // The chart takes either path depending on the zoom, so both must draw the same columns
+    const uint16_t widths[] = {1, 7, 800, 3000};
+    int different = 0;
+    for (uint16_t width : widths) {
+        for (size_t from = 0; from < n / 2; from += n / 7) {
+            size_t to = n - from / 3;
+            std::vector<float> ax(width), amin(width), amax(width), bx(width), bmin(width), bmax(width);
+            float alo, ahi, blo, bhi;
+            CHECK(spectrumEnvelopeCompute(s.x.data(), s.y.data(), from, to, width, ax.data(), amin.data(),
+                                          amax.data(), &alo, &ahi));
+            CHECK(pyramid.envelope(from, to, width, bx.data(), bmin.data(), bmax.data(), &blo, &bhi));
+            bool same = (memcmp(ax.data(), bx.data(), width * sizeof(float)) == 0) &&
+                        (memcmp(amin.data(), bmin.data(), width * sizeof(float)) == 0) &&
+                        (memcmp(amax.data(), bmax.data(), width * sizeof(float)) == 0) && (alo == blo) && (ahi == bhi);
+            different += same ? 0 : 1;
+        }
+    }
+    CHECK(different == 0);
+
+    // A sidecar from the other kind of build is stale, not misread
+    SpectrumCacheHeader header;
+    spectrumCacheMakeHeader(header, s.x.data(), s.y.data(), (uint32_t)n, 1, 2);
+    SpectrumCacheHeader read;
+    CHECK(spectrumCacheReadHeader(readMemory, &header, read));
+    header.flags ^= SPECTRUM_CACHE_FIXED_PREFIX;
+    CHECK(!spectrumCacheReadHeader(readMemory, &header, read));
+}
+
+int main(void)
+{
+    testFixed();
+    testColumns();
+
+    // 200k samples at about 0.018 cm-1 from 400 cm-1, x and y well inside Q16.16
+    Spectrum spectrum = makeSpectrum(200000, 400, 0.0175);
+    checkIntegral<SpectrumQ16>("Q16.16", spectrum, ldexp(1.0, -16));
+    checkIntegral<SpectrumQ32>("Q32.32", spectrum, ldexp(1.0, -32));
+    printFloatIntegral(spectrum);
+
+    // Envelopes on x that both types hold exactly, so the columns are the same ones: 0.25 steps, 100001 of them
+    // across 800 columns, none of which starts exactly on a sample
+    Spectrum dense = makeSpectrum(100002, 400, 0.25);
+    Spectrum sparse = makeSpectrum(300, 4000, -0.25 * 333);
+    for (size_t i = 0; i < dense.x.size(); i++) {
+        dense.x[i] = 400 + 0.25f * i;
+    }
+    for (size_t i = 0; i < sparse.x.size(); i++) {
+        sparse.x[i] = 4000 - 0.25f * 333 * i;
+    }
+    checkEnvelope<SpectrumQ16>("Q16.16", dense, 800, ldexp(1.0, -16));
+    checkEnvelope<SpectrumQ32>("Q32.32", dense, 800, ldexp(1.0, -32));
+    checkEnvelope<SpectrumQ16>("Q16.16", sparse, 800, ldexp(1.0, -16));
+    checkEnvelope<SpectrumQ32>("Q32.32", sparse, 800, ldexp(1.0, -32));
+
+    checkSketchConfig(makeSpectrum(50000, 400, 0.07));
+    checkSketchConfig(makeSpectrum(50000, 4000, -0.07));
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
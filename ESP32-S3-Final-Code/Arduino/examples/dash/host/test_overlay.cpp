@@ -0,0 +1,189 @@
+/*
+ * Test for the overlay of several spectra: series of different sampling, direction and extent copied into the pool
+ * (which moves as it grows), checked against the same spectra held alone; their envelopes on a shared axis, for
+ * alignment and for hitting the shared cache; removal; the limits; and memory that follows the points loaded.
+ *
+ * Usage: test_overlay
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "spectrum_port.h"
+#include "spectrum_decimate.h"
+#include "spectrum_index.h"
+#include "spectrum_overlay.h"
+#include "spectrum_process.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);        \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+struct Spectrum {
+    std::vector<float> x;
+    std::vector<float> y;
+};
+
+// Sloped background and a narrow peak at `peak`, sampled from `first` to `last` (either direction)
+static Spectrum makeSpectrum(double first, double last, size_t count, double peak, double height)
+{
+    Spectrum s;
+    for (size_t i = 0; i < count; i++) {
+        double w = first + (last - first) * i / (count - 1);
+        double u = (w - peak) / 4;
+        s.x.push_back((float)w);
+        s.y.push_back((float)(0.2 + 0.0001 * w + height * exp(-0.5 * u * u)));
+    }
+    return s;
+}
+
+static const SpectrumProcessSettings SETTINGS = {SPECTRUM_BASELINE_LINEAR, 11, 2, 0.1f};
+
+// The overlay must give what the spectrum gives when it is the only one loaded
+static void checkAlone(SpectrumOverlay &overlay, size_t series, const Spectrum &s)
+{
+    CHECK(overlay.points(series) == s.x.size());
+    bool same = true;
+    for (size_t i = 0; i < s.x.size(); i++) {
+        same = same && (overlay.x(series)[i] == s.x[i]) && (overlay.y(series)[i] == s.y[i]);
+    }
+    CHECK(same);
+
+    SpectrumIndex index;
+    index.build(s.x.data(), s.y.data(), s.x.size());
+    SpectrumProcessor processor;
+    processor.attach(s.x.data(), s.y.data(), s.x.size(), &index);
+    processor.configure(SETTINGS);
+    CHECK(overlay.index(series).areaBetween(2100, 2400) == index.areaBetween(2100, 2400));
+    const SpectrumProcessResult &expected = processor.process(2100, 2400);
+    const SpectrumProcessResult &result = overlay.process(series, 2100, 2400);
+    CHECK(result.area == expected.area);
+    CHECK(result.peak_count == expected.peak_count);
+    CHECK((result.peak_count == 0) || (result.peaks[0].x == expected.peaks[0].x));
+}
+
+// Column of the shared axis holding the tallest point of the series, -1 if none
+static int tallestColumn(const float *max, uint16_t columns)
+{
+    int best = -1;
+    for (int c = 0; c < columns; c++) {
+        if (!isnan(max[c]) && ((best < 0) || (max[c] > max[best]))) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+static void testOverlay(void)
+{
+    // Descending like an FTIR export, ascending and more coarsely sampled, and covering a part of the axis only
+    Spectrum a = makeSpectrum(4000, 500, 200001, 2250, 1.0);
+    Spectrum b = makeSpectrum(400, 3800, 70001, 2330, 1.0);
+    Spectrum c = makeSpectrum(2000, 2600, 3001, 2150, 1.0);
+
+    SpectrumOverlay overlay;
+    CHECK(overlay.configure(SETTINGS));
+    CHECK(overlay.add(a.x.data(), a.y.data(), a.x.size(), "8 mM") == 0);
+    CHECK(overlay.add(b.x.data(), b.y.data(), b.x.size(), "2 mM") == 1);
+    CHECK(overlay.add(c.x.data(), c.y.data(), c.x.size(), "a name longer than the space kept for it") == 2);
+    CHECK(overlay.count() == 3);
+    CHECK(strlen(overlay.name(2)) == SPECTRUM_OVERLAY_NAME_MAX - 1);
+    checkAlone(overlay, 0, a);
+    checkAlone(overlay, 1, b);
+    checkAlone(overlay, 2, c);
+
+    // The axis of the first series: its envelope is the one it has alone
+    const uint16_t columns = 700;
+    std::vector<float> min(columns), max(columns), ex(columns), emin(columns), emax(columns);
+    float lo, hi, elo, ehi;
+    CHECK(overlay.envelope(0, 4000, 500, columns, min.data(), max.data(), lo, hi));
+    spectrumEnvelopeCompute(a.x.data(), a.y.data(), 0, a.x.size(), columns, ex.data(), emin.data(), emax.data(), &elo,
+                            &ehi);
+    CHECK((min == emin) && (max == emax) && (lo == elo) && (hi == ehi));
+
+    // The others land on the same wavenumbers to within a column, whatever their direction and extent
+    double step = 3500.0 / columns;
+    auto column_of = [&](double w) { return (int)((4000 - w) / step); };
+    CHECK(overlay.envelope(1, 4000, 500, columns, min.data(), max.data(), lo, hi));
+    CHECK(abs(tallestColumn(max.data(), columns) - column_of(2330)) <= 1);
+    CHECK(isnan(max[column_of(3900)]) && !isnan(max[column_of(3790)]) && !isnan(max[columns - 1]));
+    CHECK(overlay.envelope(2, 4000, 500, columns, min.data(), max.data(), lo, hi));
+    CHECK(abs(tallestColumn(max.data(), columns) - column_of(2150)) <= 1);
+    int covered = 0;
+    for (int k = 0; k < columns; k++) {
+        covered += isnan(max[k]) ? 0 : 1;
+    }
+    CHECK(abs(covered - (int)(600 / step)) <= 2);
+    CHECK(isnan(max[column_of(3000)]) && isnan(max[column_of(1000)]));
+
+    // Redrawing the same axis is served from the shared cache
+    uint32_t misses = overlay.decimator().misses();
+    uint32_t hits = overlay.decimator().hits();
+    for (size_t s = 0; s < overlay.count(); s++) {
+        overlay.envelope(s, 4000, 500, columns, min.data(), max.data(), lo, hi);
+    }
+    CHECK(overlay.decimator().misses() == misses);
+    CHECK(overlay.decimator().hits() == hits + 3);
+    CHECK(!overlay.envelope(2, 500, 1500, columns, min.data(), max.data(), lo, hi));    // Out of its extent
+
+    // Removing one moves the later ones down without changing them
+    overlay.remove(0);
+    CHECK(overlay.count() == 2);
+    CHECK(strcmp(overlay.name(0), "2 mM") == 0);
+    checkAlone(overlay, 0, b);
+    checkAlone(overlay, 1, c);
+    CHECK(overlay.envelope(1, 4000, 500, columns, min.data(), max.data(), lo, hi));
+    CHECK(abs(tallestColumn(max.data(), columns) - column_of(2150)) <= 1);
+
+    // Limits
+    CHECK(overlay.add(a.x.data(), a.y.data(), 1, "one sample") == -1);
+    CHECK(overlay.add(a.x.data(), a.y.data(), a.x.size(), "3") == 2);
+    CHECK(overlay.add(c.x.data(), c.y.data(), c.x.size(), "4") == 3);
+    CHECK(overlay.add(c.x.data(), c.y.data(), c.x.size(), "5") == -1);
+    CHECK(overlay.count() == SPECTRUM_OVERLAY_MAX_SERIES);
+    checkAlone(overlay, 2, a);
+}
+
+// Memory follows the points loaded, not the number of series, and the pool is kept for the next ones
+static void testMemory(void)
+{
+    Spectrum big = makeSpectrum(4000, 500, 400000, 2250, 1.0);
+    Spectrum small = makeSpectrum(4000, 500, 1000, 2250, 1.0);
+
+    SpectrumOverlay overlay;
+    overlay.configure(SETTINGS);
+    overlay.add(small.x.data(), small.y.data(), small.x.size(), "small");
+    size_t one_small = overlay.bytes();
+    overlay.add(small.x.data(), small.y.data(), small.x.size(), "small");
+    overlay.add(small.x.data(), small.y.data(), small.x.size(), "small");
+    size_t three_small = overlay.bytes();
+    CHECK(three_small <= 3 * one_small + 64);
+
+    overlay.clear();
+    overlay.add(big.x.data(), big.y.data(), big.x.size(), "big");
+    size_t per_point = overlay.bytes() / big.x.size();
+    printf("%u points: %u bytes, %u per point\n", (unsigned)big.x.size(), (unsigned)overlay.bytes(),
+           (unsigned)per_point);
+    CHECK(per_point <= 24);
+
+    overlay.clear();
+    overlay.add(small.x.data(), small.y.data(), small.x.size(), "small");
+    CHECK(overlay.bytes() >= big.x.size() * 2 * sizeof(float));    // The pool is kept
+    checkAlone(overlay, 0, small);
+}
+
+int main(void)
+{
+    testOverlay();
+    testMemory();
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
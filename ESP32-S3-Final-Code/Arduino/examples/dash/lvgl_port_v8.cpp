@@ -7,6 +7,7 @@
 #include <ESP_Panel_Library.h>
 #include <lvgl.h>
 #include "lvgl_port_v8.h"
+#include "spectrum_metrics.h"
 
 #define LVGL_PORT_BUFFER_NUM_MAX       (2)
 
@@ -407,6 +408,19 @@ static void update_callback(lv_disp_drv_t *drv)
 
 #endif /* LVGL_PORT_AVOID_TEAR */
 
+static void timed_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_FLUSH);
+    flush_callback(drv, area, color_map);
+}
+
+// The display's refresh timer: drawing the invalidated areas and flushing them, but none of the app's timers
+static void timed_refr_timer(lv_timer_t *timer)
+{
+    SPECTRUM_METRICS_SCOPE(SPECTRUM_SCOPE_RENDER);
+    _lv_disp_refr_timer(timer);
+}
+
 void rounder_callback(lv_disp_drv_t *drv, lv_area_t *area)
 {
     ESP_PanelLcd *lcd = (ESP_PanelLcd *)drv->user_data;
@@ -484,7 +498,7 @@ static lv_disp_t *display_init(ESP_PanelLcd *lcd)
 
     ESP_LOGD(TAG, "Register display driver to LVGL");
     lv_disp_drv_init(&disp_drv);
-    disp_drv.flush_cb = flush_callback;
+    disp_drv.flush_cb = timed_flush_callback;
 #if LVGL_PORT_ROTATION_90 || LVGL_PORT_ROTATION_270
     disp_drv.hor_res = LVGL_PORT_DISP_HEIGHT;
     disp_drv.ver_res = LVGL_PORT_DISP_WIDTH;
@@ -610,6 +624,7 @@ bool lvgl_port_init(ESP_PanelLcd *lcd, ESP_PanelTouch *tp)
     ESP_LOGD(TAG, "Initialize LVGL display driver");
     disp = display_init(lcd);
     ESP_PANEL_CHECK_NULL_RET(disp, false, "Initialize LVGL display driver failed");
+    lv_timer_set_cb(disp->refr_timer, timed_refr_timer);
     // Record the initial rotation of the display
     lv_disp_set_rotation(disp, LV_DISP_ROT_NONE);
 
@@ -0,0 +1,68 @@
+#include "spectrum_port.h"
+#include "screen_manager.h"
+
+ScreenManager::ScreenManager():
+    _screens(),
+    _count(0),
+    _scratch(nullptr),
+    _current(SCREEN_NONE),
+    _stats()
+{
+}
+
+int ScreenManager::add(ScreenCallback build, ScreenCallback refresh, void *user_data)
+{
+    if (_count >= SCREEN_MANAGER_MAX_SCREENS) {
+        return -1;
+    }
+    _screens[_count] = {build, refresh, user_data, nullptr};
+    return _count++;
+}
+
+void ScreenManager::show(int id)
+{
+    if ((id < 0) || (id >= _count)) {
+        return;
+    }
+    uint32_t start = spectrum_time_us();
+    Screen &screen = _screens[id];
+    if (screen.obj == nullptr) {
+        screen.obj = lv_obj_create(NULL);
+        screen.build(screen.obj, screen.user_data);
+        _stats.builds++;
+    }
+    _current = id;      // Already, for the refresh to see which screen it is on
+    if (screen.refresh != nullptr) {
+        screen.refresh(screen.obj, screen.user_data);
+    }
+    lv_scr_load(screen.obj);
+    finish(start);
+}
+
+lv_obj_t *ScreenManager::scratch(void)
+{
+    uint32_t start = spectrum_time_us();
+    if (_scratch == nullptr) {
+        _scratch = lv_obj_create(NULL);
+        _stats.builds++;
+    }
+    lv_obj_clean(_scratch);     // The previous one-off page
+    lv_scr_load(_scratch);
+    _current = SCREEN_SCRATCH;
+    finish(start);
+    return _scratch;
+}
+
+void ScreenManager::finish(uint32_t start)
+{
+    uint32_t us = spectrum_time_us() - start;
+    _stats.transitions++;
+    _stats.last_us = us;
+    _stats.max_us = (us > _stats.max_us) ? us : _stats.max_us;
+    _stats.total_us += us;
+
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    _stats.lv_used = (uint32_t)(mon.total_size - mon.free_size);
+    _stats.lv_used_max = (_stats.lv_used > _stats.lv_used_max) ? _stats.lv_used : _stats.lv_used_max;
+}
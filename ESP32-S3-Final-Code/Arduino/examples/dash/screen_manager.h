@@ -0,0 +1,95 @@
+/*
+ * Cached LVGL screens, switched with `lv_scr_load()` instead of cleaning the active screen and rebuilding it.
+ *
+ * Each screen is built once, the first time it is shown, on its own `lv_obj` screen that is never deleted. Showing it
+ * again only runs its refresh callback, which updates the widgets bound to data that may have changed meanwhile
+ * (the loaded spectrum, the curve in use, the file index), then loads it. Navigating thus allocates nothing from the
+ * LVGL heap once every screen exists, and styles are initialised once with the widgets that use them.
+ *
+ * One-off pages (progress bars, the calibration fit) go on a scratch screen, cleaned when the next one is drawn on
+ * it, so they hold at most one page's worth of objects.
+ *
+ * Every transition is timed, from the call to the screen being loaded (not the redraw, which happens on the next
+ * `lv_timer_handler()` like any other), and the LVGL heap in use is sampled after it.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lvgl.h>
+
+#define SCREEN_MANAGER_MAX_SCREENS  (8)
+#define SCREEN_NONE                 (-1)    // `current()` before anything is shown
+#define SCREEN_SCRATCH              (-2)    // `current()` while a one-off page is shown
+
+/**
+ * @brief Builds the widgets of `screen` (first show) or refreshes its data-bound ones (every show).
+ */
+typedef void (*ScreenCallback)(lv_obj_t *screen, void *user_data);
+
+struct ScreenManagerStats {
+    uint32_t transitions;
+    uint32_t builds;            // Screens built, the cached ones once each
+    uint32_t last_us;           // Last transition
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t lv_used;           // LVGL heap in use after the last transition, in bytes
+    uint32_t lv_used_max;       // Highest after any transition
+};
+
+class ScreenManager {
+public:
+    ScreenManager();
+
+    ScreenManager(const ScreenManager &) = delete;
+    ScreenManager &operator=(const ScreenManager &) = delete;
+
+    /**
+     * @brief Register a screen. Nothing is created until it is first shown.
+     *
+     * @param refresh Optional, run before every show including the first, after `build`
+     *
+     * @return Its id, -1 if `SCREEN_MANAGER_MAX_SCREENS` are registered already
+     */
+    int add(ScreenCallback build, ScreenCallback refresh, void *user_data);
+
+    /**
+     * @brief Make screen `id` the active one, building it if it does not exist yet.
+     */
+    void show(int id);
+
+    /**
+     * @brief Load the scratch screen, emptied, for a one-off page to be built on. Not to be called from an event of
+     *        an object of the scratch screen, which this deletes.
+     */
+    lv_obj_t *scratch(void);
+
+    /**
+     * @brief Id of the active screen (the one being shown, from its refresh), or `SCREEN_SCRATCH` or `SCREEN_NONE`.
+     */
+    int current(void) const
+    {
+        return _current;
+    }
+
+    const ScreenManagerStats &stats(void) const
+    {
+        return _stats;
+    }
+
+private:
+    struct Screen {
+        ScreenCallback build;
+        ScreenCallback refresh;
+        void *user_data;
+        lv_obj_t *obj;
+    };
+
+    void finish(uint32_t start);
+
+    Screen _screens[SCREEN_MANAGER_MAX_SCREENS];
+    int _count;
+    lv_obj_t *_scratch;
+    int _current;
+    ScreenManagerStats _stats;
+};
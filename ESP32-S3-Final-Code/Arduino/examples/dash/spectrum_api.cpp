@@ -0,0 +1,180 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "spectrum_api.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "The f32 format copies floats as they are in memory, which must be little-endian"
+#endif
+
+// One block of columns between the pyramid and the encoder. The server calls body callbacks one at a time.
+static float block_x[SPECTRUM_API_BLOCK_COLUMNS];
+static float block_min[SPECTRUM_API_BLOCK_COLUMNS];
+static float block_max[SPECTRUM_API_BLOCK_COLUMNS];
+
+// Leaves `value` alone if `name` is missing, fails if it is there but not a number
+static bool optionalFloat(const char *query, const char *name, double &value)
+{
+    char text[32];
+    size_t length = strlen(query);
+    if (!spectrum_http_form_text(query, length, name, text, sizeof(text))) {
+        return true;
+    }
+    return spectrum_http_form_float(query, length, name, value);
+}
+
+bool spectrumApiParse(const char *query, const SpectrumIndex &index, const SpectrumPyramid &pyramid,
+                      SpectrumApiStream &stream)
+{
+    size_t count = pyramid.size();
+    if ((count == 0) || (index.size() != count)) {
+        return false;
+    }
+
+    size_t length = strlen(query);
+    double from = index.minX();
+    double to = index.maxX();
+    double width = SPECTRUM_API_DEFAULT_WIDTH;
+    if (!optionalFloat(query, "from", from) || !optionalFloat(query, "to", to) ||
+        !optionalFloat(query, "width", width) || !isfinite(from) || !isfinite(to) || !isfinite(width) ||
+        (width < 1)) {
+        return false;
+    }
+
+    SpectrumApiFormat format = SPECTRUM_API_JSON;
+    char format_text[8];
+    if (spectrum_http_form_text(query, length, "format", format_text, sizeof(format_text))) {
+        if (strcmp(format_text, "f32") == 0) {
+            format = SPECTRUM_API_F32;
+        } else if (strcmp(format_text, "json") != 0) {
+            return false;
+        }
+    }
+
+    // Wavenumbers to samples, in file order whichever way the x column runs
+    int a = index.indexOf(from);
+    int b = index.indexOf(to);
+    if (a > b) {
+        int swap = a;
+        a = b;
+        b = swap;
+    }
+    size_t samples = (size_t)(b - a) + 1;
+    width = (width > SPECTRUM_API_MAX_WIDTH) ? SPECTRUM_API_MAX_WIDTH : width;
+    width = (width > samples) ? samples : width;
+
+    stream.pyramid = &pyramid;
+    stream.x = pyramid.x();
+    stream.from = (uint32_t)a;
+    stream.to = (uint32_t)b + 1;
+    stream.columns = (uint16_t)width;
+    stream.next = 0;
+    stream.format = format;
+    stream.opened = false;
+    return true;
+}
+
+const char *spectrumApiContentType(SpectrumApiFormat format)
+{
+    return (format == SPECTRUM_API_F32) ? "application/octet-stream" : "application/json";
+}
+
+size_t spectrumApiBody(void *ctx, void *state, char *buffer, size_t size, bool &done)
+{
+    (void)ctx;
+    SpectrumApiStream *stream = static_cast<SpectrumApiStream *>(state);
+    const bool json = (stream->format == SPECTRUM_API_JSON);
+    const size_t column_bytes = 3 * sizeof(float);
+
+    size_t used = 0;
+    if (json && !stream->opened) {
+        buffer[used++] = '[';
+        stream->opened = true;
+    }
+
+    // A spectrum published in the middle of the response ends it early rather than mixing two spectra
+    bool same = (stream->pyramid->x() == stream->x) && (stream->to <= stream->pyramid->size());
+    while (same && (stream->next < stream->columns)) {
+        uint16_t count = stream->columns - stream->next;
+        count = (count > SPECTRUM_API_BLOCK_COLUMNS) ? SPECTRUM_API_BLOCK_COLUMNS : count;
+        if (!json) {
+            size_t fit = (size - used) / column_bytes;
+            count = (count > fit) ? (uint16_t)fit : count;
+            if (count == 0) {
+                return used;
+            }
+        }
+        if (!stream->pyramid->envelopeColumns(stream->from, stream->to, stream->columns, stream->next, count,
+                                              block_x, block_min, block_max)) {
+            break;
+        }
+
+        uint16_t k = 0;
+        for (; k < count; k++) {
+            if (json) {
+                int n = snprintf(buffer + used, size - used, "%s%.6g,%.6g,%.6g", (stream->next + k > 0) ? "," : "",
+                                 block_x[k], block_min[k], block_max[k]);
+                if ((size_t)n >= size - used) {
+                    break;
+                }
+                used += n;
+            } else {
+                const float column[3] = {block_x[k], block_min[k], block_max[k]};
+                memcpy(buffer + used, column, column_bytes);
+                used += column_bytes;
+            }
+        }
+        stream->next += k;
+        if (k < count) {
+            return used;    // Chunk full, the rest of the block is computed again next time
+        }
+    }
+
+    if (json) {
+        if (used == size) {
+            return used;
+        }
+        buffer[used++] = ']';
+    }
+    done = true;
+    return used;
+}
+
+void spectrumApiRespond(const SpectrumHttpRequest &request, SpectrumHttpResponse &response, const SpectrumIndex &index,
+                        const SpectrumPyramid &pyramid)
+{
+    response.addHeader("Cache-Control", "no-store");
+    if (pyramid.size() == 0) {
+        response.setStatus(503);
+        response.print("No spectrum loaded\n");
+        return;
+    }
+
+    SpectrumApiStream parsed;
+    if (!spectrumApiParse(request.query, index, pyramid, parsed)) {
+        response.setStatus(400);
+        response.print("Expected from, to (wavenumbers), width (columns) and format (json or f32)\n");
+        return;
+    }
+
+    char columns[8];
+    snprintf(columns, sizeof(columns), "%u", (unsigned)parsed.columns);
+    response.addHeader("Content-Type", spectrumApiContentType(parsed.format));
+    response.addHeader("X-Spectrum-Columns", columns);
+    void *state = response.stream(spectrumApiBody, nullptr, sizeof(SpectrumApiStream));
+    memcpy(state, &parsed, sizeof(parsed));
+}
+
+int spectrumApiFormatState(char *buffer, size_t size, const SpectrumApiState &state)
+{
+    char area[24];
+    char concentration[24];
+    snprintf(area, sizeof(area), isfinite(state.area) ? "%.6g" : "null", state.area);
+    snprintf(concentration, sizeof(concentration), isfinite(state.concentration) ? "%.6g" : "null",
+             state.concentration);
+    return snprintf(buffer, size,
+                    "{\"area\":%s,\"concentration\":%s,\"lower\":%d,\"upper\":%d,\"min\":%d,\"max\":%d,"
+                    "\"events\":%u,\"recomputes\":%u}",
+                    area, concentration, state.lower, state.upper, state.min, state.max, (unsigned)state.events,
+                    (unsigned)state.recomputes);
+}
@@ -0,0 +1,89 @@
+/*
+ * Chart data endpoint of the web server: the min/max envelope of any wavenumber range of the loaded spectrum, at any
+ * width, streamed through the HTTP server's fixed output buffer.
+ *
+ *      GET /api/spectrum?from=<wavenumber>&to=<wavenumber>&width=<columns>&format=json|f32
+ *
+ * `from` and `to` default to the ends of the spectrum, `width` to `SPECTRUM_API_DEFAULT_WIDTH` (it is capped by
+ * `SPECTRUM_API_MAX_WIDTH` and by the number of samples in the range). The body holds x, min and max of every column:
+ * `json` as a flat array "[x0,min0,max0,x1,...]", `f32` as the same values in little-endian float32, ready for a
+ * `Float32Array` at a third of the size.
+ *
+ * Nothing is built up front: each call of the body callback computes the next block of columns from the pyramid and
+ * encodes as many as fit in the chunk, so the cost per request is a few hundred bytes of state whatever the width, and
+ * the first bytes leave after one block instead of after the whole envelope.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectrum_http.h"
+#include "spectrum_index.h"
+#include "spectrum_pyramid.h"
+
+#define SPECTRUM_API_DEFAULT_WIDTH  (800)
+#define SPECTRUM_API_MAX_WIDTH      (4096)
+#define SPECTRUM_API_BLOCK_COLUMNS  (64)    // Columns computed per step of the stream
+
+enum SpectrumApiFormat : uint8_t {
+    SPECTRUM_API_JSON,
+    SPECTRUM_API_F32,
+};
+
+/**
+ * @brief State of one `/api/spectrum` response, kept in the connection by `SpectrumHttpResponse::stream()`.
+ */
+struct SpectrumApiStream {
+    const SpectrumPyramid *pyramid;
+    const float *x;             // `pyramid->x()` when the request came in, to notice a new spectrum mid-stream
+    uint32_t from;              // Sample range
+    uint32_t to;
+    uint16_t columns;
+    uint16_t next;              // Next column to send
+    SpectrumApiFormat format;
+    bool opened;                // JSON '[' sent
+};
+static_assert(sizeof(SpectrumApiStream) <= SPECTRUM_HTTP_STATE_MAX, "Must fit in the per-connection stream state");
+
+/**
+ * @brief Turn the query string of a request into `stream`, for the spectrum that `index` and `pyramid` were built on.
+ *
+ * @return false if a parameter is malformed or nothing is loaded
+ */
+bool spectrumApiParse(const char *query, const SpectrumIndex &index, const SpectrumPyramid &pyramid,
+                      SpectrumApiStream &stream);
+
+const char *spectrumApiContentType(SpectrumApiFormat format);
+
+/**
+ * @brief `SpectrumHttpBodyCallback` producing the body of a `SpectrumApiStream`. Runs on the server's thread only: the
+ *        columns go through one static scratch block shared by every response.
+ */
+size_t spectrumApiBody(void *ctx, void *state, char *buffer, size_t size, bool &done);
+
+/**
+ * @brief Values of the panel behind `/api/state` and the "state" events.
+ */
+struct SpectrumApiState {
+    double area;
+    double concentration;   // NAN without a calibration
+    int lower;              // Integration range, in wavenumbers
+    int upper;
+    int min;                // Span of the sliders
+    int max;
+    uint32_t events;        // Range changes requested, and recomputes run for them
+    uint32_t recomputes;
+};
+
+/**
+ * @brief `state` as one JSON object, non-finite numbers as null.
+ *
+ * @return Length it needs, like `snprintf()`
+ */
+int spectrumApiFormatState(char *buffer, size_t size, const SpectrumApiState &state);
+
+/**
+ * @brief Start the `/api/spectrum` response for `request`: a stream, or a 400/503 if the query cannot be served.
+ */
+void spectrumApiRespond(const SpectrumHttpRequest &request, SpectrumHttpResponse &response, const SpectrumIndex &index,
+                        const SpectrumPyramid &pyramid);
@@ -0,0 +1,326 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "spectrum_batch.h"
+#include "spectrum_process.h"
+
+float SpectrumBatchStats::filesPerSecond(void) const
+{
+    return (elapsed_us == 0) ? 0.0f : (float)files * 1e6f / (float)elapsed_us;
+}
+
+float SpectrumBatchStats::bytesPerSecond(void) const
+{
+    return (elapsed_us == 0) ? 0.0f : (float)bytes * 1e6f / (float)elapsed_us;
+}
+
+// Trapezoids of the segments between consecutive rows, clipped to [lo, hi]: SpectrumIndex::areaBetweenLinear() as the
+// rows go by, without keeping them. Also notes the curve at both ends of the range, or at the ends of the spectrum if
+// the range reaches past them, for the baseline.
+struct AreaSum {
+    double lo;
+    double hi;
+    double sum;
+    float x;                    // Previous row
+    float y;
+    bool started;
+    double y_lo;                // Curve at lo and hi, once a segment reaches them
+    double y_hi;
+    bool has_lo;
+    bool has_hi;
+    float min_x;                // Ends of the spectrum
+    float y_min_x;
+    float max_x;
+    float y_max_x;
+    float **samples;            // Rows inside the range, x then y halves of `capacity` each; nullptr not to keep them
+    size_t *capacity;
+    size_t sample_count;
+    bool out_of_memory;
+};
+
+static void keepSample(AreaSum *area, float x, float y)
+{
+    if (area->sample_count == *area->capacity) {
+        size_t capacity = (*area->capacity == 0) ? 1024 : 2 * *area->capacity;
+        float *grown = static_cast<float *>(spectrum_malloc(2 * capacity * sizeof(float)));
+        if (grown == nullptr) {
+            area->out_of_memory = true;
+            return;
+        }
+        if (area->sample_count > 0) {
+            memcpy(grown, *area->samples, area->sample_count * sizeof(float));
+            memcpy(grown + capacity, *area->samples + *area->capacity, area->sample_count * sizeof(float));
+        }
+        spectrum_free(*area->samples);
+        *area->samples = grown;
+        *area->capacity = capacity;
+    }
+    (*area->samples)[area->sample_count] = x;
+    (*area->samples)[*area->capacity + area->sample_count] = y;
+    area->sample_count++;
+}
+
+static bool integratePoint(float x, float y, void *user_data)
+{
+    AreaSum *area = static_cast<AreaSum *>(user_data);
+    if (!area->started || (x < area->min_x)) {
+        area->min_x = x;
+        area->y_min_x = y;
+    }
+    if (!area->started || (x > area->max_x)) {
+        area->max_x = x;
+        area->y_max_x = y;
+    }
+    if ((area->samples != nullptr) && (x >= area->lo) && (x <= area->hi) && !area->out_of_memory) {
+        keepSample(area, x, y);
+    }
+    if (area->started) {
+        double xa = area->x;
+        double xb = x;
+        double ya = area->y;
+        double yb = y;
+        if (xa > xb) {
+            double tmp = xa;
+            xa = xb;
+            xb = tmp;
+            tmp = ya;
+            ya = yb;
+            yb = tmp;
+        }
+        double from = (area->lo > xa) ? area->lo : xa;
+        double to = (area->hi < xb) ? area->hi : xb;
+        if ((to > from) && (xb != xa)) {
+            double y_from = ya + (from - xa) / (xb - xa) * (yb - ya);
+            double y_to = ya + (to - xa) / (xb - xa) * (yb - ya);
+            area->sum += 0.5 * (to - from) * (y_from + y_to);
+        }
+        if ((xa <= area->lo) && (area->lo <= xb) && !area->has_lo) {
+            area->y_lo = (xb == xa) ? ya : ya + (area->lo - xa) / (xb - xa) * (yb - ya);
+            area->has_lo = true;
+        }
+        if ((xa <= area->hi) && (area->hi <= xb) && !area->has_hi) {
+            area->y_hi = (xb == xa) ? yb : ya + (area->hi - xa) / (xb - xa) * (yb - ya);
+            area->has_hi = true;
+        }
+    }
+    area->x = x;
+    area->y = y;
+    area->started = true;
+    return true;
+}
+
+struct BatchRead {
+    const SpectrumBatchJob *job;
+    const std::atomic<bool> *cancel;
+    void *file;
+};
+
+// Baseline of `mode` under the rows integrated into `area`, over the range clamped to the spectrum like
+// SpectrumProcessor::process() does
+static double baselineArea(AreaSum &area, uint8_t mode)
+{
+    double lo = (area.lo < area.min_x) ? area.min_x : area.lo;
+    double hi = (area.hi > area.max_x) ? area.max_x : area.hi;
+    if ((mode == SPECTRUM_BASELINE_NONE) || !area.started || !(hi > lo)) {
+        return 0;
+    }
+    double y_lo = area.has_lo ? area.y_lo : area.y_min_x;
+    double y_hi = area.has_hi ? area.y_hi : area.y_max_x;
+    SpectrumBaseline baseline = spectrumBaselineLinear(lo, y_lo, hi, y_hi);
+    if ((mode == SPECTRUM_BASELINE_POLYNOMIAL) && !area.out_of_memory) {
+        // The x half becomes t in place
+        float *t = *area.samples;
+        float *y = *area.samples + *area.capacity;
+        for (size_t i = 0; i < area.sample_count; i++) {
+            t[i] = (float)((t[i] - baseline.center) / baseline.half_width);
+        }
+        SpectrumBaseline fitted;
+        if (spectrumBaselineFit(t, y, area.sample_count, lo, y_lo, hi, y_hi, SPECTRUM_BASELINE_DEGREE, fitted)) {
+            baseline = fitted;
+        }
+    }
+    return baseline.integral(lo, hi);
+}
+
+static int readBatchChunk(void *ctx, uint8_t *buf, size_t len)
+{
+    BatchRead *read = static_cast<BatchRead *>(ctx);
+    if (read->cancel->load()) {
+        return -1;
+    }
+    return read->job->read(read->file, buf, len);
+}
+
+SpectrumBatch::SpectrumBatch():
+    _job(),
+    _workers(),
+    _worker_count(0),
+    _next(0),
+    _completed(0),
+    _running(0),
+    _cancel(false),
+    _start_us(0),
+    _end_us(0),
+    _stats()
+{
+}
+
+SpectrumBatch::~SpectrumBatch()
+{
+    cancel();
+    wait();
+}
+
+bool SpectrumBatch::start(const SpectrumBatchJob &job, int workers)
+{
+    if (_worker_count > 0) {
+        return false;
+    }
+    workers = (workers < 1) ? 1 : (workers > SPECTRUM_BATCH_MAX_WORKERS) ? SPECTRUM_BATCH_MAX_WORKERS : workers;
+
+    _job = job;
+    memset(_job.results, 0, _job.count * sizeof(SpectrumBatchResult));
+    _next = 0;
+    _completed = 0;
+    _cancel = false;
+    _stats = SpectrumBatchStats();
+    _start_us = spectrum_time_us();
+    _end_us = _start_us;
+
+    // Counted up front so that a fast first worker cannot see itself as the last one
+    _running = workers;
+    for (int i = 0; i < workers; i++) {
+        Worker &worker = _workers[_worker_count];
+        worker.batch = this;
+        worker.samples = nullptr;
+        worker.sample_capacity = 0;
+        worker.chunk = static_cast<uint8_t *>(spectrum_malloc(SPECTRUM_CSV_CHUNK_SIZE));
+        worker.task = (worker.chunk == nullptr) ? nullptr :
+                      spectrum_task_start("batch", workerEntry, &worker, SPECTRUM_BATCH_STACK_SIZE,
+                                          SPECTRUM_BATCH_PRIORITY, i % 2);
+        if (worker.task == nullptr) {
+            spectrum_free(worker.chunk);
+            _running--;
+            continue;
+        }
+        _worker_count++;
+    }
+    return _worker_count > 0;
+}
+
+const SpectrumBatchStats &SpectrumBatch::wait(void)
+{
+    if (_worker_count == 0) {
+        return _stats;
+    }
+    for (int i = 0; i < _worker_count; i++) {
+        spectrum_task_join(_workers[i].task);
+        spectrum_free(_workers[i].chunk);
+        spectrum_free(_workers[i].samples);
+        _workers[i] = Worker();
+    }
+    _worker_count = 0;
+
+    _stats = SpectrumBatchStats();
+    for (size_t i = 0; i < _job.count; i++) {
+        const SpectrumBatchResult &result = _job.results[i];
+        if (!result.analysed) {
+            continue;
+        }
+        _stats.files++;
+        _stats.failed += result.ok ? 0 : 1;
+        _stats.rows += result.rows;
+        _stats.bytes += result.bytes;
+    }
+    _stats.elapsed_us = _end_us.load() - _start_us;
+    return _stats;
+}
+
+void SpectrumBatch::workerEntry(void *arg)
+{
+    Worker *worker = static_cast<Worker *>(arg);
+    worker->batch->work(*worker);
+}
+
+void SpectrumBatch::work(Worker &worker)
+{
+    for (;;) {
+        uint32_t i = _next.fetch_add(1);
+        if ((i >= _job.count) || _cancel.load()) {
+            break;
+        }
+        analyse(worker, i);
+    }
+    uint32_t now = spectrum_time_us();
+    if (_running.fetch_sub(1) == 1) {
+        _end_us = now;
+    }
+}
+
+void SpectrumBatch::analyse(Worker &worker, size_t i)
+{
+    SpectrumBatchResult &result = _job.results[i];
+    uint32_t start = spectrum_time_us();
+    BatchRead read = {&_job, &_cancel, _job.open(_job.io_ctx, _job.paths[i])};
+    if (read.file == nullptr) {
+        result.ok = false;
+        result.analysed = true;
+        _completed++;
+        return;
+    }
+
+    AreaSum area = {};
+    area.lo = (_job.lower < _job.upper) ? _job.lower : _job.upper;
+    area.hi = (_job.lower < _job.upper) ? _job.upper : _job.lower;
+    if (_job.baseline == SPECTRUM_BASELINE_POLYNOMIAL) {
+        area.samples = &worker.samples;
+        area.capacity = &worker.sample_capacity;
+    }
+    SpectrumCsvParser parser(integratePoint, &area);
+    SpectrumCsvStats stats = {};
+    bool ok = spectrumCsvParseStream(readBatchChunk, &read, worker.chunk, SPECTRUM_CSV_CHUNK_SIZE, parser, &stats);
+    _job.close(_job.io_ctx, read.file);
+    if (_cancel.load()) {
+        return;
+    }
+
+    result.area = area.sum - baselineArea(area, _job.baseline);
+    result.concentration = (_job.concentration != nullptr) ? _job.concentration(result.area, _job.concentration_ctx)
+                                                           : NAN;
+    result.rows = stats.rows;
+    result.skipped = stats.skipped;
+    result.bytes = stats.bytes;
+    result.elapsed_us = spectrum_time_us() - start;
+    result.ok = ok && (stats.rows >= 2);
+    result.analysed = true;
+    _completed++;
+}
+
+bool spectrumBatchWriteSummary(SpectrumWriteCallback write, void *ctx, const SpectrumBatchJob &job)
+{
+    char line[2 * 256 + 128];
+    int n = snprintf(line, sizeof(line), "file,lower,upper,baseline,points,area,concentration,status\n");
+    if (write(ctx, (const uint8_t *)line, n) != n) {
+        return false;
+    }
+    double lo = (job.lower < job.upper) ? job.lower : job.upper;
+    double hi = (job.lower < job.upper) ? job.upper : job.lower;
+    const char *baseline = (job.baseline == SPECTRUM_BASELINE_LINEAR) ? "linear" :
+                           (job.baseline == SPECTRUM_BASELINE_POLYNOMIAL) ? "polynomial" : "none";
+    for (size_t i = 0; i < job.count; i++) {
+        const SpectrumBatchResult &result = job.results[i];
+        size_t length = spectrumCsvQuote(job.paths[i], line, 2 * 256);
+        const char *status = !result.analysed ? "cancelled" : !result.ok ? "failed" : "ok";
+        if (result.analysed && result.ok) {
+            length += snprintf(line + length, sizeof(line) - length, ",%g,%g,%s,%u,%.6g,%.6g,%s\n", lo, hi,
+                               baseline, (unsigned)result.rows, result.area, result.concentration, status);
+        } else {
+            length += snprintf(line + length, sizeof(line) - length, ",%g,%g,%s,%u,,,%s\n", lo, hi, baseline,
+                               (unsigned)result.rows, status);
+        }
+        if (write(ctx, (const uint8_t *)line, length) != (int)length) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,161 @@
+/*
+ * Batch analysis: the area and concentration of every file of a list (e.g. a directory of the card), computed off the
+ * LVGL thread by one worker task per core.
+ *
+ * Each worker takes the next file of the list, streams it through the CSV parser with its own chunk buffer and
+ * integrates the range as the rows go by, so nothing of a spectrum is kept and a worker needs one chunk of memory
+ * whatever the file sizes. While one worker waits on the card the other parses, which overlaps the I/O with the
+ * compute even though the card serves one read at a time. Results land in a per-file array, in list order, and the UI
+ * polls `completed()` from an `lv_timer` like it does for the loader.
+ *
+ * The areas are corrected by the same baseline as on the chart (see `SpectrumProcessor`): the linear one is worked out
+ * from the rows as they go by, the polynomial one keeps the rows inside the range in a per-worker buffer to fit it.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "spectrum_port.h"
+#include "spectrum_csv.h"
+#include "spectrum_cache.h"
+
+#define SPECTRUM_BATCH_MAX_WORKERS      (4)
+#define SPECTRUM_BATCH_WORKERS          (2)         // One per core
+#define SPECTRUM_BATCH_STACK_SIZE       (6 * 1024)
+#define SPECTRUM_BATCH_PRIORITY         (1)         // Below the LVGL task
+
+/**
+ * @brief Open `path` for reading.
+ *
+ * @return Handle passed to the read and close callbacks, nullptr if it cannot be opened
+ */
+typedef void *(*SpectrumOpenCallback)(void *ctx, const char *path);
+typedef void (*SpectrumCloseCallback)(void *ctx, void *file);
+
+/**
+ * @brief Concentration for an area, i.e. the calibration.
+ */
+typedef float (*SpectrumConcentrationFn)(double area, void *ctx);
+
+struct SpectrumBatchResult {
+    double area;                // Minus the baseline of the job
+    float concentration;
+    uint32_t rows;
+    uint32_t skipped;           // Lines without an x,y pair
+    uint64_t bytes;
+    uint32_t elapsed_us;
+    bool analysed;              // false if the batch was cancelled before this file
+    bool ok;                    // Opened and read to the end
+};
+
+struct SpectrumBatchJob {
+    const char *const *paths;   // `count` files, valid until `wait()` returns
+    size_t count;
+    double lower;               // Integration range, in either order
+    double upper;
+    uint8_t baseline;           // SpectrumBaselineMode subtracted from the areas
+    SpectrumConcentrationFn concentration;  // nullptr for the areas alone, the concentrations are then NAN
+    void *concentration_ctx;
+    SpectrumOpenCallback open;
+    SpectrumReadCallback read;  // Called with the handle returned by `open`
+    SpectrumCloseCallback close;
+    void *io_ctx;
+    SpectrumBatchResult *results;   // `count` entries, one per path, cleared by `start()`
+};
+
+struct SpectrumBatchStats {
+    uint32_t files;             // Files analysed (ok or not), fewer than the list if cancelled
+    uint32_t failed;
+    uint64_t rows;
+    uint64_t bytes;
+    uint32_t elapsed_us;
+
+    float filesPerSecond(void) const;
+    float bytesPerSecond(void) const;
+};
+
+class SpectrumBatch {
+public:
+    SpectrumBatch();
+    ~SpectrumBatch();
+
+    SpectrumBatch(const SpectrumBatch &) = delete;
+    SpectrumBatch &operator=(const SpectrumBatch &) = delete;
+
+    /**
+     * @brief Start `workers` tasks on `job`, worker i on core i % 2. The job is copied, what it points to is not.
+     *
+     * @return false if a batch is already running or nothing could be started
+     */
+    bool start(const SpectrumBatchJob &job, int workers = SPECTRUM_BATCH_WORKERS);
+
+    /**
+     * @brief Stop at the next chunk. The files being read are abandoned and, like the ones not reached, keep
+     *        `analysed` false.
+     */
+    void cancel(void)
+    {
+        _cancel = true;
+    }
+
+    /**
+     * @brief Files done so far. Safe from any task.
+     */
+    uint32_t completed(void) const
+    {
+        return _completed.load();
+    }
+
+    /**
+     * @brief Whether every worker is done, i.e. `wait()` will not block.
+     */
+    bool finished(void) const
+    {
+        return _running.load() == 0;
+    }
+
+    bool running(void) const
+    {
+        return _worker_count > 0;
+    }
+
+    /**
+     * @brief Wait for the workers to finish and release them.
+     *
+     * @return Totals of the batch
+     */
+    const SpectrumBatchStats &wait(void);
+
+private:
+    struct Worker {
+        SpectrumBatch *batch;
+        SpectrumTask *task;
+        uint8_t *chunk;
+        float *samples;             // x, y pairs inside the range, for the polynomial baseline
+        size_t sample_capacity;     // Pairs
+    };
+
+    static void workerEntry(void *arg);
+    void work(Worker &worker);
+    void analyse(Worker &worker, size_t i);
+
+    SpectrumBatchJob _job;
+    Worker _workers[SPECTRUM_BATCH_MAX_WORKERS];
+    int _worker_count;
+    std::atomic<uint32_t> _next;            // Next file to hand out
+    std::atomic<uint32_t> _completed;
+    std::atomic<int> _running;
+    std::atomic<bool> _cancel;
+    uint32_t _start_us;
+    std::atomic<uint32_t> _end_us;          // Set by the last worker to finish
+    SpectrumBatchStats _stats;
+};
+
+/**
+ * @brief Write the results of `job` as a CSV file: a header line, then file, range, baseline, points, area,
+ *        concentration and status for every file of the list, in list order.
+ *
+ * @return false if a write failed
+ */
+bool spectrumBatchWriteSummary(SpectrumWriteCallback write, void *ctx, const SpectrumBatchJob &job);
@@ -0,0 +1,40 @@
+#include <string.h>
+#include "spectrum_cache.h"
+
+bool spectrumCachePath(const char *csv_path, char *out, size_t out_size)
+{
+    size_t len = strlen(csv_path);
+    const char *slash = strrchr(csv_path, '/');
+    const char *dot = strrchr(csv_path, '.');
+    if ((dot != nullptr) && ((slash == nullptr) || (dot > slash))) {
+        len = (size_t)(dot - csv_path);
+    }
+    size_t ext_len = strlen(SPECTRUM_CACHE_EXTENSION);
+    if (len + ext_len + 1 > out_size) {
+        return false;
+    }
+    memcpy(out, csv_path, len);
+    memcpy(out + len, SPECTRUM_CACHE_EXTENSION, ext_len + 1);
+    return true;
+}
+
+uint64_t spectrumCacheFileSize(uint32_t count)
+{
+    return sizeof(SpectrumCacheHeader) + (uint64_t)count * (2 * sizeof(float) + sizeof(SpectrumPrefix));
+}
+
+bool spectrumCacheReadHeader(SpectrumReadCallback read, void *ctx, SpectrumCacheHeader &header)
+{
+    if (read(ctx, (uint8_t *)&header, sizeof(header)) != (int)sizeof(header)) {
+        return false;
+    }
+    return (header.magic == SPECTRUM_CACHE_MAGIC) && (header.version == SPECTRUM_CACHE_VERSION) &&
+           (header.header_size == sizeof(SpectrumCacheHeader)) && (header.flags == SPECTRUM_CACHE_FLAGS);
+}
+
+bool spectrumCacheIsFresh(const SpectrumCacheHeader &header, uint64_t source_size, int64_t source_mtime,
+                          uint64_t cache_size)
+{
+    return (header.source_size == source_size) && (header.source_mtime == source_mtime) &&
+           (cache_size == spectrumCacheFileSize(header.count));
+}
@@ -0,0 +1,199 @@
+/*
+ * Binary sidecar cache (`.spc`) for parsed spectrum CSV files.
+ *
+ * Layout (little-endian, as both the ESP32-S3 and the host are):
+ *
+ *      SpectrumCacheHeader             64 bytes
+ *      float   x[count]
+ *      float   y[count]
+ *      double  prefix[count]           trapezoid prefix sums, see `SpectrumIndex`
+ *
+ * The header records the size and modification time of the CSV it was built from. A sidecar whose source no longer
+ * matches, whose version differs or whose length is inconsistent is treated as stale and rebuilt by the caller.
+ *
+ * A build with `SPECTRUM_NUMERIC_FIXED` writes its prefix sums as Q32.32 (int64_t, same size) and flags the header,
+ * so that a card moved between builds has its sidecars rebuilt rather than misread.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectrum_csv.h"
+#include "spectrum_numeric.h"
+
+#define SPECTRUM_CACHE_MAGIC        (0x31435053)    // "SPC1"
+#define SPECTRUM_CACHE_VERSION      (1)
+#define SPECTRUM_CACHE_EXTENSION    ".spc"
+#define SPECTRUM_CACHE_FIXED_PREFIX (1u << 0)       // Prefix sums in Q32.32
+#define SPECTRUM_CACHE_FLAGS        ((SPECTRUM_NUMERIC_FIXED != 0) ? SPECTRUM_CACHE_FIXED_PREFIX : 0u)
+
+struct SpectrumCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t count;             // Number of samples in each column
+    uint32_t flags;             // SPECTRUM_CACHE_FIXED_PREFIX, other bits 0
+    uint64_t source_size;       // Size of the CSV in bytes
+    int64_t source_mtime;       // Last write time of the CSV, seconds since the epoch (0 if unknown)
+    float min_x;
+    float max_x;
+    float min_y;
+    float max_y;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(SpectrumCacheHeader) == 64, "Sidecar header layout must not change without a version bump");
+static_assert(sizeof(SpectrumPrefix) == sizeof(double), "Prefix sums must keep the sidecar layout");
+
+/**
+ * @brief Writes `len` bytes from `buf`.
+ *
+ * @return number of bytes written, less than `len` on error
+ */
+typedef int (*SpectrumWriteCallback)(void *ctx, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Build the sidecar path for `csv_path` ("/dir/a.csv" -> "/dir/a.spc").
+ *
+ * @return false if `out` is too small
+ */
+bool spectrumCachePath(const char *csv_path, char *out, size_t out_size);
+
+/**
+ * @brief Total file size of a sidecar holding `count` samples.
+ */
+uint64_t spectrumCacheFileSize(uint32_t count);
+
+/**
+ * @brief Read and sanity-check the header. Does not check freshness.
+ */
+bool spectrumCacheReadHeader(SpectrumReadCallback read, void *ctx, SpectrumCacheHeader &header);
+
+/**
+ * @brief Whether a header matches the current source file and has the expected length on disk.
+ */
+bool spectrumCacheIsFresh(const SpectrumCacheHeader &header, uint64_t source_size, int64_t source_mtime,
+                          uint64_t cache_size);
+
+/**
+ * @brief Fill a header for `count` samples (min/max are computed from the columns).
+ */
+template <typename T>
+void spectrumCacheMakeHeader(SpectrumCacheHeader &header, const T *x, const T *y, uint32_t count,
+                             uint64_t source_size, int64_t source_mtime)
+{
+    header = SpectrumCacheHeader();
+    header.magic = SPECTRUM_CACHE_MAGIC;
+    header.version = SPECTRUM_CACHE_VERSION;
+    header.header_size = sizeof(SpectrumCacheHeader);
+    header.count = count;
+    header.flags = SPECTRUM_CACHE_FLAGS;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    for (uint32_t i = 0; i < count; i++) {
+        float xv = (float)x[i];
+        float yv = (float)y[i];
+        if ((i == 0) || (xv < header.min_x)) {
+            header.min_x = xv;
+        }
+        if ((i == 0) || (xv > header.max_x)) {
+            header.max_x = xv;
+        }
+        if ((i == 0) || (yv < header.min_y)) {
+            header.min_y = yv;
+        }
+        if ((i == 0) || (yv > header.max_y)) {
+            header.max_y = yv;
+        }
+    }
+}
+
+/**
+ * @brief Write one float column, converting from `T` through a small stack buffer.
+ */
+template <typename T>
+bool spectrumCacheWriteColumn(SpectrumWriteCallback write, void *ctx, const T *values, uint32_t count)
+{
+    float chunk[256];
+    uint32_t done = 0;
+    while (done < count) {
+        uint32_t n = count - done;
+        n = (n > 256) ? 256 : n;
+        for (uint32_t i = 0; i < n; i++) {
+            chunk[i] = (float)values[done + i];
+        }
+        if (write(ctx, (const uint8_t *)chunk, n * sizeof(float)) != (int)(n * sizeof(float))) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+template <>
+inline bool spectrumCacheWriteColumn<float>(SpectrumWriteCallback write, void *ctx, const float *values,
+                                            uint32_t count)
+{
+    size_t len = (size_t)count * sizeof(float);
+    return write(ctx, (const uint8_t *)values, len) == (int)len;
+}
+
+/**
+ * @brief Read one float column into `values`, converting to `T`. Float columns are read straight into place.
+ */
+template <typename T>
+bool spectrumCacheReadColumn(SpectrumReadCallback read, void *ctx, T *values, uint32_t count)
+{
+    float chunk[256];
+    uint32_t done = 0;
+    while (done < count) {
+        uint32_t n = count - done;
+        n = (n > 256) ? 256 : n;
+        if (read(ctx, (uint8_t *)chunk, n * sizeof(float)) != (int)(n * sizeof(float))) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            values[done + i] = (T)chunk[i];
+        }
+        done += n;
+    }
+    return true;
+}
+
+template <>
+inline bool spectrumCacheReadColumn<float>(SpectrumReadCallback read, void *ctx, float *values, uint32_t count)
+{
+    size_t len = (size_t)count * sizeof(float);
+    return read(ctx, (uint8_t *)values, len) == (int)len;
+}
+
+/**
+ * @brief Write header, x, y and prefix columns.
+ */
+template <typename T>
+bool spectrumCacheWrite(SpectrumWriteCallback write, void *ctx, const SpectrumCacheHeader &header, const T *x,
+                        const T *y, const SpectrumPrefix *prefix)
+{
+    if (write(ctx, (const uint8_t *)&header, sizeof(header)) != (int)sizeof(header)) {
+        return false;
+    }
+    if (!spectrumCacheWriteColumn(write, ctx, x, header.count) ||
+            !spectrumCacheWriteColumn(write, ctx, y, header.count)) {
+        return false;
+    }
+    size_t len = (size_t)header.count * sizeof(SpectrumPrefix);
+    return write(ctx, (const uint8_t *)prefix, len) == (int)len;
+}
+
+/**
+ * @brief Read the x, y and prefix columns that follow a header read with `spectrumCacheReadHeader()`.
+ */
+template <typename T>
+bool spectrumCacheReadColumns(SpectrumReadCallback read, void *ctx, const SpectrumCacheHeader &header, T *x, T *y,
+                              SpectrumPrefix *prefix)
+{
+    if (!spectrumCacheReadColumn(read, ctx, x, header.count) || !spectrumCacheReadColumn(read, ctx, y, header.count)) {
+        return false;
+    }
+    size_t len = (size_t)header.count * sizeof(SpectrumPrefix);
+    return read(ctx, (uint8_t *)prefix, len) == (int)len;
+}
@@ -0,0 +1,287 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spectrum_calibration.h"
+#include "spectrum_process.h"
+
+SpectrumCalibration SpectrumCalibration::linear(double m, double c)
+{
+    SpectrumCalibration curve = {};
+    curve.model = SPECTRUM_CALIBRATION_LINEAR;
+    curve.coef[0] = c;
+    curve.coef[1] = m;
+    return curve;
+}
+
+static bool usable(const double *area, const double *concentration, size_t i)
+{
+    return isfinite(area[i]) && isfinite(concentration[i]);
+}
+
+typedef double Matrix[SPECTRUM_CALIBRATION_TERMS][SPECTRUM_CALIBRATION_TERMS];
+
+// Solve the n x n system a * x = b in place, by Gaussian elimination with partial pivoting
+static bool solve(Matrix a, double b[SPECTRUM_CALIBRATION_TERMS], int n, double x[SPECTRUM_CALIBRATION_TERMS])
+{
+    double largest = 0;
+    for (int i = 0; i < n; i++) {
+        largest = fmax(largest, fabs(a[i][i]));
+    }
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (!(fabs(a[pivot][col]) > 1e-12 * largest)) {
+            return false;
+        }
+        if (pivot != col) {
+            for (int k = 0; k < n; k++) {
+                double tmp = a[col][k];
+                a[col][k] = a[pivot][k];
+                a[pivot][k] = tmp;
+            }
+            double tmp = b[col];
+            b[col] = b[pivot];
+            b[pivot] = tmp;
+        }
+        for (int row = col + 1; row < n; row++) {
+            double factor = a[row][col] / a[col][col];
+            for (int k = col; k < n; k++) {
+                a[row][k] -= factor * a[col][k];
+            }
+            b[row] -= factor * b[col];
+        }
+    }
+    for (int row = n - 1; row >= 0; row--) {
+        double sum = b[row];
+        for (int k = row + 1; k < n; k++) {
+            sum -= a[row][k] * x[k];
+        }
+        x[row] = sum / a[row][row];
+    }
+    return true;
+}
+
+bool SpectrumCalibration::fit(const double *area, const double *concentration, size_t count,
+                              SpectrumCalibrationModel new_model, SpectrumCalibrationWeighting new_weighting,
+                              double *residuals)
+{
+    int terms = (new_model == SPECTRUM_CALIBRATION_QUADRATIC) ? 3 : 2;
+
+    // Weights relative to the lowest non-zero concentration, so a blank does not get an infinite one
+    size_t used = 0;
+    double floor_y = INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        if (usable(area, concentration, i)) {
+            used++;
+            if (concentration[i] != 0) {
+                floor_y = fmin(floor_y, fabs(concentration[i]));
+            }
+        }
+    }
+    if (used <= (size_t)terms) {
+        return false;
+    }
+    auto weight = [&](size_t i) {
+        double y = isfinite(floor_y) ? fmax(fabs(concentration[i]), floor_y) : 1.0;
+        return (new_weighting == SPECTRUM_CALIBRATION_INVERSE) ? 1.0 / y :
+               (new_weighting == SPECTRUM_CALIBRATION_INVERSE_SQUARE) ? 1.0 / (y * y) : 1.0;
+    };
+
+    // Centre and scale the areas: t = (area - mean) / scale
+    double sum_w = 0;
+    double sum_wa = 0;
+    double sum_wy = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (usable(area, concentration, i)) {
+            double w = weight(i);
+            sum_w += w;
+            sum_wa += w * area[i];
+            sum_wy += w * concentration[i];
+        }
+    }
+    double mean = sum_wa / sum_w;
+    double mean_y = sum_wy / sum_w;
+    double spread = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (usable(area, concentration, i)) {
+            spread += weight(i) * (area[i] - mean) * (area[i] - mean);
+        }
+    }
+    double scale = sqrt(spread / sum_w);
+    if (!(scale > 1e-12 * fabs(mean))) {
+        return false;
+    }
+
+    // Normal equations in t, well conditioned now that t has zero mean and unit spread
+    Matrix a = {};
+    double b[SPECTRUM_CALIBRATION_TERMS] = {};
+    for (size_t i = 0; i < count; i++) {
+        if (!usable(area, concentration, i)) {
+            continue;
+        }
+        double w = weight(i);
+        double t = (area[i] - mean) / scale;
+        double power[2 * SPECTRUM_CALIBRATION_TERMS - 1] = {1, t, t * t, t * t * t, t * t * t * t};
+        for (int j = 0; j < terms; j++) {
+            for (int k = 0; k < terms; k++) {
+                a[j][k] += w * power[j + k];
+            }
+            b[j] += w * power[j] * (concentration[i] - mean_y);
+        }
+    }
+    double beta[SPECTRUM_CALIBRATION_TERMS] = {};
+    if (!solve(a, b, terms, beta)) {
+        return false;
+    }
+    beta[0] += mean_y;
+
+    double ss_res = 0;
+    double ss_tot = 0;
+    double largest = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!usable(area, concentration, i)) {
+            if (residuals != nullptr) {
+                residuals[i] = NAN;
+            }
+            continue;
+        }
+        double w = weight(i);
+        double t = (area[i] - mean) / scale;
+        double r = concentration[i] - (beta[0] + t * (beta[1] + t * beta[2]));
+        ss_res += w * r * r;
+        ss_tot += w * (concentration[i] - mean_y) * (concentration[i] - mean_y);
+        largest = fmax(largest, fabs(r));
+        if (residuals != nullptr) {
+            residuals[i] = r;
+        }
+    }
+
+    // Back to powers of the area
+    double s2 = scale * scale;
+    double range[2] = {lower, upper};
+    uint8_t measured = baseline;
+    *this = SpectrumCalibration();
+    model = new_model;
+    weighting = new_weighting;
+    fitted = 1;
+    points = (uint32_t)used;
+    coef[0] = beta[0] - beta[1] * mean / scale + beta[2] * mean * mean / s2;
+    coef[1] = beta[1] / scale - 2 * beta[2] * mean / s2;
+    coef[2] = beta[2] / s2;
+    r2 = (ss_tot > 0) ? 1 - ss_res / ss_tot : NAN;
+    std_error = sqrt(ss_res / (double)(used - terms));
+    max_residual = largest;
+    lower = range[0];
+    upper = range[1];
+    baseline = measured;
+    return true;
+}
+
+int SpectrumCalibration::format(char *buffer, size_t size) const
+{
+    if (model == SPECTRUM_CALIBRATION_QUADRATIC) {
+        return snprintf(buffer, size, "y = %.6gx^2 %c %.6gx %c %.6g", coef[2], (coef[1] < 0) ? '-' : '+',
+                        fabs(coef[1]), (coef[0] < 0) ? '-' : '+', fabs(coef[0]));
+    }
+    return snprintf(buffer, size, "y = %.6gx %c %.6g", coef[1], (coef[0] < 0) ? '-' : '+', fabs(coef[0]));
+}
+
+bool SpectrumCalibration::save(SpectrumWriteCallback write, void *ctx) const
+{
+    SpectrumCalibrationHeader header = {};
+    header.magic = SPECTRUM_CALIBRATION_MAGIC;
+    header.version = SPECTRUM_CALIBRATION_VERSION;
+    header.header_size = sizeof(header);
+    header.curve_size = sizeof(*this);
+    return (write(ctx, (const uint8_t *)&header, sizeof(header)) == (int)sizeof(header)) &&
+           (write(ctx, (const uint8_t *)this, sizeof(*this)) == (int)sizeof(*this));
+}
+
+bool SpectrumCalibration::load(SpectrumReadCallback read, void *ctx)
+{
+    SpectrumCalibrationHeader header;
+    SpectrumCalibration curve;
+    if ((read(ctx, (uint8_t *)&header, sizeof(header)) != (int)sizeof(header)) ||
+            (header.magic != SPECTRUM_CALIBRATION_MAGIC) || (header.version != SPECTRUM_CALIBRATION_VERSION) ||
+            (header.header_size != sizeof(header)) || (header.curve_size != sizeof(curve)) ||
+            (read(ctx, (uint8_t *)&curve, sizeof(curve)) != (int)sizeof(curve))) {
+        return false;
+    }
+    if ((curve.model > SPECTRUM_CALIBRATION_QUADRATIC) || (curve.weighting > SPECTRUM_CALIBRATION_INVERSE_SQUARE) ||
+            (curve.baseline > SPECTRUM_BASELINE_POLYNOMIAL) || !isfinite(curve.coef[0]) || !isfinite(curve.coef[1]) ||
+            !isfinite(curve.coef[2])) {
+        return false;
+    }
+    *this = curve;
+    return true;
+}
+
+bool spectrumConcentrationFromName(const char *name, double &concentration)
+{
+    const char *slash = strrchr(name, '/');
+    name = (slash != nullptr) ? slash + 1 : name;
+    const char *dot = strrchr(name, '.');
+    const char *end = (dot != nullptr) ? dot : name + strlen(name);
+
+    // Last run of digits with at most one decimal point inside
+    const char *start = nullptr;
+    size_t length = 0;
+    for (const char *p = name; p < end; ) {
+        if ((*p < '0') || (*p > '9')) {
+            p++;
+            continue;
+        }
+        const char *q = p;
+        while ((q < end) && (*q >= '0') && (*q <= '9')) {
+            q++;
+        }
+        if ((q + 1 < end) && (*q == '.') && (q[1] >= '0') && (q[1] <= '9')) {
+            q++;
+            while ((q < end) && (*q >= '0') && (*q <= '9')) {
+                q++;
+            }
+        }
+        start = p;
+        length = q - p;
+        p = q;
+    }
+
+    char number[32];
+    if ((start == nullptr) || (length >= sizeof(number))) {
+        return false;
+    }
+    memcpy(number, start, length);
+    number[length] = '\0';
+    concentration = strtod(number, nullptr);
+    return true;
+}
+
+bool spectrumCalibrationWriteStandards(SpectrumWriteCallback write, void *ctx, const SpectrumCalibration &curve,
+                                       const char *const *paths, const double *area, const double *concentration,
+                                       size_t count)
+{
+    char line[2 * 256 + 128];
+    int n = snprintf(line, sizeof(line), "file,concentration,area,fitted,residual\n");
+    if (write(ctx, (const uint8_t *)line, n) != n) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t length = spectrumCsvQuote(paths[i], line, 2 * 256);
+        if (usable(area, concentration, i)) {
+            double fitted = curve.concentration(area[i]);
+            length += snprintf(line + length, sizeof(line) - length, ",%.6g,%.6g,%.6g,%.3g\n", concentration[i],
+                               area[i], fitted, concentration[i] - fitted);
+        } else {
+            length += snprintf(line + length, sizeof(line) - length, ",,,,\n");
+        }
+        if (write(ctx, (const uint8_t *)line, length) != (int)length) {
+            return false;
+        }
+    }
+    return true;
+}
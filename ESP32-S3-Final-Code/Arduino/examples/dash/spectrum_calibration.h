@@ -0,0 +1,119 @@
+/*
+ * Calibration curve: the concentration for an area, either entered by hand as y = mx + c or fitted by least squares to
+ * a set of standards of known concentration.
+ *
+ * The fit centres and scales the areas before forming the normal equations, so a few thousand standards, or areas far
+ * from zero, keep the accuracy of a QR solve in double precision. Weighted fits use 1/y or 1/y^2 of the known
+ * concentration, the usual choice when the error grows with the concentration; a blank (y = 0) gets the weight of the
+ * lowest non-zero standard.
+ *
+ * A fitted or entered curve can be saved to a file on the card (layout below). Like the file index, a file with the
+ * wrong magic, version or length is ignored.
+ *
+ *      SpectrumCalibrationHeader       16 bytes
+ *      SpectrumCalibration             the curve
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectrum_csv.h"
+#include "spectrum_cache.h"
+
+#define SPECTRUM_CALIBRATION_MAGIC      (0x31424353)    // "SCB1"
+#define SPECTRUM_CALIBRATION_VERSION    (1)
+#define SPECTRUM_CALIBRATION_PATH       "/.calibration"
+#define SPECTRUM_CALIBRATION_TERMS      (3)             // Up to quadratic
+
+enum SpectrumCalibrationModel {
+    SPECTRUM_CALIBRATION_LINEAR,
+    SPECTRUM_CALIBRATION_QUADRATIC,
+};
+
+enum SpectrumCalibrationWeighting {
+    SPECTRUM_CALIBRATION_UNWEIGHTED,
+    SPECTRUM_CALIBRATION_INVERSE,           // 1/y
+    SPECTRUM_CALIBRATION_INVERSE_SQUARE,    // 1/y^2
+};
+
+struct SpectrumCalibrationHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t curve_size;
+    uint8_t reserved[4];
+};
+static_assert(sizeof(SpectrumCalibrationHeader) == 16,
+              "Calibration header layout must not change without a version bump");
+
+struct SpectrumCalibration {
+    uint8_t model;              // SpectrumCalibrationModel
+    uint8_t weighting;          // SpectrumCalibrationWeighting
+    uint8_t fitted;             // 0 if entered by hand, the statistics below are then 0
+    uint8_t baseline;           // SpectrumBaselineMode subtracted from the standards' areas
+    uint32_t points;            // Standards used by the fit
+    double coef[SPECTRUM_CALIBRATION_TERMS];    // y = coef[0] + coef[1] * area + coef[2] * area^2
+    double r2;                  // Coefficient of determination, weighted like the fit
+    double std_error;           // Residual standard error, sqrt(weighted SS / (points - terms))
+    double max_residual;        // Largest |known - fitted| concentration
+    double lower;               // Integration range the standards were measured over
+    double upper;
+
+    /**
+     * @brief y = mx + c, as entered on the parameter page.
+     */
+    static SpectrumCalibration linear(double m, double c);
+
+    /**
+     * @brief Fit the curve to `count` standards. Standards with a non-finite area or concentration are left out.
+     *        `lower`, `upper` and `baseline` are kept, they are for the caller to set.
+     *
+     * @param[out] residuals Optional, `count` entries: known - fitted concentration, NAN for the standards left out
+     *
+     * @return false, leaving the curve unchanged, if fewer standards than terms (plus one) remain or their areas do
+     *         not determine the curve (e.g. all equal)
+     */
+    bool fit(const double *area, const double *concentration, size_t count, SpectrumCalibrationModel new_model,
+             SpectrumCalibrationWeighting new_weighting, double *residuals = nullptr);
+
+    double concentration(double area) const
+    {
+        return coef[0] + area * (coef[1] + area * coef[2]);
+    }
+
+    /**
+     * @brief The curve as text, e.g. "y = 0.0123x + 0.45" or "y = 1.2e-05x^2 + 0.0123x + 0.45".
+     *
+     * @return Length written, like snprintf
+     */
+    int format(char *buffer, size_t size) const;
+
+    bool save(SpectrumWriteCallback write, void *ctx) const;
+
+    /**
+     * @brief Replace the curve with a saved one.
+     *
+     * @return false, leaving the curve unchanged, if the file is not a valid calibration
+     */
+    bool load(SpectrumReadCallback read, void *ctx);
+};
+static_assert(sizeof(SpectrumCalibration) == 72, "Calibration layout must not change without a version bump");
+
+/**
+ * @brief Concentration of a standard from its file name: the last number in it, before the extension, e.g. 2.5 for
+ *        "Cu-2.5mM.csv" or "Cu 2.5 mM.csv". Signs are not recognised since '-' usually separates words.
+ *
+ * @return false if the name holds no number
+ */
+bool spectrumConcentrationFromName(const char *name, double &concentration);
+
+/**
+ * @brief Write the standards of a fit as a CSV file: a header line, then file, known concentration, area, fitted
+ *        concentration and residual for each standard, in the order given. Standards left out of the fit (non-finite
+ *        area or concentration) have empty columns.
+ *
+ * @return false if a write failed
+ */
+bool spectrumCalibrationWriteStandards(SpectrumWriteCallback write, void *ctx, const SpectrumCalibration &curve,
+                                       const char *const *paths, const double *area, const double *concentration,
+                                       size_t count);
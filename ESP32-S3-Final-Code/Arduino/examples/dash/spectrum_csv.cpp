@@ -0,0 +1,264 @@
+#include <string.h>
+#include "spectrum_port.h"
+#include "spectrum_csv.h"
+
+static const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+static const int kPow10Max = (int)(sizeof(kPow10) / sizeof(kPow10[0])) - 1;
+
+static inline bool isBlank(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+float SpectrumCsvStats::rowsPerSecond(void) const
+{
+    return (elapsed_us == 0) ? 0.0f : (float)((double)rows * 1e6 / (double)elapsed_us);
+}
+
+float SpectrumCsvStats::bytesPerSecond(void) const
+{
+    return (elapsed_us == 0) ? 0.0f : (float)((double)bytes * 1e6 / (double)elapsed_us);
+}
+
+bool spectrumParseFloat(const char *&p, const char *end, float &out)
+{
+    const char *s = p;
+    while ((s < end) && isBlank(*s)) {
+        s++;
+    }
+
+    bool negative = false;
+    if ((s < end) && ((*s == '-') || (*s == '+'))) {
+        negative = (*s == '-');
+        s++;
+    }
+
+    // Accumulate up to 19 significant digits in an integer, track the decimal exponent separately
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int significant = 0;
+    bool any_digit = false;
+
+    while ((s < end) && (*s >= '0') && (*s <= '9')) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+            if (mantissa != 0) {
+                significant++;
+            }
+        } else {
+            exponent++;
+        }
+        any_digit = true;
+        s++;
+    }
+    if ((s < end) && (*s == '.')) {
+        s++;
+        while ((s < end) && (*s >= '0') && (*s <= '9')) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+                if (mantissa != 0) {
+                    significant++;
+                }
+                exponent--;
+            }
+            any_digit = true;
+            s++;
+        }
+    }
+    if (!any_digit) {
+        return false;
+    }
+
+    if ((s < end) && ((*s == 'e') || (*s == 'E'))) {
+        const char *e = s + 1;
+        bool exp_negative = false;
+        if ((e < end) && ((*e == '-') || (*e == '+'))) {
+            exp_negative = (*e == '-');
+            e++;
+        }
+        if ((e < end) && (*e >= '0') && (*e <= '9')) {
+            int value = 0;
+            while ((e < end) && (*e >= '0') && (*e <= '9')) {
+                if (value < 10000) {
+                    value = value * 10 + (*e - '0');
+                }
+                e++;
+            }
+            exponent += exp_negative ? -value : value;
+            s = e;
+        }
+        // A bare 'e' without digits is not part of the number
+    }
+
+    double result = (double)mantissa;
+    while (exponent > 0) {
+        int step = (exponent > kPow10Max) ? kPow10Max : exponent;
+        result *= kPow10[step];
+        exponent -= step;
+    }
+    while (exponent < 0) {
+        int step = (-exponent > kPow10Max) ? kPow10Max : -exponent;
+        result /= kPow10[step];
+        exponent += step;
+    }
+
+    out = (float)(negative ? -result : result);
+    p = s;
+    return true;
+}
+
+SpectrumCsvParser::SpectrumCsvParser(SpectrumPointCallback callback, void *user_data):
+    _callback(callback),
+    _user_data(user_data),
+    _rows(0),
+    _skipped(0),
+    _stopped(false)
+{
+}
+
+void SpectrumCsvParser::reset(void)
+{
+    _rows = 0;
+    _skipped = 0;
+    _stopped = false;
+}
+
+void SpectrumCsvParser::parseLine(const char *begin, const char *end)
+{
+    // Trim, the same way `String::trim()` did in the original loader
+    while ((begin < end) && isBlank(*begin)) {
+        begin++;
+    }
+    while ((end > begin) && isBlank(end[-1])) {
+        end--;
+    }
+    if (begin == end) {
+        return;
+    }
+
+    // The separator is the first ',' on the line, or the first tab if there is no comma
+    const char *sep = (const char *)memchr(begin, ',', end - begin);
+    if (sep == nullptr) {
+        sep = (const char *)memchr(begin, '\t', end - begin);
+    }
+
+    float x = 0;
+    float y = 0;
+    const char *p = begin;
+    if ((sep == nullptr) || !spectrumParseFloat(p, sep, x)) {
+        _skipped++;
+        return;
+    }
+    p = sep + 1;
+    if (!spectrumParseFloat(p, end, y)) {
+        _skipped++;
+        return;
+    }
+
+    _rows++;
+    if (!_callback(x, y, _user_data)) {
+        _stopped = true;
+    }
+}
+
+size_t SpectrumCsvParser::consume(const char *data, size_t len, bool final)
+{
+    const char *cur = data;
+    const char *end = data + len;
+
+    while (!_stopped && (cur < end)) {
+        const char *nl = (const char *)memchr(cur, '\n', end - cur);
+        if (nl == nullptr) {
+            if (final) {
+                parseLine(cur, end);
+                cur = end;
+            }
+            break;
+        }
+        parseLine(cur, nl);
+        cur = nl + 1;
+    }
+
+    return _stopped ? len : (size_t)(cur - data);
+}
+
+bool spectrumCsvParseStream(SpectrumReadCallback read, void *ctx, uint8_t *buf, size_t buf_size,
+                            SpectrumCsvParser &parser, SpectrumCsvStats *stats)
+{
+    uint32_t start_us = spectrum_time_us();
+    uint64_t total = 0;
+    uint32_t oversized = 0;
+    size_t used = 0;
+    bool discarding = false;
+    bool ok = true;
+
+    parser.reset();
+    while (!parser.stopped()) {
+        int n = read(ctx, buf + used, buf_size - used);
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        total += (uint64_t)n;
+        bool final = (n == 0);
+        size_t avail = used + (size_t)n;
+        size_t offset = 0;
+
+        if (discarding) {
+            // Drop the rest of an oversized line
+            uint8_t *nl = (uint8_t *)memchr(buf, '\n', avail);
+            if (nl == nullptr) {
+                used = 0;
+                if (final) {
+                    break;
+                }
+                continue;
+            }
+            offset = (size_t)(nl - buf) + 1;
+            discarding = false;
+        }
+
+        size_t consumed = offset + parser.consume((const char *)buf + offset, avail - offset, final);
+        if (final) {
+            break;
+        }
+        if ((consumed == 0) && (avail == buf_size)) {
+            // The buffer holds a single line that does not fit, skip it
+            oversized++;
+            discarding = true;
+            used = 0;
+            continue;
+        }
+        used = avail - consumed;
+        if (used > 0) {
+            memmove(buf, buf + consumed, used);
+        }
+    }
+
+    if (stats != nullptr) {
+        stats->rows = parser.rows();
+        stats->skipped = parser.skipped() + oversized;
+        stats->bytes = total;
+        stats->elapsed_us = spectrum_time_us() - start_us;
+    }
+
+    return ok;
+}
+
+size_t spectrumCsvQuote(const char *text, char *out, size_t size)
+{
+    size_t n = 0;
+    out[n++] = '"';
+    for (const char *p = text; (*p != '\0') && (n + 3 < size); p++) {
+        if (*p == '"') {
+            out[n++] = '"';
+        }
+        out[n++] = *p;
+    }
+    out[n++] = '"';
+    out[n] = '\0';
+    return n;
+}
@@ -0,0 +1,113 @@
+/*
+ * Streaming, zero-allocation parser for two-column (x, y) spectrum CSV files.
+ *
+ * The file is read in large fixed chunks into a caller-provided buffer and tokenized in place. A line that straddles
+ * two chunks is moved to the front of the buffer before the next read, so no per-row memory is ever allocated.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Default chunk size used by the sketch. Larger chunks mean fewer SD transactions; 4 KB matches the FAT cluster size
+ * of the cards we ship with.
+ */
+#define SPECTRUM_CSV_CHUNK_SIZE     (4096)
+
+/**
+ * @brief Called once per parsed row.
+ *
+ * @return false to stop parsing (e.g. the destination is full), true to continue
+ */
+typedef bool (*SpectrumPointCallback)(float x, float y, void *user_data);
+
+/**
+ * @brief Reads up to `len` bytes into `buf`.
+ *
+ * @return number of bytes read, 0 at end of stream, negative on error
+ */
+typedef int (*SpectrumReadCallback)(void *ctx, uint8_t *buf, size_t len);
+
+struct SpectrumCsvStats {
+    uint32_t rows;          // Rows delivered to the point callback
+    uint32_t skipped;       // Non-empty lines that did not contain a valid x,y pair (headers, comments, ...)
+    uint64_t bytes;         // Bytes consumed from the stream
+    uint32_t elapsed_us;    // Wall time spent in `spectrumCsvParseStream()`
+
+    float rowsPerSecond(void) const;
+    float bytesPerSecond(void) const;
+};
+
+/**
+ * @brief Parse a decimal floating point number (`[+-]digits[.digits][(e|E)[+-]digits]`).
+ *
+ * Leading spaces/tabs are skipped. On success `p` is advanced past the number.
+ *
+ * @return true if at least one digit was consumed
+ */
+bool spectrumParseFloat(const char *&p, const char *end, float &out);
+
+class SpectrumCsvParser {
+public:
+    SpectrumCsvParser(SpectrumPointCallback callback, void *user_data);
+
+    /**
+     * @brief Reset the row counters. Call before reusing the parser for another file.
+     */
+    void reset(void);
+
+    /**
+     * @brief Tokenize every complete line in `data`.
+     *
+     * @param final true if `data` holds the end of the stream, so a trailing line without '\n' is parsed as well
+     *
+     * @return number of bytes consumed; the caller keeps the unconsumed tail and prepends it to the next chunk
+     */
+    size_t consume(const char *data, size_t len, bool final);
+
+    /**
+     * @brief Whether the point callback asked to stop.
+     */
+    bool stopped(void) const
+    {
+        return _stopped;
+    }
+
+    uint32_t rows(void) const
+    {
+        return _rows;
+    }
+
+    uint32_t skipped(void) const
+    {
+        return _skipped;
+    }
+
+private:
+    void parseLine(const char *begin, const char *end);
+
+    SpectrumPointCallback _callback;
+    void *_user_data;
+    uint32_t _rows;
+    uint32_t _skipped;
+    bool _stopped;
+};
+
+/**
+ * @brief Drive `parser` over a whole stream using `buf` as the only working memory.
+ *
+ * Lines longer than `buf_size` are dropped and counted as skipped.
+ *
+ * @return true if the stream was read to the end (or the callback stopped early), false on read error
+ */
+bool spectrumCsvParseStream(SpectrumReadCallback read, void *ctx, uint8_t *buf, size_t buf_size,
+                            SpectrumCsvParser &parser, SpectrumCsvStats *stats);
+
+/**
+ * @brief Write `text` as one CSV field: between double quotes, with the quotes inside doubled, truncated to fit `size`
+ *        (at least 3) with its NUL.
+ *
+ * @return Length written, without the NUL
+ */
+size_t spectrumCsvQuote(const char *text, char *out, size_t size);
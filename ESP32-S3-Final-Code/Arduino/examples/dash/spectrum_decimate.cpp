@@ -0,0 +1,92 @@
+#include <string.h>
+#include "spectrum_port.h"
+#include "spectrum_decimate.h"
+#include "spectrum_numeric.h"
+#include "spectrum_pyramid.h"
+
+bool spectrumEnvelopeCompute(const float *x, const float *y, size_t from, size_t to, uint16_t columns, float *out_x,
+                             float *out_min, float *out_max, float *y_min, float *y_max)
+{
+    return spectrumEnvelope<SpectrumChartType>(x, y, from, to, columns, out_x, out_min, out_max, y_min, y_max);
+}
+
+SpectrumDecimator::SpectrumDecimator():
+    _pyramid(nullptr),
+    _generation(1),
+    _clock(0),
+    _hits(0),
+    _misses(0)
+{
+    memset(_entries, 0, sizeof(_entries));
+}
+
+SpectrumDecimator::~SpectrumDecimator()
+{
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        spectrum_free(_entries[i].buffer);
+    }
+}
+
+void SpectrumDecimator::invalidate(void)
+{
+    // Entries of older generations never match again, their buffers are reused on eviction
+    _generation++;
+}
+
+const SpectrumEnvelope *SpectrumDecimator::envelope(const float *x, const float *y, size_t from, size_t to,
+                                                    uint16_t width)
+{
+    if ((to <= from) || (width == 0)) {
+        return nullptr;
+    }
+
+    _clock++;
+    Entry *victim = &_entries[0];
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        Entry &entry = _entries[i];
+        if ((entry.generation == _generation) && (entry.from == from) && (entry.to == to) && (entry.width == width)) {
+            entry.last_used = _clock;
+            _hits++;
+            return &entry.envelope;
+        }
+        // Evict stale entries first, then the least recently used one
+        uint32_t age = (entry.generation == _generation) ? entry.last_used : 0;
+        uint32_t victim_age = (victim->generation == _generation) ? victim->last_used : 0;
+        if (age < victim_age) {
+            victim = &entry;
+        }
+    }
+
+    _misses++;
+    if (victim->capacity < width) {
+        spectrum_free(victim->buffer);
+        victim->buffer = static_cast<float *>(spectrum_malloc((size_t)width * 3 * sizeof(float)));
+        victim->capacity = (victim->buffer == nullptr) ? 0 : width;
+        if (victim->buffer == nullptr) {
+            victim->generation = 0;
+            return nullptr;
+        }
+    }
+
+    SpectrumEnvelope &env = victim->envelope;
+    float *out_x = victim->buffer;
+    float *out_min = out_x + width;
+    float *out_max = out_min + width;
+    // Scanning is cheaper than the pyramid's per-column searches when there are only a few samples per column
+    if ((_pyramid != nullptr) && (to <= _pyramid->size()) && ((to - from) > (size_t)width * 4)) {
+        _pyramid->envelope(from, to, width, out_x, out_min, out_max, &env.y_min, &env.y_max);
+    } else {
+        spectrumEnvelopeCompute(x, y, from, to, width, out_x, out_min, out_max, &env.y_min, &env.y_max);
+    }
+    env.x = out_x;
+    env.min = out_min;
+    env.max = out_max;
+    env.columns = width;
+
+    victim->from = from;
+    victim->to = to;
+    victim->width = width;
+    victim->generation = _generation;
+    victim->last_used = _clock;
+    return &env;
+}
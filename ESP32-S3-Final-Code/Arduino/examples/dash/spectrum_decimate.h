@@ -0,0 +1,97 @@
+/*
+ * Min/max envelope decimation of a spectrum for display.
+ *
+ * A sample range is split into one bucket per pixel column (by wavenumber, in file order) and each bucket keeps the
+ * smallest and largest y it contains, so narrow peaks survive no matter how many samples share a column. The result is
+ * computed in one linear pass and cached per (range, width), so redrawing the same view after a slider move is free.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class SpectrumPyramid;
+
+struct SpectrumEnvelope {
+    const float *x;         // Wavenumber at the center of each column
+    const float *min;       // Smallest y in each column
+    const float *max;       // Largest y in each column
+    uint16_t columns;
+    float y_min;            // Extents over all columns, for scaling the chart
+    float y_max;
+};
+
+/**
+ * @brief Compute the envelope of samples [from, to) into `columns` buckets.
+ *
+ * Columns that receive no sample (more pixels than samples) repeat the value of the previous sample, so the envelope
+ * stays continuous.
+ *
+ * @return false if the range is empty or `columns` is 0
+ */
+bool spectrumEnvelopeCompute(const float *x, const float *y, size_t from, size_t to, uint16_t columns, float *out_x,
+                             float *out_min, float *out_max, float *y_min, float *y_max);
+
+class SpectrumDecimator {
+public:
+    static const int CACHE_ENTRIES = 4;
+
+    SpectrumDecimator();
+    ~SpectrumDecimator();
+
+    SpectrumDecimator(const SpectrumDecimator &) = delete;
+    SpectrumDecimator &operator=(const SpectrumDecimator &) = delete;
+
+    /**
+     * @brief Drop every cached envelope. Call whenever the underlying samples change.
+     */
+    void invalidate(void);
+
+    /**
+     * @brief Answer cache misses from a pyramid built over the same samples instead of scanning them, so zooming
+     *        and panning cost the same on any spectrum size. Pass nullptr to go back to linear scans.
+     */
+    void setPyramid(const SpectrumPyramid *pyramid)
+    {
+        _pyramid = pyramid;
+        invalidate();
+    }
+
+    /**
+     * @brief Envelope of samples [from, to) at `width` columns, from the cache if the same view was requested since the
+     *        last `invalidate()`.
+     *
+     * @return nullptr if the range is empty or memory could not be allocated. The pointer stays valid until the entry is
+     *         evicted, i.e. for at least `CACHE_ENTRIES - 1` further requests of other views.
+     */
+    const SpectrumEnvelope *envelope(const float *x, const float *y, size_t from, size_t to, uint16_t width);
+
+    uint32_t hits(void) const
+    {
+        return _hits;
+    }
+
+    uint32_t misses(void) const
+    {
+        return _misses;
+    }
+
+private:
+    struct Entry {
+        size_t from;
+        size_t to;
+        uint16_t width;
+        uint16_t capacity;
+        uint32_t generation;
+        uint32_t last_used;
+        float *buffer;
+        SpectrumEnvelope envelope;
+    };
+
+    Entry _entries[CACHE_ENTRIES];
+    const SpectrumPyramid *_pyramid;
+    uint32_t _generation;
+    uint32_t _clock;
+    uint32_t _hits;
+    uint32_t _misses;
+};
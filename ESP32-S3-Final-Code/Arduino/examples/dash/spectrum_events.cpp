@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <string.h>
+#include "spectrum_port.h"
+#include "spectrum_events.h"
+
+SpectrumEvents::SpectrumEvents():
+    _events(),
+    _version(0),
+    _clients(0)
+{
+}
+
+bool SpectrumEvents::publish(const char *name, const char *data)
+{
+    size_t length = strlen(data);
+    if ((length >= SPECTRUM_EVENTS_DATA_MAX) || (strpbrk(data, "\r\n") != nullptr)) {
+        return false;
+    }
+
+    Event *event = nullptr;
+    for (int i = 0; i < SPECTRUM_EVENTS_MAX_EVENTS; i++) {
+        if ((_events[i].name == nullptr) || (strcmp(_events[i].name, name) == 0)) {
+            event = &_events[i];
+            break;
+        }
+    }
+    if (event == nullptr) {
+        return false;
+    }
+    event->name = name;
+    memcpy(event->data, data, length + 1);
+    event->version = ++_version;
+    return true;
+}
+
+void SpectrumEvents::respond(SpectrumHttpResponse &response)
+{
+    response.addHeader("Cache-Control", "no-store");
+    if (_clients >= SPECTRUM_EVENTS_MAX_CLIENTS) {
+        response.setStatus(503);
+        response.addHeader("Retry-After", "5");
+        response.print("Too many event streams\n");
+        return;
+    }
+    response.addHeader("Content-Type", "text/event-stream");
+    if (response.stream(body, this, sizeof(Subscriber), release) != nullptr) {
+        _clients++;
+    }
+}
+
+size_t SpectrumEvents::body(void *ctx, void *state, char *buffer, size_t size, bool &done)
+{
+    (void)done;     // Until the browser goes away
+    SpectrumEvents *events = static_cast<SpectrumEvents *>(ctx);
+    Subscriber *subscriber = static_cast<Subscriber *>(state);
+    uint32_t now = spectrum_time_us();
+
+    size_t used = 0;
+    if (!subscriber->opened) {
+        used = snprintf(buffer, size, "retry: %u\n\n", (unsigned)SPECTRUM_EVENTS_RETRY_MS);
+        subscriber->opened = true;
+        subscriber->sent_at = now - SPECTRUM_EVENTS_MIN_INTERVAL_MS * 1000u;
+    }
+
+    if (now - subscriber->sent_at >= SPECTRUM_EVENTS_MIN_INTERVAL_MS * 1000u) {
+        bool sent = false;
+        for (int i = 0; i < SPECTRUM_EVENTS_MAX_EVENTS; i++) {
+            const Event &event = events->_events[i];
+            if ((event.version == 0) || (event.version == subscriber->sent[i])) {
+                continue;
+            }
+            int n = snprintf(buffer + used, size - used, "event: %s\ndata: %s\n\n", event.name, event.data);
+            if ((size_t)n >= size - used) {
+                break;      // The rest goes in the next message
+            }
+            used += n;
+            subscriber->sent[i] = event.version;
+            sent = true;
+        }
+        if (sent) {
+            subscriber->sent_at = now;
+        }
+    }
+
+    if ((used == 0) && (now - subscriber->sent_at >= SPECTRUM_EVENTS_KEEPALIVE_MS * 1000u)) {
+        used = snprintf(buffer, size, ":\n\n");
+        subscriber->sent_at = now;
+    }
+    return used;
+}
+
+void SpectrumEvents::release(void *ctx, void *state)
+{
+    (void)state;
+    static_cast<SpectrumEvents *>(ctx)->_clients--;
+}
@@ -0,0 +1,71 @@
+/*
+ * Server-Sent Events for the web page: the latest value of a few named events, pushed to every browser that has
+ * `/api/events` open as a `text/event-stream` response of the HTTP server.
+ *
+ * Only the latest value of each event is kept. Every subscriber gets what changed since its last message, at most once
+ * per `SPECTRUM_EVENTS_MIN_INTERVAL_MS`: the first change after a quiet spell goes out on the next `handleClients()`,
+ * a burst (a slider being dragged) is coalesced into one message per interval, and no browser ever falls behind by
+ * more than the latest values. A new subscriber gets every event published so far right away.
+ *
+ * Nothing is locked here: `publish()` must never run while `SpectrumHttpServer::handleClients()` does. Call it from
+ * the thread that polls the server, or hold the same lock around both (the sketch publishes from LVGL timers and polls
+ * the server under the LVGL lock).
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectrum_http.h"
+
+#define SPECTRUM_EVENTS_MAX_EVENTS          (4)
+#define SPECTRUM_EVENTS_DATA_MAX            (256)   // One line of data per event, e.g. a small JSON object
+#define SPECTRUM_EVENTS_MAX_CLIENTS         (4)     // Each one holds a connection of the server's pool
+#define SPECTRUM_EVENTS_MIN_INTERVAL_MS     (50)    // At most 20 messages a second per subscriber
+#define SPECTRUM_EVENTS_KEEPALIVE_MS        (15000) // Comment line sent on a quiet stream
+#define SPECTRUM_EVENTS_RETRY_MS            (1000)  // Reconnection delay asked of the browser
+
+class SpectrumEvents {
+public:
+    SpectrumEvents();
+
+    /**
+     * @brief Make `data` the latest value of event `name` (a string that outlives the object, e.g. a literal) and
+     *        push it to the subscribers.
+     *
+     * @return false if `data` is too long or holds a line break, or if there are already `SPECTRUM_EVENTS_MAX_EVENTS`
+     *         other events
+     */
+    bool publish(const char *name, const char *data);
+
+    /**
+     * @brief Answer a request for the event stream: subscribe, or a 503 if `SPECTRUM_EVENTS_MAX_CLIENTS` are already
+     *        listening.
+     */
+    void respond(SpectrumHttpResponse &response);
+
+    uint32_t clients(void) const
+    {
+        return _clients;
+    }
+
+private:
+    struct Event {
+        const char *name;
+        uint32_t version;       // 0 until published
+        char data[SPECTRUM_EVENTS_DATA_MAX];
+    };
+
+    struct Subscriber {
+        uint32_t sent[SPECTRUM_EVENTS_MAX_EVENTS];  // Version of each event last sent
+        uint32_t sent_at;       // spectrum_time_us() of the last message
+        bool opened;
+    };
+    static_assert(sizeof(Subscriber) <= SPECTRUM_HTTP_STATE_MAX, "Must fit in the per-connection stream state");
+
+    static size_t body(void *ctx, void *state, char *buffer, size_t size, bool &done);
+    static void release(void *ctx, void *state);
+
+    Event _events[SPECTRUM_EVENTS_MAX_EVENTS];
+    uint32_t _version;
+    uint32_t _clients;
+};
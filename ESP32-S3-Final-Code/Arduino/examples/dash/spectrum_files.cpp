@@ -0,0 +1,365 @@
+#include <ctype.h>
+#include <string.h>
+#include <utility>
+#include "spectrum_port.h"
+#include "spectrum_files.h"
+
+struct SpectrumFileIndex::Scan {
+    Tables *next;
+    const Tables *old;
+    const char *suffix;
+    size_t suffix_len;
+    SpectrumListCallback list;
+    SpectrumStatCallback stat;
+    void *ctx;
+    SpectrumFileIndexStats stats;
+    const char *path;           // Directory being listed
+    uint32_t dir;
+    bool ok;
+};
+
+template <typename T>
+bool SpectrumFileIndex::Table<T>::reserve(size_t n)
+{
+    if (n <= capacity) {
+        return true;
+    }
+    T *grown = static_cast<T *>(spectrum_malloc(n * sizeof(T)));
+    if (grown == nullptr) {
+        return false;
+    }
+    if (count > 0) {
+        memcpy(grown, data, count * sizeof(T));
+    }
+    spectrum_free(data);
+    data = grown;
+    capacity = n;
+    return true;
+}
+
+template <typename T>
+void SpectrumFileIndex::Table<T>::release(void)
+{
+    spectrum_free(data);
+    data = nullptr;
+    count = 0;
+    capacity = 0;
+}
+
+SpectrumFileIndex::SpectrumFileIndex():
+    _tables(),
+    _next(),
+    _generation(1),
+    _dirty(false)
+{
+}
+
+SpectrumFileIndex::~SpectrumFileIndex()
+{
+    _tables.release();
+    _next.release();
+}
+
+void SpectrumFileIndex::clear(void)
+{
+    _tables.clear();
+    _generation++;
+    _dirty = true;
+}
+
+// Append "dir/name" (or just `name` if `dir` is nullptr) to the arena
+uint32_t SpectrumFileIndex::addString(Tables &tables, const char *dir, const char *name)
+{
+    size_t dir_len = (dir == nullptr) ? 0 : strlen(dir);
+    bool slash = (dir_len > 0) && (dir[dir_len - 1] != '/');
+    size_t name_len = strlen(name);
+    size_t len = dir_len + (slash ? 1 : 0) + name_len;
+    if (len >= SPECTRUM_FILE_INDEX_PATH_MAX) {
+        return NONE;
+    }
+
+    Table<char> &arena = tables.arena;
+    size_t need = arena.count + len + 1;
+    if ((need > arena.capacity) && !arena.reserve((arena.capacity * 2 > need) ? arena.capacity * 2 : need + 1024)) {
+        return NONE;
+    }
+    uint32_t offset = (uint32_t)arena.count;
+    char *out = arena.data + offset;
+    memcpy(out, dir, dir_len);
+    if (slash) {
+        out[dir_len] = '/';
+    }
+    memcpy(out + len - name_len, name, name_len + 1);
+    arena.count += len + 1;
+    return offset;
+}
+
+bool SpectrumFileIndex::visitEntry(const SpectrumDirEntry &entry, void *visit_ctx)
+{
+    Scan &scan = *static_cast<Scan *>(visit_ctx);
+    Tables &next = *scan.next;
+
+    size_t name_len = strlen(entry.name);
+    if (entry.is_dir) {
+        uint32_t path = addString(next, scan.path, entry.name);
+        Dir dir = {path, scan.dir, entry.mtime, 0, 0};
+        scan.ok = (path != NONE) && next.dirs.push(dir);
+    } else if ((name_len >= scan.suffix_len) && (strcmp(entry.name + name_len - scan.suffix_len, scan.suffix) == 0)) {
+        uint32_t path = addString(next, scan.path, entry.name);
+        if (path == NONE) {
+            scan.ok = false;
+            return false;
+        }
+        File file = {path, (uint32_t)(strlen(next.arena.data + path) - name_len), entry.size, entry.mtime};
+        scan.ok = next.files.push(file);
+    }
+    return scan.ok;
+}
+
+bool SpectrumFileIndex::scanDir(Scan &scan, uint32_t dir, uint32_t old_dir)
+{
+    Tables &next = *scan.next;
+    const Tables &old = *scan.old;
+
+    // The arena may move while this directory is scanned, work on a copy of its path
+    char path[SPECTRUM_FILE_INDEX_PATH_MAX];
+    strcpy(path, next.arena.data + next.dirs.data[dir].path);
+    next.dirs.data[dir].first_file = (uint32_t)next.files.count;
+
+    if ((old_dir != NONE) && (old.dirs.data[old_dir].mtime == next.dirs.data[dir].mtime)) {
+        // Unchanged since the last scan: copy its files, then stat its subdirectories
+        scan.stats.dirs_reused++;
+        const Dir &from = old.dirs.data[old_dir];
+        for (uint32_t i = from.first_file; i < from.first_file + from.file_count; i++) {
+            File file = old.files.data[i];
+            file.path = addString(next, nullptr, old.arena.data + file.path);
+            if ((file.path == NONE) || !next.files.push(file)) {
+                return false;
+            }
+        }
+        next.dirs.data[dir].file_count = (uint32_t)next.files.count - next.dirs.data[dir].first_file;
+
+        for (uint32_t k = old_dir + 1; k < old.dirs.count; k++) {
+            int64_t mtime;
+            if ((old.dirs.data[k].parent != old_dir) ||
+                    !scan.stat(scan.ctx, old.arena.data + old.dirs.data[k].path, mtime)) {
+                continue;
+            }
+            Dir child = {addString(next, nullptr, old.arena.data + old.dirs.data[k].path), dir, mtime, 0, 0};
+            if ((child.path == NONE) || !next.dirs.push(child) || !scanDir(scan, (uint32_t)next.dirs.count - 1, k)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // New or changed: list it, then match its subdirectories with the previous table
+    scan.stats.dirs_listed++;
+    size_t first_child = next.dirs.count;
+    scan.path = path;
+    scan.dir = dir;
+    scan.list(scan.ctx, path, visitEntry, &scan);
+    if (!scan.ok) {
+        return false;
+    }
+    next.dirs.data[dir].file_count = (uint32_t)next.files.count - next.dirs.data[dir].first_file;
+
+    size_t last_child = next.dirs.count;
+    for (size_t c = first_child; c < last_child; c++) {
+        uint32_t match = NONE;
+        for (uint32_t k = 0; (old_dir != NONE) && (k < old.dirs.count); k++) {
+            if ((old.dirs.data[k].parent == old_dir) &&
+                    (strcmp(old.arena.data + old.dirs.data[k].path, next.arena.data + next.dirs.data[c].path) == 0)) {
+                match = k;
+                break;
+            }
+        }
+        if (!scanDir(scan, (uint32_t)c, match)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SpectrumFileIndex::refresh(const char *root, const char *suffix, SpectrumListCallback list,
+                                SpectrumStatCallback stat, void *ctx, SpectrumFileIndexStats *stats)
+{
+    uint32_t start = spectrum_time_us();
+    Scan scan = {&_next, &_tables, suffix, strlen(suffix), list, stat, ctx, {}, nullptr, 0, true};
+    _next.clear();
+
+    int64_t mtime;
+    bool ok = true;
+    if (stat(ctx, root, mtime)) {
+        bool same_root = (_tables.dirs.count > 0) &&
+                         (strcmp(_tables.arena.data + _tables.dirs.data[0].path, root) == 0);
+        Dir dir = {addString(_next, nullptr, root), NONE, mtime, 0, 0};
+        ok = (dir.path != NONE) && _next.dirs.push(dir) && scanDir(scan, 0, same_root ? 0 : NONE);
+    }
+    if (!ok) {
+        return false;
+    }
+
+    _dirty = _dirty || (scan.stats.dirs_listed > 0) || (_next.dirs.count != _tables.dirs.count);
+    std::swap(_tables, _next);
+    _generation++;
+    if (stats != nullptr) {
+        *stats = scan.stats;
+        stats->files = (uint32_t)_tables.files.count;
+        stats->elapsed_us = spectrum_time_us() - start;
+    }
+    return true;
+}
+
+bool SpectrumFileIndex::save(SpectrumWriteCallback write, void *ctx)
+{
+    SpectrumFileIndexHeader header = {};
+    header.magic = SPECTRUM_FILE_INDEX_MAGIC;
+    header.version = SPECTRUM_FILE_INDEX_VERSION;
+    header.header_size = sizeof(header);
+    header.dir_count = (uint32_t)_tables.dirs.count;
+    header.file_count = (uint32_t)_tables.files.count;
+    header.arena_size = (uint32_t)_tables.arena.count;
+
+    size_t dirs_len = _tables.dirs.count * sizeof(Dir);
+    size_t files_len = _tables.files.count * sizeof(File);
+    if ((write(ctx, (const uint8_t *)&header, sizeof(header)) != (int)sizeof(header)) ||
+            (write(ctx, (const uint8_t *)_tables.dirs.data, dirs_len) != (int)dirs_len) ||
+            (write(ctx, (const uint8_t *)_tables.files.data, files_len) != (int)files_len) ||
+            (write(ctx, (const uint8_t *)_tables.arena.data, _tables.arena.count) != (int)_tables.arena.count)) {
+        return false;
+    }
+    _dirty = false;
+    return true;
+}
+
+bool SpectrumFileIndex::load(SpectrumReadCallback read, void *ctx)
+{
+    clear();
+
+    SpectrumFileIndexHeader header;
+    if ((read(ctx, (uint8_t *)&header, sizeof(header)) != (int)sizeof(header)) ||
+            (header.magic != SPECTRUM_FILE_INDEX_MAGIC) || (header.version != SPECTRUM_FILE_INDEX_VERSION) ||
+            (header.header_size != sizeof(header)) || (header.dir_count == 0) || (header.arena_size == 0)) {
+        return false;
+    }
+    if (!_tables.dirs.reserve(header.dir_count) || !_tables.files.reserve(header.file_count) ||
+            !_tables.arena.reserve(header.arena_size)) {
+        return false;
+    }
+
+    size_t dirs_len = header.dir_count * sizeof(Dir);
+    size_t files_len = header.file_count * sizeof(File);
+    if ((read(ctx, (uint8_t *)_tables.dirs.data, dirs_len) != (int)dirs_len) ||
+            (read(ctx, (uint8_t *)_tables.files.data, files_len) != (int)files_len) ||
+            (read(ctx, (uint8_t *)_tables.arena.data, header.arena_size) != (int)header.arena_size) ||
+            (_tables.arena.data[header.arena_size - 1] != '\0')) {
+        return false;
+    }
+
+    // Everything must point inside the tables, a truncated or foreign file must not be trusted
+    bool valid = true;
+    for (uint32_t i = 0; valid && (i < header.dir_count); i++) {
+        const Dir &dir = _tables.dirs.data[i];
+        valid = (dir.path < header.arena_size) && ((i == 0) ? (dir.parent == NONE) : (dir.parent < i)) &&
+                (dir.first_file <= header.file_count) && (dir.file_count <= header.file_count - dir.first_file);
+    }
+    for (uint32_t i = 0; valid && (i < header.file_count); i++) {
+        const File &file = _tables.files.data[i];
+        valid = (file.path < header.arena_size) && (file.name < header.arena_size - file.path);
+    }
+    if (!valid) {
+        return false;
+    }
+
+    _tables.dirs.count = header.dir_count;
+    _tables.files.count = header.file_count;
+    _tables.arena.count = header.arena_size;
+    _dirty = false;
+    return true;
+}
+
+SpectrumFileFilter::SpectrumFileFilter():
+    _matches(nullptr),
+    _count(0),
+    _capacity(0),
+    _total(0),
+    _checked(0),
+    _generation(0),
+    _all(true),
+    _query()
+{
+}
+
+SpectrumFileFilter::~SpectrumFileFilter()
+{
+    spectrum_free(_matches);
+}
+
+// Case-insensitive substring search, `needle` is already lower case
+static bool spectrumNameMatches(const char *name, const char *needle, size_t needle_len)
+{
+    for (; *name != '\0'; name++) {
+        size_t i = 0;
+        while ((i < needle_len) && (name[i] != '\0') && (tolower((unsigned char)name[i]) == needle[i])) {
+            i++;
+        }
+        if (i == needle_len) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SpectrumFileFilter::update(const SpectrumFileIndex &index, const char *query)
+{
+    char needle[SPECTRUM_FILE_FILTER_QUERY_MAX];
+    size_t len = 0;
+    for (; (query[len] != '\0') && (len + 1 < sizeof(needle)); len++) {
+        needle[len] = (char)tolower((unsigned char)query[len]);
+    }
+    needle[len] = '\0';
+
+    bool narrowing = !_all && (_generation == index.generation()) && (strncmp(needle, _query, strlen(_query)) == 0);
+    _total = index.size();
+    _generation = index.generation();
+    memcpy(_query, needle, len + 1);
+    _checked = 0;
+    if (len == 0) {
+        _all = true;
+        return true;
+    }
+
+    if (narrowing) {
+        // Every match of the longer query also matched the shorter one
+        size_t kept = 0;
+        for (size_t i = 0; i < _count; i++) {
+            if (spectrumNameMatches(index.name(_matches[i]), needle, len)) {
+                _matches[kept++] = _matches[i];
+            }
+        }
+        _checked = _count;
+        _count = kept;
+        return true;
+    }
+
+    if (_total > _capacity) {
+        spectrum_free(_matches);
+        _matches = static_cast<uint32_t *>(spectrum_malloc(_total * sizeof(uint32_t)));
+        _capacity = (_matches == nullptr) ? 0 : _total;
+        if (_matches == nullptr) {
+            _all = true;
+            _query[0] = '\0';
+            return false;
+        }
+    }
+    _all = false;
+    _count = 0;
+    for (size_t i = 0; i < _total; i++) {
+        if (spectrumNameMatches(index.name(i), needle, len)) {
+            _matches[_count++] = (uint32_t)i;
+        }
+    }
+    _checked = _total;
+    return true;
+}
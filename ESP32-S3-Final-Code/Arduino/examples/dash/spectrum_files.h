@@ -0,0 +1,288 @@
+/*
+ * Index of the spectrum files on the SD card, for the file selector.
+ *
+ * The tree is walked once and flattened into a table of files whose paths live in one arena, so a page of the selector
+ * is a slice of the table and costs the same with ten files or ten thousand. Each directory keeps the modification
+ * time it was listed with: `refresh()` only lists directories whose time changed and copies the rest from the
+ * previous table, which costs one stat per directory instead of one per file.
+ *
+ * The table can be saved to a file on the card (layout below) so a reboot starts from the last index instead of an
+ * empty one. Like the sidecar cache, a file with the wrong magic, version or length is ignored.
+ *
+ *      SpectrumFileIndexHeader         32 bytes
+ *      Dir     dirs[dir_count]
+ *      File    files[file_count]
+ *      char    arena[arena_size]       NUL-terminated paths
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectrum_csv.h"
+#include "spectrum_cache.h"
+
+#define SPECTRUM_FILE_INDEX_MAGIC       (0x31494653)    // "SFI1"
+#define SPECTRUM_FILE_INDEX_VERSION     (1)
+#define SPECTRUM_FILE_INDEX_PATH        "/.csvindex"
+#define SPECTRUM_FILE_INDEX_PATH_MAX    (256)
+
+struct SpectrumFileIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t dir_count;
+    uint32_t file_count;
+    uint32_t arena_size;
+    uint8_t reserved[12];
+};
+static_assert(sizeof(SpectrumFileIndexHeader) == 32, "Index header layout must not change without a version bump");
+
+/**
+ * @brief One directory entry, as reported by a `SpectrumListCallback`.
+ */
+struct SpectrumDirEntry {
+    const char *name;           // Base name, without the directory
+    bool is_dir;
+    uint64_t size;
+    int64_t mtime;              // Last write time, seconds since the epoch (0 if unknown)
+};
+
+typedef bool (*SpectrumDirVisitCallback)(const SpectrumDirEntry &entry, void *visit_ctx);
+
+/**
+ * @brief Call `visit` for every direct child of directory `path`.
+ *
+ * @return false if `path` could not be opened as a directory
+ */
+typedef bool (*SpectrumListCallback)(void *ctx, const char *path, SpectrumDirVisitCallback visit, void *visit_ctx);
+
+/**
+ * @brief Last write time of directory `path`.
+ *
+ * @return false if it does not exist any more
+ */
+typedef bool (*SpectrumStatCallback)(void *ctx, const char *path, int64_t &mtime);
+
+struct SpectrumFileIndexStats {
+    uint32_t dirs_listed;       // Directories that were new or changed
+    uint32_t dirs_reused;       // Directories copied from the previous table after one stat
+    uint32_t files;
+    uint32_t elapsed_us;
+};
+
+class SpectrumFileIndex {
+public:
+    SpectrumFileIndex();
+    ~SpectrumFileIndex();
+
+    SpectrumFileIndex(const SpectrumFileIndex &) = delete;
+    SpectrumFileIndex &operator=(const SpectrumFileIndex &) = delete;
+
+    /**
+     * @brief Bring the table up to date with the tree under `root`, keeping files whose name ends in `suffix`.
+     *        Directories whose modification time is unchanged are not listed again.
+     *
+     * @return false if memory ran out; the previous table is kept in that case
+     */
+    bool refresh(const char *root, const char *suffix, SpectrumListCallback list, SpectrumStatCallback stat, void *ctx,
+                 SpectrumFileIndexStats *stats = nullptr);
+
+    /**
+     * @brief Forget everything, so the next `refresh()` lists every directory.
+     */
+    void clear(void);
+
+    /**
+     * @brief Write the table in the layout above and mark it clean.
+     */
+    bool save(SpectrumWriteCallback write, void *ctx);
+
+    /**
+     * @return false if the file is not a valid index; the table is then empty
+     */
+    bool load(SpectrumReadCallback read, void *ctx);
+
+    /**
+     * @brief Whether the table differs from what was last saved or loaded.
+     */
+    bool dirty(void) const
+    {
+        return _dirty;
+    }
+
+    /**
+     * @brief Changes whenever the table is replaced, i.e. whenever file numbers and `path()` pointers may have changed.
+     */
+    uint32_t generation(void) const
+    {
+        return _generation;
+    }
+
+    size_t size(void) const
+    {
+        return _tables.files.count;
+    }
+
+    /**
+     * @brief Full path of file `i`, valid until the next `refresh()`, `load()` or `clear()`.
+     */
+    const char *path(size_t i) const
+    {
+        return _tables.arena.data + _tables.files.data[i].path;
+    }
+
+    /**
+     * @brief Base name of file `i`, pointing into `path(i)`.
+     */
+    const char *name(size_t i) const
+    {
+        return path(i) + _tables.files.data[i].name;
+    }
+
+    uint64_t fileSize(size_t i) const
+    {
+        return _tables.files.data[i].size;
+    }
+
+    int64_t mtime(size_t i) const
+    {
+        return _tables.files.data[i].mtime;
+    }
+
+    size_t pageCount(size_t per_page) const
+    {
+        return (_tables.files.count + per_page - 1) / per_page;
+    }
+
+    /**
+     * @brief First file and number of files on page `page`.
+     */
+    size_t page(size_t page, size_t per_page, size_t &first) const
+    {
+        first = page * per_page;
+        if (first >= _tables.files.count) {
+            first = _tables.files.count;
+            return 0;
+        }
+        return (_tables.files.count - first < per_page) ? _tables.files.count - first : per_page;
+    }
+
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    struct Dir {
+        uint32_t path;          // Offset in the arena
+        uint32_t parent;        // Index in the dir table, NONE for the root
+        int64_t mtime;
+        uint32_t first_file;
+        uint32_t file_count;
+    };
+
+    struct File {
+        uint32_t path;          // Offset in the arena
+        uint32_t name;          // Offset of the base name within the path
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    // Grow-only array in spectrum_malloc() memory
+    template <typename T>
+    struct Table {
+        T *data;
+        size_t count;
+        size_t capacity;
+
+        bool reserve(size_t n);
+        bool push(const T &value)
+        {
+            if ((count == capacity) && !reserve((capacity < 16) ? 16 : capacity * 2)) {
+                return false;
+            }
+            data[count++] = value;
+            return true;
+        }
+        void release(void);
+    };
+
+    struct Tables {
+        Table<Dir> dirs;
+        Table<File> files;
+        Table<char> arena;
+
+        void clear(void)
+        {
+            dirs.count = 0;
+            files.count = 0;
+            arena.count = 0;
+        }
+        void release(void)
+        {
+            dirs.release();
+            files.release();
+            arena.release();
+        }
+    };
+
+    struct Scan;
+
+    static bool visitEntry(const SpectrumDirEntry &entry, void *visit_ctx);
+    static uint32_t addString(Tables &tables, const char *dir, const char *name);
+    static bool scanDir(Scan &scan, uint32_t dir, uint32_t old_dir);
+
+    Tables _tables;
+    Tables _next;               // Built by `refresh()` from `_tables`, swapped with it when complete
+    uint32_t _generation;
+    bool _dirty;
+};
+
+#define SPECTRUM_FILE_FILTER_QUERY_MAX  (64)
+
+/**
+ * Type-ahead filter over a `SpectrumFileIndex`: the files whose name contains the query, ignoring case, in index
+ * order. Typing one more character only re-checks the files that matched the shorter query, so narrowing costs
+ * O(matches) instead of O(files); anything else (deleting, editing, a refreshed index) filters from scratch.
+ */
+class SpectrumFileFilter {
+public:
+    SpectrumFileFilter();
+    ~SpectrumFileFilter();
+
+    SpectrumFileFilter(const SpectrumFileFilter &) = delete;
+    SpectrumFileFilter &operator=(const SpectrumFileFilter &) = delete;
+
+    /**
+     * @return false if memory ran out; the filter then matches every file
+     */
+    bool update(const SpectrumFileIndex &index, const char *query);
+
+    size_t size(void) const
+    {
+        return _all ? _total : _count;
+    }
+
+    /**
+     * @brief Index number of match `i`.
+     */
+    size_t at(size_t i) const
+    {
+        return _all ? i : _matches[i];
+    }
+
+    /**
+     * @brief Files checked by the last `update()`, to see the incremental path at work.
+     */
+    size_t checked(void) const
+    {
+        return _checked;
+    }
+
+private:
+    uint32_t *_matches;
+    size_t _count;
+    size_t _capacity;
+    size_t _total;
+    size_t _checked;
+    uint32_t _generation;
+    bool _all;                  // Empty query, `at()` is the identity
+    char _query[SPECTRUM_FILE_FILTER_QUERY_MAX];
+};
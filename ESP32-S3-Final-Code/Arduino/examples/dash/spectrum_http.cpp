@@ -0,0 +1,837 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#if defined(ARDUINO)
+#include "lwip/sockets.h"
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+#include "spectrum_port.h"
+#include "spectrum_http.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL    (0)     // lwIP never raises SIGPIPE
+#endif
+
+enum ConnectionState : uint8_t {
+    CONNECTION_FREE,
+    CONNECTION_READING,         // Waiting for (the rest of) a request
+    CONNECTION_WRITING,         // Sending a response
+    CONNECTION_CLOSING,         // Response sent, draining input until the client closes its side
+};
+
+struct SpectrumHttpServer::Connection {
+    int fd;
+    ConnectionState state;
+    uint32_t last_active;       // spectrum_time_us() of the last progress, for the timeouts
+
+    // Request, parsed in place in `in`
+    SpectrumHttpRequest request;
+    size_t in_length;
+    size_t scan;                // Where the search for the end of the head resumes
+    size_t line_start;
+    size_t head_length;         // 0 until the blank line after the headers has been received
+    size_t content_length;
+    bool http11;
+    bool keep_alive;
+
+    // Response, sent from `out[out_pos, out_end)`
+    size_t out_pos;
+    size_t out_end;
+    bool head_only;
+    bool chunked;
+    bool stream_done;
+    const uint8_t *static_body;     // Rest of a `writeStatic()` body, sent once `out` is drained
+    size_t static_left;
+    SpectrumHttpBodyCallback stream;
+    SpectrumHttpStreamEndCallback stream_end;
+    void *stream_ctx;
+
+    alignas(8) uint8_t state_data[SPECTRUM_HTTP_STATE_MAX];
+    char in[SPECTRUM_HTTP_REQUEST_MAX];
+    // The head is written right before the body so the two go out in one send
+    char out[SPECTRUM_HTTP_HEAD_MAX + SPECTRUM_HTTP_BODY_MAX];
+};
+
+static const char *reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Content Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return (status < 400) ? "OK" : "Error";
+    }
+}
+
+// Whether comma-separated header value `value` contains `token`, ignoring case
+static bool hasToken(const char *value, const char *token)
+{
+    size_t length = strlen(token);
+    while (*value != '\0') {
+        while ((*value == ' ') || (*value == '\t') || (*value == ',')) {
+            value++;
+        }
+        const char *end = value;
+        while ((*end != '\0') && (*end != ',')) {
+            end++;
+        }
+        const char *last = end;
+        while ((last > value) && ((last[-1] == ' ') || (last[-1] == '\t'))) {
+            last--;
+        }
+        if (((size_t)(last - value) == length) && (strncasecmp(value, token, length) == 0)) {
+            return true;
+        }
+        value = end;
+    }
+    return false;
+}
+
+static bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return (flags >= 0) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0);
+}
+
+static bool wouldBlock(void)
+{
+    return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+}
+
+const char *SpectrumHttpRequest::header(const char *name) const
+{
+    size_t length = strlen(name);
+    const char *line = _headers;
+    while (line < _headers_end) {
+        if (*line == '\0') {
+            line++;
+            continue;
+        }
+        const char *colon = strchr(line, ':');
+        if ((colon != nullptr) && ((size_t)(colon - line) == length) && (strncasecmp(line, name, length) == 0)) {
+            const char *value = colon + 1;
+            while ((*value == ' ') || (*value == '\t')) {
+                value++;
+            }
+            return value;
+        }
+        line += strlen(line);
+    }
+    return nullptr;
+}
+
+bool SpectrumHttpRequest::notModified(const char *etag) const
+{
+    const char *match = header("If-None-Match");
+    return (match != nullptr) && ((strcmp(match, "*") == 0) || hasToken(match, etag));
+}
+
+SpectrumHttpResponse::SpectrumHttpResponse(char *body, void *state):
+    _status(200),
+    _headers(),
+    _headers_length(0),
+    _body(body),
+    _body_length(0),
+    _overflow(false),
+    _static_body(nullptr),
+    _static_length(0),
+    _state(state),
+    _stream(nullptr),
+    _stream_end(nullptr),
+    _stream_ctx(nullptr)
+{
+}
+
+bool SpectrumHttpResponse::addHeader(const char *name, const char *value)
+{
+    size_t room = sizeof(_headers) - _headers_length;
+    int length = snprintf(_headers + _headers_length, room, "%s: %s\r\n", name, value);
+    if ((length < 0) || ((size_t)length >= room)) {
+        _headers[_headers_length] = '\0';
+        return false;
+    }
+    _headers_length += length;
+    return true;
+}
+
+bool SpectrumHttpResponse::write(const void *data, size_t length)
+{
+    if ((_stream != nullptr) || (length > SPECTRUM_HTTP_BODY_MAX - _body_length)) {
+        _overflow = true;
+        return false;
+    }
+    memcpy(_body + _body_length, data, length);
+    _body_length += length;
+    return true;
+}
+
+bool SpectrumHttpResponse::print(const char *text)
+{
+    return write(text, strlen(text));
+}
+
+bool SpectrumHttpResponse::printf(const char *format, ...)
+{
+    if (_stream != nullptr) {
+        _overflow = true;
+        return false;
+    }
+    size_t room = SPECTRUM_HTTP_BODY_MAX - _body_length;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(_body + _body_length, room, format, args);
+    va_end(args);
+    if ((length < 0) || ((size_t)length >= room)) {
+        _overflow = true;
+        return false;
+    }
+    _body_length += length;
+    return true;
+}
+
+void SpectrumHttpResponse::writeStatic(const void *data, size_t length)
+{
+    _static_body = static_cast<const uint8_t *>(data);
+    _static_length = length;
+    _stream = nullptr;
+    _body_length = 0;
+}
+
+void *SpectrumHttpResponse::stream(SpectrumHttpBodyCallback body, void *ctx, size_t state_size,
+                                   SpectrumHttpStreamEndCallback end)
+{
+    if (state_size > SPECTRUM_HTTP_STATE_MAX) {
+        return nullptr;
+    }
+    memset(_state, 0, state_size);
+    _stream = body;
+    _stream_end = end;
+    _stream_ctx = ctx;
+    _static_body = nullptr;
+    _body_length = 0;
+    return _state;
+}
+
+SpectrumHttpServer::SpectrumHttpServer():
+    _listen_fd(-1),
+    _port(0),
+    _handler(nullptr),
+    _ctx(nullptr),
+    _connections(nullptr),
+    _stats()
+{
+}
+
+SpectrumHttpServer::~SpectrumHttpServer()
+{
+    end();
+}
+
+bool SpectrumHttpServer::begin(uint16_t port, SpectrumHttpHandler handler, void *ctx)
+{
+    if (_listen_fd >= 0) {
+        return true;
+    }
+
+    _connections = static_cast<Connection *>(spectrum_malloc(sizeof(Connection) * SPECTRUM_HTTP_MAX_CONNECTIONS));
+    if (_connections == nullptr) {
+        return false;
+    }
+    memset(_connections, 0, sizeof(Connection) * SPECTRUM_HTTP_MAX_CONNECTIONS);
+    for (int i = 0; i < SPECTRUM_HTTP_MAX_CONNECTIONS; i++) {
+        _connections[i].fd = -1;
+        _connections[i].state = CONNECTION_FREE;
+    }
+
+    _listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    bool ok = (_listen_fd >= 0);
+    if (ok) {
+        int one = 1;
+        setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        socklen_t addr_length = sizeof(addr);
+        ok = (bind(_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) &&
+             (listen(_listen_fd, SPECTRUM_HTTP_BACKLOG) == 0) && setNonBlocking(_listen_fd) &&
+             (getsockname(_listen_fd, (struct sockaddr *)&addr, &addr_length) == 0);
+        _port = ntohs(addr.sin_port);
+    }
+    if (!ok) {
+        end();
+        return false;
+    }
+
+    _handler = handler;
+    _ctx = ctx;
+    _stats = SpectrumHttpStats();
+    return true;
+}
+
+void SpectrumHttpServer::end(void)
+{
+    if (_connections != nullptr) {
+        for (int i = 0; i < SPECTRUM_HTTP_MAX_CONNECTIONS; i++) {
+            if (_connections[i].state != CONNECTION_FREE) {
+                closeConnection(_connections[i]);
+            }
+        }
+        spectrum_free(_connections);
+        _connections = nullptr;
+    }
+    if (_listen_fd >= 0) {
+        close(_listen_fd);
+        _listen_fd = -1;
+    }
+    _port = 0;
+}
+
+void SpectrumHttpServer::handleClients(void)
+{
+    if (_listen_fd < 0) {
+        return;
+    }
+
+    uint32_t start = spectrum_time_us();
+    acceptConnections(start);
+    for (int i = 0; i < SPECTRUM_HTTP_MAX_CONNECTIONS; i++) {
+        if (_connections[i].state != CONNECTION_FREE) {
+            serve(_connections[i], spectrum_time_us());
+        }
+    }
+
+    uint32_t elapsed = spectrum_time_us() - start;
+    _stats.max_handle_us = (elapsed > _stats.max_handle_us) ? elapsed : _stats.max_handle_us;
+}
+
+void SpectrumHttpServer::acceptConnections(uint32_t now)
+{
+    for (;;) {
+        // With the pool full, only accept if an idle keep-alive connection can make room
+        Connection *slot = nullptr;
+        Connection *victim = nullptr;
+        for (int i = 0; (i < SPECTRUM_HTTP_MAX_CONNECTIONS) && (slot == nullptr); i++) {
+            Connection &conn = _connections[i];
+            if (conn.state == CONNECTION_FREE) {
+                slot = &conn;
+            } else if ((conn.state == CONNECTION_READING) && (conn.in_length == 0) &&
+                       ((victim == nullptr) || (now - conn.last_active > now - victim->last_active))) {
+                victim = &conn;
+            }
+        }
+        if ((slot == nullptr) && (victim == nullptr)) {
+            return;
+        }
+
+        int fd = accept(_listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        if (!setNonBlocking(fd)) {
+            close(fd);
+            continue;
+        }
+        // Responses are written whole, there is nothing for Nagle's algorithm to coalesce
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (slot == nullptr) {
+            closeConnection(*victim);
+            _stats.evicted++;
+            slot = victim;
+        }
+        slot->fd = fd;
+        slot->state = CONNECTION_READING;
+        slot->last_active = now;
+        slot->in_length = 0;
+        slot->scan = 0;
+        slot->line_start = 0;
+        slot->head_length = 0;
+        slot->stream = nullptr;
+        slot->static_left = 0;
+        _stats.accepted++;
+        _stats.active++;
+    }
+}
+
+void SpectrumHttpServer::serve(Connection &conn, uint32_t now)
+{
+    if (conn.state == CONNECTION_READING) {
+        int status = parseRequest(conn);
+        if (status < 0) {
+            if (receive(conn, now)) {
+                status = parseRequest(conn);
+            }
+            if (conn.state == CONNECTION_FREE) {
+                return;
+            }
+        }
+        if (status < 0) {
+            uint32_t timeout = (conn.in_length == 0) ? SPECTRUM_HTTP_IDLE_TIMEOUT_MS : SPECTRUM_HTTP_IO_TIMEOUT_MS;
+            if (now - conn.last_active >= timeout * 1000u) {
+                _stats.timeouts++;
+                closeConnection(conn);
+            }
+            return;
+        }
+        if (status == 0) {
+            respond(conn);
+        } else {
+            respondError(conn, status);
+        }
+    }
+
+    if (conn.state == CONNECTION_WRITING) {
+        writeOut(conn, now);
+        if ((conn.state == CONNECTION_WRITING) && (now - conn.last_active >= SPECTRUM_HTTP_IO_TIMEOUT_MS * 1000u)) {
+            _stats.timeouts++;
+            closeConnection(conn);
+        }
+        return;
+    }
+
+    if (conn.state == CONNECTION_CLOSING) {
+        // Closing with unread input would reset the connection and could destroy the response in flight
+        ssize_t n = recv(conn.fd, conn.in, sizeof(conn.in), 0);
+        if ((n == 0) || ((n < 0) && !wouldBlock()) ||
+            (now - conn.last_active >= SPECTRUM_HTTP_IO_TIMEOUT_MS * 1000u)) {
+            closeConnection(conn);
+        }
+    }
+}
+
+bool SpectrumHttpServer::receive(Connection &conn, uint32_t now)
+{
+    size_t room = sizeof(conn.in) - conn.in_length;
+    if (room == 0) {
+        return false;
+    }
+    ssize_t n = recv(conn.fd, conn.in + conn.in_length, room, 0);
+    if (n > 0) {
+        conn.in_length += n;
+        conn.last_active = now;
+        return true;
+    }
+    if ((n == 0) || !wouldBlock()) {
+        closeConnection(conn);
+    }
+    return false;
+}
+
+int SpectrumHttpServer::parseRequest(Connection &conn)
+{
+    if (conn.head_length == 0) {
+        while (conn.scan < conn.in_length) {
+            size_t i = conn.scan++;
+            if (conn.in[i] != '\n') {
+                continue;
+            }
+            size_t line_length = i - conn.line_start;
+            bool empty = (line_length == 0) || ((line_length == 1) && (conn.in[conn.line_start] == '\r'));
+            if (empty && (conn.line_start == 0)) {
+                // Stray line break before a request (e.g. after a POST body), drop it
+                conn.in_length -= i + 1;
+                memmove(conn.in, conn.in + i + 1, conn.in_length);
+                conn.scan = 0;
+                continue;
+            }
+            conn.line_start = i + 1;
+            if (empty) {
+                conn.head_length = i + 1;
+                int status = parseHead(conn);
+                if (status != 0) {
+                    return status;
+                }
+                break;
+            }
+        }
+        if (conn.head_length == 0) {
+            return (conn.in_length == sizeof(conn.in)) ? 431 : -1;
+        }
+    }
+
+    if (conn.content_length > sizeof(conn.in) - conn.head_length) {
+        return 413;
+    }
+    return (conn.in_length < conn.head_length + conn.content_length) ? -1 : 0;
+}
+
+// Split the head in `in[0, head_length)` into the request line and headers, in place
+int SpectrumHttpServer::parseHead(Connection &conn)
+{
+    char *head = conn.in;
+    char *end = conn.in + conn.head_length;
+    for (char *p = head; p < end; p++) {
+        if ((*p == '\r') || (*p == '\n')) {
+            *p = '\0';
+        }
+    }
+
+    SpectrumHttpRequest &request = conn.request;
+    char *method = head;
+    char *target = strchr(method, ' ');
+    char *version = (target != nullptr) ? strchr(target + 1, ' ') : nullptr;
+    if (version == nullptr) {
+        return 400;
+    }
+    *target++ = '\0';
+    *version++ = '\0';
+    if ((*target != '/') || (strncmp(version, "HTTP/1.", 7) != 0)) {
+        return 400;
+    }
+    conn.http11 = (strcmp(version, "HTTP/1.0") != 0);
+
+    if (strcmp(method, "GET") == 0) {
+        request.method = SPECTRUM_HTTP_GET;
+    } else if (strcmp(method, "HEAD") == 0) {
+        request.method = SPECTRUM_HTTP_HEAD;
+    } else if (strcmp(method, "POST") == 0) {
+        request.method = SPECTRUM_HTTP_POST;
+    } else {
+        request.method = SPECTRUM_HTTP_OTHER;
+    }
+    char *query = strchr(target, '?');
+    if (query != nullptr) {
+        *query++ = '\0';
+    }
+    request.path = target;
+    request.query = (query != nullptr) ? query : "";
+    request._headers = version + strlen(version);
+    request._headers_end = end;
+
+    // Trim the values and pick out the headers that matter to the connection itself
+    conn.content_length = 0;
+    conn.keep_alive = conn.http11;
+    for (char *line = version + strlen(version); line < end; line++) {
+        if (*line == '\0') {
+            continue;
+        }
+        size_t length = strlen(line);
+        char *last = line + length;
+        while ((last > line) && ((last[-1] == ' ') || (last[-1] == '\t'))) {
+            *--last = '\0';
+        }
+        char *colon = strchr(line, ':');
+        if (colon == nullptr) {
+            return 400;
+        }
+        const char *value = colon + 1;
+        while ((*value == ' ') || (*value == '\t')) {
+            value++;
+        }
+        size_t name_length = colon - line;
+        if ((name_length == 14) && (strncasecmp(line, "Content-Length", 14) == 0)) {
+            char *digits_end;
+            unsigned long content_length = strtoul(value, &digits_end, 10);
+            if ((*value < '0') || (*value > '9') || (*digits_end != '\0')) {
+                return 400;
+            }
+            conn.content_length = (content_length > SPECTRUM_HTTP_REQUEST_MAX) ? SPECTRUM_HTTP_REQUEST_MAX + 1 :
+                                  content_length;
+        } else if ((name_length == 17) && (strncasecmp(line, "Transfer-Encoding", 17) == 0)) {
+            return 501;     // Chunked request bodies are not needed by anything served here
+        } else if ((name_length == 10) && (strncasecmp(line, "Connection", 10) == 0)) {
+            if (hasToken(value, "close")) {
+                conn.keep_alive = false;
+            } else if (hasToken(value, "keep-alive")) {
+                conn.keep_alive = true;
+            }
+        }
+        line += length;
+    }
+
+    request.body = end;
+    request.body_length = conn.content_length;
+    request.keep_alive = conn.keep_alive;
+    return 0;
+}
+
+void SpectrumHttpServer::respond(Connection &conn)
+{
+    if (conn.request.method == SPECTRUM_HTTP_OTHER) {
+        respondError(conn, 501);
+        return;
+    }
+
+    SpectrumHttpResponse response(conn.out + SPECTRUM_HTTP_HEAD_MAX, conn.state_data);
+    _handler(conn.request, response, _ctx);
+    if (response._overflow) {
+        if ((response._stream != nullptr) && (response._stream_end != nullptr)) {
+            response._stream_end(response._stream_ctx, conn.state_data);
+        }
+        respondError(conn, 500);
+        return;
+    }
+
+    conn.head_only = (conn.request.method == SPECTRUM_HTTP_HEAD) || (response._status == 204) ||
+                     (response._status == 304);
+    conn.stream = response._stream;
+    conn.stream_end = response._stream_end;
+    conn.stream_ctx = response._stream_ctx;
+    conn.stream_done = (conn.stream == nullptr) || conn.head_only;
+    // HTTP/1.0 clients do not understand chunks, the end of a streamed body is the end of the connection
+    conn.chunked = (conn.stream != nullptr) && conn.http11;
+    if ((conn.stream != nullptr) && !conn.http11) {
+        conn.keep_alive = false;
+    }
+
+    conn.static_left = 0;
+    if (response._static_body != nullptr) {
+        // As much as fits goes out with the head, the rest straight from where it is
+        size_t length = response._static_length;
+        response._body_length = (length < SPECTRUM_HTTP_BODY_MAX) ? length : SPECTRUM_HTTP_BODY_MAX;
+        memcpy(response._body, response._static_body, response._body_length);
+        conn.static_body = response._static_body + response._body_length;
+        conn.static_left = conn.head_only ? 0 : length - response._body_length;
+        finishHead(conn, response, length);
+    } else {
+        finishHead(conn, response, response._body_length);
+    }
+    if (conn.stream == nullptr) {
+        conn.out_end = SPECTRUM_HTTP_HEAD_MAX + (conn.head_only ? 0 : response._body_length);
+    } else if (!conn.stream_done) {
+        fillChunk(conn, SPECTRUM_HTTP_HEAD_MAX);
+    }
+}
+
+void SpectrumHttpServer::respondError(Connection &conn, int status)
+{
+    _stats.errors++;
+    conn.keep_alive = false;
+    conn.head_only = false;
+    conn.stream = nullptr;
+    conn.stream_done = true;
+    conn.chunked = false;
+    conn.static_left = 0;
+
+    SpectrumHttpResponse response(conn.out + SPECTRUM_HTTP_HEAD_MAX, conn.state_data);
+    response.setStatus(status);
+    response.addHeader("Content-Type", "text/plain");
+    response.printf("%d %s\n", status, reasonPhrase(status));
+    finishHead(conn, response, response._body_length);
+    conn.out_end = SPECTRUM_HTTP_HEAD_MAX + response._body_length;
+}
+
+// Write the status line and headers so that they end where the body starts, and start sending
+void SpectrumHttpServer::finishHead(Connection &conn, SpectrumHttpResponse &response, size_t body_length)
+{
+    char head[SPECTRUM_HTTP_HEAD_MAX];
+    int length = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\n%s", response._status,
+                          reasonPhrase(response._status), response._headers);
+    if (conn.chunked) {
+        length += snprintf(head + length, sizeof(head) - length, "Transfer-Encoding: chunked\r\n");
+    } else if ((conn.stream == nullptr) && (response._status != 204) && (response._status != 304)) {
+        length += snprintf(head + length, sizeof(head) - length, "Content-Length: %u\r\n", (unsigned)body_length);
+    }
+    length += snprintf(head + length, sizeof(head) - length, "Connection: %s\r\n\r\n",
+                       conn.keep_alive ? "keep-alive" : "close");
+
+    memcpy(conn.out + SPECTRUM_HTTP_HEAD_MAX - length, head, length);
+    conn.out_pos = SPECTRUM_HTTP_HEAD_MAX - length;
+    conn.out_end = SPECTRUM_HTTP_HEAD_MAX;
+    conn.state = CONNECTION_WRITING;
+}
+
+// Ask the body callback for the next piece and frame it at `out + start`
+bool SpectrumHttpServer::fillChunk(Connection &conn, size_t start)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    static const char LAST_CHUNK[] = "0\r\n\r\n";
+    const size_t size_length = 6 + 2;       // Six hex digits and CRLF, enough for any chunk that fits in `out`
+    const size_t trailer_length = 2 + sizeof(LAST_CHUNK) - 1;
+
+    char *frame = conn.out + start;
+    size_t room = sizeof(conn.out) - start;
+    char *payload = conn.chunked ? frame + size_length : frame;
+    size_t payload_room = conn.chunked ? room - size_length - trailer_length : room;
+
+    bool done = false;
+    size_t n = conn.stream(conn.stream_ctx, conn.state_data, payload, payload_room, done);
+    n = (n > payload_room) ? payload_room : n;
+    conn.stream_done = done;
+
+    size_t length = n;
+    if (conn.chunked) {
+        length = 0;
+        if (n > 0) {
+            for (int i = 0; i < 6; i++) {
+                frame[i] = hex_digits[(n >> (4 * (5 - i))) & 0xF];
+            }
+            memcpy(frame + 6, "\r\n", 2);
+            memcpy(payload + n, "\r\n", 2);
+            length = size_length + n + 2;
+        }
+        if (done) {
+            memcpy(frame + length, LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+            length += sizeof(LAST_CHUNK) - 1;
+        }
+    }
+    conn.out_end = start + length;
+    return length > 0;
+}
+
+void SpectrumHttpServer::writeOut(Connection &conn, uint32_t now)
+{
+    size_t budget = SPECTRUM_HTTP_POLL_BUDGET;
+    while (budget > 0) {
+        if ((conn.out_pos == conn.out_end) && (conn.static_left > 0)) {
+            size_t length = (conn.static_left > budget) ? budget : conn.static_left;
+            ssize_t n = ::send(conn.fd, conn.static_body, length, MSG_NOSIGNAL);
+            if (n <= 0) {
+                if ((n < 0) && !wouldBlock()) {
+                    closeConnection(conn);
+                }
+                return;
+            }
+            conn.static_body += n;
+            conn.static_left -= n;
+            budget -= n;
+            conn.last_active = now;
+            continue;
+        }
+        if (conn.out_pos == conn.out_end) {
+            if (conn.stream_done) {
+                finishResponse(conn, now);
+                return;
+            }
+            conn.out_pos = 0;
+            if (!fillChunk(conn, 0)) {
+                // Nothing to send yet: not a stall, but notice if the client went away in the meantime
+                char c;
+                ssize_t n = recv(conn.fd, &c, 1, MSG_PEEK);
+                if ((n == 0) || ((n < 0) && !wouldBlock())) {
+                    closeConnection(conn);
+                    return;
+                }
+                conn.last_active = now;
+                return;
+            }
+            continue;
+        }
+
+        size_t length = conn.out_end - conn.out_pos;
+        length = (length > budget) ? budget : length;
+        ssize_t n = ::send(conn.fd, conn.out + conn.out_pos, length, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out_pos += n;
+            budget -= n;
+            conn.last_active = now;
+        } else {
+            if ((n < 0) && !wouldBlock()) {
+                closeConnection(conn);
+            }
+            return;
+        }
+    }
+}
+
+void SpectrumHttpServer::finishResponse(Connection &conn, uint32_t now)
+{
+    _stats.requests++;
+    endStream(conn);
+    conn.last_active = now;
+    if (!conn.keep_alive) {
+        shutdown(conn.fd, SHUT_WR);
+        conn.state = CONNECTION_CLOSING;
+        return;
+    }
+
+    // Keep whatever the client pipelined after this request
+    size_t used = conn.head_length + conn.content_length;
+    conn.in_length -= used;
+    memmove(conn.in, conn.in + used, conn.in_length);
+    conn.scan = 0;
+    conn.line_start = 0;
+    conn.head_length = 0;
+    conn.content_length = 0;
+    conn.state = CONNECTION_READING;
+}
+
+void SpectrumHttpServer::endStream(Connection &conn)
+{
+    if ((conn.stream != nullptr) && (conn.stream_end != nullptr)) {
+        conn.stream_end(conn.stream_ctx, conn.state_data);
+    }
+    conn.stream = nullptr;
+}
+
+void SpectrumHttpServer::closeConnection(Connection &conn)
+{
+    endStream(conn);
+    close(conn.fd);
+    conn.fd = -1;
+    conn.state = CONNECTION_FREE;
+    _stats.active--;
+}
+
+bool spectrum_http_form_text(const char *form, size_t length, const char *name, char *value, size_t size)
+{
+    size_t name_length = strlen(name);
+    const char *end = form + length;
+    const char *pair = form;
+    while (pair < end) {
+        const char *pair_end = static_cast<const char *>(memchr(pair, '&', end - pair));
+        pair_end = (pair_end != nullptr) ? pair_end : end;
+        if (((size_t)(pair_end - pair) > name_length) && (memcmp(pair, name, name_length) == 0) &&
+            (pair[name_length] == '=')) {
+            const char *start = pair + name_length + 1;
+            size_t value_length = pair_end - start;
+            if (value_length >= size) {
+                return false;
+            }
+            memcpy(value, start, value_length);
+            value[value_length] = '\0';
+            return true;
+        }
+        pair = pair_end + 1;
+    }
+    return false;
+}
+
+bool spectrum_http_form_int(const char *form, size_t length, const char *name, long &value)
+{
+    char text[24];
+    if (!spectrum_http_form_text(form, length, name, text, sizeof(text)) || (text[0] == '\0')) {
+        return false;
+    }
+    char *text_end;
+    long parsed = strtol(text, &text_end, 10);
+    if (*text_end != '\0') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool spectrum_http_form_float(const char *form, size_t length, const char *name, double &value)
+{
+    char text[32];
+    if (!spectrum_http_form_text(form, length, name, text, sizeof(text)) || (text[0] == '\0')) {
+        return false;
+    }
+    char *text_end;
+    double parsed = strtod(text, &text_end);
+    if (*text_end != '\0') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
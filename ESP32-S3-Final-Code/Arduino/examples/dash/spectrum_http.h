@@ -0,0 +1,237 @@
+/*
+ * Non-blocking HTTP/1.1 server for the web page, polled from `loop()`. Handlers run inside `handleClients()`, so the
+ * sketch holds the LVGL lock around it: they read the loaded spectrum and drive widgets, both owned by the LVGL task.
+ *
+ * Every socket is non-blocking and `handleClients()` does a bounded amount of work per connection (one read, at most
+ * `SPECTRUM_HTTP_POLL_BUDGET` bytes written), so a slow or silent browser can never hold up the UI. Connections come
+ * from a fixed pool allocated once by `begin()`; each one parses its request incrementally into a fixed input buffer
+ * and writes its response from a fixed output buffer, so serving a request allocates nothing.
+ *
+ * Connections are kept alive between requests (pipelined requests are answered in order) until the client closes
+ * them, they stay idle for `SPECTRUM_HTTP_IDLE_TIMEOUT_MS`, or they make no progress for `SPECTRUM_HTTP_IO_TIMEOUT_MS`
+ * in the middle of a request. When the pool is full, the connection that has been idle the longest makes room.
+ *
+ * Bodies that fit in the output buffer are sent with a Content-Length, and so are constant ones of any size, which are
+ * sent from where they are (`writeStatic()`). Others are produced piece by piece by a `SpectrumHttpBodyCallback` as
+ * the socket drains and sent with chunked transfer encoding.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPECTRUM_HTTP_MAX_CONNECTIONS   (8)     // lwIP allows 16 sockets, the listener takes one
+#define SPECTRUM_HTTP_REQUEST_MAX       (2048)  // Request line, headers and body of one request
+#define SPECTRUM_HTTP_HEAD_MAX          (512)   // Status line and headers of one response
+#define SPECTRUM_HTTP_BODY_MAX          (4096)  // Body sent with a Content-Length, or one chunk of a streamed one
+#define SPECTRUM_HTTP_STATE_MAX         (64)    // Per-response state of a streamed body
+#define SPECTRUM_HTTP_POLL_BUDGET       (32 * 1024)
+#define SPECTRUM_HTTP_IDLE_TIMEOUT_MS   (5000)  // Keep-alive connection without a request
+#define SPECTRUM_HTTP_IO_TIMEOUT_MS     (2000)  // Request half received, or response not draining
+#define SPECTRUM_HTTP_BACKLOG           (4)
+
+enum SpectrumHttpMethod : uint8_t {
+    SPECTRUM_HTTP_GET,
+    SPECTRUM_HTTP_HEAD,
+    SPECTRUM_HTTP_POST,
+    SPECTRUM_HTTP_OTHER,
+};
+
+/**
+ * @brief A parsed request. The strings point into the connection's input buffer and are only valid during the call
+ *        to the handler.
+ */
+struct SpectrumHttpRequest {
+    SpectrumHttpMethod method;
+    const char *path;           // Target without the query, e.g. "/api/spectrum"
+    const char *query;          // After the '?', "" if there is none
+    const char *body;           // Not NUL-terminated
+    size_t body_length;
+    bool keep_alive;
+
+    /**
+     * @brief Value of header `name` (case-insensitive), without surrounding spaces.
+     *
+     * @return nullptr if the request does not have it
+     */
+    const char *header(const char *name) const;
+
+    /**
+     * @brief Whether the client's If-None-Match already names `etag` (quotes included), i.e. a 304 will do.
+     */
+    bool notModified(const char *etag) const;
+
+private:
+    friend class SpectrumHttpServer;
+
+    const char *_headers;       // Header lines, NUL-terminated, with the line breaks turned into NULs as well
+    const char *_headers_end;
+};
+
+/**
+ * @brief Produce the next piece of a streamed body into `buffer`. `state` is the zero-initialised storage returned by
+ *        `SpectrumHttpResponse::stream()`, private to this response. Set `done` once the body is complete (possibly
+ *        along with the last bytes); returning 0 without `done` means nothing is ready yet, ask again on the next
+ *        `handleClients()`.
+ *
+ * @return Bytes written, at most `size`
+ */
+typedef size_t (*SpectrumHttpBodyCallback)(void *ctx, void *state, char *buffer, size_t size, bool &done);
+
+/**
+ * @brief Called once when a streamed response is over, whether it was sent in full or the connection dropped, e.g. to
+ *        release what the stream holds.
+ */
+typedef void (*SpectrumHttpStreamEndCallback)(void *ctx, void *state);
+
+/**
+ * @brief Response being built by a `SpectrumHttpHandler`. The status defaults to 200 and the body to empty.
+ */
+class SpectrumHttpResponse {
+public:
+    void setStatus(int status)
+    {
+        _status = status;
+    }
+
+    /**
+     * @return false if the headers no longer fit in `SPECTRUM_HTTP_HEAD_MAX`
+     */
+    bool addHeader(const char *name, const char *value);
+
+    /**
+     * @brief Append to the body.
+     *
+     * @return false if the body no longer fits in `SPECTRUM_HTTP_BODY_MAX`; the client then gets a 500
+     */
+    bool write(const void *data, size_t length);
+    bool print(const char *text);
+    bool printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    /**
+     * @brief Send the `length` bytes at `data` as the body, straight from where they are. They must outlive the
+     *        response, e.g. a const array in flash. Anything written before is discarded.
+     */
+    void writeStatic(const void *data, size_t length);
+
+    /**
+     * @brief Send the body from `body` instead, as the socket drains. Anything written before is discarded. `end`,
+     *        if given, is called with the same `ctx` and state once the response is over.
+     *
+     * @return `state_size` bytes of zeroed storage passed to every call of `body`, nullptr if `state_size` is larger
+     *         than `SPECTRUM_HTTP_STATE_MAX`
+     */
+    void *stream(SpectrumHttpBodyCallback body, void *ctx, size_t state_size = 0,
+                 SpectrumHttpStreamEndCallback end = nullptr);
+
+private:
+    friend class SpectrumHttpServer;
+
+    SpectrumHttpResponse(char *body, void *state);
+
+    int _status;
+    char _headers[SPECTRUM_HTTP_HEAD_MAX - 128];    // Leaves room for the status line and framing headers
+    size_t _headers_length;
+    char *_body;
+    size_t _body_length;
+    bool _overflow;
+    const uint8_t *_static_body;
+    size_t _static_length;
+    void *_state;
+    SpectrumHttpBodyCallback _stream;
+    SpectrumHttpStreamEndCallback _stream_end;
+    void *_stream_ctx;
+};
+
+typedef void (*SpectrumHttpHandler)(const SpectrumHttpRequest &request, SpectrumHttpResponse &response, void *ctx);
+
+struct SpectrumHttpStats {
+    uint32_t accepted;
+    uint32_t requests;          // Responses sent in full
+    uint32_t errors;            // Requests answered with an error by the server itself (400, 413, 431, 501...)
+    uint32_t timeouts;
+    uint32_t evicted;           // Idle connections closed to make room for a new one
+    uint32_t active;
+    uint32_t max_handle_us;     // Longest `handleClients()` so far
+};
+
+class SpectrumHttpServer {
+public:
+    SpectrumHttpServer();
+    ~SpectrumHttpServer();
+
+    SpectrumHttpServer(const SpectrumHttpServer &) = delete;
+    SpectrumHttpServer &operator=(const SpectrumHttpServer &) = delete;
+
+    /**
+     * @brief Allocate the connection pool and listen on `port` (0 picks a free one, see `port()`).
+     *
+     * @return false if the pool could not be allocated or the socket could not be set up
+     */
+    bool begin(uint16_t port, SpectrumHttpHandler handler, void *ctx);
+
+    /**
+     * @brief Close every connection and the listening socket, and release the pool.
+     */
+    void end(void);
+
+    /**
+     * @brief Accept, read, answer and write whatever can be done without waiting. The handler runs from here, so call
+     *        it holding whatever lock the handler's data needs.
+     */
+    void handleClients(void);
+
+    uint16_t port(void) const
+    {
+        return _port;
+    }
+
+    const SpectrumHttpStats &stats(void) const
+    {
+        return _stats;
+    }
+
+private:
+    struct Connection;
+
+    void acceptConnections(uint32_t now);
+    void serve(Connection &conn, uint32_t now);
+    bool receive(Connection &conn, uint32_t now);
+
+    /**
+     * @return 0 once the request is complete, -1 while more input is needed, or the status of an error response
+     */
+    int parseRequest(Connection &conn);
+    int parseHead(Connection &conn);
+    void respond(Connection &conn);
+    void respondError(Connection &conn, int status);
+    void finishHead(Connection &conn, SpectrumHttpResponse &response, size_t body_length);
+    bool fillChunk(Connection &conn, size_t start);
+    void writeOut(Connection &conn, uint32_t now);
+    void finishResponse(Connection &conn, uint32_t now);
+    void endStream(Connection &conn);
+    void closeConnection(Connection &conn);
+
+    int _listen_fd;
+    uint16_t _port;
+    SpectrumHttpHandler _handler;
+    void *_ctx;
+    Connection *_connections;
+    SpectrumHttpStats _stats;
+};
+
+/**
+ * @brief Find `name` in a form body or query string ("a=1&b=2") and copy its value to `value`, as
+ *        is (not URL-decoded).
+ *
+ * @return false if it is missing or does not fit in `size` bytes with its NUL
+ */
+bool spectrum_http_form_text(const char *form, size_t length, const char *name, char *value, size_t size);
+
+/**
+ * @brief Same, parsed as an integer or a decimal number.
+ *
+ * @return false if it is missing or not a number
+ */
+bool spectrum_http_form_int(const char *form, size_t length, const char *name, long &value);
+bool spectrum_http_form_float(const char *form, size_t length, const char *name, double &value);
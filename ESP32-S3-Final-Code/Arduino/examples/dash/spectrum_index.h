@@ -0,0 +1,219 @@
+/*
+ * Trapezoid prefix-sum index over a loaded spectrum.
+ *
+ * `prefix[k]` holds the area from sample 0 to sample k, so the area over any index range is one subtraction and a
+ * slider move costs the same on a 100-point and on a 1M-point spectrum.
+ *
+ * Ranges can also be given in wavenumbers: the x column is monotonic (ascending or descending), so a binary search
+ * maps a wavenumber to its segment and the partial trapezoids at both ends are interpolated.
+ *
+ * The table holds doubles, or Q32.32 sums with `SPECTRUM_NUMERIC_FIXED` (see spectrum_numeric.h). Queries answer in
+ * double either way, which costs a few operations per query rather than per sample.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "spectrum_numeric.h"
+
+/**
+ * Set to 1 (before including this header) to make the sketch cross-check every area query against a linear walk over
+ * the samples with `SpectrumIndex::verify()`. This costs O(n) per query again, so it is only meant for debugging.
+ */
+#ifndef SPECTRUM_INDEX_VERIFY
+#define SPECTRUM_INDEX_VERIFY       (0)
+#endif
+
+class SpectrumIndex {
+public:
+    SpectrumIndex();
+    ~SpectrumIndex();
+
+    /**
+     * @brief Build the prefix table in one pass. The sample arrays are not copied and must outlive the index.
+     *
+     * @return false if the table could not be allocated
+     */
+    template <typename T>
+    bool build(const T *x, const T *y, size_t count)
+    {
+        if (!reserve(count)) {
+            return false;
+        }
+        fill(x, y, 0, count);
+        attach(x, y, count);
+        return true;
+    }
+
+    /**
+     * @brief Add the samples appended since the last `build()` or `extend()`, e.g. as they arrive from the
+     *        spectrometer. O(new samples), amortised. The first `size()` samples must be unchanged, but the arrays may
+     *        have moved.
+     *
+     * @return false if the table could not be grown (the table is then left as it was)
+     */
+    template <typename T>
+    bool extend(const T *x, const T *y, size_t count)
+    {
+        if (count < _count) {
+            return build(x, y, count);
+        }
+        if (!grow(count)) {
+            return false;
+        }
+        fill(x, y, _count, count);
+        attach(x, y, count);
+        return true;
+    }
+
+    /**
+     * @brief Writable prefix table for `count` samples, e.g. to fill it from a sidecar cache instead of `build()`.
+     *        Call `attach()` once it has been filled.
+     *
+     * @return nullptr if the table could not be allocated
+     */
+    SpectrumPrefix *prefixBuffer(size_t count)
+    {
+        return reserve(count) ? _prefix : nullptr;
+    }
+
+    /**
+     * @brief Bind the sample arrays to a prefix table filled through `prefixBuffer()`.
+     */
+    template <typename T>
+    void attach(const T *x, const T *y, size_t count)
+    {
+        _count = count;
+        _sample = &SpectrumIndex::sampleAt<T>;
+        _x = x;
+        _y = y;
+        _descending = (count > 1) && ((double)x[count - 1] < (double)x[0]);
+    }
+
+    void clear(void);
+
+    /**
+     * @brief Exchange tables with `other`, together with the `SpectrumStore::swap()` of the samples they point into.
+     */
+    void swap(SpectrumIndex &other);
+
+    /**
+     * @brief Area between sample `lower` and sample `upper - 1`, matching the original `computeAreaUnderCurve()`
+     *        loop. Indices are clamped to the loaded range.
+     */
+    double area(int lower, int upper) const;
+
+    /**
+     * @brief The same area computed by walking the samples, for verification.
+     */
+    double areaLinear(int lower, int upper) const;
+
+    /**
+     * @brief Area under the curve between two wavenumbers, in either order. The range is clamped to the loaded x
+     *        span and partial trapezoids at both ends are linearly interpolated. O(log n).
+     */
+    double areaBetween(double x0, double x1) const;
+
+    /**
+     * @brief `areaBetween()` computed by scanning the samples, for verification.
+     */
+    double areaBetweenLinear(double x0, double x1) const;
+
+    /**
+     * @brief Index of the sample whose wavenumber is closest to `x`, -1 if nothing is loaded. O(log n).
+     */
+    int indexOf(double x) const;
+
+    /**
+     * @brief The curve at wavenumber `x`, linearly interpolated between the samples around it, with `x` clamped to
+     *        the loaded span. 0 if fewer than two samples are loaded. O(log n).
+     */
+    double valueAt(double x) const;
+
+    /**
+     * @brief Samples [from, to), in file order, with wavenumbers between `x0` and `x1` (in either order). O(log n).
+     *
+     * @return false if there is none
+     */
+    bool samplesBetween(double x0, double x1, size_t &from, size_t &to) const;
+
+    /**
+     * @brief Smallest and largest wavenumber of the loaded spectrum.
+     */
+    double minX(void) const;
+    double maxX(void) const;
+
+    bool descending(void) const
+    {
+        return _descending;
+    }
+
+    size_t size(void) const
+    {
+        return _count;
+    }
+
+    const SpectrumPrefix *prefix(void) const
+    {
+        return _prefix;
+    }
+
+    /**
+     * @brief Compare `area()` with `areaLinear()` for the same range.
+     *
+     * @param expected Optional, receives the linear result
+     *
+     * @return true if both agree within rounding, false otherwise (and the mismatch counter is incremented)
+     */
+    bool verify(int lower, int upper, double *expected) const;
+
+    /**
+     * @brief Number of queries whose linear result differed from the prefix result.
+     */
+    uint32_t mismatches(void) const
+    {
+        return _mismatches;
+    }
+
+private:
+    typedef double (*SampleFn)(const void *data, size_t i);
+
+    template <typename T>
+    static double sampleAt(const void *data, size_t i)
+    {
+        return (double)static_cast<const T *>(data)[i];
+    }
+
+    double x(size_t i) const
+    {
+        return _sample(_x, i);
+    }
+
+    double y(size_t i) const
+    {
+        return _sample(_y, i);
+    }
+
+    template <typename T>
+    void fill(const T *x, const T *y, size_t from, size_t count)
+    {
+        // Never in float whatever the samples are: the difference of two large sums would lose the area between
+        spectrumPrefixSum<SpectrumAreaType>(x, y, from, count, _prefix);
+    }
+
+    bool reserve(size_t count);
+    bool grow(size_t count);
+    bool clampRange(int lower, int upper, size_t &from, size_t &to) const;
+    size_t segmentOf(double x) const;
+    double cumulativeAt(double x) const;
+
+    SpectrumPrefix *_prefix;
+    size_t _count;
+    size_t _capacity;
+    const void *_x;
+    const void *_y;
+    SampleFn _sample;
+    bool _descending;
+    mutable uint32_t _mismatches;
+};
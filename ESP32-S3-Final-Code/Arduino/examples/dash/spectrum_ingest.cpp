@@ -0,0 +1,186 @@
+#include <string.h>
+#include "spectrum_ingest.h"
+
+uint16_t spectrumFrameCrc(const uint8_t *data, size_t length, uint16_t crc)
+{
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+size_t spectrumFrameEncode(uint8_t type, const void *payload, size_t length, uint8_t *out, size_t size)
+{
+    size_t total = SPECTRUM_FRAME_HEADER + length + SPECTRUM_FRAME_CRC;
+    if ((length > SPECTRUM_FRAME_PAYLOAD_MAX) || (total > size)) {
+        return 0;
+    }
+    out[0] = SPECTRUM_FRAME_SYNC_0;
+    out[1] = SPECTRUM_FRAME_SYNC_1;
+    out[2] = type;
+    out[3] = (uint8_t)length;
+    out[4] = (uint8_t)(length >> 8);
+    if (length > 0) {
+        memcpy(out + SPECTRUM_FRAME_HEADER, payload, length);
+    }
+    uint16_t crc = spectrumFrameCrc(out + 2, SPECTRUM_FRAME_HEADER - 2 + length);
+    out[SPECTRUM_FRAME_HEADER + length] = (uint8_t)crc;
+    out[SPECTRUM_FRAME_HEADER + length + 1] = (uint8_t)(crc >> 8);
+    return total;
+}
+
+SpectrumIngest::SpectrumIngest():
+    _store(nullptr),
+    _index(nullptr),
+    _pyramid(nullptr),
+    _scanning(false),
+    _stats(),
+    _bytes(0),
+    _stalls(0)
+{
+}
+
+bool SpectrumIngest::begin(SpectrumStore *store, SpectrumIndex *index, SpectrumPyramid *pyramid, size_t ring_size)
+{
+    _store = store;
+    _index = index;
+    _pyramid = pyramid;
+    _scanning = false;
+    return _ring.begin(ring_size);
+}
+
+size_t SpectrumIngest::receive(SpectrumIngestReadFn read, void *ctx)
+{
+    size_t space;
+    uint8_t *span = _ring.writeSpan(space);
+    if (space == 0) {
+        _stalls.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    size_t length = read(ctx, span, space);
+    if (length > 0) {
+        _ring.commitWrite(length);
+        _bytes.fetch_add((uint32_t)length, std::memory_order_relaxed);
+    }
+    return length;
+}
+
+SpectrumIngestUpdate SpectrumIngest::poll(size_t max_samples)
+{
+    SpectrumIngestUpdate update = {};
+    while (decode(update, max_samples)) {
+    }
+
+    // One pass over what this update appended, however many frames brought it
+    if (_scanning || update.ended) {
+        const size_t count = _store->size();
+        if (!_index->extend(_store->x(), _store->y(), count)) {
+            _index->clear();
+        }
+        if (!_pyramid->extend(_store->x(), _store->y(), count)) {
+            _pyramid->clear();
+        }
+    }
+    return update;
+}
+
+// Decode the frame at the front of the ring, false once there is nothing more for this update
+bool SpectrumIngest::decode(SpectrumIngestUpdate &update, size_t max_samples)
+{
+    if (update.ended || (update.added >= max_samples)) {
+        return false;
+    }
+    size_t available = _ring.available();
+    if (available < SPECTRUM_FRAME_HEADER) {
+        return false;
+    }
+
+    // Resynchronise one byte at a time: anything but a plausible header is line noise or the tail of a lost frame
+    uint8_t type = _ring.peek(2);
+    size_t length = _ring.peek(3) | ((size_t)_ring.peek(4) << 8);
+    if ((_ring.peek(0) != SPECTRUM_FRAME_SYNC_0) || (_ring.peek(1) != SPECTRUM_FRAME_SYNC_1) ||
+        (type < SPECTRUM_FRAME_BEGIN) || (type > SPECTRUM_FRAME_END) || (length > SPECTRUM_FRAME_PAYLOAD_MAX)) {
+        _ring.consume(1);
+        _stats.skipped++;
+        return true;
+    }
+    const size_t total = SPECTRUM_FRAME_HEADER + length + SPECTRUM_FRAME_CRC;
+    if (available < total) {
+        return false;
+    }
+
+    // Checked where it lies, in one or two spans
+    const uint8_t *first;
+    const uint8_t *second;
+    size_t checked = SPECTRUM_FRAME_HEADER - 2 + length;
+    size_t n = _ring.spans(2, checked, first, second);
+    uint16_t crc = spectrumFrameCrc(second, checked - n, spectrumFrameCrc(first, n));
+    uint16_t expected = _ring.peek(SPECTRUM_FRAME_HEADER + length) |
+                        (uint16_t)(_ring.peek(SPECTRUM_FRAME_HEADER + length + 1) << 8);
+    if (crc != expected) {
+        _ring.consume(1);
+        _stats.crc_errors++;
+        _stats.skipped++;
+        return true;
+    }
+
+    if (type == SPECTRUM_FRAME_BEGIN) {
+        // The next scan goes to the next update, so this one can be drawn first
+        if (update.begun || (update.added > 0)) {
+            return false;
+        }
+        uint32_t points = 0;
+        if (length == sizeof(points)) {
+            _ring.read(SPECTRUM_FRAME_HEADER, &points, sizeof(points));
+        }
+        startScan(points, update);
+    } else if (type == SPECTRUM_FRAME_SAMPLES) {
+        size_t samples = length / (2 * sizeof(float));
+        if (!_scanning) {
+            _stats.ignored += samples;
+        }
+        // Straight from the ring into the store's arrays
+        for (size_t i = 0; _scanning && (i < samples); i++) {
+            float sample[2];
+            _ring.read(SPECTRUM_FRAME_HEADER + i * sizeof(sample), sample, sizeof(sample));
+            if (_store->push(sample[0], sample[1])) {
+                update.added++;
+                _stats.samples++;
+            } else {
+                _stats.ignored++;
+            }
+        }
+    } else if (_scanning) {
+        _scanning = false;
+        update.ended = true;
+    }
+    _ring.consume(total);
+    _stats.frames++;
+    return true;
+}
+
+void SpectrumIngest::startScan(uint32_t expected, SpectrumIngestUpdate &update)
+{
+    // Room for the whole scan up front, so the arrays do not move under the index and pyramid while it arrives
+    _store->clear();
+    if ((expected > 0) && !_store->reserve(expected)) {
+        expected = 0;
+    }
+    _index->clear();
+    _pyramid->clear();
+    _scanning = true;
+    _stats.scans++;
+    update.begun = true;
+    update.expected = expected;
+}
+
+SpectrumIngestStats SpectrumIngest::stats(void) const
+{
+    SpectrumIngestStats stats = _stats;
+    stats.bytes = _bytes.load(std::memory_order_relaxed);
+    stats.stalls = _stalls.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,148 @@
+/*
+ * Live spectra streamed by the spectrometer over RS485 (a UART at up to 921600 baud), fed into the analysis pipeline
+ * as they arrive instead of from a CSV on the SD card.
+ *
+ * A reader task drains the UART straight into a `SpectrumRing` with `receive()`. The UI thread calls `poll()` from an
+ * `lv_timer`: it decodes the frames where they lie in the ring, appends their samples to the displayed
+ * `SpectrumStore`, and extends its area index and chart pyramid over the new samples only, so every sample costs the
+ * same whether it is the 10th or the 10 millionth of the scan.
+ *
+ * Frames, all little-endian:
+ *
+ *     0xA5 0x5A | type (1) | length (2) | payload (length) | CRC-16/MODBUS over type, length and payload (2)
+ *
+ * A scan is a BEGIN frame (payload: points to come as a uint32, 0 if unknown), SAMPLES frames (payload: up to
+ * `SPECTRUM_FRAME_SAMPLES_MAX` pairs of float32 wavenumber and intensity, in the order of the scan), then an END frame
+ * (no payload). A frame that fails its CRC is dropped and the decoder resynchronises on the next sync bytes; samples
+ * outside a scan are counted and ignored.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "spectrum_ring.h"
+#include "spectrum_store.h"
+#include "spectrum_index.h"
+#include "spectrum_pyramid.h"
+
+#define SPECTRUM_INGEST_RING_SIZE       (64 * 1024)     // ~0.7 s of a saturated 921600 baud line
+#define SPECTRUM_INGEST_STACK_SIZE      (4 * 1024)
+#define SPECTRUM_INGEST_PRIORITY        (2)             // Above the loader: the UART must never back up
+#define SPECTRUM_INGEST_CORE            (0)             // The LVGL task runs on core 1
+
+#define SPECTRUM_FRAME_SYNC_0           (0xA5)
+#define SPECTRUM_FRAME_SYNC_1           (0x5A)
+#define SPECTRUM_FRAME_HEADER           (5)             // Sync, type and length
+#define SPECTRUM_FRAME_CRC              (2)
+#define SPECTRUM_FRAME_SAMPLES_MAX      (64)
+#define SPECTRUM_FRAME_PAYLOAD_MAX      (SPECTRUM_FRAME_SAMPLES_MAX * 2 * sizeof(float))
+#define SPECTRUM_FRAME_MAX              (SPECTRUM_FRAME_HEADER + SPECTRUM_FRAME_PAYLOAD_MAX + SPECTRUM_FRAME_CRC)
+
+enum SpectrumFrameType : uint8_t {
+    SPECTRUM_FRAME_BEGIN = 1,
+    SPECTRUM_FRAME_SAMPLES = 2,
+    SPECTRUM_FRAME_END = 3,
+};
+
+/**
+ * @brief CRC-16/MODBUS (reflected 0x8005, initial 0xFFFF) of `length` bytes, continuing from `crc`.
+ */
+uint16_t spectrumFrameCrc(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+/**
+ * @brief Frame `length` bytes of `payload` as `type` into `out`, e.g. for the host test standing in for the
+ *        spectrometer.
+ *
+ * @return Bytes written, 0 if the payload is too long or the frame does not fit in `size`
+ */
+size_t spectrumFrameEncode(uint8_t type, const void *payload, size_t length, uint8_t *out, size_t size);
+
+/**
+ * @brief Reads up to `size` bytes from the port into `buffer` without waiting long, e.g. what a UART driver holds.
+ *
+ * @return Bytes read, 0 if none
+ */
+typedef size_t (*SpectrumIngestReadFn)(void *ctx, uint8_t *buffer, size_t size);
+
+struct SpectrumIngestStats {
+    uint32_t bytes;             // Read from the port, wrapping at 4 GB
+    uint32_t frames;            // Decoded with a valid CRC
+    uint32_t samples;           // Appended to the store
+    uint32_t scans;             // BEGIN frames
+    uint32_t crc_errors;
+    uint32_t skipped;           // Bytes dropped while resynchronising
+    uint32_t ignored;           // Samples outside a scan, or that the store had no room for
+    uint32_t stalls;            // Reads put off because the ring was full
+};
+
+/**
+ * @brief What one `poll()` changed. It stops at scan boundaries, so a scan never begins and ends in the same update.
+ */
+struct SpectrumIngestUpdate {
+    bool begun;                 // A new scan replaced the store's samples
+    bool ended;                 // The scan is complete
+    size_t added;               // Samples appended (and indexed) by this update
+    uint32_t expected;          // Points the scan announced, 0 if unknown
+};
+
+class SpectrumIngest {
+public:
+    SpectrumIngest();
+
+    SpectrumIngest(const SpectrumIngest &) = delete;
+    SpectrumIngest &operator=(const SpectrumIngest &) = delete;
+
+    /**
+     * @brief Allocate the ring and bind the spectrum that scans go to. Before the reader task starts.
+     *
+     * @return false if the ring could not be allocated
+     */
+    bool begin(SpectrumStore *store, SpectrumIndex *index, SpectrumPyramid *pyramid,
+               size_t ring_size = SPECTRUM_INGEST_RING_SIZE);
+
+    /**
+     * @brief Reader task: one `read()` straight into the free space of the ring.
+     *
+     * @return Bytes read, 0 if there was none or the ring is full
+     */
+    size_t receive(SpectrumIngestReadFn read, void *ctx);
+
+    /**
+     * @brief UI thread: decode the frames received so far, up to about `max_samples` samples, into the store, and
+     *        extend the index and pyramid over them.
+     */
+    SpectrumIngestUpdate poll(size_t max_samples);
+
+    /**
+     * @brief UI thread: drop the scan in progress, e.g. because a file replaced the spectrum; its remaining samples
+     *        are ignored until the next BEGIN.
+     */
+    void reset(void)
+    {
+        _scanning = false;
+    }
+
+    bool scanning(void) const
+    {
+        return _scanning;
+    }
+
+    /**
+     * @brief UI thread: counters so far.
+     */
+    SpectrumIngestStats stats(void) const;
+
+private:
+    bool decode(SpectrumIngestUpdate &update, size_t max_samples);
+    void startScan(uint32_t expected, SpectrumIngestUpdate &update);
+
+    SpectrumRing _ring;
+    SpectrumStore *_store;
+    SpectrumIndex *_index;
+    SpectrumPyramid *_pyramid;
+    bool _scanning;
+    SpectrumIngestStats _stats;                 // Owned by the UI thread, but for the two below
+    std::atomic<uint32_t> _bytes;               // Owned by the reader task
+    std::atomic<uint32_t> _stalls;
+};
@@ -0,0 +1,338 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "spectrum_port.h"
+#include "spectrum_journal.h"
+
+#define ROUND_DOWN(n)   ((n) & ~(uint64_t)(SPECTRUM_JOURNAL_SECTOR - 1))
+#define ROUND_UP(n)     ROUND_DOWN((n) + SPECTRUM_JOURNAL_SECTOR - 1)
+
+// A nibble at a time: 64 bytes of table instead of 1 KB, a quarter of the work of going bit by bit
+static const uint32_t crcTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t spectrumJournalCrc(const void *data, size_t length, uint32_t crc)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = crcTable[(crc ^ bytes[i]) & 0x0F] ^ (crc >> 4);
+        crc = crcTable[(crc ^ (bytes[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+static void put16(uint8_t *out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *out, uint32_t value)
+{
+    put16(out, value);
+    put16(out + 2, value >> 16);
+}
+
+static uint32_t get16(const uint8_t *in)
+{
+    return in[0] | ((uint32_t)in[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *in)
+{
+    return get16(in) | (get16(in + 2) << 16);
+}
+
+SpectrumJournal::SpectrumJournal():
+    _fd(-1),
+    _config(spectrumJournalDefaults()),
+    _block(nullptr),
+    _block_offset(0),
+    _fill(0),
+    _flushed(0),
+    _window_offset(0),
+    _window_length(0),
+    _file_size(0),
+    _sequence(1),
+    _pending(0),
+    _pending_since(0),
+    _unsynced(0),
+    _stats()
+{
+}
+
+SpectrumJournal::~SpectrumJournal()
+{
+    close();
+    spectrum_free(_block);
+}
+
+bool SpectrumJournal::mount(const char *path, const SpectrumJournalConfig &config, SpectrumJournalRecordFn record,
+                            void *ctx)
+{
+    close();
+    // Any record, plus the partly filled sector a flush leaves behind, fits in the block
+    if ((config.block_size % SPECTRUM_JOURNAL_SECTOR != 0) ||
+        (config.block_size < SPECTRUM_JOURNAL_SECTOR + SPECTRUM_JOURNAL_HEADER + SPECTRUM_JOURNAL_PAYLOAD_MAX)) {
+        return false;
+    }
+    if (config.block_size != _config.block_size) {
+        spectrum_free(_block);
+        _block = nullptr;
+    }
+    _config = config;
+    if (_block == nullptr) {
+        _block = static_cast<uint8_t *>(spectrum_malloc(_config.block_size));
+        if (_block == nullptr) {
+            return false;
+        }
+    }
+
+    _fill = _flushed = 0;
+    _fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if ((_fd < 0) || (fstat(_fd, &st) != 0)) {
+        close();
+        return false;
+    }
+    _stats = SpectrumJournalStats();
+    _file_size = st.st_size;
+    _window_length = 0;
+    _sequence = 1;
+    _pending = 0;
+    _unsynced = 0;
+
+    uint64_t end;
+    if (!recover(record, ctx, end)) {
+        close();
+        return false;
+    }
+    if (end < _file_size) {
+        if (ftruncate(_fd, (off_t)end) != 0) {
+            close();
+            return false;
+        }
+        _stats.truncated = _file_size - end;
+        _file_size = end;
+    }
+
+    // Append after the last good record, keeping its sector to complete on the next flush, along with any padding
+    // the power cut stopped short
+    uint64_t kept = (end < _file_size) ? end : _file_size;
+    _block_offset = ROUND_DOWN(kept);
+    _flushed = (size_t)(kept - _block_offset);
+    _fill = (size_t)(end - _block_offset);
+    const uint8_t *tail;
+    if ((_flushed > 0) && !fetch(_block_offset, _flushed, tail)) {
+        close();
+        return false;
+    }
+    if (_flushed > 0) {
+        memmove(_block, tail, _flushed);
+    }
+    memset(_block + _flushed, 0, _fill - _flushed);
+    return true;
+}
+
+// Walks the good records from the start, `end` just after the last one (or the end of the sector it pads)
+bool SpectrumJournal::recover(SpectrumJournalRecordFn record, void *ctx, uint64_t &end)
+{
+    uint64_t offset = 0;
+    bool first = true;
+    end = 0;
+    while (offset < _file_size) {
+        const uint8_t *data;
+        if (!fetch(offset, 1, data)) {
+            return false;
+        }
+        if (data[0] == 0) {
+            offset = end = ROUND_DOWN(offset + SPECTRUM_JOURNAL_SECTOR);
+            continue;
+        }
+
+        if (offset + SPECTRUM_JOURNAL_HEADER > _file_size) {
+            break;
+        }
+        if (!fetch(offset, SPECTRUM_JOURNAL_HEADER, data)) {
+            return false;
+        }
+        size_t length = get16(data + 2);
+        uint32_t sequence = get32(data + 4);
+        if ((get16(data) != SPECTRUM_JOURNAL_MAGIC) || (length > SPECTRUM_JOURNAL_PAYLOAD_MAX) ||
+            (offset + SPECTRUM_JOURNAL_HEADER + length > _file_size) || (!first && (sequence != _sequence))) {
+            break;
+        }
+        if (!fetch(offset, SPECTRUM_JOURNAL_HEADER + length, data)) {
+            return false;
+        }
+        uint32_t crc = spectrumJournalCrc(data + SPECTRUM_JOURNAL_HEADER, length, spectrumJournalCrc(data + 2, 6));
+        if (crc != get32(data + 8)) {
+            break;
+        }
+
+        if (record != nullptr) {
+            record(ctx, sequence, data + SPECTRUM_JOURNAL_HEADER, length);
+        }
+        _stats.recovered++;
+        _sequence = sequence + 1;
+        first = false;
+        offset = end = offset + SPECTRUM_JOURNAL_HEADER + length;
+    }
+    return true;
+}
+
+// Points `data` at `length` bytes of the file from `offset`, reading them into the block a block at a time
+bool SpectrumJournal::fetch(uint64_t offset, size_t length, const uint8_t *&data)
+{
+    if ((offset < _window_offset) || (offset + length > _window_offset + _window_length)) {
+        uint64_t start = ROUND_DOWN(offset);
+        uint64_t left = _file_size - start;
+        size_t wanted = (left < _config.block_size) ? (size_t)left : _config.block_size;
+        size_t done = 0;
+        _window_length = 0;
+        if (lseek(_fd, (off_t)start, SEEK_SET) < 0) {
+            return false;
+        }
+        while (done < wanted) {
+            ssize_t n = ::read(_fd, _block + done, wanted - done);
+            if (n <= 0) {
+                return false;
+            }
+            done += n;
+        }
+        _window_offset = start;
+        _window_length = done;
+        if (offset + length > start + done) {
+            return false;
+        }
+    }
+    data = _block + (offset - _window_offset);
+    return true;
+}
+
+bool SpectrumJournal::writeAt(uint64_t offset, const uint8_t *data, size_t length)
+{
+    if (lseek(_fd, (off_t)offset, SEEK_SET) < 0) {
+        return false;
+    }
+    while (length > 0) {
+        ssize_t n = ::write(_fd, data, length);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+void SpectrumJournal::close(void)
+{
+    if (_fd < 0) {
+        return;
+    }
+    sync();
+    ::close(_fd);
+    _fd = -1;
+}
+
+bool SpectrumJournal::append(const void *payload, size_t length)
+{
+    if ((_fd < 0) || (length > SPECTRUM_JOURNAL_PAYLOAD_MAX)) {
+        return false;
+    }
+    size_t size = SPECTRUM_JOURNAL_HEADER + length;
+    if ((_fill + size > _config.block_size) && !flush()) {
+        return false;
+    }
+
+    uint8_t *out = _block + _fill;
+    put16(out, SPECTRUM_JOURNAL_MAGIC);
+    put16(out + 2, (uint32_t)length);
+    put32(out + 4, _sequence);
+    if (length > 0) {
+        memcpy(out + SPECTRUM_JOURNAL_HEADER, payload, length);
+    }
+    put32(out + 8, spectrumJournalCrc(out + SPECTRUM_JOURNAL_HEADER, length, spectrumJournalCrc(out + 2, 6)));
+    _fill += size;
+    _sequence++;
+    if (_pending++ == 0) {
+        _pending_since = spectrum_time_ms_coarse();
+    }
+    _stats.records++;
+    _stats.record_bytes += size;
+
+    if ((_config.flush_records > 0) && (_pending >= _config.flush_records)) {
+        return flush();
+    }
+    return true;
+}
+
+bool SpectrumJournal::poll(void)
+{
+    if ((_pending == 0) || (_config.flush_interval_ms == 0) ||
+        (spectrum_time_ms_coarse() - _pending_since < _config.flush_interval_ms)) {
+        return true;
+    }
+    return flush();
+}
+
+bool SpectrumJournal::flush(void)
+{
+    if (_fd < 0) {
+        return false;
+    }
+    if (_fill == _flushed) {
+        return true;
+    }
+
+    // From the sector holding the first unwritten byte. Sealed, the rest of the last sector becomes padding.
+    size_t start = ROUND_DOWN(_flushed);
+    size_t end = _fill;
+    if (_config.seal_sectors) {
+        end = ROUND_UP(_fill);
+        memset(_block + _fill, 0, end - _fill);
+    }
+    if (!writeAt(_block_offset + start, _block + start, end - start)) {
+        _stats.errors++;
+        return false;
+    }
+    _stats.bytes_written += ROUND_UP(end - start);
+    _stats.flushes++;
+    _fill = _flushed = end;
+    _pending = 0;
+    if (_block_offset + end > _file_size) {
+        _file_size = _block_offset + end;
+    }
+
+    _unsynced++;
+    bool ok = (_config.sync_every == 0) || (_unsynced < _config.sync_every) || syncFile();
+
+    // Keep only the partly filled last sector
+    size_t keep = ROUND_DOWN(_fill);
+    memmove(_block, _block + keep, _fill - keep);
+    _block_offset += keep;
+    _fill -= keep;
+    _flushed -= keep;
+    return ok;
+}
+
+bool SpectrumJournal::sync(void)
+{
+    return flush() && ((_unsynced == 0) || syncFile());
+}
+
+bool SpectrumJournal::syncFile(void)
+{
+    _stats.syncs++;
+    _unsynced = 0;
+    if (fsync(_fd) != 0) {
+        _stats.errors++;
+        return false;
+    }
+    return true;
+}
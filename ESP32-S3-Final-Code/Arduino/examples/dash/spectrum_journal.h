@@ -0,0 +1,181 @@
+/*
+ * Append-only journal of results on the SD card that survives losing power at any point.
+ *
+ * Records are batched in a RAM block and written from a sector boundary, in one write per flush, so a flush costs the
+ * card whole 512-byte sectors and the FAT layer never has to read back what it is about to overwrite. Each record
+ * carries a sequence number and a CRC-32:
+ *
+ *     magic 0x4A52 (2) | payload length (2) | sequence (4) | CRC-32 over length, sequence and payload (4) | payload
+ *
+ * all little-endian. A zero byte where a record would start is padding up to the next sector boundary. `mount()`
+ * reads the journal from the start and stops at the first record that is cut short, fails its CRC or does not follow
+ * the previous one's sequence number (the stale tail of a sector that was being rewritten); everything from there on
+ * is truncated away and appending resumes after the last good record.
+ *
+ * The trade-offs are configurable. A flush either rewrites the partly filled last sector next time (fewer bytes
+ * written, but a power cut during that rewrite can lose the records already in it) or pads it out and never touches it
+ * again (`seal_sectors`: nothing once flushed is ever written again, at the cost of up to a sector per flush). Flushes
+ * happen when the block fills, every `flush_records` records or `flush_interval_ms` after the oldest unflushed one,
+ * and `sync_every` of them end with an fsync, the only point at which the records are known to be on the card.
+ *
+ * It works on a POSIX file descriptor, which on the ESP32 is the FAT volume the SD library mounts at /sd (Arduino's
+ * `File` cannot truncate) and on the host a local file, for the benchmark and tests. Not thread-safe: the UI thread
+ * owns it.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPECTRUM_JOURNAL_SECTOR         (512)
+#define SPECTRUM_JOURNAL_MAGIC          (0x4A52)        // "RJ"; its first byte is never the zero of padding
+#define SPECTRUM_JOURNAL_HEADER         (12)
+#define SPECTRUM_JOURNAL_PAYLOAD_MAX    (256)
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected 0xEDB88320) of `length` bytes, continuing from `crc` (0 to start).
+ */
+uint32_t spectrumJournalCrc(const void *data, size_t length, uint32_t crc = 0);
+
+struct SpectrumJournalConfig {
+    size_t block_size;              // RAM batch: a multiple of the sector size, at least two sectors
+    uint32_t flush_records;         // Flush once this many records are waiting, 0 only when the block is full
+    uint32_t flush_interval_ms;     // Flush `poll()` this long after the oldest waiting record, 0 never
+    uint32_t sync_every;            // fsync after every this many flushes, 0 only on `sync()` and `close()`
+    bool seal_sectors;              // Pad each flush to a sector boundary instead of rewriting the last sector
+};
+
+/**
+ * @brief Defaults for results: a record every few seconds at most, on the card within a second, synced every time.
+ */
+static inline SpectrumJournalConfig spectrumJournalDefaults(void)
+{
+    SpectrumJournalConfig config = {};
+    config.block_size = 4 * SPECTRUM_JOURNAL_SECTOR;
+    config.flush_records = 0;
+    config.flush_interval_ms = 1000;
+    config.sync_every = 1;
+    config.seal_sectors = false;
+    return config;
+}
+
+struct SpectrumJournalStats {
+    uint32_t records;               // Appended since mount
+    uint64_t record_bytes;          // Their headers and payloads
+    uint64_t bytes_written;         // Sectors written, padding and rewrites included
+    uint32_t flushes;
+    uint32_t syncs;
+    uint32_t errors;                // Failed writes and syncs
+    uint32_t recovered;             // Good records found by `mount()`
+    uint64_t truncated;             // Bytes `mount()` cut off after them
+
+    /**
+     * @brief Bytes written per byte of record, 1 at best.
+     */
+    double amplification(void) const
+    {
+        return (record_bytes == 0) ? 0 : (double)bytes_written / record_bytes;
+    }
+};
+
+/**
+ * @brief Called by `mount()` for every good record, oldest first.
+ */
+typedef void (*SpectrumJournalRecordFn)(void *ctx, uint32_t sequence, const uint8_t *payload, size_t length);
+
+class SpectrumJournal {
+public:
+    SpectrumJournal();
+    ~SpectrumJournal();
+
+    SpectrumJournal(const SpectrumJournal &) = delete;
+    SpectrumJournal &operator=(const SpectrumJournal &) = delete;
+
+    /**
+     * @brief Open or create the journal at `path`, recover it as described above and get ready to append.
+     *
+     * @param record Optional, sees every record recovered
+     *
+     * @return false if the file could not be opened, read or truncated, or the configuration is invalid
+     */
+    bool mount(const char *path, const SpectrumJournalConfig &config, SpectrumJournalRecordFn record = nullptr,
+               void *ctx = nullptr);
+
+    /**
+     * @brief Flush, sync and close the file. Also done by the destructor.
+     */
+    void close(void);
+
+    /**
+     * @brief Queue a record, flushing first if the block has no room left for it.
+     *
+     * @return false if not mounted, the payload is longer than `SPECTRUM_JOURNAL_PAYLOAD_MAX`, or that flush failed
+     */
+    bool append(const void *payload, size_t length);
+
+    /**
+     * @brief Flush if the oldest waiting record has waited `flush_interval_ms`. Call from a timer.
+     *
+     * @return false if that flush failed
+     */
+    bool poll(void);
+
+    /**
+     * @brief Write the waiting records, and fsync if this is the `sync_every`th flush.
+     *
+     * @return false if a write or the sync failed; the records stay queued for the next try
+     */
+    bool flush(void);
+
+    /**
+     * @brief Flush and fsync now.
+     */
+    bool sync(void);
+
+    bool mounted(void) const
+    {
+        return _fd >= 0;
+    }
+
+    /**
+     * @brief Sequence number the next record gets.
+     */
+    uint32_t sequence(void) const
+    {
+        return _sequence;
+    }
+
+    /**
+     * @brief Records appended but not flushed yet.
+     */
+    uint32_t pending(void) const
+    {
+        return _pending;
+    }
+
+    const SpectrumJournalStats &stats(void) const
+    {
+        return _stats;
+    }
+
+private:
+    bool recover(SpectrumJournalRecordFn record, void *ctx, uint64_t &end);
+    bool fetch(uint64_t offset, size_t length, const uint8_t *&data);
+    bool writeAt(uint64_t offset, const uint8_t *data, size_t length);
+    bool syncFile(void);
+
+    int _fd;
+    SpectrumJournalConfig _config;
+    uint8_t *_block;                // Sectors from `_block_offset` on in the file
+    uint64_t _block_offset;
+    size_t _fill;                   // Bytes of records (and sealed padding) in the block
+    size_t _flushed;                // Of which already in the file
+    uint64_t _window_offset;        // What `fetch()` holds in the block while mounting
+    size_t _window_length;
+    uint64_t _file_size;
+    uint32_t _sequence;
+    uint32_t _pending;
+    uint32_t _pending_since;        // `spectrum_time_ms_coarse()` of the oldest waiting record
+    uint32_t _unsynced;             // Flushes since the last fsync
+    SpectrumJournalStats _stats;
+};
@@ -0,0 +1,150 @@
+#include <string.h>
+#include "spectrum_loader.h"
+
+SpectrumLoader::SpectrumLoader():
+    _load(nullptr),
+    _user_data(nullptr),
+    _task(nullptr),
+    _requests(nullptr),
+    _events(nullptr),
+    _next_job(0),
+    _last_job(0),
+    _job(0),
+    _cancel_job(0),
+    _finished_job(0),
+    _last_percent(-1),
+    _last_done(0),
+    _last_total(0),
+    _dropped(0)
+{
+}
+
+SpectrumLoader::~SpectrumLoader()
+{
+    end();
+}
+
+bool SpectrumLoader::begin(SpectrumLoadFn load, void *user_data, uint32_t stack_size, int priority, int core)
+{
+    if (_task != nullptr) {
+        return true;
+    }
+
+    _load = load;
+    _user_data = user_data;
+    _requests = spectrum_queue_create(2, sizeof(Request));
+    _events = spectrum_queue_create(SPECTRUM_LOADER_QUEUE_LENGTH, sizeof(SpectrumLoadEvent));
+    if ((_requests != nullptr) && (_events != nullptr)) {
+        _task = spectrum_task_start("loader", taskEntry, this, stack_size, priority, core);
+    }
+    if (_task == nullptr) {
+        spectrum_queue_delete(_requests);
+        spectrum_queue_delete(_events);
+        _requests = nullptr;
+        _events = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void SpectrumLoader::end(void)
+{
+    if (_task == nullptr) {
+        return;
+    }
+
+    cancel();
+    // The task may be blocked on a full event queue with an outcome, keep draining until it has stopped
+    SpectrumLoadEvent event;
+    Request stop = {};
+    while (!spectrum_queue_send(_requests, &stop, 10)) {
+        spectrum_queue_receive(_events, &event, 0);
+    }
+    while (_finished_job.load() != STOPPED) {
+        spectrum_queue_receive(_events, &event, 10);
+    }
+    spectrum_task_join(_task);
+    _task = nullptr;
+    spectrum_queue_delete(_requests);
+    spectrum_queue_delete(_events);
+    _requests = nullptr;
+    _events = nullptr;
+    _finished_job = _last_job.load();
+}
+
+uint32_t SpectrumLoader::request(const char *path)
+{
+    size_t len = strlen(path);
+    if ((_task == nullptr) || (len >= SPECTRUM_LOADER_PATH_MAX)) {
+        return 0;
+    }
+
+    Request request;
+    request.job = ++_next_job;
+    memcpy(request.path, path, len + 1);
+
+    if (!spectrum_queue_send(_requests, &request, 0)) {
+        return 0;
+    }
+    // Whatever is loading or queued before it is superseded, but only once it is sure to run
+    _cancel_job = request.job - 1;
+    _last_job = request.job;
+    return request.job;
+}
+
+void SpectrumLoader::cancel(void)
+{
+    _cancel_job = _last_job.load();
+}
+
+bool SpectrumLoader::poll(SpectrumLoadEvent &event)
+{
+    return (_events != nullptr) && spectrum_queue_receive(_events, &event, 0);
+}
+
+void SpectrumLoader::progress(uint64_t done, uint64_t total)
+{
+    _last_done = done;
+    _last_total = total;
+    SpectrumLoadEvent event = {SPECTRUM_LOAD_PROGRESS, 0, done, total};
+    int percent = event.percent();
+    if (percent == _last_percent) {
+        return;
+    }
+    _last_percent = percent;
+    post(SPECTRUM_LOAD_PROGRESS, done, total, 0);
+}
+
+void SpectrumLoader::post(SpectrumLoadEventType type, uint64_t done, uint64_t total, uint32_t timeout_ms)
+{
+    SpectrumLoadEvent event = {type, _job.load(), done, total};
+    if (!spectrum_queue_send(_events, &event, timeout_ms)) {
+        _dropped++;
+    }
+}
+
+void SpectrumLoader::taskEntry(void *arg)
+{
+    static_cast<SpectrumLoader *>(arg)->run();
+}
+
+void SpectrumLoader::run(void)
+{
+    Request request;
+    while (spectrum_queue_receive(_requests, &request, SPECTRUM_WAIT_FOREVER) && (request.job != 0)) {
+        _job = request.job;
+        _last_percent = -1;
+        _last_done = 0;
+        _last_total = 0;
+
+        SpectrumLoadEventType outcome = SPECTRUM_LOAD_CANCELLED;
+        if (!cancelled()) {
+            bool ok = _load(request.path, *this, _user_data);
+            outcome = cancelled() ? SPECTRUM_LOAD_CANCELLED : (ok ? SPECTRUM_LOAD_DONE : SPECTRUM_LOAD_FAILED);
+        }
+        // The outcome must not be dropped, the UI waits for it. It repeats the last progress in case updates were.
+        post(outcome, _last_done, _last_total, SPECTRUM_WAIT_FOREVER);
+        _finished_job = request.job;
+    }
+    _finished_job = STOPPED;
+}
@@ -0,0 +1,149 @@
+/*
+ * Background loading of spectrum files, off the LVGL thread.
+ *
+ * A dedicated task owns the file I/O: the UI queues a path with `request()`, the task runs the load function on it and
+ * reports progress and the outcome through an event queue that the UI drains with `poll()` from an `lv_timer`, so no
+ * LVGL call is ever made from the loader task and the UI keeps drawing while a file is read and parsed.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "spectrum_port.h"
+
+#define SPECTRUM_LOADER_PATH_MAX        (256)
+#define SPECTRUM_LOADER_QUEUE_LENGTH    (8)
+#define SPECTRUM_LOADER_STACK_SIZE      (8 * 1024)
+#define SPECTRUM_LOADER_PRIORITY        (1)     // Below the LVGL task
+#define SPECTRUM_LOADER_CORE            (0)     // The LVGL task runs on core 1
+
+class SpectrumLoader;
+
+enum SpectrumLoadEventType : uint8_t {
+    SPECTRUM_LOAD_PROGRESS,
+    SPECTRUM_LOAD_DONE,
+    SPECTRUM_LOAD_FAILED,
+    SPECTRUM_LOAD_CANCELLED,
+};
+
+struct SpectrumLoadEvent {
+    SpectrumLoadEventType type;
+    uint32_t job;           // Id returned by `request()`
+    uint64_t done;          // Bytes processed so far (when the load ended, for the outcome events)
+    uint64_t total;         // File size, 0 if unknown
+
+    /**
+     * @brief Progress in percent, 0..100.
+     */
+    int percent(void) const
+    {
+        return (total == 0) ? 0 : (int)((done >= total) ? 100 : done * 100 / total);
+    }
+};
+
+/**
+ * @brief Loads `path` on the loader task. It should call `loader.progress()` as it goes and stop early once
+ *        `loader.cancelled()` returns true.
+ *
+ * @return false if the load failed
+ */
+typedef bool (*SpectrumLoadFn)(const char *path, SpectrumLoader &loader, void *user_data);
+
+class SpectrumLoader {
+public:
+    SpectrumLoader();
+    ~SpectrumLoader();
+
+    SpectrumLoader(const SpectrumLoader &) = delete;
+    SpectrumLoader &operator=(const SpectrumLoader &) = delete;
+
+    /**
+     * @brief Create the queues and start the loader task.
+     *
+     * @return false if any of them could not be created
+     */
+    bool begin(SpectrumLoadFn load, void *user_data, uint32_t stack_size = SPECTRUM_LOADER_STACK_SIZE,
+               int priority = SPECTRUM_LOADER_PRIORITY, int core = SPECTRUM_LOADER_CORE);
+
+    /**
+     * @brief Cancel the current load, stop the task and wait for it to exit.
+     */
+    void end(void);
+
+    /**
+     * @brief Queue a load of `path`, cancelling the one in progress (if any): only the newest request matters.
+     *
+     * @return Job id reported in the events of this load, 0 if the request queue is full or the path too long
+     */
+    uint32_t request(const char *path);
+
+    /**
+     * @brief Ask the current load to stop. Its last event will be `SPECTRUM_LOAD_CANCELLED`.
+     */
+    void cancel(void);
+
+    /**
+     * @brief Take the next event without blocking. Call from the UI thread.
+     *
+     * @return false if there is none
+     */
+    bool poll(SpectrumLoadEvent &event);
+
+    /**
+     * @brief Whether the current load should stop. Call from the load function.
+     */
+    bool cancelled(void) const
+    {
+        return _cancel_job.load() >= _job.load();
+    }
+
+    /**
+     * @brief Report progress of the current load. Call from the load function; updates are dropped rather than waited
+     *        for when the UI is not keeping up, and throttled to one per percent.
+     */
+    void progress(uint64_t done, uint64_t total);
+
+    /**
+     * @brief Whether a load is queued or running.
+     */
+    bool busy(void) const
+    {
+        return _finished_job.load() != _last_job.load();
+    }
+
+    /**
+     * @brief Progress updates dropped because the event queue was full.
+     */
+    uint32_t dropped(void) const
+    {
+        return _dropped.load();
+    }
+
+private:
+    static const uint32_t STOPPED = 0xFFFFFFFFu;  // `_finished_job` once the task has exited
+
+    struct Request {
+        uint32_t job;                           // 0 stops the task
+        char path[SPECTRUM_LOADER_PATH_MAX];
+    };
+
+    static void taskEntry(void *arg);
+    void run(void);
+    void post(SpectrumLoadEventType type, uint64_t done, uint64_t total, uint32_t timeout_ms);
+
+    SpectrumLoadFn _load;
+    void *_user_data;
+    SpectrumTask *_task;
+    SpectrumQueue *_requests;
+    SpectrumQueue *_events;
+    uint32_t _next_job;                         // Owned by the UI thread
+    std::atomic<uint32_t> _last_job;            // Newest requested job
+    std::atomic<uint32_t> _job;                 // Job being loaded
+    std::atomic<uint32_t> _cancel_job;          // Every job up to this one is cancelled
+    std::atomic<uint32_t> _finished_job;        // Last job the task is done with
+    int _last_percent;                          // Last progress posted, owned by the loader task
+    uint64_t _last_done;
+    uint64_t _last_total;
+    std::atomic<uint32_t> _dropped;
+};
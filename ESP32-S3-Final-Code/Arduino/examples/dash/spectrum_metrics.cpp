@@ -0,0 +1,223 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "spectrum_metrics.h"
+
+SpectrumMetrics spectrumMetrics;
+
+// Exported bucket bounds, 4^k cycles: from ~1 us to ~5 min at 240 MHz, or 256 ns to 69 s on the host
+#define METRICS_EXPORT_FIRST    (4)
+#define METRICS_EXPORT_LAST     (18)
+
+static const char *const SCOPE_NAMES[SPECTRUM_SCOPE_COUNT] = {"load", "area", "chart", "render", "flush", "http"};
+
+static uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double SpectrumMetricsSnapshot::quantile(double q) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    double target = q * count;
+    uint32_t below = 0;
+    for (int b = 0; b < SPECTRUM_METRICS_BUCKETS; b++) {
+        if ((buckets[b] > 0) && (below + buckets[b] >= target)) {
+            double fraction = (target - below) / buckets[b];
+            double value = ldexp(1.0, b) * pow(2.0, (fraction < 0) ? 0 : fraction);
+            return (value > max) ? max : value;
+        }
+        below += buckets[b];
+    }
+    return max;
+}
+
+SpectrumMetrics::SpectrumMetrics()
+{
+    reset();
+}
+
+void SpectrumMetrics::record(int scope, int core, uint64_t cycles)
+{
+    if ((scope < 0) || (scope >= SPECTRUM_SCOPE_COUNT)) {
+        return;
+    }
+    Histogram &h = _histograms[scope][core & (SPECTRUM_METRICS_CORES - 1)];
+
+    int bucket = 63 - __builtin_clzll(cycles | 1);
+    bucket = (bucket >= SPECTRUM_METRICS_BUCKETS) ? SPECTRUM_METRICS_BUCKETS - 1 : bucket;
+    h.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t low = (uint32_t)cycles;
+    uint32_t high = (uint32_t)(cycles >> 32);
+    uint32_t before = h.sum_low.fetch_add(low, std::memory_order_relaxed);
+    high += ((uint32_t)(before + low) < before) ? 1 : 0;
+    if (high != 0) {
+        h.sum_high.fetch_add(high, std::memory_order_relaxed);
+    }
+
+    // Almost always a single load: a new maximum is rare
+    uint32_t bits = floatBits((float)cycles);
+    uint32_t max = h.max.load(std::memory_order_relaxed);
+    while ((bits > max) && !h.max.compare_exchange_weak(max, bits, std::memory_order_relaxed)) {
+    }
+}
+
+void SpectrumMetrics::snapshot(int scope, int core, SpectrumMetricsSnapshot &out) const
+{
+    memset(&out, 0, sizeof(out));
+    for (int c = 0; c < SPECTRUM_METRICS_CORES; c++) {
+        if ((core >= 0) && (core != c)) {
+            continue;
+        }
+        const Histogram &h = _histograms[scope][c];
+        for (int b = 0; b < SPECTRUM_METRICS_BUCKETS; b++) {
+            uint32_t n = h.buckets[b].load(std::memory_order_relaxed);
+            out.buckets[b] += n;
+            out.count += n;
+        }
+
+        // Read the high word again to catch a carry between the two halves
+        uint32_t high, low;
+        do {
+            high = h.sum_high.load(std::memory_order_relaxed);
+            low = h.sum_low.load(std::memory_order_relaxed);
+        } while (high != h.sum_high.load(std::memory_order_relaxed));
+        out.sum += ((uint64_t)high << 32) | low;
+
+        float max = bitsFloat(h.max.load(std::memory_order_relaxed));
+        out.max = (max > out.max) ? max : out.max;
+    }
+}
+
+void SpectrumMetrics::reset(void)
+{
+    for (int s = 0; s < SPECTRUM_SCOPE_COUNT; s++) {
+        for (int c = 0; c < SPECTRUM_METRICS_CORES; c++) {
+            Histogram &h = _histograms[s][c];
+            for (int b = 0; b < SPECTRUM_METRICS_BUCKETS; b++) {
+                h.buckets[b].store(0, std::memory_order_relaxed);
+            }
+            h.sum_low.store(0, std::memory_order_relaxed);
+            h.sum_high.store(0, std::memory_order_relaxed);
+            h.max.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+const char *SpectrumMetrics::scopeName(int scope)
+{
+    return ((scope >= 0) && (scope < SPECTRUM_SCOPE_COUNT)) ? SCOPE_NAMES[scope] : "unknown";
+}
+
+/*
+ * The body is the histogram family, then a gauge family of the maxima, one series (scope and core) per step. A series
+ * that no longer fits in what is left of the buffer waits for the next call.
+ */
+struct MetricsStream {
+    uint16_t next;              // Series to write next, over both families
+};
+
+static_assert(sizeof(MetricsStream) <= SPECTRUM_HTTP_STATE_MAX, "Must fit in the per-connection stream state");
+
+#define METRICS_SERIES      (SPECTRUM_SCOPE_COUNT * SPECTRUM_METRICS_CORES)
+
+// Appends to a buffer, remembering whether anything did not fit
+struct MetricsWriter {
+    char *buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
+
+    void printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (overflow) {
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer + length, size - length, format, args);
+        va_end(args);
+        if ((n < 0) || ((size_t)n >= size - length)) {
+            overflow = true;
+            return;
+        }
+        length += (size_t)n;
+    }
+};
+
+static void writeHistogram(MetricsWriter &out, const SpectrumMetricsSnapshot &snapshot, const char *scope, int core,
+                           double seconds_per_cycle)
+{
+    uint32_t below = 0;
+    int b = 0;
+    for (int k = METRICS_EXPORT_FIRST; k <= METRICS_EXPORT_LAST; k++) {
+        for (; b < 2 * k; b++) {
+            below += snapshot.buckets[b];
+        }
+        out.printf("dash_scope_seconds_bucket{scope=\"%s\",core=\"%d\",le=\"%.3g\"} %u\n", scope, core,
+                   ldexp(1.0, 2 * k) * seconds_per_cycle, (unsigned)below);
+    }
+    out.printf("dash_scope_seconds_bucket{scope=\"%s\",core=\"%d\",le=\"+Inf\"} %u\n", scope, core,
+               (unsigned)snapshot.count);
+    out.printf("dash_scope_seconds_sum{scope=\"%s\",core=\"%d\"} %.9g\n", scope, core,
+               (double)snapshot.sum * seconds_per_cycle);
+    out.printf("dash_scope_seconds_count{scope=\"%s\",core=\"%d\"} %u\n", scope, core, (unsigned)snapshot.count);
+}
+
+size_t SpectrumMetrics::body(void *ctx, void *state, char *buffer, size_t size, bool &done)
+{
+    const SpectrumMetrics &metrics = *static_cast<const SpectrumMetrics *>(ctx);
+    MetricsStream &stream = *static_cast<MetricsStream *>(state);
+    const double seconds_per_cycle = 1e-6 / spectrum_cycles_per_us();
+
+    MetricsWriter out = {buffer, size, 0, false};
+    while (stream.next < 2 * METRICS_SERIES) {
+        size_t length = out.length;
+        int series = stream.next % METRICS_SERIES;
+        int scope = series / SPECTRUM_METRICS_CORES;
+        int core = series % SPECTRUM_METRICS_CORES;
+        SpectrumMetricsSnapshot snapshot;
+        metrics.snapshot(scope, core, snapshot);
+
+        if (stream.next < METRICS_SERIES) {
+            if (series == 0) {
+                out.printf("# HELP dash_scope_seconds Time spent in an instrumented path of the firmware.\n"
+                           "# TYPE dash_scope_seconds histogram\n");
+            }
+            writeHistogram(out, snapshot, scopeName(scope), core, seconds_per_cycle);
+        } else {
+            if (series == 0) {
+                out.printf("# HELP dash_scope_max_seconds Longest time spent in an instrumented path.\n"
+                           "# TYPE dash_scope_max_seconds gauge\n");
+            }
+            out.printf("dash_scope_max_seconds{scope=\"%s\",core=\"%d\"} %.9g\n", scopeName(scope), core,
+                       snapshot.max * seconds_per_cycle);
+        }
+        if (out.overflow) {
+            return length;
+        }
+        stream.next++;
+    }
+    done = true;
+    return out.length;
+}
+
+void SpectrumMetrics::respond(SpectrumHttpResponse &response)
+{
+    response.addHeader("Content-Type", "text/plain; version=0.0.4");
+    response.addHeader("Cache-Control", "no-store");
+    response.stream(body, this, sizeof(MetricsStream));
+}
@@ -0,0 +1,151 @@
+/*
+ * Timing of the firmware's hot paths: loading a file, the area readout, the chart update, LVGL rendering and flushing,
+ * and the HTTP handler.
+ *
+ * A `SpectrumMetricsTimer` reads the CPU cycle counter on entry and exit and adds the difference to the histogram of
+ * its scope on the current core. Histograms have one bucket per power of two cycles and are only ever touched with
+ * relaxed atomic adds, so recording never takes a lock or disables interrupts and costs a few tens of cycles, against
+ * the tens of microseconds at least of the paths it wraps. Readers (the `/metrics` endpoint and the on-screen overlay)
+ * take a snapshot of the counters without stopping the writers, so a snapshot may miss a sample being recorded.
+ *
+ * Set `SPECTRUM_METRICS` to 0 to compile the timers out of the sketch entirely.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "spectrum_port.h"
+#include "spectrum_http.h"
+
+#ifndef SPECTRUM_METRICS
+#define SPECTRUM_METRICS            (1)
+#endif
+
+#define SPECTRUM_METRICS_CORES      (2)
+#define SPECTRUM_METRICS_BUCKETS    (40)    // Bucket b holds [2^b, 2^(b+1)) cycles, the last one everything above
+
+enum SpectrumMetricsScope {
+    SPECTRUM_SCOPE_LOAD,        // `loadCSV()`, on the loader task
+    SPECTRUM_SCOPE_AREA,        // Area, concentration and peak readout
+    SPECTRUM_SCOPE_CHART,       // `update_chart()`
+    SPECTRUM_SCOPE_RENDER,      // One run of the display refresh timer, including the flushes it triggers
+    SPECTRUM_SCOPE_FLUSH,       // One display flush callback
+    SPECTRUM_SCOPE_HTTP,        // One request handled by the web server
+    SPECTRUM_SCOPE_COUNT,
+};
+
+/**
+ * @brief Counters of one scope, merged over the cores asked for.
+ */
+struct SpectrumMetricsSnapshot {
+    uint32_t buckets[SPECTRUM_METRICS_BUCKETS];
+    uint32_t count;
+    uint64_t sum;               // Cycles
+    float max;                  // Cycles
+
+    /**
+     * @brief Estimate the `q` quantile (0..1) in cycles, interpolating geometrically inside its bucket. 0 if empty.
+     */
+    double quantile(double q) const;
+};
+
+class SpectrumMetrics {
+public:
+    SpectrumMetrics();
+
+    SpectrumMetrics(const SpectrumMetrics &) = delete;
+    SpectrumMetrics &operator=(const SpectrumMetrics &) = delete;
+
+    /**
+     * @brief Add one sample of `cycles` to `scope` on `core`. Lock-free, callable from any task.
+     */
+    void record(int scope, int core, uint64_t cycles);
+
+    /**
+     * @brief Read the counters of `scope` on `core`, or merged over both cores if `core` is -1.
+     */
+    void snapshot(int scope, int core, SpectrumMetricsSnapshot &out) const;
+
+    /**
+     * @brief Zero every histogram. Samples recorded meanwhile may be kept or lost.
+     */
+    void reset(void);
+
+    /**
+     * @brief Start a streamed response with every histogram in the Prometheus text format, in seconds: too long for
+     *        the server's body buffer, it is produced one series at a time.
+     */
+    void respond(SpectrumHttpResponse &response);
+
+    /**
+     * @brief Name of `scope` in the `scope` label and on screen.
+     */
+    static const char *scopeName(int scope);
+
+    /**
+     * @brief `SpectrumHttpBodyCallback` behind `respond()`, `ctx` being the `SpectrumMetrics`.
+     */
+    static size_t body(void *ctx, void *state, char *buffer, size_t size, bool &done);
+
+private:
+    struct Histogram {
+        std::atomic<uint32_t> buckets[SPECTRUM_METRICS_BUCKETS];
+        std::atomic<uint32_t> sum_low;      // 64-bit atomics are emulated with a lock on the Xtensa cores
+        std::atomic<uint32_t> sum_high;
+        std::atomic<uint32_t> max;          // Bits of a positive float, which order like the integers
+    };
+
+    Histogram _histograms[SPECTRUM_SCOPE_COUNT][SPECTRUM_METRICS_CORES];
+};
+
+/**
+ * The histograms the `SPECTRUM_METRICS_SCOPE()` timers record into.
+ */
+extern SpectrumMetrics spectrumMetrics;
+
+/**
+ * @brief Times its own lifetime into a scope of `spectrumMetrics`, on the core it ends on.
+ */
+class SpectrumMetricsTimer {
+public:
+    explicit SpectrumMetricsTimer(int scope):
+        _scope(scope),
+        _start_ms(spectrum_time_ms_coarse()),
+        _start(spectrum_cycles())
+    {
+    }
+
+    ~SpectrumMetricsTimer()
+    {
+        uint64_t cycles = (uint32_t)(spectrum_cycles() - _start);
+        // The counter wraps within seconds: past half a turn, trust the coarse clock instead
+        uint32_t ms = spectrum_time_ms_coarse() - _start_ms;
+        uint32_t cycles_per_ms = spectrum_cycles_per_us() * 1000;
+        if (ms > (UINT32_MAX / 2) / cycles_per_ms) {
+            cycles = (uint64_t)ms * cycles_per_ms;
+        }
+        spectrumMetrics.record(_scope, spectrum_core_id(), cycles);
+    }
+
+    SpectrumMetricsTimer(const SpectrumMetricsTimer &) = delete;
+    SpectrumMetricsTimer &operator=(const SpectrumMetricsTimer &) = delete;
+
+private:
+    int _scope;
+    uint32_t _start_ms;
+    uint32_t _start;
+};
+
+#define SPECTRUM_METRICS_CONCAT_(a, b)  a##b
+#define SPECTRUM_METRICS_CONCAT(a, b)   SPECTRUM_METRICS_CONCAT_(a, b)
+
+/**
+ * Time the rest of the enclosing block into `scope`.
+ */
+#if SPECTRUM_METRICS
+#define SPECTRUM_METRICS_SCOPE(scope) \
+    SpectrumMetricsTimer SPECTRUM_METRICS_CONCAT(_metrics_timer_, __LINE__)(scope)
+#else
+#define SPECTRUM_METRICS_SCOPE(scope)   do {} while (0)
+#endif
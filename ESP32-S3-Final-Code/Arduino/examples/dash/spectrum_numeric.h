@@ -0,0 +1,532 @@
+/*
+ * Numeric core of the integration, prefix-sum and envelope kernels, so that they can run on float, double or fixed
+ * point.
+ *
+ * The ESP32-S3 has a single-precision FPU: float costs about what an integer does, while double is emulated in
+ * software, tens of cycles per multiply. Parts without an FPU emulate both. `SpectrumQ16` (Q16.16 in an int32_t) and
+ * `SpectrumQ32` (Q32.32 in an int64_t) need integer arithmetic only.
+ *
+ * `SpectrumNumeric<T>` says how each type converts samples, sums trapezoids, and places and interpolates envelope
+ * columns. The kernels below are templates over it, so every instantiation is specialised at compile time with nothing
+ * indirect per sample. The sketch uses double for the prefix table (see `SpectrumIndex`) and float for envelopes
+ * (`spectrumEnvelopeCompute()` and `SpectrumPyramid`), or fixed point for both with `SPECTRUM_NUMERIC_FIXED`.
+ *
+ * Trapezoids are summed in `SpectrumNumeric<T>::Accum`:
+ * - double for double and float for float;
+ * - Q32.32 for both fixed-point types. The product of two Q16.16 values is exact in Q32.32, and fixed-point prefix
+ *   sums are integer additions, so the difference of two prefix sums carries no rounding from the rest of the
+ *   spectrum.
+ *
+ * Q16.16 holds ±32768 in steps of 1.5e-5 and Q32.32 holds ±2.1e9 in steps of 2.3e-10. Conversions saturate. Sums and
+ * products are not checked: an area must stay within ±2^31, and Q16.16 samples must keep |dx| * (y0 + y1) below
+ * 2^31.
+ *
+ * host/test_numeric bounds the fixed-point error against double, and host/bench_numeric measures each type's
+ * throughput.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <limits>
+
+/**
+ * @brief (a * b) >> 32 of two signed 64-bit values, rounded to nearest, without a 128-bit type (Xtensa has none).
+ *        The result must fit in 64 bits.
+ */
+static inline int64_t spectrumMulShift32(int64_t a, int64_t b)
+{
+    bool negative = (a < 0) != (b < 0);
+    uint64_t ua = (a < 0) ? 0 - (uint64_t)a : (uint64_t)a;
+    uint64_t ub = (b < 0) ? 0 - (uint64_t)b : (uint64_t)b;
+    uint64_t a_lo = (uint32_t)ua;
+    uint64_t a_hi = ua >> 32;
+    uint64_t b_lo = (uint32_t)ub;
+    uint64_t b_hi = ub >> 32;
+    uint64_t result = ((a_hi * b_hi) << 32) + a_hi * b_lo + a_lo * b_hi + ((a_lo * b_lo + 0x80000000u) >> 32);
+    return negative ? -(int64_t)result : (int64_t)result;
+}
+
+template <int FRAC, typename Raw>
+class SpectrumFixed {
+public:
+    static const int FRAC_BITS = FRAC;
+
+    SpectrumFixed():
+        raw(0)
+    {
+    }
+
+    static SpectrumFixed fromRaw(Raw value)
+    {
+        SpectrumFixed fixed;
+        fixed.raw = value;
+        return fixed;
+    }
+
+    /**
+     * @brief Nearest value to `v`, saturated to the range (NaN is 0), in float arithmetic only.
+     */
+    static SpectrumFixed fromFloat(float v)
+    {
+        const float limit = -(float)std::numeric_limits<Raw>::min();
+        float scaled = v * (float)((Raw)1 << FRAC);
+        if (scaled != scaled) {
+            return SpectrumFixed();
+        }
+        if (scaled >= limit) {
+            return fromRaw(std::numeric_limits<Raw>::max());
+        }
+        if (scaled <= -limit) {
+            return fromRaw(std::numeric_limits<Raw>::min());
+        }
+        return fromRaw((Raw)(scaled + ((scaled < 0) ? -0.5f : 0.5f)));
+    }
+
+    /**
+     * @brief Nearest value to `v`, saturated to the range (NaN is 0).
+     */
+    static SpectrumFixed fromDouble(double v)
+    {
+        const double limit = -(double)std::numeric_limits<Raw>::min();
+        double scaled = v * (double)((Raw)1 << FRAC);
+        if (scaled != scaled) {
+            return SpectrumFixed();
+        }
+        if (scaled >= limit) {
+            return fromRaw(std::numeric_limits<Raw>::max());
+        }
+        if (scaled <= -limit) {
+            return fromRaw(std::numeric_limits<Raw>::min());
+        }
+        return fromRaw((Raw)(scaled + ((scaled < 0) ? -0.5 : 0.5)));
+    }
+
+    double toDouble(void) const
+    {
+        return (double)raw / (double)((Raw)1 << FRAC);
+    }
+
+    float toFloat(void) const
+    {
+        return (float)raw / (float)((Raw)1 << FRAC);
+    }
+
+    SpectrumFixed operator+(SpectrumFixed other) const
+    {
+        return fromRaw(raw + other.raw);
+    }
+
+    SpectrumFixed operator-(SpectrumFixed other) const
+    {
+        return fromRaw(raw - other.raw);
+    }
+
+    SpectrumFixed &operator+=(SpectrumFixed other)
+    {
+        raw += other.raw;
+        return *this;
+    }
+
+    bool operator<(SpectrumFixed other) const
+    {
+        return raw < other.raw;
+    }
+
+    bool operator>(SpectrumFixed other) const
+    {
+        return raw > other.raw;
+    }
+
+    bool operator==(SpectrumFixed other) const
+    {
+        return raw == other.raw;
+    }
+
+    bool operator!=(SpectrumFixed other) const
+    {
+        return raw != other.raw;
+    }
+
+    Raw raw;
+};
+
+typedef SpectrumFixed<16, int32_t> SpectrumQ16;
+typedef SpectrumFixed<32, int64_t> SpectrumQ32;
+
+static inline float spectrumAbs(float v)
+{
+    return fabsf(v);
+}
+
+static inline double spectrumAbs(double v)
+{
+    return fabs(v);
+}
+
+static inline double spectrumToDouble(float v)
+{
+    return v;
+}
+
+static inline double spectrumToDouble(double v)
+{
+    return v;
+}
+
+template <int FRAC, typename Raw>
+static inline double spectrumToDouble(SpectrumFixed<FRAC, Raw> v)
+{
+    return v.toDouble();
+}
+
+template <typename T>
+struct SpectrumNumeric;
+
+template <typename T>
+struct SpectrumFloatNumeric {
+    typedef T Accum;
+
+    template <typename S>
+    static T from(S v)
+    {
+        return (T)v;
+    }
+
+    template <typename S>
+    static void store(T v, S &out)
+    {
+        out = (S)v;
+    }
+
+    static Accum trapezoid(T x0, T x1, T y0, T y1)
+    {
+        return (T)0.5 * spectrumAbs(x1 - x0) * (y0 + y1);
+    }
+
+    static T center(T x_first, T span, int column, uint16_t columns)
+    {
+        return x_first + ((T)column + (T)0.5) * (span / (T)columns);
+    }
+
+    /**
+     * @brief `y0 + (y1 - y0) * num / den`, `y0` if `den` is 0.
+     */
+    static T interpolate(T y0, T y1, T num, T den)
+    {
+        T t = (den == 0) ? (T)0 : num / den;
+        return y0 + t * (y1 - y0);
+    }
+
+    /**
+     * @brief Maps an offset from the first sample to its column, for offsets visited in order.
+     */
+    class Columns {
+    public:
+        Columns(T span, uint16_t columns):
+            _scale((span == 0) ? (T)0 : (T)columns / span)
+        {
+        }
+
+        int of(T offset)
+        {
+            return at(offset);
+        }
+
+        /**
+         * @brief The column of any offset, in no particular order.
+         */
+        int at(T offset) const
+        {
+            return (int)(offset * _scale);
+        }
+
+    private:
+        T _scale;
+    };
+};
+
+template <>
+struct SpectrumNumeric<float> : SpectrumFloatNumeric<float> {
+};
+
+template <>
+struct SpectrumNumeric<double> : SpectrumFloatNumeric<double> {
+};
+
+template <int FRAC, typename Raw>
+struct SpectrumFixedNumeric {
+    typedef SpectrumFixed<FRAC, Raw> T;
+    typedef SpectrumQ32 Accum;
+
+    static T from(float v)
+    {
+        return T::fromFloat(v);
+    }
+
+    static T from(double v)
+    {
+        return T::fromDouble(v);
+    }
+
+    static T from(T v)
+    {
+        return v;
+    }
+
+    static void store(T v, float &out)
+    {
+        out = v.toFloat();
+    }
+
+    static void store(T v, double &out)
+    {
+        out = v.toDouble();
+    }
+
+    static void store(T v, T &out)
+    {
+        out = v;
+    }
+
+    static Accum trapezoid(T x0, T x1, T y0, T y1)
+    {
+        int64_t dx = (int64_t)x1.raw - (int64_t)x0.raw;
+        dx = (dx < 0) ? -dx : dx;
+        int64_t sum = (int64_t)y0.raw + (int64_t)y1.raw;
+        // Q16.16 * Q16.16 is Q32.32 as it stands; Q32.32 * Q32.32 is brought back down by 32 bits
+        int64_t product = (FRAC == 16) ? dx * sum : spectrumMulShift32(dx, sum);
+        // Halved to the nearest even: flooring every trapezoid would add up to a bias over a large spectrum
+        return Accum::fromRaw((product >> 1) + (product & (product >> 1) & 1));
+    }
+
+    static T center(T x_first, T span, int column, uint16_t columns)
+    {
+        return x_first + T::fromRaw((Raw)((int64_t)span.raw * (2 * column + 1) / (2 * (int64_t)columns)));
+    }
+
+    static T interpolate(T y0, T y1, T num, T den)
+    {
+        int64_t n = num.raw;
+        int64_t d = den.raw;
+        if (d == 0) {
+            return y0;
+        }
+        if (d < 0) {
+            n = -n;
+            d = -d;
+        }
+        n = (n < 0) ? 0 : (n > d) ? d : n;
+        // num / den is between 0 and 1: as a 0.32 fraction, once both fit in 31 bits
+        while (d >= ((int64_t)1 << 31)) {
+            n >>= 1;
+            d >>= 1;
+        }
+        int64_t t = (int64_t)(((uint64_t)n << 32) / (uint64_t)d);
+        return y0 + T::fromRaw((Raw)spectrumMulShift32((int64_t)y1.raw - (int64_t)y0.raw, t));
+    }
+
+    /**
+     * @brief Walks the column boundaries instead of dividing per sample: the first offset at or past each one moves to
+     *        the next column, as `floor(offset * columns / span)` would.
+     */
+    class Columns {
+    public:
+        Columns(T span, uint16_t columns):
+            _span((span.raw < 0) ? -(int64_t)span.raw : (int64_t)span.raw),
+            _negative(span.raw < 0),
+            _columns(columns),
+            _column(0),
+            _next(boundary(1))
+        {
+        }
+
+        int of(T offset)
+        {
+            int64_t o = _negative ? -(int64_t)offset.raw : (int64_t)offset.raw;
+            while ((_span > 0) && (o >= _next) && (_column < _columns)) {
+                _column++;
+                _next = boundary(_column + 1);
+            }
+            return _column;
+        }
+
+        /**
+         * @brief The column of any offset, in no particular order: the one `of()` would have reached.
+         */
+        int at(T offset) const
+        {
+            int64_t o = _negative ? -(int64_t)offset.raw : (int64_t)offset.raw;
+            if ((_span == 0) || (o <= 0)) {
+                return 0;
+            }
+            int64_t c = o * _columns / _span;
+            return (c > _columns) ? (int)_columns : (int)c;
+        }
+
+    private:
+        // ceil(span * k / columns), so that an offset reaches it exactly when offset * columns / span reaches k
+        int64_t boundary(int k) const
+        {
+            return ((_span * k) + _columns - 1) / _columns;
+        }
+
+        int64_t _span;
+        bool _negative;
+        int64_t _columns;
+        int _column;
+        int64_t _next;
+    };
+};
+
+template <>
+struct SpectrumNumeric<SpectrumQ16> : SpectrumFixedNumeric<16, int32_t> {
+};
+
+template <>
+struct SpectrumNumeric<SpectrumQ32> : SpectrumFixedNumeric<32, int64_t> {
+};
+
+/**
+ * Arithmetic of the sketch's prefix table and chart envelopes: 0 for double and float, 16 for Q16.16 or 32 for Q32.32
+ * in both. A build flag rather than a define in the sketch, since every file must agree (`-DSPECTRUM_NUMERIC_FIXED=16`
+ * in the sketch's build_opt.h). Fixed-point prefix tables are Q32.32 whatever the samples are.
+ */
+#ifndef SPECTRUM_NUMERIC_FIXED
+#define SPECTRUM_NUMERIC_FIXED      (0)
+#endif
+
+#if SPECTRUM_NUMERIC_FIXED == 0
+typedef double SpectrumAreaType;
+typedef float SpectrumChartType;
+#elif SPECTRUM_NUMERIC_FIXED == 16
+typedef SpectrumQ16 SpectrumAreaType;
+typedef SpectrumQ16 SpectrumChartType;
+#elif SPECTRUM_NUMERIC_FIXED == 32
+typedef SpectrumQ32 SpectrumAreaType;
+typedef SpectrumQ32 SpectrumChartType;
+#else
+#error "SPECTRUM_NUMERIC_FIXED must be 0, 16 or 32"
+#endif
+
+typedef SpectrumNumeric<SpectrumAreaType>::Accum SpectrumPrefix;
+
+/**
+ * @brief Trapezoid area between samples `from` and `to - 1` in `T` arithmetic, the samples converted from `S` as they
+ *        are read.
+ */
+template <typename T, typename S>
+typename SpectrumNumeric<T>::Accum spectrumIntegrate(const S *x, const S *y, size_t from, size_t to)
+{
+    typedef SpectrumNumeric<T> N;
+    typename N::Accum sum = typename N::Accum();
+    if (to <= from + 1) {
+        return sum;
+    }
+    T x0 = N::from(x[from]);
+    T y0 = N::from(y[from]);
+    for (size_t i = from + 1; i < to; i++) {
+        T x1 = N::from(x[i]);
+        T y1 = N::from(y[i]);
+        sum += N::trapezoid(x0, x1, y0, y1);
+        x0 = x1;
+        y0 = y1;
+    }
+    return sum;
+}
+
+/**
+ * @brief `prefix[k]` = area from sample 0 to sample k, for k in [from, count), carrying on from `prefix[from - 1]`.
+ */
+template <typename T, typename S>
+void spectrumPrefixSum(const S *x, const S *y, size_t from, size_t count, typename SpectrumNumeric<T>::Accum *prefix)
+{
+    typedef SpectrumNumeric<T> N;
+    typename N::Accum sum = (from > 0) ? prefix[from - 1] : typename N::Accum();
+    if ((from == 0) && (count > 0)) {
+        prefix[0] = sum;
+        from = 1;
+    }
+    if (from >= count) {
+        return;
+    }
+    T x0 = N::from(x[from - 1]);
+    T y0 = N::from(y[from - 1]);
+    for (size_t i = from; i < count; i++) {
+        T x1 = N::from(x[i]);
+        T y1 = N::from(y[i]);
+        sum += N::trapezoid(x0, x1, y0, y1);
+        prefix[i] = sum;
+        x0 = x1;
+        y0 = y1;
+    }
+}
+
+/**
+ * @brief Min/max envelope of samples [from, to) in `columns` buckets, see `spectrumEnvelopeCompute()`, in `T`
+ *        arithmetic: the samples are converted from `S` as they are read and the columns back to `S`.
+ */
+template <typename T, typename S>
+bool spectrumEnvelope(const S *x, const S *y, size_t from, size_t to, uint16_t columns, S *out_x, S *out_min,
+                      S *out_max, S *y_min, S *y_max)
+{
+    typedef SpectrumNumeric<T> N;
+    if ((to <= from) || (columns == 0)) {
+        return false;
+    }
+
+    const T x_first = N::from(x[from]);
+    const T span = N::from(x[to - 1]) - x_first;
+    typename N::Columns column(span, columns);
+
+    for (uint16_t c = 0; c < columns; c++) {
+        N::store(N::center(x_first, span, c, columns), out_x[c]);
+    }
+
+    int current = 0;
+    T lo = N::from(y[from]);
+    T hi = lo;
+    T prev_x = x_first;
+    T prev_y = lo;
+    T all_lo = lo;
+    T all_hi = lo;
+
+    for (size_t i = from + 1; i < to; i++) {
+        const T xi = N::from(x[i]);
+        const T yi = N::from(y[i]);
+        // The x column is monotonic, so columns are visited in order, whatever the direction of the file
+        int c = column.of(xi - x_first);
+        c = (c >= (int)columns) ? (int)columns - 1 : c;
+        if (c > current) {
+            N::store(lo, out_min[current]);
+            N::store(hi, out_max[current]);
+            // Columns no sample falls into get the line between the two neighbouring samples
+            for (int e = current + 1; e < c; e++) {
+                T v = N::interpolate(prev_y, yi, N::center(x_first, span, e, columns) - prev_x, xi - prev_x);
+                N::store(v, out_min[e]);
+                N::store(v, out_max[e]);
+            }
+            current = c;
+            lo = yi;
+            hi = yi;
+        } else {
+            lo = (yi < lo) ? yi : lo;
+            hi = (yi > hi) ? yi : hi;
+        }
+        all_lo = (yi < all_lo) ? yi : all_lo;
+        all_hi = (yi > all_hi) ? yi : all_hi;
+        prev_x = xi;
+        prev_y = yi;
+    }
+    N::store(lo, out_min[current]);
+    N::store(hi, out_max[current]);
+    for (int e = current + 1; e < (int)columns; e++) {
+        N::store(prev_y, out_min[e]);
+        N::store(prev_y, out_max[e]);
+    }
+
+    N::store(all_lo, *y_min);
+    N::store(all_hi, *y_max);
+    return true;
+}
@@ -0,0 +1,179 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "spectrum_port.h"
+#include "spectrum_overlay.h"
+
+SpectrumOverlay::SpectrumOverlay():
+    _count(0),
+    _settings()
+{
+    for (int i = 0; i < SPECTRUM_OVERLAY_MAX_SERIES; i++) {
+        _series[i].offset = 0;
+        _series[i].count = 0;
+        _series[i].name[0] = '\0';
+    }
+    _settings = _series[0].processor.settings();
+}
+
+int SpectrumOverlay::add(const float *x, const float *y, size_t count, const char *name)
+{
+    if ((_count >= SPECTRUM_OVERLAY_MAX_SERIES) || (count < 2)) {
+        return -1;
+    }
+
+    // The pool grows to the exact size: series are added rarely and the arena is kept for the next ones
+    size_t offset = _pool.size();
+    if (!_pool.reserve(offset + count) || !_pool.resize(offset + count)) {
+        return -1;
+    }
+    memcpy(_pool.x() + offset, x, count * sizeof(float));
+    memcpy(_pool.y() + offset, y, count * sizeof(float));
+
+    Series &series = _series[_count];
+    if (!series.index.build(_pool.x() + offset, _pool.y() + offset, count)) {
+        _pool.resize(offset);
+        return -1;
+    }
+    series.offset = offset;
+    series.count = count;
+    snprintf(series.name, sizeof(series.name), "%s", (name != nullptr) ? name : "");
+    series.processor.configure(_settings);
+    _count++;
+
+    // Reserving may have moved the pool under every series
+    if (!bind()) {
+        remove(_count - 1);
+        return -1;
+    }
+    return (int)(_count - 1);
+}
+
+void SpectrumOverlay::remove(size_t series)
+{
+    if (series >= _count) {
+        return;
+    }
+
+    const size_t offset = _series[series].offset;
+    const size_t removed = _series[series].count;
+    const size_t tail = _pool.size() - offset - removed;
+    memmove(_pool.x() + offset, _pool.x() + offset + removed, tail * sizeof(float));
+    memmove(_pool.y() + offset, _pool.y() + offset + removed, tail * sizeof(float));
+    _pool.resize(_pool.size() - removed);
+
+    // Area tables hold sums relative to their own first sample, so they move down with their series unchanged
+    for (size_t i = series; i + 1 < _count; i++) {
+        Series &to = _series[i];
+        Series &from = _series[i + 1];
+        to.offset = from.offset - removed;
+        to.count = from.count;
+        memcpy(to.name, from.name, sizeof(to.name));
+        to.index.swap(from.index);
+    }
+    _count--;
+    _series[_count].index.clear();
+    _series[_count].processor.clear();
+    bind();
+}
+
+void SpectrumOverlay::clear(void)
+{
+    for (size_t i = 0; i < _count; i++) {
+        _series[i].index.clear();
+        _series[i].processor.clear();
+    }
+    _count = 0;
+    _pool.clear();
+    _pyramid.clear();
+    _decimator.setPyramid(nullptr);
+}
+
+bool SpectrumOverlay::bind(void)
+{
+    bool ok = true;
+    for (size_t i = 0; i < _count; i++) {
+        Series &series = _series[i];
+        const float *x = _pool.x() + series.offset;
+        const float *y = _pool.y() + series.offset;
+        series.index.attach(x, y, series.count);
+        ok = series.processor.attach(x, y, series.count, &series.index) && ok;
+    }
+
+    // The pyramid only ever answers ranges inside one series, so one over the whole pool serves them all
+    if ((_count > 0) && _pyramid.build(_pool.x(), _pool.y(), _pool.size())) {
+        _decimator.setPyramid(&_pyramid);
+    } else {
+        _pyramid.clear();
+        _decimator.setPyramid(nullptr);
+    }
+    return ok;
+}
+
+bool SpectrumOverlay::configure(const SpectrumProcessSettings &settings)
+{
+    if (!_series[0].processor.configure(settings)) {
+        return false;
+    }
+    for (int i = 1; i < SPECTRUM_OVERLAY_MAX_SERIES; i++) {
+        _series[i].processor.configure(settings);
+    }
+    _settings = settings;
+    return true;
+}
+
+const SpectrumProcessResult &SpectrumOverlay::process(size_t series, double lower, double upper)
+{
+    return _series[series].processor.process(lower, upper);
+}
+
+bool SpectrumOverlay::envelope(size_t series, double x_first, double x_last, uint16_t columns, float *out_min,
+                               float *out_max, float &y_min, float &y_max)
+{
+    if ((series >= _count) || (columns == 0) || (x_first == x_last)) {
+        return false;
+    }
+    const Series &s = _series[series];
+    size_t from, to;
+    if (!s.index.samplesBetween(x_first, x_last, from, to)) {
+        return false;
+    }
+
+    // Columns of the axis the series' first and last samples fall into
+    const float *x = _pool.x() + s.offset;
+    const double scale = columns / (x_last - x_first);
+    double a = (x[from] - x_first) * scale;
+    double b = (x[to - 1] - x_first) * scale;
+    const bool reversed = b < a;
+    int first = (int)floor(reversed ? b : a);
+    int last = (int)floor(reversed ? a : b) + 1;
+    first = (first < 0) ? 0 : ((first >= (int)columns) ? (int)columns - 1 : first);
+    last = (last > (int)columns) ? (int)columns : ((last <= first) ? first + 1 : last);
+    const uint16_t width = (uint16_t)(last - first);
+
+    const SpectrumEnvelope *env = _decimator.envelope(_pool.x(), _pool.y(), s.offset + from, s.offset + to, width);
+    if (env == nullptr) {
+        return false;
+    }
+    for (int c = 0; c < (int)columns; c++) {
+        out_min[c] = NAN;
+        out_max[c] = NAN;
+    }
+    for (uint16_t k = 0; k < width; k++) {
+        int c = reversed ? last - 1 - k : first + k;
+        out_min[c] = env->min[k];
+        out_max[c] = env->max[k];
+    }
+    y_min = env->y_min;
+    y_max = env->y_max;
+    return true;
+}
+
+size_t SpectrumOverlay::bytes(void) const
+{
+    size_t total = _pool.bytes() + _pyramid.bytes();
+    for (size_t i = 0; i < _count; i++) {
+        total += _series[i].count * (sizeof(double) + sizeof(float));
+    }
+    return total;
+}
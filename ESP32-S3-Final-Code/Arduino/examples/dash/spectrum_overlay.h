@@ -0,0 +1,135 @@
+/*
+ * Spectra overlaid on the displayed one for comparison, e.g. the other concentrations of a series.
+ *
+ * Every series is copied into one pooled `SpectrumStore`, one after the other, so memory grows with the points loaded
+ * and not with a fixed array per series. A single pyramid is built over the whole pool and a single decimator caches
+ * the envelopes of all series: a series is a contiguous sample range of the pool, which is all either needs. Each
+ * series keeps its own area index and processor over its part of the pool for its area readout.
+ *
+ * Envelopes are placed on a shared wavenumber axis, so column c covers the same wavenumbers for every series (to within
+ * a column, each envelope being bucketed over its own first and last sample) whatever its sampling, direction or
+ * extent.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectrum_store.h"
+#include "spectrum_index.h"
+#include "spectrum_pyramid.h"
+#include "spectrum_decimate.h"
+#include "spectrum_process.h"
+
+#define SPECTRUM_OVERLAY_MAX_SERIES     (4)     // As many as `SpectrumDecimator::CACHE_ENTRIES`, so a redraw all hits
+#define SPECTRUM_OVERLAY_NAME_MAX       (32)
+
+class SpectrumOverlay {
+public:
+    SpectrumOverlay();
+
+    SpectrumOverlay(const SpectrumOverlay &) = delete;
+    SpectrumOverlay &operator=(const SpectrumOverlay &) = delete;
+
+    /**
+     * @brief Copy a spectrum into the pool as a new series. O(total points): the pyramid is rebuilt over the pool.
+     *
+     * @param name Shown next to its readout, truncated to `SPECTRUM_OVERLAY_NAME_MAX - 1` characters
+     *
+     * @return Its index, -1 if `SPECTRUM_OVERLAY_MAX_SERIES` are loaded, it has fewer than two samples or memory
+     *         could not be allocated (the other series are kept)
+     */
+    int add(const float *x, const float *y, size_t count, const char *name);
+
+    /**
+     * @brief Drop series `series`, moving the later ones down in the pool. Their indices shift down by one.
+     */
+    void remove(size_t series);
+
+    /**
+     * @brief Drop every series but keep the pool and the tables for the next ones.
+     */
+    void clear(void);
+
+    /**
+     * @brief Apply processing settings to every series, and to those added later.
+     *
+     * @return false, keeping the previous settings, if they are not supported
+     */
+    bool configure(const SpectrumProcessSettings &settings);
+
+    /**
+     * @brief Baseline corrected area and peaks of `series` over [lower, upper], see `SpectrumProcessor::process()`.
+     */
+    const SpectrumProcessResult &process(size_t series, double lower, double upper);
+
+    /**
+     * @brief Envelope of `series` on a shared axis of `columns` columns running from wavenumber `x_first` to `x_last`
+     *        (either may be the larger), like the columns `spectrumEnvelopeCompute()` gives a spectrum sampled from
+     *        `x_first` to `x_last`. Columns the series does not reach are NAN. Served from the shared cache when the
+     *        axis is unchanged.
+     *
+     * @param y_min, y_max Extents of the series over the axis
+     *
+     * @return false if the series does not overlap the axis, or its envelope could not be allocated
+     */
+    bool envelope(size_t series, double x_first, double x_last, uint16_t columns, float *out_min, float *out_max,
+                  float &y_min, float &y_max);
+
+    size_t count(void) const
+    {
+        return _count;
+    }
+
+    const char *name(size_t series) const
+    {
+        return _series[series].name;
+    }
+
+    size_t points(size_t series) const
+    {
+        return _series[series].count;
+    }
+
+    const float *x(size_t series) const
+    {
+        return _pool.x() + _series[series].offset;
+    }
+
+    const float *y(size_t series) const
+    {
+        return _pool.y() + _series[series].offset;
+    }
+
+    const SpectrumIndex &index(size_t series) const
+    {
+        return _series[series].index;
+    }
+
+    /**
+     * @brief Bytes held by the pool, the pyramid, and the area index and smoothed copy of each series.
+     */
+    size_t bytes(void) const;
+
+    const SpectrumDecimator &decimator(void) const
+    {
+        return _decimator;
+    }
+
+private:
+    struct Series {
+        size_t offset;              // First sample in the pool
+        size_t count;
+        char name[SPECTRUM_OVERLAY_NAME_MAX];
+        SpectrumIndex index;
+        SpectrumProcessor processor;
+    };
+
+    bool bind(void);
+
+    SpectrumStore _pool;
+    SpectrumPyramid _pyramid;
+    SpectrumDecimator _decimator;
+    Series _series[SPECTRUM_OVERLAY_MAX_SERIES];
+    size_t _count;
+    SpectrumProcessSettings _settings;
+};
@@ -0,0 +1,219 @@
+#include <string.h>
+#include "spectrum_port.h"
+
+#if defined(ARDUINO)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+struct SpectrumTask {
+    SpectrumTaskFn fn;
+    void *arg;
+    SemaphoreHandle_t done;
+};
+
+struct SpectrumQueue {
+    QueueHandle_t handle;
+};
+
+static TickType_t spectrum_ticks(uint32_t timeout_ms)
+{
+    return (timeout_ms == SPECTRUM_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+}
+
+static void spectrum_task_entry(void *arg)
+{
+    SpectrumTask *task = static_cast<SpectrumTask *>(arg);
+    task->fn(task->arg);
+    xSemaphoreGive(task->done);
+    vTaskDelete(NULL);
+}
+
+SpectrumTask *spectrum_task_start(const char *name, SpectrumTaskFn fn, void *arg, uint32_t stack_size, int priority,
+                                  int core)
+{
+    SpectrumTask *task = new SpectrumTask{fn, arg, xSemaphoreCreateBinary()};
+    if (task->done == NULL) {
+        delete task;
+        return nullptr;
+    }
+    BaseType_t ret = xTaskCreatePinnedToCore(spectrum_task_entry, name, stack_size, task, priority, NULL,
+                                             (core < 0) ? tskNO_AFFINITY : core);
+    if (ret != pdPASS) {
+        vSemaphoreDelete(task->done);
+        delete task;
+        return nullptr;
+    }
+    return task;
+}
+
+void spectrum_task_join(SpectrumTask *task)
+{
+    if (task == nullptr) {
+        return;
+    }
+    xSemaphoreTake(task->done, portMAX_DELAY);
+    vSemaphoreDelete(task->done);
+    delete task;
+}
+
+SpectrumQueue *spectrum_queue_create(size_t length, size_t item_size)
+{
+    QueueHandle_t handle = xQueueCreate(length, item_size);
+    return (handle == NULL) ? nullptr : new SpectrumQueue{handle};
+}
+
+void spectrum_queue_delete(SpectrumQueue *queue)
+{
+    if (queue != nullptr) {
+        vQueueDelete(queue->handle);
+        delete queue;
+    }
+}
+
+bool spectrum_queue_send(SpectrumQueue *queue, const void *item, uint32_t timeout_ms)
+{
+    return xQueueSend(queue->handle, item, spectrum_ticks(timeout_ms)) == pdTRUE;
+}
+
+bool spectrum_queue_receive(SpectrumQueue *queue, void *item, uint32_t timeout_ms)
+{
+    return xQueueReceive(queue->handle, item, spectrum_ticks(timeout_ms)) == pdTRUE;
+}
+#else
+#include <errno.h>
+#include <pthread.h>
+
+struct SpectrumTask {
+    SpectrumTaskFn fn;
+    void *arg;
+    pthread_t thread;
+};
+
+struct SpectrumQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *items;
+    size_t item_size;
+    size_t length;
+    size_t head;
+    size_t count;
+};
+
+static void *spectrum_task_entry(void *arg)
+{
+    SpectrumTask *task = static_cast<SpectrumTask *>(arg);
+    task->fn(task->arg);
+    return nullptr;
+}
+
+SpectrumTask *spectrum_task_start(const char *name, SpectrumTaskFn fn, void *arg, uint32_t stack_size, int priority,
+                                  int core)
+{
+    (void)name;
+    (void)stack_size;
+    (void)priority;
+    (void)core;
+    SpectrumTask *task = new SpectrumTask{fn, arg, pthread_t()};
+    if (pthread_create(&task->thread, nullptr, spectrum_task_entry, task) != 0) {
+        delete task;
+        return nullptr;
+    }
+    return task;
+}
+
+void spectrum_task_join(SpectrumTask *task)
+{
+    if (task == nullptr) {
+        return;
+    }
+    pthread_join(task->thread, nullptr);
+    delete task;
+}
+
+SpectrumQueue *spectrum_queue_create(size_t length, size_t item_size)
+{
+    uint8_t *items = static_cast<uint8_t *>(malloc(length * item_size));
+    if (items == nullptr) {
+        return nullptr;
+    }
+    SpectrumQueue *queue = new SpectrumQueue;
+    pthread_mutex_init(&queue->lock, nullptr);
+    pthread_cond_init(&queue->not_empty, nullptr);
+    pthread_cond_init(&queue->not_full, nullptr);
+    queue->items = items;
+    queue->item_size = item_size;
+    queue->length = length;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+void spectrum_queue_delete(SpectrumQueue *queue)
+{
+    if (queue == nullptr) {
+        return;
+    }
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->items);
+    delete queue;
+}
+
+// Wait on `cond` until `ready()` holds or the timeout expires, with `queue->lock` held
+template <typename Ready>
+static bool spectrum_queue_wait(SpectrumQueue *queue, pthread_cond_t *cond, uint32_t timeout_ms, Ready ready)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (!ready()) {
+        if (timeout_ms == SPECTRUM_WAIT_FOREVER) {
+            pthread_cond_wait(cond, &queue->lock);
+        } else if ((timeout_ms == 0) || (pthread_cond_timedwait(cond, &queue->lock, &deadline) == ETIMEDOUT)) {
+            return ready();
+        }
+    }
+    return true;
+}
+
+bool spectrum_queue_send(SpectrumQueue *queue, const void *item, uint32_t timeout_ms)
+{
+    pthread_mutex_lock(&queue->lock);
+    bool ok = spectrum_queue_wait(queue, &queue->not_full, timeout_ms, [queue]() {
+        return queue->count < queue->length;
+    });
+    if (ok) {
+        size_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+        queue->count++;
+        pthread_cond_signal(&queue->not_empty);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok;
+}
+
+bool spectrum_queue_receive(SpectrumQueue *queue, void *item, uint32_t timeout_ms)
+{
+    pthread_mutex_lock(&queue->lock);
+    bool ok = spectrum_queue_wait(queue, &queue->not_empty, timeout_ms, [queue]() {
+        return queue->count > 0;
+    });
+    if (ok) {
+        memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return ok;
+}
+#endif
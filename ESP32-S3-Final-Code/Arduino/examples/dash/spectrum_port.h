@@ -0,0 +1,169 @@
+/*
+ * Minimal platform shim for the spectrum analysis core.
+ *
+ * The `spectrum_*` sources are plain C++ so that they build both inside the Arduino sketch and on a Linux host
+ * (see `host/CMakeLists.txt`). Everything that differs between the two lives here.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include "esp_memory_utils.h"
+#include "esp_lib_utils.h"
+#include "esp_cpu.h"
+
+static inline uint32_t spectrum_time_us(void)
+{
+    return (uint32_t)micros();
+}
+
+/**
+ * Cheap clocks for the metrics scopes (see `spectrum_metrics.h`): the CPU cycle counter (CCOUNT), which wraps every
+ * 2^32 cycles (~18 s at 240 MHz), and the scheduler tick, coarse but nearly free to read, to notice that it did.
+ */
+static inline uint32_t spectrum_cycles(void)
+{
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+static inline uint32_t spectrum_cycles_per_us(void)
+{
+    return getCpuFrequencyMhz();
+}
+
+static inline uint32_t spectrum_time_ms_coarse(void)
+{
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+static inline int spectrum_core_id(void)
+{
+    return (int)xPortGetCoreID();
+}
+
+/**
+ * Large spectrum buffers go through the esp-lib-utils general allocator. With PSRAM enabled, the Arduino core serves
+ * allocations above `CONFIG_SPIRAM_MALLOC_ALWAYSINTERNAL` from PSRAM, which keeps internal SRAM for LVGL draw buffers.
+ */
+static inline void *spectrum_malloc(size_t size)
+{
+    return esp_utils_mem_gen_malloc(size);
+}
+
+static inline void spectrum_free(void *p)
+{
+    esp_utils_mem_gen_free(p);
+}
+
+static inline bool spectrum_is_external_ram(const void *p)
+{
+    return esp_ptr_external_ram(p);
+}
+#else
+#include <stdlib.h>
+#include <time.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+static inline void *spectrum_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static inline void spectrum_free(void *p)
+{
+    free(p);
+}
+
+static inline bool spectrum_is_external_ram(const void *p)
+{
+    (void)p;
+    return false;
+}
+
+static inline uint32_t spectrum_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL);
+}
+
+// The host has no cycle counter to read from user space: "cycles" are nanoseconds, wrapping every ~4.3 s
+static inline uint32_t spectrum_cycles(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+static inline uint32_t spectrum_cycles_per_us(void)
+{
+    return 1000;
+}
+
+static inline uint32_t spectrum_time_ms_coarse(void)
+{
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC_COARSE)
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL);
+}
+
+/**
+ * The metrics keep one set of histograms per core of the ESP32-S3; host threads are folded onto the same two.
+ */
+static inline int spectrum_core_id(void)
+{
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+    return (cpu < 0) ? 0 : (cpu & 1);
+#else
+    return 0;
+#endif
+}
+#endif
+
+/*
+ * Tasks and queues for work that must not run on the LVGL thread. On the device they are FreeRTOS tasks and queues,
+ * on the host pthreads and a mutex/condition-variable ring buffer with the same semantics (see `spectrum_port.cpp`).
+ */
+#define SPECTRUM_WAIT_FOREVER       (UINT32_MAX)
+
+struct SpectrumTask;
+struct SpectrumQueue;
+
+typedef void (*SpectrumTaskFn)(void *arg);
+
+/**
+ * @brief Run `fn(arg)` in a new task. `core` is ignored on the host, -1 means any core.
+ *
+ * @return nullptr if the task could not be created
+ */
+SpectrumTask *spectrum_task_start(const char *name, SpectrumTaskFn fn, void *arg, uint32_t stack_size, int priority,
+                                  int core);
+
+/**
+ * @brief Wait for the task function to return and release the handle.
+ */
+void spectrum_task_join(SpectrumTask *task);
+
+/**
+ * @brief Fixed-size FIFO of `length` items of `item_size` bytes, copied in and out. Safe between any two tasks.
+ *
+ * @return nullptr if it could not be allocated
+ */
+SpectrumQueue *spectrum_queue_create(size_t length, size_t item_size);
+void spectrum_queue_delete(SpectrumQueue *queue);
+
+/**
+ * @return false if the queue stayed full (send) or empty (receive) for `timeout_ms`
+ */
+bool spectrum_queue_send(SpectrumQueue *queue, const void *item, uint32_t timeout_ms);
+bool spectrum_queue_receive(SpectrumQueue *queue, void *item, uint32_t timeout_ms);
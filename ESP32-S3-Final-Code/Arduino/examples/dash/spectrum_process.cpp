@@ -0,0 +1,634 @@
+#include <math.h>
+#include <string.h>
+#include "spectrum_port.h"
+#include "spectrum_process.h"
+
+#define MAX_TERMS       (SPECTRUM_BASELINE_DEGREE + 1)
+#define MAX_SAVGOL_ORDER (6)
+
+// Solve the n x n system a * x = b in place, by Gaussian elimination with partial pivoting
+static bool solveSmall(double *a, double *b, int n, double *x)
+{
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) {
+            if (fabs(a[row * n + col]) > fabs(a[pivot * n + col])) {
+                pivot = row;
+            }
+        }
+        if (!(fabs(a[pivot * n + col]) > 1e-12)) {
+            return false;
+        }
+        for (int k = 0; k < n; k++) {
+            double tmp = a[col * n + k];
+            a[col * n + k] = a[pivot * n + k];
+            a[pivot * n + k] = tmp;
+        }
+        double tmp = b[col];
+        b[col] = b[pivot];
+        b[pivot] = tmp;
+        for (int row = col + 1; row < n; row++) {
+            double factor = a[row * n + col] / a[col * n + col];
+            for (int k = col; k < n; k++) {
+                a[row * n + k] -= factor * a[col * n + k];
+            }
+            b[row] -= factor * b[col];
+        }
+    }
+    for (int row = n - 1; row >= 0; row--) {
+        double sum = b[row];
+        for (int k = row + 1; k < n; k++) {
+            sum -= a[row * n + k] * x[k];
+        }
+        x[row] = sum / a[row * n + row];
+    }
+    return true;
+}
+
+double SpectrumBaseline::at(double x) const
+{
+    double t = (x - center) / half_width;
+    double p = coef[degree];
+    for (int k = degree - 1; k >= 0; k--) {
+        p = p * t + coef[k];
+    }
+    return p;
+}
+
+double SpectrumBaseline::integral(double lo, double hi) const
+{
+    double t_lo = (lo - center) / half_width;
+    double t_hi = (hi - center) / half_width;
+    double sum = 0;
+    double p_lo = t_lo;
+    double p_hi = t_hi;
+    for (int k = 0; k <= degree; k++) {
+        sum += coef[k] * (p_hi - p_lo) / (k + 1);
+        p_lo *= t_lo;
+        p_hi *= t_hi;
+    }
+    return sum * half_width;
+}
+
+SpectrumBaseline spectrumBaselineLinear(double lower, double y_lower, double upper, double y_upper)
+{
+    SpectrumBaseline baseline = {};
+    baseline.degree = 1;
+    baseline.center = 0.5 * (lower + upper);
+    baseline.half_width = 0.5 * (upper - lower);
+    baseline.coef[0] = 0.5 * (y_lower + y_upper);
+    baseline.coef[1] = 0.5 * (y_upper - y_lower);
+    return baseline;
+}
+
+bool spectrumBaselineFit(const float *t, float *y, size_t count, double lower, double y_lower, double upper,
+                         double y_upper, int degree, SpectrumBaseline &baseline)
+{
+    // p(t) = a0 + a1 t + (1 - t^2) (c0 + c1 t + ...): the line through both ends plus a bow that vanishes there, whose
+    // coefficients are fitted to the residual r = y - a0 - a1 t in the basis (1 - t^2) t^j
+    int terms = degree - 1;
+    if ((degree < 2) || (degree > SPECTRUM_BASELINE_DEGREE) || (count <= (size_t)terms)) {
+        return false;
+    }
+    double a0 = 0.5 * (y_lower + y_upper);
+    double a1 = 0.5 * (y_upper - y_lower);
+
+    // Sums of the powers of t, the same for every pass
+    double power_sums[2 * MAX_TERMS - 1] = {};
+    for (size_t i = 0; i < count; i++) {
+        double p = 1;
+        for (int k = 0; k <= 2 * degree; k++) {
+            power_sums[k] += p;
+            p *= t[i];
+        }
+    }
+
+    double c[MAX_TERMS] = {};
+    float clip[MAX_TERMS] = {};
+    for (int pass = 0; pass <= SPECTRUM_BASELINE_ITERATIONS; pass++) {
+        double moments[MAX_TERMS];
+        spectrumClipMoments(t, y, count, (pass == 0) ? nullptr : clip, degree, moments);
+        double a[MAX_TERMS * MAX_TERMS];
+        double b[MAX_TERMS];
+        for (int j = 0; j < terms; j++) {
+            for (int k = 0; k < terms; k++) {
+                a[j * terms + k] = power_sums[j + k] - 2 * power_sums[j + k + 2] + power_sums[j + k + 4];
+            }
+            b[j] = moments[j] - moments[j + 2] - a0 * (power_sums[j] - power_sums[j + 2]) -
+                   a1 * (power_sums[j + 1] - power_sums[j + 3]);
+        }
+        if (!solveSmall(a, b, terms, c)) {
+            return false;
+        }
+        for (int k = 0; k <= degree; k++) {
+            double bow = ((k < terms) ? c[k] : 0) - ((k >= 2) ? c[k - 2] : 0);
+            clip[k] = (float)(((k == 0) ? a0 : (k == 1) ? a1 : 0) + bow);
+        }
+    }
+
+    baseline = SpectrumBaseline();
+    baseline.degree = (uint8_t)degree;
+    baseline.center = 0.5 * (lower + upper);
+    baseline.half_width = 0.5 * (upper - lower);
+    for (int k = 0; k <= degree; k++) {
+        baseline.coef[k] = ((k == 0) ? a0 : (k == 1) ? a1 : 0) + ((k < terms) ? c[k] : 0) - ((k >= 2) ? c[k - 2] : 0);
+    }
+    return true;
+}
+
+bool spectrumSavgolCoefficients(int window, int order, float *coef)
+{
+    if ((window < 3) || (window > SPECTRUM_SMOOTH_MAX_WINDOW) || ((window & 1) == 0) || (order < 0) ||
+            (order >= window) || (order > MAX_SAVGOL_ORDER)) {
+        return false;
+    }
+    // Least squares polynomial over the window, evaluated at its centre: coef = e0' (A'A)^-1 A', with the offsets
+    // scaled to [-1, 1] to keep A'A well conditioned
+    int half = window / 2;
+    int terms = order + 1;
+    double a[(MAX_SAVGOL_ORDER + 1) * (MAX_SAVGOL_ORDER + 1)] = {};
+    for (int k = -half; k <= half; k++) {
+        double u = (double)k / half;
+        for (int i = 0; i < terms; i++) {
+            for (int j = 0; j < terms; j++) {
+                a[i * terms + j] += pow(u, i + j);
+            }
+        }
+    }
+    double e0[MAX_SAVGOL_ORDER + 1] = {1};
+    double z[MAX_SAVGOL_ORDER + 1];
+    if (!solveSmall(a, e0, terms, z)) {
+        return false;
+    }
+    for (int k = -half; k <= half; k++) {
+        double u = (double)k / half;
+        double c = 0;
+        for (int j = terms - 1; j >= 0; j--) {
+            c = c * u + z[j];
+        }
+        coef[k + half] = (float)c;
+    }
+    return true;
+}
+
+void spectrumConvolveScalar(const float *in, float *out, size_t count, const float *coef, int window)
+{
+    for (size_t i = 0; i < count; i++) {
+        float acc = 0;
+        for (int k = 0; k < window; k++) {
+            acc += coef[k] * in[i + k];
+        }
+        out[i] = acc;
+    }
+}
+
+void spectrumSubtractPolynomialScalar(const float *t, const float *y, float *out, size_t count, const float *coef,
+                                      int degree)
+{
+    for (size_t i = 0; i < count; i++) {
+        float p = coef[degree];
+        for (int k = degree - 1; k >= 0; k--) {
+            p = p * t[i] + coef[k];
+        }
+        out[i] = y[i] - p;
+    }
+}
+
+void spectrumClipMomentsScalar(const float *t, float *y, size_t count, const float *coef, int degree,
+                               double *moments)
+{
+    for (int k = 0; k <= degree; k++) {
+        moments[k] = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        float v = y[i];
+        if (coef != nullptr) {
+            float p = coef[degree];
+            for (int k = degree - 1; k >= 0; k--) {
+                p = p * t[i] + coef[k];
+            }
+            v = (v > p) ? p : v;
+            y[i] = v;
+        }
+        double tk = 1;
+        for (int k = 0; k <= degree; k++) {
+            moments[k] += tk * v;
+            tk *= t[i];
+        }
+    }
+}
+
+#if SPECTRUM_PROCESS_SIMD
+
+typedef float Vec4 __attribute__((vector_size(16)));
+
+static inline Vec4 load4(const float *p)
+{
+    Vec4 v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store4(float *p, Vec4 v)
+{
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+static inline Vec4 horner4(Vec4 t, const float *coef, int degree)
+{
+    Vec4 p = coef[degree] + (Vec4){};
+    for (int k = degree - 1; k >= 0; k--) {
+        p = p * t + coef[k];
+    }
+    return p;
+}
+
+void spectrumConvolve(const float *in, float *out, size_t count, const float *coef, int window)
+{
+    // Eight outputs per step, as two independent accumulators, each tap a broadcast and two unaligned loads
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        Vec4 acc0 = {};
+        Vec4 acc1 = {};
+        for (int k = 0; k < window; k++) {
+            acc0 += coef[k] * load4(in + i + k);
+            acc1 += coef[k] * load4(in + i + k + 4);
+        }
+        store4(out + i, acc0);
+        store4(out + i + 4, acc1);
+    }
+    spectrumConvolveScalar(in + i, out + i, count - i, coef, window);
+}
+
+void spectrumSubtractPolynomial(const float *t, const float *y, float *out, size_t count, const float *coef,
+                                int degree)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        store4(out + i, load4(y + i) - horner4(load4(t + i), coef, degree));
+    }
+    spectrumSubtractPolynomialScalar(t + i, y + i, out + i, count - i, coef, degree);
+}
+
+void spectrumClipMoments(const float *t, float *y, size_t count, const float *coef, int degree, double *moments)
+{
+    // Float lanes, added into the double sums every block so that long ranges keep their precision
+    const size_t block = 256;
+    for (int k = 0; k <= degree; k++) {
+        moments[k] = 0;
+    }
+    size_t i = 0;
+    while (i + 4 <= count) {
+        Vec4 acc[MAX_TERMS] = {};
+        size_t end = i + block;
+        for (; (i + 4 <= count) && (i < end); i += 4) {
+            Vec4 tv = load4(t + i);
+            Vec4 v = load4(y + i);
+            if (coef != nullptr) {
+                Vec4 p = horner4(tv, coef, degree);
+                v = (v > p) ? p : v;
+                store4(y + i, v);
+            }
+            Vec4 tk = v;
+            for (int k = 0; k <= degree; k++) {
+                acc[k] += tk;
+                tk *= tv;
+            }
+        }
+        for (int k = 0; k <= degree; k++) {
+            moments[k] += (double)acc[k][0] + (double)acc[k][1] + (double)acc[k][2] + (double)acc[k][3];
+        }
+    }
+    double tail[MAX_TERMS];
+    spectrumClipMomentsScalar(t + i, y + i, count - i, coef, degree, tail);
+    for (int k = 0; k <= degree; k++) {
+        moments[k] += tail[k];
+    }
+}
+
+#else
+
+void spectrumConvolve(const float *in, float *out, size_t count, const float *coef, int window)
+{
+    spectrumConvolveScalar(in, out, count, coef, window);
+}
+
+void spectrumSubtractPolynomial(const float *t, const float *y, float *out, size_t count, const float *coef,
+                                int degree)
+{
+    spectrumSubtractPolynomialScalar(t, y, out, count, coef, degree);
+}
+
+void spectrumClipMoments(const float *t, float *y, size_t count, const float *coef, int degree, double *moments)
+{
+    spectrumClipMomentsScalar(t, y, count, coef, degree, moments);
+}
+
+#endif
+
+SpectrumProcessor::SpectrumProcessor():
+    _x(nullptr),
+    _y(nullptr),
+    _count(0),
+    _index(nullptr),
+    _capacity(0),
+    _smoothed(nullptr),
+    _tile_done(nullptr),
+    _t(nullptr),
+    _work(nullptr),
+    _stack(nullptr),
+    _work_capacity(0),
+    _settings(),
+    _coef(),
+    _result(),
+    _valid(false),
+    _smoothed_now(0)
+{
+    _settings.baseline = SPECTRUM_BASELINE_NONE;
+}
+
+SpectrumProcessor::~SpectrumProcessor()
+{
+    spectrum_free(_smoothed);
+    spectrum_free(_tile_done);
+    spectrum_free(_t);
+    spectrum_free(_work);
+    spectrum_free(_stack);
+}
+
+bool SpectrumProcessor::reserve(size_t count)
+{
+    clear();
+    if (count > _capacity) {
+        size_t words = (count + 32 * SPECTRUM_PROCESS_TILE - 1) / (32 * SPECTRUM_PROCESS_TILE);
+        spectrum_free(_smoothed);
+        spectrum_free(_tile_done);
+        _smoothed = static_cast<float *>(spectrum_malloc(count * sizeof(float)));
+        _tile_done = static_cast<uint32_t *>(spectrum_malloc(words * sizeof(uint32_t)));
+        if ((_smoothed == nullptr) || (_tile_done == nullptr)) {
+            spectrum_free(_smoothed);
+            spectrum_free(_tile_done);
+            _smoothed = nullptr;
+            _tile_done = nullptr;
+            _capacity = 0;
+            return false;
+        }
+        _capacity = count;
+    }
+    return true;
+}
+
+bool SpectrumProcessor::attach(const float *x, const float *y, size_t count, const SpectrumIndex *index)
+{
+    if (!reserve(count)) {
+        return false;
+    }
+    size_t words = (count + 32 * SPECTRUM_PROCESS_TILE - 1) / (32 * SPECTRUM_PROCESS_TILE);
+    if (words > 0) {
+        memset(_tile_done, 0, words * sizeof(uint32_t));
+    }
+    _x = x;
+    _y = y;
+    _count = count;
+    _index = index;
+    return true;
+}
+
+void SpectrumProcessor::clear(void)
+{
+    _x = nullptr;
+    _y = nullptr;
+    _count = 0;
+    _index = nullptr;
+    _valid = false;
+}
+
+bool SpectrumProcessor::configure(const SpectrumProcessSettings &settings)
+{
+    bool smoothing = settings.smooth_window > 1;
+    float coef[SPECTRUM_SMOOTH_MAX_WINDOW];
+    if (smoothing && !spectrumSavgolCoefficients(settings.smooth_window, settings.smooth_order, coef)) {
+        return false;
+    }
+    if ((settings.smooth_window != _settings.smooth_window) || (settings.smooth_order != _settings.smooth_order)) {
+        if (smoothing) {
+            memcpy(_coef, coef, settings.smooth_window * sizeof(float));
+        }
+        if (_count > 0) {
+            memset(_tile_done, 0, ((_count + 32 * SPECTRUM_PROCESS_TILE - 1) / (32 * SPECTRUM_PROCESS_TILE)) *
+                   sizeof(uint32_t));
+        }
+    }
+    _settings = settings;
+    _valid = false;
+    return true;
+}
+
+void SpectrumProcessor::smoothTile(size_t tile)
+{
+    // The tile and `half` samples on either side, the spectrum's end samples repeated past its ends
+    float in[SPECTRUM_PROCESS_TILE + SPECTRUM_SMOOTH_MAX_WINDOW - 1];
+    int window = _settings.smooth_window;
+    ptrdiff_t half = window / 2;
+    size_t start = tile * SPECTRUM_PROCESS_TILE;
+    size_t end = (start + SPECTRUM_PROCESS_TILE < _count) ? start + SPECTRUM_PROCESS_TILE : _count;
+    ptrdiff_t first = (ptrdiff_t)start - half;
+    ptrdiff_t last = (ptrdiff_t)end + half;
+    ptrdiff_t copy_from = (first < 0) ? 0 : first;
+    ptrdiff_t copy_to = (last > (ptrdiff_t)_count) ? (ptrdiff_t)_count : last;
+    for (ptrdiff_t j = first; j < copy_from; j++) {
+        in[j - first] = _y[0];
+    }
+    memcpy(in + (copy_from - first), _y + copy_from, (copy_to - copy_from) * sizeof(float));
+    for (ptrdiff_t j = copy_to; j < last; j++) {
+        in[j - first] = _y[_count - 1];
+    }
+    spectrumConvolve(in, _smoothed + start, end - start, _coef, window);
+    _tile_done[tile / 32] |= 1u << (tile % 32);
+    _smoothed_now += end - start;
+}
+
+const float *SpectrumProcessor::smoothed(size_t from, size_t to)
+{
+    if (_settings.smooth_window <= 1) {
+        return _y + from;
+    }
+    for (size_t tile = from / SPECTRUM_PROCESS_TILE; tile * SPECTRUM_PROCESS_TILE < to; tile++) {
+        if ((_tile_done[tile / 32] & (1u << (tile % 32))) == 0) {
+            smoothTile(tile);
+        }
+    }
+    return _smoothed + from;
+}
+
+bool SpectrumProcessor::reserveWork(size_t count)
+{
+    if (count <= _work_capacity) {
+        return true;
+    }
+    spectrum_free(_t);
+    spectrum_free(_work);
+    spectrum_free(_stack);
+    _t = static_cast<float *>(spectrum_malloc(count * sizeof(float)));
+    _work = static_cast<float *>(spectrum_malloc(count * sizeof(float)));
+    _stack = static_cast<StackEntry *>(spectrum_malloc(count * sizeof(StackEntry)));
+    if ((_t == nullptr) || (_work == nullptr) || (_stack == nullptr)) {
+        spectrum_free(_t);
+        spectrum_free(_work);
+        spectrum_free(_stack);
+        _t = nullptr;
+        _work = nullptr;
+        _stack = nullptr;
+        _work_capacity = 0;
+        return false;
+    }
+    _work_capacity = count;
+    return true;
+}
+
+const SpectrumProcessResult &SpectrumProcessor::process(double lower, double upper)
+{
+    double lo = (lower < upper) ? lower : upper;
+    double hi = (lower < upper) ? upper : lower;
+    if (_count >= 2) {
+        lo = (lo < _index->minX()) ? _index->minX() : lo;
+        hi = (hi > _index->maxX()) ? _index->maxX() : hi;
+    }
+    if (_valid && (_result.lower == lo) && (_result.upper == hi)) {
+        _result.smoothed = 0;
+        return _result;
+    }
+
+    uint32_t start = spectrum_time_us();
+    _smoothed_now = 0;
+    _result = SpectrumProcessResult();
+    _result.lower = lo;
+    _result.upper = hi;
+    _result.baseline.center = 0.5 * (lo + hi);
+    _result.baseline.half_width = 0.5 * (hi - lo);
+    _valid = true;
+    size_t from = 0;
+    size_t to = 0;
+    if ((_count < 2) || (lo >= hi) || !_index->samplesBetween(lo, hi, from, to) || !reserveWork(to - from)) {
+        return _result;
+    }
+    size_t n = to - from;
+    for (size_t i = 0; i < n; i++) {
+        _t[i] = (float)((_x[from + i] - _result.baseline.center) / _result.baseline.half_width);
+    }
+
+    _result.raw_area = _index->areaBetween(lo, hi);
+    if (_settings.baseline != SPECTRUM_BASELINE_NONE) {
+        _result.baseline = spectrumBaselineLinear(lo, _index->valueAt(lo), hi, _index->valueAt(hi));
+    }
+    if (_settings.baseline == SPECTRUM_BASELINE_POLYNOMIAL) {
+        memcpy(_work, _y + from, n * sizeof(float));
+        SpectrumBaseline fitted;
+        if (spectrumBaselineFit(_t, _work, n, lo, _index->valueAt(lo), hi, _index->valueAt(hi),
+                                SPECTRUM_BASELINE_DEGREE, fitted)) {
+            _result.baseline = fitted;
+        }
+    }
+    _result.area = _result.raw_area - _result.baseline.integral(lo, hi);
+
+    float coef[MAX_TERMS] = {};
+    for (int k = 0; k <= _result.baseline.degree; k++) {
+        coef[k] = (float)_result.baseline.coef[k];
+    }
+    spectrumSubtractPolynomial(_t, smoothed(from, to), _work, n, coef, _result.baseline.degree);
+    findPeaks(from, to);
+
+    _result.smoothed = _smoothed_now;
+    _result.elapsed_us = spectrum_time_us() - start;
+    return _result;
+}
+
+// Local maxima of `_work` (samples [from, to) minus the baseline) standing out by the threshold, the tallest first.
+// A peak's prominence is its height over the higher of the lowest points between it and the nearest taller sample on
+// either side (or the end of the range), so the ripples of noise on a peak or its flanks do not count. Both sides are
+// found in one pass each with a stack of decreasing samples, each entry holding the lowest sample since the one below.
+void SpectrumProcessor::findPeaks(size_t from, size_t to)
+{
+    size_t n = to - from;
+    const float *v = _work;
+    const float *x = _x + from;
+    float tallest = 0;
+    for (size_t i = 0; i < n; i++) {
+        tallest = (v[i] > tallest) ? v[i] : tallest;
+    }
+    if (!(tallest > 0) || (n < 3)) {
+        return;
+    }
+    float threshold = tallest * _settings.peak_threshold;
+
+    float *left_base = _t;      // Free once the baseline has been subtracted
+    size_t top = 0;
+    for (size_t i = 0; i < n; i++) {
+        float low = v[i];
+        while ((top > 0) && (v[_stack[top - 1].index] <= v[i])) {
+            top--;
+            low = (_stack[top].min < low) ? _stack[top].min : low;
+        }
+        _stack[top++] = {(uint32_t)i, low};
+        left_base[i] = low;
+    }
+
+    size_t peaks[SPECTRUM_PROCESS_MAX_PEAKS];
+    int count = 0;
+    top = 0;
+    for (size_t i = n; i-- > 0; ) {
+        float low = v[i];
+        while ((top > 0) && (v[_stack[top - 1].index] <= v[i])) {
+            top--;
+            low = (_stack[top].min < low) ? _stack[top].min : low;
+        }
+        _stack[top++] = {(uint32_t)i, low};
+
+        bool local_max = (i > 0) && (i + 1 < n) && (v[i] > v[i - 1]) && (v[i] >= v[i + 1]);
+        float base = (left_base[i] > low) ? left_base[i] : low;
+        if (!local_max || (v[i] - base < threshold)) {
+            continue;
+        }
+        // Kept sorted by height, the lowest dropped once full
+        int pos = (count < SPECTRUM_PROCESS_MAX_PEAKS) ? count++ : SPECTRUM_PROCESS_MAX_PEAKS;
+        while ((pos > 0) && (v[peaks[pos - 1]] < v[i])) {
+            if (pos < SPECTRUM_PROCESS_MAX_PEAKS) {
+                peaks[pos] = peaks[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < SPECTRUM_PROCESS_MAX_PEAKS) {
+            peaks[pos] = i;
+        }
+    }
+
+    for (int p = 0; p < count; p++) {
+        size_t i = peaks[p];
+
+        // Vertex of the parabola through the top three samples
+        float curvature = v[i - 1] - 2 * v[i] + v[i + 1];
+        float d = (curvature < 0) ? 0.5f * (v[i - 1] - v[i + 1]) / curvature : 0.0f;
+        SpectrumPeak &peak = _result.peaks[p];
+        peak.height = v[i] - 0.25f * (v[i - 1] - v[i + 1]) * d;
+        peak.x = x[i] + d * 0.5 * ((double)x[i + 1] - (double)x[i - 1]);
+
+        // Half height crossings on both sides, interpolated between samples
+        float half = 0.5f * peak.height;
+        size_t a = i;
+        while ((a > 0) && (v[a] > half)) {
+            a--;
+        }
+        size_t b = i;
+        while ((b + 1 < n) && (v[b] > half)) {
+            b++;
+        }
+        if ((v[a] <= half) && (v[b] <= half)) {
+            double xa = x[a] + (x[a + 1] - x[a]) * (half - v[a]) / (v[a + 1] - v[a]);
+            double xb = x[b] + (x[b - 1] - x[b]) * (half - v[b]) / (v[b - 1] - v[b]);
+            peak.fwhm = (float)fabs(xb - xa);
+        } else {
+            peak.fwhm = NAN;
+        }
+    }
+    _result.peak_count = (uint8_t)count;
+}
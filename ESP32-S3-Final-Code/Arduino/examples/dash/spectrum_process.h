@@ -0,0 +1,207 @@
+/*
+ * Processing of the integration range: baseline subtraction, Savitzky-Golay smoothing and peak finding.
+ *
+ * The baseline runs between the curve's values at both ends of the range: either as a straight line, or as a polynomial
+ * through the same two points whose bow is fitted over the range by iterative clipping (each pass fits it, then lowers
+ * the samples above it onto it, so the peaks stop pulling it up and it settles on the background). Pinning the ends
+ * keeps it from sagging under peaks that cover much of the range. The corrected area is the
+ * trapezoid area from the index minus the exact integral of the baseline, so it does not depend on the offset of the
+ * spectrum, and a linear baseline costs O(log n) like the raw area.
+ *
+ * Peaks are searched in the smoothed spectrum minus the baseline. The smoothed spectrum is computed a tile of
+ * `SPECTRUM_PROCESS_TILE` samples at a time through a small buffer, so each sample is read once from PSRAM and written
+ * once, and it is kept: moving the range only smooths the tiles it has not covered yet.
+ *
+ * The kernels have a portable SIMD path written with GCC vector extensions (four floats), used where those map onto
+ * vector registers, and a scalar fallback. The ESP32-S3 runs the scalar one: its vector instructions are not reachable
+ * from portable code.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spectrum_index.h"
+
+#ifndef SPECTRUM_PROCESS_SIMD
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON) || defined(__aarch64__))
+#define SPECTRUM_PROCESS_SIMD           (1)
+#else
+#define SPECTRUM_PROCESS_SIMD           (0)
+#endif
+#endif
+
+#define SPECTRUM_PROCESS_TILE           (256)       // Samples smoothed at a time
+#define SPECTRUM_PROCESS_MAX_PEAKS      (8)
+#define SPECTRUM_SMOOTH_MAX_WINDOW      (51)
+#define SPECTRUM_BASELINE_DEGREE        (3)         // Of the polynomial baseline
+#define SPECTRUM_BASELINE_ITERATIONS    (20)
+
+enum SpectrumBaselineMode {
+    SPECTRUM_BASELINE_NONE,
+    SPECTRUM_BASELINE_LINEAR,           // Straight line between the curve at both ends of the range
+    SPECTRUM_BASELINE_POLYNOMIAL,       // Through the same points, bowed to the background by iterative clipping
+};
+
+/**
+ * @brief Polynomial in t = (x - center) / half_width, i.e. t in [-1, 1] over the range it was made for.
+ */
+struct SpectrumBaseline {
+    uint8_t degree;
+    double center;
+    double half_width;
+    double coef[SPECTRUM_BASELINE_DEGREE + 1];
+
+    double at(double x) const;
+
+    /**
+     * @brief Exact integral from `lo` to `hi`.
+     */
+    double integral(double lo, double hi) const;
+};
+
+/**
+ * @brief Baseline over [lower, upper]: the straight line through (lower, y_lower) and (upper, y_upper).
+ */
+SpectrumBaseline spectrumBaselineLinear(double lower, double y_lower, double upper, double y_upper);
+
+/**
+ * @brief Fit a polynomial baseline of `degree` (2 or more) through (lower, y_lower) and (upper, y_upper) by iterative
+ *        clipping to `count` samples of the range, given as t (see `SpectrumBaseline`) and y. `y` is overwritten with
+ *        the clipped samples.
+ *
+ * @return false if there are not enough samples for the degree
+ */
+bool spectrumBaselineFit(const float *t, float *y, size_t count, double lower, double y_lower, double upper,
+                         double y_upper, int degree, SpectrumBaseline &baseline);
+
+/**
+ * @brief Savitzky-Golay smoothing coefficients of an odd `window` (3 to `SPECTRUM_SMOOTH_MAX_WINDOW`) and polynomial
+ *        `order` (below the window).
+ *
+ * @return false if the window or order is not supported
+ */
+bool spectrumSavgolCoefficients(int window, int order, float *coef);
+
+/**
+ * @brief out[i] = sum of coef[k] * in[i + k] for k in [0, window): `in` holds `count + window - 1` samples.
+ */
+void spectrumConvolve(const float *in, float *out, size_t count, const float *coef, int window);
+void spectrumConvolveScalar(const float *in, float *out, size_t count, const float *coef, int window);
+
+/**
+ * @brief out[i] = y[i] - p(t[i]) for the polynomial of `degree` with coefficients `coef` (lowest first).
+ */
+void spectrumSubtractPolynomial(const float *t, const float *y, float *out, size_t count, const float *coef,
+                                int degree);
+void spectrumSubtractPolynomialScalar(const float *t, const float *y, float *out, size_t count, const float *coef,
+                                      int degree);
+
+/**
+ * @brief One pass of the clipping fit: y[i] = min(y[i], p(t[i])) if `coef` is not nullptr, then moments[k] = sum of
+ *        t[i]^k * y[i] for k up to `degree`.
+ */
+void spectrumClipMoments(const float *t, float *y, size_t count, const float *coef, int degree, double *moments);
+void spectrumClipMomentsScalar(const float *t, float *y, size_t count, const float *coef, int degree,
+                               double *moments);
+
+struct SpectrumPeak {
+    double x;               // Wavenumber of the top, interpolated between samples
+    float height;           // Above the baseline, in the smoothed curve
+    float fwhm;             // Full width at half height in wavenumbers, NAN if the range cuts the peak first
+};
+
+struct SpectrumProcessSettings {
+    uint8_t baseline;       // SpectrumBaselineMode
+    uint8_t smooth_window;  // Odd, 0 or 1 for no smoothing
+    uint8_t smooth_order;
+    float peak_threshold;   // Smallest prominence of a peak, as a fraction of the tallest point of the range
+};
+
+struct SpectrumProcessResult {
+    double lower;           // Range processed, clamped to the spectrum
+    double upper;
+    double raw_area;
+    double area;            // raw_area minus the integral of the baseline
+    SpectrumBaseline baseline;
+    SpectrumPeak peaks[SPECTRUM_PROCESS_MAX_PEAKS];     // Tallest first
+    uint8_t peak_count;
+    uint32_t smoothed;      // Samples smoothed by this call, 0 once the tiles of the range are all done
+    uint32_t elapsed_us;
+};
+
+class SpectrumProcessor {
+public:
+    SpectrumProcessor();
+    ~SpectrumProcessor();
+
+    SpectrumProcessor(const SpectrumProcessor &) = delete;
+    SpectrumProcessor &operator=(const SpectrumProcessor &) = delete;
+
+    /**
+     * @brief Process the samples `index` was built over. The arrays are not copied and must outlive the processor
+     *        or the next `attach()`. Buffers are kept and reused by later spectra of the same or smaller size.
+     *
+     * @return false if the smoothed copy could not be allocated
+     */
+    bool attach(const float *x, const float *y, size_t count, const SpectrumIndex *index);
+
+    /**
+     * @brief Allocate the buffers for `count` samples ahead, e.g. for a spectrum announced before it arrives, so that
+     *        attaching it as it grows allocates nothing.
+     *
+     * @return false if they could not be allocated (nothing is attached then)
+     */
+    bool reserve(size_t count);
+
+    void clear(void);
+
+    /**
+     * @brief Change the settings. Changing the smoothing drops the smoothed tiles.
+     *
+     * @return false, keeping the previous settings, if the smoothing window or order is not supported
+     */
+    bool configure(const SpectrumProcessSettings &settings);
+
+    const SpectrumProcessSettings &settings(void) const
+    {
+        return _settings;
+    }
+
+    /**
+     * @brief Baseline, corrected area and peaks over [lower, upper] (in either order). Asking again for the same
+     *        range with the same settings returns the previous result without any work.
+     */
+    const SpectrumProcessResult &process(double lower, double upper);
+
+    /**
+     * @brief Smoothed samples [from, to), computing the tiles that are not yet.
+     */
+    const float *smoothed(size_t from, size_t to);
+
+private:
+    struct StackEntry {
+        uint32_t index;
+        float min;                  // Lowest sample since the entry below
+    };
+
+    void smoothTile(size_t tile);
+    bool reserveWork(size_t count);
+    void findPeaks(size_t from, size_t to);
+
+    const float *_x;
+    const float *_y;
+    size_t _count;
+    const SpectrumIndex *_index;
+    size_t _capacity;
+    float *_smoothed;
+    uint32_t *_tile_done;           // One bit per tile of `_smoothed`
+    float *_t;                      // Range-sized work buffers
+    float *_work;
+    StackEntry *_stack;
+    size_t _work_capacity;
+    SpectrumProcessSettings _settings;
+    float _coef[SPECTRUM_SMOOTH_MAX_WINDOW];
+    SpectrumProcessResult _result;
+    bool _valid;                    // `_result` matches the range and settings
+    uint32_t _smoothed_now;
+};
@@ -0,0 +1,275 @@
+#include <float.h>
+#include <utility>
+#include "spectrum_port.h"
+#include "spectrum_numeric.h"
+#include "spectrum_pyramid.h"
+
+typedef SpectrumNumeric<SpectrumChartType> ChartNumeric;
+
+// A sample as `spectrumEnvelopeCompute()` outputs it: rounded to the chart's arithmetic and back
+static float chartValue(float v)
+{
+    float out;
+    ChartNumeric::store(ChartNumeric::from(v), out);
+    return out;
+}
+
+SpectrumPyramid::SpectrumPyramid():
+    _x(nullptr),
+    _y(nullptr),
+    _count(0),
+    _blocks(nullptr),
+    _capacity(0),
+    _levels(0),
+    _planned(0),
+    _planned_levels(0)
+{
+}
+
+SpectrumPyramid::~SpectrumPyramid()
+{
+    spectrum_free(_blocks);
+}
+
+void SpectrumPyramid::clear(void)
+{
+    _x = nullptr;
+    _y = nullptr;
+    _count = 0;
+    _levels = 0;
+    _planned = 0;
+    _planned_levels = 0;
+}
+
+void SpectrumPyramid::swap(SpectrumPyramid &other)
+{
+    std::swap(_x, other._x);
+    std::swap(_y, other._y);
+    std::swap(_count, other._count);
+    std::swap(_blocks, other._blocks);
+    std::swap(_capacity, other._capacity);
+    std::swap(_levels, other._levels);
+    std::swap(_planned, other._planned);
+    std::swap(_planned_levels, other._planned_levels);
+    std::swap(_level_offset, other._level_offset);
+}
+
+bool SpectrumPyramid::build(const float *x, const float *y, size_t count)
+{
+    clear();
+    if (!layout(count)) {
+        return false;
+    }
+    update(x, y, 0, count);
+    return true;
+}
+
+bool SpectrumPyramid::extend(const float *x, const float *y, size_t count)
+{
+    if ((_y == nullptr) || (count < _count)) {
+        return build(x, y, count);
+    }
+    if (count > _planned) {
+        // Lay out for half as many again, so appending a few samples at a time is amortised O(1) per sample
+        if (!layout(count + count / 2)) {
+            return false;
+        }
+        update(x, y, 0, count);
+        return true;
+    }
+    update(x, y, _count, count);
+    return true;
+}
+
+bool SpectrumPyramid::layout(size_t count)
+{
+    // Lay out the levels until one has no more than FANOUT blocks
+    size_t total = 0;
+    size_t blocks = count;
+    int levels = 0;
+    _level_offset[0] = 0;
+    while ((blocks > SPECTRUM_PYRAMID_FANOUT) && (levels < SPECTRUM_PYRAMID_MAX_LEVELS)) {
+        blocks = (blocks + SPECTRUM_PYRAMID_FANOUT - 1) / SPECTRUM_PYRAMID_FANOUT;
+        levels++;
+        _level_offset[levels] = total;
+        total += blocks;
+    }
+
+    if (total > _capacity) {
+        spectrum_free(_blocks);
+        _blocks = static_cast<float *>(spectrum_malloc(total * 2 * sizeof(float)));
+        _capacity = (_blocks == nullptr) ? 0 : total;
+        if (_blocks == nullptr) {
+            clear();
+            return false;
+        }
+    }
+    _planned = count;
+    _planned_levels = levels;
+    return true;
+}
+
+void SpectrumPyramid::update(const float *x, const float *y, size_t from, size_t count)
+{
+    // Only the blocks over samples [from, count) change, and the levels that did not exist yet
+    const int levels_before = (from == 0) ? 0 : _levels;
+    size_t blocks = count;
+    int levels = 0;
+    while ((blocks > SPECTRUM_PYRAMID_FANOUT) && (levels < _planned_levels)) {
+        blocks = (blocks + SPECTRUM_PYRAMID_FANOUT - 1) / SPECTRUM_PYRAMID_FANOUT;
+        levels++;
+    }
+
+    size_t below = count;
+    size_t dirty = from;
+    for (int level = 1; level <= levels; level++) {
+        float *out = _blocks + _level_offset[level] * 2;
+        size_t blocks_here = (below + SPECTRUM_PYRAMID_FANOUT - 1) / SPECTRUM_PYRAMID_FANOUT;
+        dirty = (level > levels_before) ? 0 : dirty / SPECTRUM_PYRAMID_FANOUT;
+        for (size_t j = dirty; j < blocks_here; j++) {
+            size_t first = j * SPECTRUM_PYRAMID_FANOUT;
+            size_t last = first + SPECTRUM_PYRAMID_FANOUT;
+            last = (last > below) ? below : last;
+            float lo = FLT_MAX;
+            float hi = -FLT_MAX;
+            if (level == 1) {
+                for (size_t i = first; i < last; i++) {
+                    lo = (y[i] < lo) ? y[i] : lo;
+                    hi = (y[i] > hi) ? y[i] : hi;
+                }
+            } else {
+                const float *in = _blocks + _level_offset[level - 1] * 2;
+                for (size_t i = first; i < last; i++) {
+                    lo = (in[i * 2] < lo) ? in[i * 2] : lo;
+                    hi = (in[i * 2 + 1] > hi) ? in[i * 2 + 1] : hi;
+                }
+            }
+            out[j * 2] = lo;
+            out[j * 2 + 1] = hi;
+        }
+        below = blocks_here;
+    }
+
+    _x = x;
+    _y = y;
+    _count = count;
+    _levels = levels;
+}
+
+bool SpectrumPyramid::rangeMinMax(size_t from, size_t to, float &lo, float &hi) const
+{
+    if ((from >= to) || (to > _count)) {
+        return false;
+    }
+
+    lo = FLT_MAX;
+    hi = -FLT_MAX;
+    size_t a = from;
+    size_t b = to;
+    size_t span = 1;
+    for (int level = 0; a < b; level++) {
+        const float *blocks = (level == 0) ? nullptr : _blocks + _level_offset[level] * 2;
+        if (level == _levels) {
+            // Top level: whatever is left is a run of whole blocks
+            for (size_t j = a / span; j < b / span; j++) {
+                float bl = (level == 0) ? _y[j] : blocks[j * 2];
+                float bh = (level == 0) ? _y[j] : blocks[j * 2 + 1];
+                lo = (bl < lo) ? bl : lo;
+                hi = (bh > hi) ? bh : hi;
+            }
+            break;
+        }
+
+        // Consume blocks of this level until both ends are aligned to the next one
+        size_t next = span * SPECTRUM_PYRAMID_FANOUT;
+        while ((a < b) && (a % next != 0)) {
+            size_t j = a / span;
+            float bl = (level == 0) ? _y[j] : blocks[j * 2];
+            float bh = (level == 0) ? _y[j] : blocks[j * 2 + 1];
+            lo = (bl < lo) ? bl : lo;
+            hi = (bh > hi) ? bh : hi;
+            a += span;
+        }
+        while ((b > a) && (b % next != 0)) {
+            b -= span;
+            size_t j = b / span;
+            float bl = (level == 0) ? _y[j] : blocks[j * 2];
+            float bh = (level == 0) ? _y[j] : blocks[j * 2 + 1];
+            lo = (bl < lo) ? bl : lo;
+            hi = (bh > hi) ? bh : hi;
+        }
+        span = next;
+    }
+
+    return true;
+}
+
+bool SpectrumPyramid::envelope(size_t from, size_t to, uint16_t columns, float *out_x, float *out_min,
+                               float *out_max, float *y_min, float *y_max) const
+{
+    if (!envelopeColumns(from, to, columns, 0, columns, out_x, out_min, out_max) ||
+        !rangeMinMax(from, to, *y_min, *y_max)) {
+        return false;
+    }
+    *y_min = chartValue(*y_min);
+    *y_max = chartValue(*y_max);
+    return true;
+}
+
+bool SpectrumPyramid::envelopeColumns(size_t from, size_t to, uint16_t columns, uint16_t first, uint16_t count,
+                                      float *out_x, float *out_min, float *out_max) const
+{
+    if ((to <= from) || (to > _count) || (columns == 0) || (first + count > columns)) {
+        return false;
+    }
+
+    // Same column assignment and arithmetic as `spectrumEnvelopeCompute()`, so both paths produce identical output
+    typedef SpectrumChartType T;
+    const T x_first = ChartNumeric::from(_x[from]);
+    const T span = ChartNumeric::from(_x[to - 1]) - x_first;
+    const ChartNumeric::Columns columns_of(span, columns);
+    auto column_of = [&](size_t i) -> int {
+        int c = columns_of.at(ChartNumeric::from(_x[i]) - x_first);
+        return (c >= (int)columns) ? (int)columns - 1 : c;
+    };
+    // First sample past column `c`
+    auto column_end = [&](size_t begin, int c) -> size_t {
+        size_t lo = begin;
+        size_t hi = to;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if ((mid != from) && (column_of(mid) > c)) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    };
+
+    size_t begin = (first == 0) ? from : column_end(from, first - 1);
+    for (uint16_t k = 0; k < count; k++) {
+        uint16_t c = first + k;
+        const T center = ChartNumeric::center(x_first, span, c, columns);
+        ChartNumeric::store(center, out_x[k]);
+        size_t end = column_end(begin, c);
+
+        if (end > begin) {
+            rangeMinMax(begin, end, out_min[k], out_max[k]);
+            out_min[k] = chartValue(out_min[k]);
+            out_max[k] = chartValue(out_max[k]);
+        } else if (begin < to) {
+            // Empty column: the line between the two neighbouring samples
+            T prev_x = ChartNumeric::from(_x[begin - 1]);
+            T v = ChartNumeric::interpolate(ChartNumeric::from(_y[begin - 1]), ChartNumeric::from(_y[begin]),
+                                            center - prev_x, ChartNumeric::from(_x[begin]) - prev_x);
+            ChartNumeric::store(v, out_min[k]);
+            out_max[k] = out_min[k];
+        } else {
+            out_min[k] = chartValue(_y[to - 1]);
+            out_max[k] = out_min[k];
+        }
+        begin = end;
+    }
+    return true;
+}
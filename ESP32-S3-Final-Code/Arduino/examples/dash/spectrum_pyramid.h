@@ -0,0 +1,111 @@
+/*
+ * Multi-resolution min/max pyramid over a loaded spectrum, for instant zoom and pan.
+ *
+ * Level k stores the min and max y of aligned blocks of `SPECTRUM_PYRAMID_FANOUT^k` samples. The min/max over any
+ * sample range is assembled from the coarsest blocks that fit inside it (at most `FANOUT - 1` blocks per level and
+ * side), so an envelope of W pixel columns costs O(W * log n) no matter how many samples each column covers.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPECTRUM_PYRAMID_FANOUT     (8)
+#define SPECTRUM_PYRAMID_MAX_LEVELS (12)
+
+class SpectrumPyramid {
+public:
+    SpectrumPyramid();
+    ~SpectrumPyramid();
+
+    SpectrumPyramid(const SpectrumPyramid &) = delete;
+    SpectrumPyramid &operator=(const SpectrumPyramid &) = delete;
+
+    /**
+     * @brief Build every level in one pass over the samples. The arrays are not copied and must outlive the pyramid.
+     *        The block table is kept and reused by later builds of the same or smaller size.
+     *
+     * @return false if the block table could not be allocated
+     */
+    bool build(const float *x, const float *y, size_t count);
+
+    /**
+     * @brief Add the samples appended since the last `build()` or `extend()`, recomputing only the blocks over them.
+     *        The levels are laid out for half as many samples again as needed, so a spectrum arriving a few samples
+     *        at a time costs amortised O(1) per sample. The first `size()` samples must be unchanged, but the arrays
+     *        may have moved.
+     *
+     * @return false if the block table could not be grown (the pyramid is then empty)
+     */
+    bool extend(const float *x, const float *y, size_t count);
+
+    void clear(void);
+
+    /**
+     * @brief Exchange block tables with `other`, together with the `SpectrumStore::swap()` of the samples.
+     */
+    void swap(SpectrumPyramid &other);
+
+    /**
+     * @brief Exact min and max y over samples [from, to).
+     *
+     * @return false if the range is empty
+     */
+    bool rangeMinMax(size_t from, size_t to, float &lo, float &hi) const;
+
+    /**
+     * @brief Same output as `spectrumEnvelopeCompute()` over the samples the pyramid was built from, but in
+     *        O(columns * log n) instead of O(to - from).
+     */
+    bool envelope(size_t from, size_t to, uint16_t columns, float *out_x, float *out_min, float *out_max,
+                  float *y_min, float *y_max) const;
+
+    /**
+     * @brief Columns [first, first + count) of that envelope alone, written from `out_x[0]` on. Lets a wide envelope
+     *        be produced a block at a time through a small buffer.
+     *
+     * @return false if the range is empty or the columns are out of range
+     */
+    bool envelopeColumns(size_t from, size_t to, uint16_t columns, uint16_t first, uint16_t count, float *out_x,
+                         float *out_min, float *out_max) const;
+
+    size_t size(void) const
+    {
+        return _count;
+    }
+
+    /**
+     * @brief The x array the pyramid was built over; changes with every `build()` or `swap()` of a new spectrum.
+     */
+    const float *x(void) const
+    {
+        return _x;
+    }
+
+    int levels(void) const
+    {
+        return _levels;
+    }
+
+    /**
+     * @brief Bytes held by the block table.
+     */
+    size_t bytes(void) const
+    {
+        return _capacity * 2 * sizeof(float);
+    }
+
+private:
+    bool layout(size_t count);
+    void update(const float *x, const float *y, size_t from, size_t count);
+
+    const float *_x;
+    const float *_y;
+    size_t _count;
+    float *_blocks;                                 // min/max pairs of every level, level 1 first
+    size_t _capacity;                               // Pairs allocated in `_blocks`
+    int _levels;                                    // Levels above the raw samples
+    size_t _planned;                                // Samples the levels are laid out for, at least `_count`
+    int _planned_levels;
+    size_t _level_offset[SPECTRUM_PYRAMID_MAX_LEVELS + 1];
+};
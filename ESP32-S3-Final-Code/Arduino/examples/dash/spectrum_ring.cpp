@@ -0,0 +1,68 @@
+#include <string.h>
+#include "spectrum_port.h"
+#include "spectrum_ring.h"
+
+SpectrumRing::SpectrumRing():
+    _buffer(nullptr),
+    _mask(0),
+    _head(0),
+    _tail(0)
+{
+}
+
+SpectrumRing::~SpectrumRing()
+{
+    spectrum_free(_buffer);
+}
+
+bool SpectrumRing::begin(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    if ((_buffer == nullptr) || (size != _mask + 1)) {
+        spectrum_free(_buffer);
+        _buffer = static_cast<uint8_t *>(spectrum_malloc(size));
+        _mask = (_buffer == nullptr) ? 0 : size - 1;
+    }
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    return _buffer != nullptr;
+}
+
+uint8_t *SpectrumRing::writeSpan(size_t &length)
+{
+    if (_buffer == nullptr) {
+        length = 0;
+        return nullptr;
+    }
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t space = capacity() - (head - _tail.load(std::memory_order_acquire));
+    size_t to_end = capacity() - (head & _mask);
+    length = (space < to_end) ? space : to_end;
+    return _buffer + (head & _mask);
+}
+
+void SpectrumRing::commitWrite(size_t length)
+{
+    _head.store(_head.load(std::memory_order_relaxed) + length, std::memory_order_release);
+}
+
+size_t SpectrumRing::spans(size_t offset, size_t length, const uint8_t *&first, const uint8_t *&second) const
+{
+    size_t start = (_tail.load(std::memory_order_relaxed) + offset) & _mask;
+    size_t to_end = capacity() - start;
+    first = _buffer + start;
+    second = _buffer;
+    return (length < to_end) ? length : to_end;
+}
+
+void SpectrumRing::read(size_t offset, void *out, size_t length) const
+{
+    const uint8_t *first;
+    const uint8_t *second;
+    size_t n = spans(offset, length, first, second);
+    memcpy(out, first, n);
+    memcpy(static_cast<uint8_t *>(out) + n, second, length - n);
+}
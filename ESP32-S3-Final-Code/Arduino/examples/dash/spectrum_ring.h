@@ -0,0 +1,89 @@
+/*
+ * Single-producer, single-consumer byte ring between a task reading a serial port and the thread decoding what it
+ * read.
+ *
+ * Neither side ever copies through a buffer of its own: the producer is handed the free space as one contiguous span
+ * to read the port straight into, and the consumer reads frames where they lie (see `SpectrumIngest`). The positions
+ * are free-running counters published with release/acquire atomics, so neither side takes a lock.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+class SpectrumRing {
+public:
+    SpectrumRing();
+    ~SpectrumRing();
+
+    SpectrumRing(const SpectrumRing &) = delete;
+    SpectrumRing &operator=(const SpectrumRing &) = delete;
+
+    /**
+     * @brief Allocate `capacity` bytes, rounded up to a power of two, and empty the ring. Not while either side runs.
+     *
+     * @return false if they could not be allocated
+     */
+    bool begin(size_t capacity);
+
+    /**
+     * @brief Producer: contiguous free space to write into, up to the end of the storage.
+     *
+     * @param length Receives its size, 0 if the ring is full
+     */
+    uint8_t *writeSpan(size_t &length);
+
+    /**
+     * @brief Producer: publish `length` bytes written into the span.
+     */
+    void commitWrite(size_t length);
+
+    /**
+     * @brief Consumer: bytes ready to be read.
+     */
+    size_t available(void) const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Consumer: byte `offset` past the oldest one, which must be below `available()`.
+     */
+    uint8_t peek(size_t offset) const
+    {
+        return _buffer[(_tail.load(std::memory_order_relaxed) + offset) & _mask];
+    }
+
+    /**
+     * @brief Consumer: the `length` bytes from `offset` past the oldest one as at most two contiguous spans, the
+     *        second one only when they wrap around the end of the storage.
+     *
+     * @return Length of the first span
+     */
+    size_t spans(size_t offset, size_t length, const uint8_t *&first, const uint8_t *&second) const;
+
+    /**
+     * @brief Consumer: copy `length` bytes from `offset` past the oldest one.
+     */
+    void read(size_t offset, void *out, size_t length) const;
+
+    /**
+     * @brief Consumer: drop the `length` oldest bytes, giving their space back to the producer.
+     */
+    void consume(size_t length)
+    {
+        _tail.store(_tail.load(std::memory_order_relaxed) + length, std::memory_order_release);
+    }
+
+    size_t capacity(void) const
+    {
+        return _mask + 1;
+    }
+
+private:
+    uint8_t *_buffer;
+    size_t _mask;
+    std::atomic<size_t> _head;      // Bytes ever written, owned by the producer
+    std::atomic<size_t> _tail;      // Bytes ever consumed, owned by the consumer
+};
@@ -0,0 +1,71 @@
+#include <string.h>
+#include <utility>
+#include "spectrum_port.h"
+#include "spectrum_store.h"
+
+SpectrumStore::SpectrumStore():
+    _arena(nullptr),
+    _x(nullptr),
+    _y(nullptr),
+    _size(0),
+    _capacity(0)
+{
+}
+
+SpectrumStore::~SpectrumStore()
+{
+    spectrum_free(_arena);
+}
+
+bool SpectrumStore::reserve(size_t count)
+{
+    if (count <= _capacity) {
+        return true;
+    }
+
+    float *arena = static_cast<float *>(spectrum_malloc(count * 2 * sizeof(float)));
+    if (arena == nullptr) {
+        return false;
+    }
+    if (_size > 0) {
+        memcpy(arena, _x, _size * sizeof(float));
+        memcpy(arena + count, _y, _size * sizeof(float));
+    }
+    spectrum_free(_arena);
+
+    _arena = arena;
+    _x = arena;
+    _y = arena + count;
+    _capacity = count;
+    return true;
+}
+
+void SpectrumStore::swap(SpectrumStore &other)
+{
+    std::swap(_arena, other._arena);
+    std::swap(_x, other._x);
+    std::swap(_y, other._y);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+}
+
+bool SpectrumStore::resize(size_t count)
+{
+    if (count > _capacity) {
+        return false;
+    }
+    _size = count;
+    return true;
+}
+
+size_t SpectrumStore::estimateRows(uint64_t file_size)
+{
+    // The shortest meaningful row is "1,2\n" (4 bytes), but real exports are ~20 bytes per row. Size for 12 and let
+    // `push()` grow the arena in the rare case that is not enough.
+    return (size_t)(file_size / 12) + 16;
+}
+
+bool SpectrumStore::inExternalRam(void) const
+{
+    return (_arena != nullptr) && spectrum_is_external_ram(_arena);
+}
@@ -0,0 +1,124 @@
+/*
+ * Dynamically sized spectrum storage.
+ *
+ * Samples are kept as structure-of-arrays floats (`x[]` then `y[]`) in a single arena allocated through
+ * `spectrum_malloc()` (PSRAM on the board). The arena only ever grows: loading a smaller file after a larger one reuses
+ * the existing block instead of freeing and reallocating it, which avoids fragmenting the heap.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class SpectrumStore {
+public:
+    SpectrumStore();
+    ~SpectrumStore();
+
+    SpectrumStore(const SpectrumStore &) = delete;
+    SpectrumStore &operator=(const SpectrumStore &) = delete;
+
+    /**
+     * @brief Make room for at least `count` samples, keeping the current contents.
+     *
+     * @return false if the arena could not be grown (the current contents are kept)
+     */
+    bool reserve(size_t count);
+
+    /**
+     * @brief Forget the samples but keep the arena for the next load.
+     */
+    void clear(void)
+    {
+        _size = 0;
+    }
+
+    /**
+     * @brief Exchange samples and arenas with `other`, e.g. to publish a spectrum loaded in the background. Nothing is
+     *        copied, so pointers into either arena stay valid.
+     */
+    void swap(SpectrumStore &other);
+
+    /**
+     * @brief Set the number of valid samples, e.g. after filling `x()`/`y()` directly from a cache.
+     *
+     * @return false if `count` exceeds the capacity
+     */
+    bool resize(size_t count);
+
+    /**
+     * @brief Append one sample, growing the arena by 1.5x when full.
+     *
+     * @return false if the arena could not be grown
+     */
+    bool push(float x, float y)
+    {
+        if ((_size == _capacity) && !reserve(grownCapacity())) {
+            return false;
+        }
+        _x[_size] = x;
+        _y[_size] = y;
+        _size++;
+        return true;
+    }
+
+    /**
+     * @brief Rough upper bound on the rows of a CSV of `file_size` bytes, used to size the arena before parsing.
+     */
+    static size_t estimateRows(uint64_t file_size);
+
+    float *x(void)
+    {
+        return _x;
+    }
+
+    float *y(void)
+    {
+        return _y;
+    }
+
+    const float *x(void) const
+    {
+        return _x;
+    }
+
+    const float *y(void) const
+    {
+        return _y;
+    }
+
+    size_t size(void) const
+    {
+        return _size;
+    }
+
+    size_t capacity(void) const
+    {
+        return _capacity;
+    }
+
+    /**
+     * @brief Bytes held by the arena.
+     */
+    size_t bytes(void) const
+    {
+        return _capacity * 2 * sizeof(float);
+    }
+
+    /**
+     * @brief Whether the arena lives in external RAM (always false on the host).
+     */
+    bool inExternalRam(void) const;
+
+private:
+    size_t grownCapacity(void) const
+    {
+        return (_capacity < 1024) ? 1024 : (_capacity + _capacity / 2);
+    }
+
+    float *_arena;
+    float *_x;
+    float *_y;
+    size_t _size;
+    size_t _capacity;
+};
@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include "virtual_list.h"
+
+VirtualList::VirtualList():
+    _list(nullptr),
+    _rows(),
+    _labels(),
+    _bound(),
+    _row_count(0),
+    _row_height(0),
+    _count(0),
+    _offset(0),
+    _velocity(0),
+    _dragged(0),
+    _fling(nullptr),
+    _text(nullptr),
+    _select(nullptr),
+    _user_data(nullptr),
+    _rebinds(0)
+{
+}
+
+lv_obj_t *VirtualList::create(lv_obj_t *parent, lv_coord_t width, lv_coord_t height, lv_coord_t row_height,
+                              VirtualListTextCallback text, VirtualListSelectCallback select, void *user_data)
+{
+    _text = text;
+    _select = select;
+    _user_data = user_data;
+    _row_height = row_height;
+    _count = 0;
+    _offset = 0;
+    _velocity = 0;
+    _rebinds = 0;
+
+    _list = lv_list_create(parent);
+    lv_obj_set_size(_list, width, height);
+    // Rows are placed by hand and the list scrolls itself, see the header
+    lv_obj_set_layout(_list, 0);
+    lv_obj_clear_flag(_list, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_event_cb(_list, listEventCb, LV_EVENT_ALL, this);
+
+    // Sized for the whole list, padding added later by the caller's styles only leaves a row spare
+    _row_count = height / row_height + 2;
+    _row_count = (_row_count > VIRTUAL_LIST_MAX_ROWS) ? VIRTUAL_LIST_MAX_ROWS : _row_count;
+
+    for (int i = 0; i < _row_count; i++) {
+        _rows[i] = lv_list_add_btn(_list, NULL, "");
+        _labels[i] = lv_obj_get_child(_rows[i], 0);
+        lv_obj_set_size(_rows[i], lv_pct(100), row_height);
+        lv_label_set_long_mode(_labels[i], LV_LABEL_LONG_DOT);
+        lv_obj_add_flag(_rows[i], LV_OBJ_FLAG_EVENT_BUBBLE);
+        lv_obj_add_event_cb(_rows[i], rowEventCb, LV_EVENT_CLICKED, this);
+        _bound[i] = SIZE_MAX;
+    }
+
+    if (_fling == nullptr) {
+        _fling = lv_timer_create(flingTimerCb, VIRTUAL_LIST_FLING_PERIOD, this);
+    }
+    lv_timer_pause(_fling);
+
+    bindRows(true);
+    return _list;
+}
+
+void VirtualList::setCount(size_t count)
+{
+    _count = count;
+    _offset = 0;
+    _velocity = 0;
+    if (_fling != nullptr) {
+        lv_timer_pause(_fling);
+    }
+    bindRows(true);
+}
+
+void VirtualList::refresh(void)
+{
+    bindRows(true);
+}
+
+int64_t VirtualList::maxOffset(void) const
+{
+    lv_obj_update_layout(_list);
+    return (int64_t)_count * _row_height - lv_obj_get_content_height(_list);
+}
+
+void VirtualList::scrollBy(int32_t dy)
+{
+    int64_t max_offset = maxOffset();
+    int64_t offset = (int64_t)_offset - dy;
+    offset = (offset > max_offset) ? max_offset : offset;
+    offset = (offset < 0) ? 0 : offset;
+    if (offset != _offset) {
+        _offset = (int32_t)offset;
+        bindRows(false);
+    }
+}
+
+// Place the rows for the current offset and point the ones that moved to another item at its text
+void VirtualList::bindRows(bool force)
+{
+    if (_list == nullptr) {
+        return;
+    }
+
+    size_t first = (size_t)(_offset / _row_height);
+    lv_coord_t shift = (lv_coord_t)(_offset % _row_height);
+    for (int i = 0; i < _row_count; i++) {
+        size_t item = first + i;
+        if (item >= _count) {
+            _bound[i] = SIZE_MAX;
+            lv_obj_add_flag(_rows[i], LV_OBJ_FLAG_HIDDEN);
+            continue;
+        }
+        lv_obj_set_y(_rows[i], i * _row_height - shift);
+        if (force || (_bound[i] != item)) {
+            lv_label_set_text_static(_labels[i], _text(item, _user_data));
+            lv_obj_clear_flag(_rows[i], LV_OBJ_FLAG_HIDDEN);
+            _bound[i] = item;
+            _rebinds++;
+        }
+    }
+}
+
+void VirtualList::listEventCb(lv_event_t *e)
+{
+    VirtualList *self = static_cast<VirtualList *>(lv_event_get_user_data(e));
+    lv_event_code_t code = lv_event_get_code(e);
+
+    if (code == LV_EVENT_DELETE) {
+        // Deleted with its screen
+        self->_list = nullptr;
+        self->_row_count = 0;
+        if (self->_fling != nullptr) {
+            lv_timer_del(self->_fling);
+            self->_fling = nullptr;
+        }
+    } else if (code == LV_EVENT_PRESSED) {
+        self->_dragged = 0;
+        self->_velocity = 0;
+        lv_timer_pause(self->_fling);
+    } else if (code == LV_EVENT_PRESSING) {
+        lv_point_t vect;
+        lv_indev_get_vect(lv_indev_get_act(), &vect);
+        if (vect.y != 0) {
+            self->_dragged += abs(vect.y);
+            self->_velocity = vect.y;
+            self->scrollBy(vect.y);
+        }
+    } else if (code == LV_EVENT_RELEASED) {
+        if (abs(self->_velocity) > 2) {
+            lv_timer_resume(self->_fling);
+        }
+    }
+}
+
+void VirtualList::rowEventCb(lv_event_t *e)
+{
+    VirtualList *self = static_cast<VirtualList *>(lv_event_get_user_data(e));
+    if (self->_dragged > VIRTUAL_LIST_DRAG_SLOP) {
+        return;  // The end of a drag, not a click
+    }
+
+    lv_obj_t *row = lv_event_get_current_target(e);
+    for (int i = 0; i < self->_row_count; i++) {
+        if ((self->_rows[i] == row) && (self->_bound[i] != SIZE_MAX)) {
+            self->_select(self->_bound[i], self->_user_data);
+            return;
+        }
+    }
+}
+
+// Keep scrolling after a fast drag, slowing down by 10% per frame
+void VirtualList::flingTimerCb(lv_timer_t *timer)
+{
+    VirtualList *self = static_cast<VirtualList *>(timer->user_data);
+    self->scrollBy(self->_velocity);
+    self->_velocity = self->_velocity * 9 / 10;
+    if ((self->_velocity == 0) || (self->_offset == 0) || (self->_offset >= self->maxOffset())) {
+        self->_velocity = 0;
+        lv_timer_pause(timer);
+    }
+}
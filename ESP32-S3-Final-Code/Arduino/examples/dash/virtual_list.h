@@ -0,0 +1,99 @@
+/*
+ * Virtualized list on top of `lv_list`, for lists far longer than the screen (e.g. every CSV on the card).
+ *
+ * Only the rows that fit in the list (plus one) exist as LVGL objects. Scrolling moves them and rebinds their labels
+ * to other items with `lv_label_set_text_static()`, so no object is created or freed and nothing is allocated from
+ * the LVGL heap however many items there are or how far the list is scrolled.
+ *
+ * LVGL 8 coordinates are limited to +/-8191 px, which a list of a few hundred rows would exceed as a scrollable
+ * child, so the list does not use LVGL scrolling: it follows drags itself and keeps the scroll offset in 32 bits.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lvgl.h>
+
+#define VIRTUAL_LIST_MAX_ROWS       (24)    // Visible rows kept alive, enough for a full-height list
+#define VIRTUAL_LIST_DRAG_SLOP      (8)     // Drag distance (px) after which a release is not a click
+#define VIRTUAL_LIST_FLING_PERIOD   (16)    // Period of the fling timer, in ms
+
+/**
+ * @brief Text of item `item`. It must stay valid until the item is rebound or the count changes.
+ */
+typedef const char *(*VirtualListTextCallback)(size_t item, void *user_data);
+
+/**
+ * @brief Item `item` was clicked.
+ */
+typedef void (*VirtualListSelectCallback)(size_t item, void *user_data);
+
+class VirtualList {
+public:
+    VirtualList();
+
+    VirtualList(const VirtualList &) = delete;
+    VirtualList &operator=(const VirtualList &) = delete;
+
+    /**
+     * @brief Create the list and its row pool under `parent`. The LVGL objects are deleted with their parent; the
+     *        `VirtualList` notices and can be created again.
+     *
+     * @return The `lv_list` object, to position and style like any other
+     */
+    lv_obj_t *create(lv_obj_t *parent, lv_coord_t width, lv_coord_t height, lv_coord_t row_height,
+                     VirtualListTextCallback text, VirtualListSelectCallback select, void *user_data);
+
+    /**
+     * @brief Set the number of items and scroll back to the top, e.g. after the filter changed.
+     */
+    void setCount(size_t count);
+
+    /**
+     * @brief Re-read the text of every visible row.
+     */
+    void refresh(void);
+
+    lv_obj_t *obj(void) const
+    {
+        return _list;
+    }
+
+    size_t count(void) const
+    {
+        return _count;
+    }
+
+    /**
+     * @brief Rows rebound to another item since `create()`.
+     */
+    uint32_t rebinds(void) const
+    {
+        return _rebinds;
+    }
+
+private:
+    static void listEventCb(lv_event_t *e);
+    static void rowEventCb(lv_event_t *e);
+    static void flingTimerCb(lv_timer_t *timer);
+
+    int64_t maxOffset(void) const;
+    void scrollBy(int32_t dy);
+    void bindRows(bool force);
+
+    lv_obj_t *_list;
+    lv_obj_t *_rows[VIRTUAL_LIST_MAX_ROWS];
+    lv_obj_t *_labels[VIRTUAL_LIST_MAX_ROWS];
+    size_t _bound[VIRTUAL_LIST_MAX_ROWS];       // Item shown by each row, SIZE_MAX if hidden
+    int _row_count;
+    lv_coord_t _row_height;
+    size_t _count;
+    int32_t _offset;                            // Scroll position in px, 0 at the top
+    int32_t _velocity;                          // Last drag step, continued as a fling on release
+    int32_t _dragged;                           // Distance dragged since the press
+    lv_timer_t *_fling;
+    VirtualListTextCallback _text;
+    VirtualListSelectCallback _select;
+    void *_user_data;
+    uint32_t _rebinds;
+};
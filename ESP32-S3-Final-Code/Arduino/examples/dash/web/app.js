@@ -0,0 +1,227 @@
+// Concentration calculator page. Values come from /api/state and then as they change from the /api/events stream
+// (whether the panel or another page changed them), the chart envelope from /api/spectrum, and the sliders post to
+// /api/limits. The chart is drawn on a canvas here instead of with a charting library, so the page needs nothing but
+// the device.
+'use strict';
+
+const $ = (id) => document.getElementById(id);
+
+let state = null;                   // Last /api/state reply
+let envelope = new Float32Array(0); // x, min, max of each chart column
+let editing = false;                // Sliders moved here and not posted yet, updates from elsewhere leave them alone
+
+function niceStep(range, count) {
+  const raw = range / count;
+  const magnitude = Math.pow(10, Math.floor(Math.log10(raw)));
+  const n = raw / magnitude;
+  return magnitude * (n < 1.5 ? 1 : n < 3 ? 2 : n < 7 ? 5 : 10);
+}
+
+function formatTick(value, step) {
+  return value.toFixed(Math.max(0, -Math.floor(Math.log10(step))));
+}
+
+function drawChart() {
+  const canvas = $('chart');
+  const ratio = window.devicePixelRatio || 1;
+  const width = canvas.clientWidth;
+  const height = canvas.clientHeight;
+  canvas.width = width * ratio;
+  canvas.height = height * ratio;
+  const g = canvas.getContext('2d');
+  g.setTransform(ratio, 0, 0, ratio, 0, 0);
+  g.clearRect(0, 0, width, height);
+
+  const columns = envelope.length / 3;
+  if (columns < 1) {
+    return;
+  }
+  let xMin = Infinity, xMax = -Infinity, yMin = Infinity, yMax = -Infinity;
+  for (let i = 0; i < envelope.length; i += 3) {
+    xMin = Math.min(xMin, envelope[i]);
+    xMax = Math.max(xMax, envelope[i]);
+    yMin = Math.min(yMin, envelope[i + 1]);
+    yMax = Math.max(yMax, envelope[i + 2]);
+  }
+  if (xMax === xMin) {
+    xMax = xMin + 1;
+  }
+  if (yMax === yMin) {
+    yMax = yMin + 1;
+  }
+
+  const left = 60, right = 12, top = 12, bottom = 44;
+  const plotWidth = width - left - right;
+  const plotHeight = height - top - bottom;
+  const sx = (x) => left + (x - xMin) / (xMax - xMin) * plotWidth;
+  const sy = (y) => top + (1 - (y - yMin) / (yMax - yMin)) * plotHeight;
+
+  // Grid and tick labels
+  g.font = '12px sans-serif';
+  g.fillStyle = '#e0e0e0';
+  g.strokeStyle = 'rgba(255, 255, 255, 0.1)';
+  g.lineWidth = 1;
+  g.textAlign = 'center';
+  g.textBaseline = 'top';
+  const xStep = niceStep(xMax - xMin, Math.max(2, Math.floor(plotWidth / 90)));
+  for (let x = Math.ceil(xMin / xStep) * xStep; x <= xMax; x += xStep) {
+    g.beginPath();
+    g.moveTo(sx(x), top);
+    g.lineTo(sx(x), top + plotHeight);
+    g.stroke();
+    g.fillText(formatTick(x, xStep), sx(x), top + plotHeight + 4);
+  }
+  g.textAlign = 'right';
+  g.textBaseline = 'middle';
+  const yStep = niceStep(yMax - yMin, Math.max(2, Math.floor(plotHeight / 50)));
+  for (let y = Math.ceil(yMin / yStep) * yStep; y <= yMax; y += yStep) {
+    g.beginPath();
+    g.moveTo(left, sy(y));
+    g.lineTo(left + plotWidth, sy(y));
+    g.stroke();
+    g.fillText(formatTick(y, yStep), left - 6, sy(y));
+  }
+  g.textAlign = 'center';
+  g.textBaseline = 'bottom';
+  g.fillText('Wavenumber', left + plotWidth / 2, height);
+  g.save();
+  g.translate(12, top + plotHeight / 2);
+  g.rotate(-Math.PI / 2);
+  g.textBaseline = 'middle';
+  g.fillText('Intensity', 0, 0);
+  g.restore();
+
+  // Integration range
+  const lower = Number($('slider1').value);
+  const upper = Number($('slider2').value);
+  const a = sx(Math.max(xMin, Math.min(xMax, lower)));
+  const b = sx(Math.max(xMin, Math.min(xMax, upper)));
+  g.fillStyle = 'rgba(243, 156, 18, 0.2)';
+  g.fillRect(Math.min(a, b), top, Math.abs(b - a), plotHeight);
+
+  // Area under the upper edge of the envelope, then every column from its minimum to its maximum
+  g.beginPath();
+  g.moveTo(sx(envelope[0]), top + plotHeight);
+  for (let i = 0; i < envelope.length; i += 3) {
+    g.lineTo(sx(envelope[i]), sy(envelope[i + 2]));
+  }
+  g.lineTo(sx(envelope[envelope.length - 3]), top + plotHeight);
+  g.closePath();
+  g.fillStyle = 'rgba(52, 152, 219, 0.2)';
+  g.fill();
+
+  g.beginPath();
+  for (let i = 0; i < envelope.length; i += 3) {
+    g.lineTo(sx(envelope[i]), sy(envelope[i + 1]));
+    g.lineTo(sx(envelope[i]), sy(envelope[i + 2]));
+  }
+  g.strokeStyle = 'rgba(52, 152, 219, 1)';
+  g.lineWidth = 2;
+  g.stroke();
+}
+
+function updateLabels() {
+  const slider1 = $('slider1');
+  const slider2 = $('slider2');
+  // Keep slider1 < slider2
+  if (parseInt(slider1.value) >= parseInt(slider2.value)) {
+    if (parseInt(slider1.value) >= parseInt(slider2.max) - 1) {
+      slider1.value = parseInt(slider2.max) - 2;
+    } else {
+      slider2.value = parseInt(slider1.value) + 1;
+    }
+  }
+  $('label1').textContent = 'Wavenumber 1: ' + slider1.value;
+  $('label2').textContent = 'Wavenumber 2: ' + slider2.value;
+}
+
+// The device sends null for values it cannot compute, e.g. before calibration
+function formatValue(value) {
+  return (value === null) ? '-' : value.toFixed(2);
+}
+
+function showState(reply) {
+  state = reply;
+  $('concentrationLabel').textContent = 'Concentration: ' + formatValue(state.concentration);
+  $('areaLabel').textContent = 'Area: ' + formatValue(state.area);
+  if (!editing) {
+    for (const id of ['slider1', 'slider2']) {
+      $(id).min = state.min;
+      $(id).max = state.max;
+    }
+    $('slider1').value = state.lower;
+    $('slider2').value = state.upper;
+  }
+  updateLabels();
+  drawChart();
+}
+
+async function fetchJson(url, options) {
+  const reply = await fetch(url, options);
+  if (!reply.ok) {
+    throw new Error(url + ': ' + reply.status);
+  }
+  return reply.json();
+}
+
+// One column per device pixel of the canvas, as little-endian float32 x, min, max (the byte order of every platform
+// a browser runs on), so it goes straight into a Float32Array
+async function fetchEnvelope() {
+  const width = Math.max(1, Math.round($('chart').clientWidth * (window.devicePixelRatio || 1)));
+  const reply = await fetch('/api/spectrum?format=f32&width=' + width);
+  if (!reply.ok) {
+    throw new Error('/api/spectrum: ' + reply.status);
+  }
+  return new Float32Array(await reply.arrayBuffer());
+}
+
+async function showSpectrum() {
+  envelope = await fetchEnvelope();
+  drawChart();
+}
+
+// The device sends the latest state at most every 50 ms, and a spectrum event (also right after connecting) whenever
+// another file is loaded. The browser reconnects by itself after a network error, but not after an error status such
+// as the 503 of a device with too many pages open.
+function listen() {
+  const events = new EventSource('/api/events');
+  events.addEventListener('state', (event) => showState(JSON.parse(event.data)));
+  events.addEventListener('spectrum', () => showSpectrum());
+  events.onerror = () => {
+    if (events.readyState === EventSource.CLOSED) {
+      setTimeout(listen, 5000);
+    }
+  };
+}
+
+async function load() {
+  const reply = await fetchJson('/api/state');
+  $('loader').style.display = 'none';
+  $('mainContent').style.display = 'block';
+  showState(reply);
+  // Now that the page is laid out and the canvas has a width
+  listen();
+}
+
+for (const id of ['slider1', 'slider2']) {
+  $(id).addEventListener('input', () => {
+    editing = true;
+    updateLabels();
+    drawChart();
+  });
+}
+
+$('sliderForm').addEventListener('submit', async (event) => {
+  event.preventDefault();
+  const body = 'slider1=' + $('slider1').value + '&slider2=' + $('slider2').value;
+  const reply = await fetchJson('/api/limits', {
+    method: 'POST',
+    headers: {'Content-Type': 'application/x-www-form-urlencoded'},
+    body: body,
+  });
+  editing = false;
+  showState(reply);
+});
+
+window.addEventListener('resize', drawChart);
+load();
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Build step for the web page: inline style.css and app.js into index.html, minify the result, gzip it and write it to
+../web_assets.h as a const array with an ETag, so the sketch serves it from flash in one piece.
+
+The Arduino IDE has no pre-build hook, so the generated header is committed: run this after editing anything in web/.
+
+Usage: python3 build_web_assets.py [output]        (default: ../web_assets.h)
+"""
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def read(name):
+    with open(os.path.join(HERE, name), encoding='utf-8') as f:
+        return f.read()
+
+
+def strip_js_comments(source):
+    """Remove // and /* */ comments outside of string literals. The page has no regular expression literals."""
+    out = []
+    i = 0
+    quote = None
+    while i < len(source):
+        c = source[i]
+        if quote is not None:
+            out.append(c)
+            if c == '\\':
+                out.append(source[i + 1])
+                i += 1
+            elif c == quote:
+                quote = None
+        elif c in '\'"`':
+            quote = c
+            out.append(c)
+        elif source.startswith('//', i):
+            i = source.find('\n', i)
+            if i < 0:
+                break
+            continue
+        elif source.startswith('/*', i):
+            i = source.index('*/', i) + 2
+            continue
+        else:
+            out.append(c)
+        i += 1
+    return ''.join(out)
+
+
+def minify_js(source):
+    # Line breaks are kept so that automatic semicolon insertion cannot change the meaning of anything
+    lines = []
+    for line in strip_js_comments(source).splitlines():
+        parts = re.split(r'''('(?:\\.|[^'\\])*'|"(?:\\.|[^"\\])*"|`(?:\\.|[^`\\])*`)''', line.strip())
+        for k in range(0, len(parts), 2):
+            parts[k] = re.sub(r'\s+', ' ', parts[k])
+            parts[k] = re.sub(r' ?([{}()\[\];,:=<>?&|]) ?', r'\1', parts[k])
+        line = ''.join(parts)
+        if line:
+            lines.append(line)
+    return '\n'.join(lines)
+
+
+def minify_css(source):
+    source = re.sub(r'/\*.*?\*/', '', source, flags=re.S)
+    source = re.sub(r'\s+', ' ', source)
+    source = re.sub(r' ?([{};,>]) ?', r'\1', source)
+    source = re.sub(r': ', ':', source)
+    return source.replace(';}', '}').strip()
+
+
+def build_page():
+    html = read('index.html')
+    html = html.replace('<link rel="stylesheet" href="style.css">', '<style>' + minify_css(read('style.css')) + '</style>')
+    html = re.sub(r'\s*\n\s*', '', html)
+    html = re.sub(r'>\s+<', '><', html)
+    # After the HTML whitespace is gone, so the line breaks kept in the script survive
+    return html.replace('<script src="app.js"></script>', '<script>' + minify_js(read('app.js')) + '</script>')
+
+
+def c_array(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append('    ' + ' '.join('0x%02x,' % b for b in data[i:i + 16]))
+    return '\n'.join(rows)
+
+
+def main():
+    output = sys.argv[1] if len(sys.argv) > 1 else os.path.join(HERE, '..', 'web_assets.h')
+    sources = ['index.html', 'style.css', 'app.js']
+    raw_size = sum(len(read(name).encode('utf-8')) for name in sources)
+    page = build_page().encode('utf-8')
+    # mtime=0 keeps the output (and the ETag) identical for identical sources
+    packed = gzip.compress(page, compresslevel=9, mtime=0)
+    etag = hashlib.sha256(packed).hexdigest()[:16]
+
+    with open(output, 'w', encoding='utf-8', newline='\n') as f:
+        f.write('''/*
+ * Web page of the sketch, generated by web/build_web_assets.py. Do not edit.
+ *
+ * %s: %d bytes, %d minified, %d gzipped.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WEB_INDEX_ETAG          "\\"%s\\""
+#define WEB_INDEX_CONTENT_TYPE  "text/html; charset=utf-8"
+
+static const uint8_t WEB_INDEX_GZ[] = {
+%s
+};
+''' % (', '.join('web/' + name for name in sources), raw_size, len(page), len(packed), etag, c_array(packed)))
+
+    print('%s: %d bytes of sources, %d minified, %d gzipped, ETag %s' %
+          (os.path.relpath(output), raw_size, len(page), len(packed), etag))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,202 @@
+/*
+ * Web page of the sketch, generated by web/build_web_assets.py. Do not edit.
+ *
+ * web/index.html, web/style.css, web/app.js: 11044 bytes, 8192 minified, 2989 gzipped.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WEB_INDEX_ETAG          "\"5f30a57d3d2f7c10\""
+#define WEB_INDEX_CONTENT_TYPE  "text/html; charset=utf-8"
+
+static const uint8_t WEB_INDEX_GZ[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x59, 0xeb, 0x73, 0xa3, 0x46,
+    0x12, 0xff, 0xee, 0xbf, 0x82, 0x68, 0x93, 0x00, 0x59, 0x90, 0x04, 0xb6, 0x7c, 0x36, 0x08, 0x6f,
+    0x92, 0x7d, 0x5c, 0x36, 0x95, 0x64, 0xb7, 0x62, 0xe7, 0x52, 0x57, 0xa9, 0xfd, 0x30, 0x82, 0x91,
+    0x34, 0x31, 0x02, 0x8a, 0x87, 0x25, 0xe2, 0xf8, 0x7f, 0xbf, 0xee, 0x9e, 0xe1, 0x25, 0xc9, 0x5e,
+    0xa7, 0xea, 0x4a, 0x65, 0x09, 0x66, 0xba, 0x7b, 0xba, 0x7f, 0xd3, 0x8f, 0xe9, 0xf1, 0xfc, 0x8b,
+    0x37, 0x1f, 0x5e, 0xdf, 0xfc, 0xf7, 0xe3, 0x5b, 0x6d, 0x5d, 0x6e, 0xe2, 0xab, 0xb9, 0xfa, 0xe6,
+    0x2c, 0xba, 0x9a, 0x6f, 0x78, 0xc9, 0xb4, 0x70, 0xcd, 0xf2, 0x82, 0x97, 0xc1, 0xa8, 0x2a, 0x97,
+    0xf6, 0xc5, 0x48, 0x8d, 0x26, 0x6c, 0xc3, 0x83, 0xd1, 0x9d, 0xe0, 0xdb, 0x2c, 0xcd, 0xcb, 0x91,
+    0x16, 0xa6, 0x49, 0xc9, 0x13, 0xa0, 0xda, 0x8a, 0xa8, 0x5c, 0x07, 0x11, 0xbf, 0x13, 0x21, 0xb7,
+    0xe9, 0xc5, 0xd2, 0x44, 0x22, 0x4a, 0xc1, 0x62, 0xbb, 0x08, 0x59, 0xcc, 0x03, 0x07, 0x64, 0xc4,
+    0x22, 0xb9, 0xd5, 0x72, 0x1e, 0x07, 0x23, 0x01, 0x9c, 0x23, 0x6d, 0x9d, 0xf3, 0x65, 0x30, 0x8a,
+    0x58, 0xc9, 0x3c, 0x0b, 0xa6, 0x4b, 0x51, 0xc6, 0xfc, 0xea, 0x75, 0x9a, 0x84, 0x20, 0x33, 0x67,
+    0xa5, 0x48, 0x13, 0xed, 0x35, 0x8b, 0xc3, 0x2a, 0x66, 0x65, 0x9a, 0xcf, 0x27, 0x72, 0x7e, 0x5e,
+    0x94, 0x35, 0xfc, 0xa0, 0xc6, 0xd6, 0x22, 0x8d, 0xea, 0xfb, 0x25, 0x28, 0x61, 0x2f, 0xd9, 0x46,
+    0xc4, 0xb5, 0x57, 0xd4, 0x45, 0xc9, 0x37, 0x76, 0x25, 0x2c, 0x9b, 0x65, 0x59, 0xcc, 0x6d, 0x39,
+    0x60, 0x8d, 0xae, 0xf9, 0x2a, 0xe5, 0xda, 0x6f, 0xef, 0x47, 0xd6, 0xaf, 0xe9, 0x22, 0x2d, 0x53,
+    0xab, 0x60, 0x49, 0x61, 0x17, 0x3c, 0x17, 0x4b, 0x7f, 0xc3, 0xf2, 0x95, 0x48, 0xbc, 0xa9, 0x9f,
+    0xb1, 0x28, 0x12, 0xc9, 0x0a, 0x9e, 0x16, 0x2c, 0xbc, 0x5d, 0xe5, 0x69, 0x95, 0x44, 0xde, 0x0b,
+    0xc7, 0xc5, 0x8f, 0x1f, 0xa6, 0x71, 0x9a, 0x7b, 0x2f, 0xf8, 0x14, 0x3f, 0x7e, 0x24, 0x8a, 0x2c,
+    0x66, 0xb5, 0xb7, 0x8c, 0xf9, 0xce, 0xc7, 0x2f, 0x3b, 0x12, 0x39, 0x0f, 0x51, 0x67, 0x0f, 0x28,
+    0xab, 0x4d, 0xe2, 0xff, 0x59, 0x15, 0xa5, 0x58, 0xd6, 0xb6, 0x02, 0xc9, 0x43, 0xab, 0x78, 0xee,
+    0xb3, 0x58, 0xac, 0x12, 0x5b, 0x80, 0x56, 0x45, 0x33, 0xb4, 0xe6, 0x62, 0xb5, 0x2e, 0x3d, 0x67,
+    0x3a, 0xbd, 0x5b, 0x3f, 0x8c, 0x91, 0x9e, 0x89, 0x84, 0xe7, 0xf7, 0x25, 0xdf, 0x95, 0x36, 0xd1,
+    0x37, 0x94, 0x04, 0xad, 0x77, 0x39, 0xfd, 0x0a, 0x94, 0xde, 0x49, 0xa0, 0xbd, 0x8b, 0xe9, 0x34,
+    0xdb, 0x0d, 0x35, 0xe6, 0xf8, 0x69, 0xcd, 0x71, 0x69, 0x3e, 0xcd, 0x23, 0x9e, 0xdb, 0x39, 0x8b,
+    0x44, 0x55, 0x78, 0x8e, 0x4b, 0x43, 0x3b, 0xbb, 0x58, 0xb3, 0x28, 0xdd, 0x7a, 0x40, 0xa1, 0x9d,
+    0xc1, 0x9f, 0x83, 0x0f, 0xf9, 0x6a, 0xc1, 0x8c, 0xa9, 0x45, 0x9f, 0xf1, 0xa9, 0xf9, 0xb0, 0x76,
+    0x24, 0xc6, 0x85, 0xf8, 0x8b, 0x7b, 0x2e, 0x90, 0xf9, 0xf4, 0xba, 0x95, 0x5a, 0x9f, 0x4f, 0xa7,
+    0x0a, 0x41, 0x1b, 0x80, 0x2d, 0xd3, 0x8d, 0x87, 0x42, 0xc0, 0x0c, 0xf0, 0xa0, 0xd2, 0xee, 0x8c,
+    0x91, 0xca, 0x82, 0x8d, 0x5f, 0x35, 0xf6, 0x9e, 0x83, 0xb9, 0x0d, 0xf8, 0xa8, 0xa3, 0x36, 0x3d,
+    0xe0, 0xd2, 0x42, 0x96, 0xdc, 0xb1, 0xe2, 0x08, 0x33, 0x3d, 0x37, 0xbb, 0xb0, 0x88, 0xd3, 0xf0,
+    0xf6, 0x61, 0x5c, 0xc4, 0x02, 0x6d, 0xec, 0xd6, 0x7c, 0xc6, 0x2e, 0x1d, 0xd9, 0x8e, 0xde, 0x62,
+    0xca, 0xb0, 0x32, 0xcd, 0x48, 0xc3, 0x66, 0x89, 0xfb, 0x06, 0xf9, 0xfe, 0x3e, 0xcc, 0x68, 0x1f,
+    0x94, 0x7a, 0x17, 0xc3, 0x2d, 0x01, 0xcf, 0xe7, 0x2c, 0xb7, 0x57, 0x08, 0x3f, 0x2c, 0x62, 0x9c,
+    0xcd, 0x22, 0xbe, 0xb2, 0x5e, 0x9c, 0x9e, 0x5d, 0x5e, 0x44, 0x0b, 0xeb, 0xc5, 0xe5, 0x62, 0x76,
+    0xb9, 0x38, 0x37, 0xf7, 0x36, 0x09, 0x91, 0x4e, 0xab, 0x12, 0x79, 0xbd, 0x24, 0x4d, 0xb8, 0x0f,
+    0x41, 0x91, 0x14, 0x82, 0xb4, 0x87, 0x8d, 0x29, 0x1a, 0xec, 0x1c, 0x85, 0x9d, 0xd4, 0xcd, 0x5b,
+    0xa7, 0x77, 0xe8, 0x3b, 0x48, 0xbb, 0x4c, 0xf3, 0x8d, 0x47, 0xf1, 0x67, 0x38, 0xe3, 0xe9, 0xcc,
+    0x7c, 0x18, 0xc7, 0x6c, 0xc1, 0xe3, 0xde, 0x76, 0x3a, 0x17, 0x7b, 0xdb, 0x79, 0x06, 0xdb, 0x79,
+    0xe8, 0x77, 0xca, 0xf9, 0xc3, 0x30, 0xec, 0x43, 0x32, 0x43, 0x44, 0x16, 0x65, 0x72, 0xff, 0x79,
+    0x4b, 0x1d, 0xb6, 0x08, 0x2f, 0x43, 0xf8, 0x3d, 0x67, 0xd3, 0x8b, 0x99, 0xa9, 0x04, 0x6e, 0xd7,
+    0x00, 0x7c, 0xeb, 0xa7, 0xe8, 0x94, 0x1a, 0xf9, 0xd7, 0x10, 0x07, 0x54, 0x31, 0xac, 0xf2, 0x02,
+    0x18, 0xb2, 0x54, 0x90, 0x3e, 0x92, 0x40, 0xa2, 0xd2, 0x33, 0xe6, 0x1c, 0x28, 0x7b, 0x20, 0xb1,
+    0x38, 0xd6, 0x7a, 0x40, 0xb5, 0xdb, 0x38, 0xf4, 0x9b, 0x66, 0x36, 0xe6, 0xcb, 0xd2, 0x63, 0x55,
+    0x99, 0x36, 0x03, 0x39, 0x01, 0x82, 0x23, 0x64, 0xa5, 0x02, 0xf6, 0x19, 0xb6, 0x92, 0x8d, 0x8d,
+    0xcd, 0xa6, 0xff, 0xc8, 0x56, 0xac, 0x41, 0x7c, 0x8c, 0x4b, 0xdc, 0x2b, 0x74, 0x97, 0xa7, 0x97,
+    0x21, 0x24, 0x9a, 0x27, 0x62, 0x6d, 0x91, 0xc6, 0xd1, 0x30, 0x62, 0x3a, 0xf0, 0xf6, 0x92, 0x00,
+    0x05, 0xb1, 0x7b, 0x76, 0x6a, 0x39, 0xb3, 0x73, 0xcb, 0xb9, 0x80, 0x48, 0x76, 0xcc, 0x43, 0x5c,
+    0xc1, 0x21, 0x52, 0xd6, 0x39, 0xf4, 0xac, 0xe7, 0xc1, 0xb3, 0x2e, 0x6b, 0x78, 0x80, 0xab, 0x56,
+    0xa4, 0xe0, 0x5e, 0xda, 0x8b, 0x28, 0x8a, 0x1a, 0x31, 0x08, 0x67, 0x6f, 0x46, 0x3a, 0xf3, 0xde,
+    0x1a, 0x33, 0x08, 0x11, 0x96, 0x88, 0x0d, 0x65, 0x73, 0xaf, 0xc8, 0x44, 0xa2, 0x39, 0xe3, 0x59,
+    0xa1, 0x49, 0xe8, 0xa0, 0x46, 0x2c, 0xb1, 0x4c, 0xf0, 0x81, 0x51, 0x84, 0xf8, 0xb7, 0xb7, 0xbc,
+    0x5e, 0xe6, 0x50, 0x6f, 0x0a, 0x0d, 0xb9, 0xee, 0xa7, 0x5f, 0xf5, 0x5c, 0x3a, 0x4f, 0x4b, 0x56,
+    0x72, 0x63, 0x0a, 0x70, 0x9b, 0x0f, 0x18, 0xa8, 0x87, 0x73, 0xa7, 0xe7, 0x72, 0x56, 0xe6, 0xd3,
+    0x3c, 0x8d, 0x07, 0x49, 0x64, 0x3f, 0x7b, 0xee, 0x2f, 0xdf, 0xc1, 0x3a, 0xdb, 0xcb, 0xad, 0x2e,
+    0xc3, 0xcf, 0x11, 0x0f, 0xa5, 0x6c, 0x2a, 0xfe, 0x42, 0x26, 0x35, 0x09, 0x23, 0x0f, 0xa8, 0xd2,
+    0x7d, 0x53, 0x60, 0x1e, 0xe6, 0x13, 0x59, 0xbc, 0xe6, 0x13, 0x59, 0x6a, 0xb1, 0x7e, 0x5d, 0xcd,
+    0x23, 0x71, 0xa7, 0x85, 0x31, 0x2b, 0x8a, 0x60, 0xd4, 0xa6, 0xae, 0xd1, 0x60, 0x58, 0x6e, 0xd2,
+    0x48, 0x13, 0x51, 0xfb, 0x0c, 0x32, 0x80, 0xe0, 0x80, 0x19, 0xdc, 0x50, 0x92, 0x6d, 0x40, 0xcc,
+    0xeb, 0x66, 0x80, 0x56, 0x85, 0x4a, 0xab, 0xdc, 0x5e, 0xa3, 0xb8, 0x01, 0x11, 0x6b, 0xe7, 0x89,
+    0x72, 0x0b, 0x93, 0x24, 0x1d, 0xa5, 0x85, 0x7d, 0xaa, 0x9f, 0x30, 0x87, 0x8c, 0x9a, 0x55, 0x5b,
+    0x37, 0x1e, 0x0d, 0x65, 0x79, 0x9a, 0xdd, 0x53, 0x11, 0x85, 0xb0, 0x9c, 0xb3, 0x21, 0x2f, 0x65,
+    0xa3, 0xd1, 0xd5, 0x77, 0x30, 0x31, 0x24, 0x6f, 0x2c, 0x1a, 0x56, 0x03, 0xd0, 0x58, 0xd6, 0x03,
+    0xa9, 0x13, 0x4e, 0x22, 0x0e, 0x72, 0xec, 0x11, 0x40, 0x70, 0xe7, 0x81, 0x08, 0xf7, 0x81, 0xb8,
+    0x64, 0x92, 0x7c, 0x07, 0xaf, 0x43, 0x88, 0xf7, 0x6b, 0x07, 0xcc, 0x8a, 0x24, 0xab, 0xca, 0x1e,
+    0x93, 0x33, 0x52, 0x07, 0xa0, 0xf6, 0xb5, 0xac, 0x33, 0x78, 0x05, 0xd7, 0x5b, 0xf1, 0xd1, 0x50,
+    0xd0, 0xa8, 0x33, 0x9b, 0x8c, 0x74, 0xf6, 0x6d, 0xfe, 0x9d, 0xdd, 0xf1, 0xa4, 0xda, 0x2c, 0xa0,
+    0xc6, 0x39, 0x9d, 0xed, 0x07, 0x26, 0x3c, 0x43, 0x2d, 0x77, 0xa8, 0x96, 0xfb, 0x4f, 0xd4, 0x72,
+    0x9f, 0x50, 0xcb, 0xdd, 0x57, 0x6b, 0x51, 0x41, 0x79, 0x4f, 0x94, 0xf4, 0xa2, 0x5a, 0x6c, 0x44,
+    0xd9, 0xb2, 0x43, 0x7e, 0x1c, 0x5d, 0xfd, 0x96, 0xc1, 0x59, 0x8e, 0x6b, 0xff, 0xce, 0x59, 0xb6,
+    0x9e, 0x4f, 0x24, 0x39, 0x30, 0x23, 0xf6, 0x57, 0x03, 0x49, 0xf2, 0xbb, 0x08, 0x73, 0x91, 0x95,
+    0x57, 0x7a, 0x55, 0x70, 0xf0, 0xd0, 0x5c, 0x84, 0xa5, 0xee, 0x9f, 0x80, 0xa5, 0x45, 0xa9, 0x7d,
+    0x19, 0x18, 0x22, 0x32, 0x83, 0xab, 0x28, 0x0d, 0xab, 0x0d, 0xb8, 0xd4, 0x78, 0xc5, 0xcb, 0xb7,
+    0x31, 0xc7, 0xc7, 0xef, 0xeb, 0xf7, 0x11, 0x4e, 0xfa, 0x27, 0x31, 0x2f, 0x81, 0x0f, 0x56, 0x0c,
+    0x92, 0x2a, 0x8e, 0xe5, 0x3b, 0x4f, 0xee, 0x78, 0x9c, 0x82, 0x82, 0x09, 0xdf, 0x6a, 0xef, 0x20,
+    0x56, 0xca, 0x53, 0xf7, 0xbb, 0x3c, 0x67, 0xb5, 0x31, 0x55, 0x1c, 0x3c, 0x82, 0xe2, 0x90, 0xac,
+    0x82, 0x25, 0x8b, 0x0b, 0xee, 0x9f, 0x2c, 0xab, 0x84, 0xce, 0x03, 0x5a, 0x02, 0x47, 0xd7, 0xeb,
+    0x92, 0x67, 0x06, 0xe1, 0x66, 0x85, 0x10, 0xee, 0xa5, 0x79, 0xaf, 0xf4, 0xc9, 0xd9, 0x36, 0xa0,
+    0x71, 0x6d, 0xa2, 0xd1, 0x4c, 0xa3, 0xe8, 0x86, 0xad, 0x20, 0x7f, 0x55, 0x11, 0x0f, 0x7e, 0x66,
+    0xe5, 0x7a, 0x9c, 0xa5, 0x5b, 0xc3, 0x99, 0x5a, 0xf4, 0xbc, 0x8c, 0xd3, 0x34, 0x37, 0xe8, 0x31,
+    0x4e, 0x57, 0xce, 0x14, 0x04, 0x6f, 0x4d, 0xd3, 0x6c, 0x38, 0x13, 0x10, 0xb8, 0x05, 0x71, 0xad,
+    0x04, 0xff, 0x24, 0xe7, 0x65, 0x95, 0x27, 0xdd, 0x88, 0xf6, 0x8d, 0x91, 0xcc, 0x21, 0x5d, 0xbe,
+    0x72, 0xbc, 0x64, 0x7e, 0xfa, 0xca, 0x85, 0xef, 0x7f, 0xbd, 0x9a, 0x41, 0x06, 0x03, 0x21, 0x0f,
+    0x9d, 0xe6, 0x88, 0x2f, 0x2b, 0x6f, 0x44, 0x78, 0x6b, 0xdc, 0xb1, 0xb8, 0xe2, 0x16, 0x1c, 0x79,
+    0x33, 0x50, 0x5d, 0x89, 0xa3, 0xb1, 0x71, 0x99, 0xbe, 0x13, 0x3b, 0x1e, 0x49, 0x7d, 0x20, 0xfd,
+    0xc1, 0x01, 0xcf, 0x3e, 0xae, 0x26, 0x71, 0x93, 0xa2, 0xbd, 0x35, 0x22, 0x50, 0xf6, 0x35, 0x06,
+    0x9c, 0xd1, 0x62, 0x22, 0xc3, 0x2e, 0xf8, 0xd2, 0xd0, 0x29, 0x12, 0xf5, 0xd6, 0x32, 0x8a, 0xff,
+    0x60, 0x2b, 0x12, 0x38, 0x59, 0x8e, 0x65, 0x4f, 0xf0, 0x11, 0xd6, 0x8e, 0x7f, 0xc5, 0xf1, 0xbf,
+    0xff, 0x76, 0x1a, 0x3a, 0xd9, 0x34, 0x48, 0x31, 0xe3, 0x30, 0xc6, 0x12, 0xfa, 0x3b, 0x0e, 0x35,
+    0xf3, 0xb2, 0x10, 0x0d, 0x09, 0x7e, 0xa0, 0x31, 0xa0, 0x90, 0x83, 0x52, 0x04, 0x7d, 0x6b, 0xdf,
+    0xc8, 0x85, 0xdb, 0x39, 0xc5, 0x2e, 0x7f, 0x7a, 0xb3, 0x24, 0x7b, 0xd5, 0x88, 0x05, 0xc7, 0xa2,
+    0x34, 0xb9, 0x2b, 0x0d, 0xdd, 0x8d, 0xd0, 0x88, 0xd5, 0x18, 0x1a, 0x9f, 0x9b, 0xa6, 0x9e, 0x18,
+    0xc4, 0x46, 0x87, 0xe1, 0xf6, 0x89, 0x88, 0xc2, 0x18, 0x0a, 0xd8, 0xaf, 0x70, 0x98, 0xa4, 0xa3,
+    0xb2, 0xec, 0x79, 0xe4, 0x5a, 0x2d, 0x10, 0xf2, 0x88, 0x59, 0x04, 0x8d, 0x53, 0x8e, 0x63, 0x9e,
+    0xac, 0x40, 0xd3, 0x89, 0x76, 0xea, 0x9f, 0x88, 0xa5, 0xa1, 0xe6, 0xe7, 0x4e, 0xbb, 0x59, 0x88,
+    0x39, 0x3a, 0xe9, 0xee, 0x67, 0x91, 0x04, 0xef, 0x65, 0x71, 0xac, 0xad, 0xdd, 0xcf, 0x6c, 0x17,
+    0xd8, 0xed, 0x6b, 0x3d, 0x98, 0xac, 0x07, 0x93, 0xe0, 0xd0, 0xb0, 0x9b, 0x28, 0x42, 0x04, 0x53,
+    0x5f, 0xcc, 0xf7, 0x96, 0xf6, 0x85, 0xf6, 0x32, 0x38, 0x85, 0xe5, 0x68, 0x01, 0xe9, 0x0b, 0x22,
+    0x31, 0xf0, 0xcd, 0x6a, 0x48, 0xff, 0x10, 0x9f, 0xc0, 0x02, 0x5a, 0xb3, 0x75, 0x16, 0x7c, 0xdb,
+    0x23, 0xa8, 0x07, 0x12, 0xea, 0xa1, 0x04, 0xed, 0xa5, 0xe6, 0x48, 0xa2, 0xbe, 0x94, 0x7a, 0x28,
+    0x05, 0x88, 0xdc, 0x4f, 0xe4, 0x66, 0x80, 0x05, 0xad, 0x17, 0x04, 0xa8, 0x09, 0xa9, 0x07, 0x6f,
+    0xf8, 0x8c, 0x82, 0x14, 0x45, 0x2d, 0x29, 0x6a, 0x49, 0x41, 0x6f, 0x75, 0x8f, 0x42, 0x42, 0x8e,
+    0x87, 0xb8, 0xe0, 0x1c, 0xf6, 0x8a, 0xf6, 0xde, 0x71, 0x2d, 0x38, 0xa4, 0xe0, 0x8f, 0x6c, 0x4d,
+    0x82, 0xb3, 0xb3, 0x66, 0x6f, 0xb2, 0x38, 0x95, 0xde, 0xa6, 0xbc, 0xc7, 0x26, 0x56, 0xf8, 0xc9,
+    0x95, 0x83, 0xb5, 0x54, 0x3f, 0x0c, 0xfc, 0xc8, 0xd6, 0x40, 0x22, 0x7c, 0x4b, 0x81, 0x0d, 0x5d,
+    0xb1, 0x0b, 0x8c, 0x1d, 0xe4, 0x2b, 0x92, 0xf1, 0xd2, 0xd8, 0x01, 0x01, 0x59, 0x32, 0x21, 0xbb,
+    0x9a, 0xb7, 0x6f, 0xba, 0x55, 0x5b, 0xc6, 0x3a, 0x30, 0x6a, 0x60, 0x44, 0xa1, 0x2f, 0x0d, 0x47,
+    0xb3, 0x8d, 0x1a, 0xa8, 0x6b, 0xc9, 0x5b, 0x4b, 0x5e, 0x7a, 0x53, 0xcc, 0x8d, 0xff, 0xaf, 0xc6,
+    0x78, 0x2e, 0x0c, 0x74, 0x3a, 0x33, 0x77, 0xbd, 0xac, 0x4e, 0x33, 0x22, 0x8e, 0xaf, 0xa9, 0xe2,
+    0xeb, 0xaa, 0x5d, 0xa5, 0x61, 0x48, 0xb1, 0xe9, 0x2d, 0x57, 0x13, 0xf2, 0x78, 0x38, 0x9b, 0x59,
+    0x5a, 0xf7, 0x85, 0x47, 0x44, 0xa2, 0xc4, 0xc3, 0x99, 0xc4, 0xc6, 0xc1, 0x57, 0x0c, 0x8e, 0xef,
+    0xb0, 0x1b, 0x08, 0x74, 0xd9, 0x0e, 0xe8, 0xcd, 0xe8, 0xf7, 0xac, 0xe0, 0x48, 0x1c, 0xe8, 0xa0,
+    0x7f, 0x9b, 0xbc, 0x77, 0x98, 0x46, 0x83, 0x36, 0x9f, 0xf6, 0x10, 0xb0, 0x5a, 0x57, 0x70, 0xfb,
+    0x39, 0xb2, 0x45, 0x05, 0x22, 0xe3, 0x72, 0x4a, 0xa9, 0xa7, 0xf1, 0x62, 0xe5, 0x3d, 0x21, 0x17,
+    0x31, 0x79, 0x29, 0x50, 0x90, 0x78, 0x80, 0x83, 0x7e, 0xfd, 0xdd, 0x3c, 0xc0, 0x05, 0xfc, 0x1d,
+    0x38, 0xb6, 0x9c, 0xb9, 0x07, 0xe5, 0x16, 0x1c, 0x0e, 0x5c, 0x1f, 0x81, 0xd3, 0xa0, 0x58, 0xdd,
+    0xc0, 0xc9, 0xfd, 0x26, 0x35, 0x0a, 0x70, 0x64, 0x13, 0x3d, 0xc2, 0x6c, 0xac, 0xec, 0x0f, 0x82,
+    0x23, 0x75, 0x08, 0x9b, 0x1d, 0x62, 0x52, 0x04, 0x82, 0x7a, 0x83, 0x59, 0xa2, 0x97, 0x6d, 0x77,
+    0x96, 0x5c, 0xd1, 0x3a, 0x2e, 0x03, 0x5e, 0xce, 0xc8, 0xbd, 0x07, 0x10, 0x92, 0x7f, 0x1d, 0x41,
+    0x70, 0x23, 0xa2, 0x28, 0xe6, 0x2d, 0x88, 0xf5, 0x10, 0xc4, 0x9e, 0x2b, 0x3c, 0x01, 0xa2, 0x5a,
+    0x77, 0xa2, 0xcd, 0x86, 0x28, 0xd6, 0x3d, 0x14, 0x6b, 0x89, 0x62, 0xad, 0x50, 0xa4, 0x5f, 0xbf,
+    0x9e, 0x07, 0xb8, 0x82, 0x5f, 0x03, 0x8a, 0xf5, 0x67, 0x50, 0x44, 0x1f, 0xb7, 0x8a, 0x1a, 0xdc,
+    0xb6, 0x0f, 0xa3, 0xf4, 0xfc, 0xce, 0xc1, 0x7b, 0x14, 0x9f, 0x83, 0x11, 0x72, 0x98, 0x84, 0x51,
+    0x45, 0xe0, 0x79, 0xcb, 0xfb, 0xf0, 0x4c, 0xef, 0x93, 0xc1, 0xa8, 0x0f, 0x16, 0xd0, 0xbb, 0xa3,
+    0x8c, 0x6e, 0xed, 0x6b, 0x07, 0x00, 0xb8, 0x5d, 0xb6, 0x06, 0x15, 0x81, 0x56, 0x2a, 0x48, 0x8d,
+    0x44, 0x8c, 0x1d, 0x84, 0x4c, 0x1e, 0xc3, 0x1d, 0x05, 0x36, 0xa2, 0x52, 0x4d, 0x86, 0xac, 0xa0,
+    0x1f, 0xdf, 0xb7, 0xe3, 0x8f, 0x6c, 0x69, 0x5f, 0xad, 0xf7, 0x78, 0x26, 0x87, 0x06, 0xb5, 0xd6,
+    0xdb, 0x52, 0x92, 0xf3, 0x02, 0x4e, 0xdc, 0xa4, 0x80, 0xca, 0x62, 0xe9, 0x96, 0xe7, 0xc1, 0x2f,
+    0xa4, 0xbc, 0x01, 0x05, 0x56, 0x1d, 0x38, 0x75, 0x73, 0x4c, 0xc5, 0xbc, 0xa5, 0xab, 0xb2, 0xec,
+    0x08, 0x9d, 0x7b, 0x40, 0xc7, 0x02, 0xf0, 0xd0, 0x5e, 0x32, 0x6f, 0x9d, 0x88, 0x72, 0x3f, 0x24,
+    0x65, 0x5a, 0xb0, 0x77, 0x38, 0x59, 0x7c, 0x8e, 0x81, 0x56, 0x36, 0x4d, 0x73, 0x2f, 0xdf, 0xb4,
+    0x5d, 0xa7, 0x86, 0x6d, 0xa7, 0x06, 0x7d, 0x27, 0x64, 0x15, 0xd7, 0x6c, 0x21, 0xa0, 0x7a, 0xd9,
+    0x4a, 0x62, 0xd6, 0x82, 0xa2, 0x46, 0xca, 0x66, 0x8b, 0xc2, 0x58, 0xc0, 0xf6, 0x33, 0xd3, 0xda,
+    0x8b, 0xc3, 0x47, 0xa3, 0xb9, 0xad, 0x25, 0xd3, 0x4f, 0x47, 0x43, 0xf8, 0x79, 0xb5, 0xb0, 0x9f,
+    0x0a, 0xfa, 0x35, 0x0e, 0xdd, 0x70, 0xbf, 0x5a, 0x29, 0xa7, 0x3c, 0xc2, 0xb0, 0x5f, 0xe4, 0x6d,
+    0xed, 0xf4, 0xd3, 0x23, 0x79, 0x25, 0x8c, 0xd3, 0x82, 0x77, 0xf6, 0xec, 0xe3, 0x37, 0x73, 0x11,
+    0x3e, 0xf8, 0x72, 0x9d, 0xcb, 0x3d, 0xfc, 0x8c, 0x43, 0x3c, 0xfe, 0xcf, 0x36, 0x3a, 0x9f, 0xcc,
+    0xbd, 0xec, 0xf8, 0x4c, 0x48, 0x0e, 0xcb, 0xcb, 0xd0, 0x8e, 0x83, 0xda, 0xe2, 0x0e, 0x73, 0x43,
+    0xef, 0xb0, 0x59, 0x51, 0x1f, 0x41, 0xad, 0x62, 0xd1, 0x9d, 0x37, 0x55, 0x10, 0x04, 0xfd, 0x78,
+    0xf0, 0x07, 0x73, 0x6e, 0xd0, 0x8f, 0x01, 0x3a, 0x62, 0x65, 0x78, 0x8d, 0x0d, 0x21, 0x67, 0x28,
+    0x16, 0x15, 0x18, 0x57, 0xc1, 0xde, 0x84, 0xab, 0x26, 0x60, 0xb5, 0x7f, 0xc4, 0x05, 0xe1, 0x61,
+    0xda, 0x1a, 0x1e, 0xe0, 0x06, 0xa4, 0x8f, 0x11, 0x82, 0xcd, 0x0f, 0x60, 0x14, 0x6f, 0xc8, 0xdd,
+    0xe3, 0xe4, 0xcd, 0x82, 0xea, 0x68, 0xf3, 0x70, 0x02, 0x76, 0xc9, 0x36, 0x12, 0x42, 0x1b, 0x73,
+    0x8c, 0xea, 0xec, 0x03, 0x7d, 0xd8, 0x46, 0xea, 0xb0, 0x23, 0x03, 0x09, 0x7e, 0xcb, 0xe9, 0x3e,
+    0xc1, 0xe9, 0xf6, 0x39, 0xdd, 0x86, 0xf3, 0xa0, 0xc3, 0xf8, 0x0f, 0x8e, 0xcb, 0x16, 0xa3, 0x3d,
+    0xb0, 0xca, 0x57, 0x38, 0x96, 0x61, 0x0b, 0x66, 0xbe, 0xd2, 0x6d, 0xdd, 0x1b, 0xf6, 0x1b, 0xee,
+    0x70, 0x6b, 0x8b, 0x75, 0xba, 0xbd, 0xa6, 0xdc, 0x99, 0xf3, 0x2c, 0xae, 0x11, 0x37, 0xea, 0xe0,
+    0xe8, 0x8d, 0xb4, 0x3d, 0xbc, 0x6a, 0xd8, 0xd7, 0x7c, 0xef, 0x9a, 0x01, 0x55, 0xef, 0x2b, 0x48,
+    0x02, 0xc7, 0x03, 0x31, 0x26, 0x49, 0x6e, 0xef, 0x1f, 0xf6, 0x05, 0xca, 0xfb, 0x87, 0xe3, 0x72,
+    0x90, 0x49, 0xba, 0xd2, 0x17, 0xaa, 0x73, 0x04, 0x9d, 0x31, 0xe6, 0xa4, 0xe3, 0x89, 0x48, 0x4b,
+    0x97, 0x7f, 0xb4, 0x0e, 0x69, 0xb5, 0xee, 0xf7, 0x09, 0xc8, 0xbe, 0xc4, 0x3e, 0x15, 0x33, 0x5d,
+    0x20, 0x65, 0xc1, 0x93, 0xdf, 0x0c, 0xc2, 0xe9, 0x55, 0x0d, 0x42, 0xd9, 0x95, 0x3b, 0xbc, 0x97,
+    0xe5, 0xd5, 0x3c, 0xa5, 0x66, 0xff, 0xe4, 0x30, 0xbb, 0xab, 0x79, 0xca, 0xc4, 0x28, 0x61, 0x18,
+    0x35, 0xfe, 0x49, 0xaf, 0x65, 0xc3, 0x69, 0x56, 0xd4, 0x49, 0xa8, 0x75, 0x5b, 0xca, 0xcb, 0x70,
+    0xfd, 0x63, 0x91, 0x26, 0x46, 0x95, 0xc7, 0x56, 0x9a, 0xe1, 0x60, 0xd1, 0xf5, 0xbb, 0xb8, 0x1d,
+    0x01, 0xdb, 0x32, 0x51, 0x4a, 0xca, 0x01, 0x95, 0x84, 0x83, 0x68, 0xc6, 0xe9, 0x2d, 0x30, 0x95,
+    0xeb, 0x3c, 0xdd, 0x6a, 0xd8, 0x72, 0xbf, 0xcd, 0x73, 0xc0, 0x06, 0x88, 0x01, 0x4c, 0x5d, 0x62,
+    0x2a, 0xe9, 0x50, 0xd9, 0xaa, 0x20, 0x4d, 0x54, 0x5f, 0x2a, 0xc7, 0xff, 0x44, 0x15, 0x1e, 0x55,
+    0xf0, 0xad, 0xca, 0x35, 0x5d, 0x16, 0x90, 0x1d, 0x5f, 0x5b, 0x9a, 0x1c, 0x59, 0x3b, 0xe8, 0x72,
+    0xce, 0xe8, 0x5a, 0xd1, 0x7e, 0x3b, 0x09, 0x5d, 0xf4, 0xe3, 0xbd, 0x68, 0xaf, 0xe6, 0x1d, 0xda,
+    0xac, 0x4f, 0x58, 0x26, 0x26, 0x45, 0x06, 0x45, 0x2b, 0xaf, 0x36, 0xaf, 0xa4, 0x73, 0x04, 0xcb,
+    0x53, 0xf7, 0x6b, 0xa9, 0x05, 0x5a, 0x47, 0x4f, 0x9f, 0x47, 0x64, 0x28, 0xea, 0x69, 0x60, 0x0e,
+    0xae, 0x2e, 0xa4, 0x4e, 0x92, 0x9c, 0xe1, 0xc8, 0xf7, 0xd5, 0x72, 0x09, 0x15, 0xdf, 0x3c, 0x86,
+    0x1b, 0x45, 0x98, 0x5a, 0x07, 0x61, 0x6b, 0x6f, 0x44, 0x7a, 0x96, 0x75, 0xb0, 0x1e, 0xb8, 0x49,
+    0x2b, 0x27, 0x16, 0x05, 0x44, 0x47, 0x07, 0x3c, 0x87, 0x74, 0x51, 0x16, 0x74, 0xaf, 0xf2, 0x16,
+    0x1f, 0xaf, 0xd3, 0x2a, 0x0f, 0xb9, 0x32, 0x4c, 0x4e, 0x62, 0xce, 0x95, 0x4f, 0x63, 0x16, 0x45,
+    0x44, 0xf5, 0x13, 0x49, 0x01, 0x5d, 0x75, 0xf2, 0x56, 0xdd, 0x32, 0x88, 0x00, 0x3a, 0x9e, 0x2e,
+    0x13, 0xfc, 0x78, 0xfd, 0xe1, 0x97, 0x31, 0x65, 0x40, 0x39, 0x39, 0xc6, 0xff, 0x08, 0xd2, 0xc6,
+    0x3c, 0x2e, 0x4c, 0x19, 0x08, 0xf2, 0x1a, 0x51, 0xad, 0xc9, 0x1d, 0x5f, 0x0a, 0xb4, 0x00, 0x7e,
+    0x80, 0x34, 0x94, 0xd7, 0xd5, 0x38, 0x84, 0x74, 0x54, 0xd3, 0xda, 0x90, 0xb8, 0x7a, 0xc6, 0x8c,
+    0x5f, 0xff, 0xf4, 0xe1, 0xfa, 0xed, 0x1b, 0x4c, 0x4a, 0x1c, 0x8e, 0xa6, 0x1b, 0x9e, 0x56, 0xa5,
+    0x21, 0x71, 0xb0, 0x66, 0xd3, 0xa9, 0xbc, 0x76, 0x79, 0x38, 0x82, 0x39, 0xde, 0xc9, 0x1a, 0x8f,
+    0x07, 0x0f, 0x85, 0x99, 0xf2, 0x00, 0x42, 0x41, 0xe6, 0x23, 0x79, 0x93, 0x0b, 0xce, 0x4a, 0xd7,
+    0xb3, 0x63, 0x75, 0x3b, 0x1b, 0xe8, 0x78, 0x3b, 0xab, 0x13, 0x45, 0xef, 0x12, 0xf7, 0x90, 0x8c,
+    0xfe, 0x79, 0x01, 0x74, 0xfb, 0x29, 0xd5, 0x3f, 0x69, 0xb6, 0x8e, 0xf6, 0xf3, 0x9f, 0xa4, 0xaa,
+    0x43, 0xa0, 0xe9, 0xb2, 0x51, 0xa2, 0x0c, 0xae, 0xa4, 0xae, 0xce, 0x00, 0x67, 0xa8, 0x0f, 0x4f,
+    0xe7, 0x1b, 0x73, 0x90, 0xd4, 0xf0, 0xbe, 0x55, 0x3f, 0x26, 0x5f, 0x5e, 0x23, 0xea, 0x16, 0x01,
+    0xda, 0xfa, 0xc6, 0xbd, 0xdc, 0xc1, 0x71, 0x96, 0xd3, 0xef, 0x1b, 0xbe, 0x64, 0x55, 0x5c, 0x76,
+    0xe7, 0x63, 0xbc, 0x37, 0x0f, 0x1a, 0x4b, 0x28, 0x0c, 0x0f, 0xd3, 0x27, 0x26, 0xa0, 0xaf, 0x9b,
+    0x73, 0xc1, 0x80, 0xa4, 0xcd, 0xa0, 0xfe, 0x33, 0x36, 0x2c, 0x16, 0xa0, 0x5f, 0xa1, 0x5b, 0xf7,
+    0x27, 0x1b, 0x5e, 0xae, 0xd3, 0xc8, 0xd3, 0x3f, 0x7e, 0xb8, 0xbe, 0xd1, 0xad, 0x13, 0xbc, 0xc1,
+    0xe7, 0x79, 0xe1, 0xdd, 0xeb, 0x6a, 0x87, 0xec, 0x9b, 0x3a, 0xe3, 0xba, 0xa7, 0xe3, 0x3f, 0x9e,
+    0x45, 0x48, 0x75, 0x67, 0xb2, 0xb3, 0xb7, 0xdb, 0xad, 0x8d, 0x89, 0xc3, 0x86, 0x9c, 0xc8, 0x93,
+    0x30, 0x8d, 0x78, 0xa4, 0x3f, 0x58, 0x27, 0x68, 0x81, 0x87, 0x5f, 0x16, 0x41, 0xb5, 0x77, 0x29,
+    0x79, 0xb8, 0xa5, 0x48, 0xa4, 0xb2, 0xd8, 0x21, 0x88, 0xd0, 0x3f, 0x88, 0xbf, 0x20, 0xb6, 0xda,
+    0x1d, 0x40, 0x1f, 0x20, 0x97, 0xf4, 0xe7, 0x13, 0x75, 0xcb, 0x3a, 0x9f, 0xc8, 0x7f, 0x36, 0x4c,
+    0xe8, 0x5f, 0xfd, 0xff, 0x03, 0xf5, 0xe4, 0xc5, 0xef, 0x00, 0x20, 0x00, 0x00,
+};